@@ -3,6 +3,7 @@
 #include "stdint.h"
 #include "mazeIR.h"
 #include <float.h>
+#include <math.h>
 
 #define AGENT_H
 
@@ -10,7 +11,38 @@ typedef MazeInternalRepr MazeEnv;
 typedef struct {int32_t dx; int32_t dy;} action_delta_t;
 typedef struct {int32_t x; int32_t y;} state_t;
 typedef float reward_t;
+
+/*
+    FIXED POINT TABLES (-DCQ_FIXED_POINT, make fixed=1)
+
+    q_val_t BECOMES A Q16.16 int32_t AND THE BACKUPS, THE DOUBLE Q MEAN AND
+    THE ARGMAX (SCALAR AND SSE2 BATCH) ARE INTEGER ONLY, SO ONE seed GIVES THE
+    SAME TABLE BIT FOR BIT WITH ANY COMPILER, -O LEVEL OR -march. THE FLOAT
+    HYPER PARAMETERS AND REWARDS ARE ROUNDED TO Q16.16 AT EACH USE, WHICH IS
+    EXACT AND THE SAME EVERYWHERE. EXPLORATION ALSO MOVES FROM rand() (ONE PER
+    C LIBRARY) TO THE AGENT RNG, AND agentEpsilonSchedule FROM libm exp() TO
+    AN INTEGER ONE.
+
+    RANGE IS +-32767 WITH A RESOLUTION OF 2^-16: ENOUGH FOR THE UNSCALED
+    REWARDS, THE SCALED ONES (opensCount*1.0) OVERFLOW ON BIG MAZES. PRODUCTS
+    AND SUMS SATURATE INSTEAD OF WRAPPING. AN UPDATE lr*td UNDER 2^-17 ROUNDS
+    TO 0, SO A VERY SMALL lr (< ~1e-3 WITH THE -.01 STEP REWARD) STALLS.
+
+    CODE OUTSIDE THE TABLE (OVERLAYS, PRIORITIES, LOSSES) GOES THROUGH
+    qvalToFloat/qvalFromFloat, WHICH ARE PLAIN CASTS IN THE FLOAT BUILD.
+    PRIORITIZED REPLAY SAMPLES AND WEIGHTS IN float (powf), SO ITS TABLES
+    ARE THE EXCEPTION: THE BACKUPS ARE Q16.16 BUT WHICH ONES RUN IS NOT.
+    .qtable FILES CARRY QTABLE_FIXED_FLAG AND EITHER BUILD READS BOTH KINDS.
+*/
+#ifdef CQ_FIXED_POINT
+typedef int32_t q_val_t;
+#define QVAL_FRAC_BITS 16
+#define QVAL_ONE       (1 << QVAL_FRAC_BITS)
+#define QVAL_LOWEST    INT32_MIN
+#else
 typedef reward_t q_val_t;
+#define QVAL_LOWEST    (-FLT_MAX)
+#endif
 typedef enum {
 	ACTION_LEFT,
 	ACTION_RIGHT,
@@ -29,21 +61,86 @@ typedef struct {
 	bool isGoal;
 } stepResult;
 
+typedef enum {
+	QTABLE_LAYOUT_ROW = 0,	// CELL (y*n_x + x), WHAT A ZEROED q_table_t IS
+	QTABLE_LAYOUT_TILED,	// 8x8 CELL TILES
+	QTABLE_LAYOUT_MORTON,	// Z-ORDER
+	QTABLE_LAYOUT_COUNT
+} qtable_layout_t;
+
 typedef struct {
 	size_t len_state_x;
 	size_t len_state_y;
 	size_t len_state_actions;
+	size_t n_tables;	// 2 FOR DOUBLE Q, 0 OR 1 FOR A SINGLE TABLE
 	q_val_t* vals;
+	bool borrowed;		// vals BELONGS TO AN ARENA OR POOL (agentArena.h), NEVER free() IT
+	qtable_layout_t layout;
+	uint8_t log_x;		// MORTON: log2 OF THE PADDED SIDES, SET BY qtableSetLayout
+	uint8_t log_y;
 } q_table_t;
 
-typedef struct {
+/*
+    TABLE LAYOUTS
+
+    A STATE'S ROW (OR ITS A/B PAIR) IS ONE SLOT, THE LAYOUT ONLY CHANGES WHICH
+    SLOT A CELL GETS. ROW MAJOR PUTS THE CELL ABOVE n_x SLOTS AWAY, SO EVERY
+    UP/DOWN MOVE IN A WIDE MAZE IS A NEW CACHE LINE.
+        TILED   8x8 CELL TILES, ROW MAJOR INSIDE A TILE AND BETWEEN TILES. A
+                VERTICAL NEIGHBOUR IS 8 SLOTS AWAY (128 BYTES FOR 4 FLOAT
+                ACTIONS) UNLESS IT IS ACROSS A TILE EDGE. EACH SIDE IS PADDED
+                TO A MULTIPLE OF 8.
+        MORTON  Z-ORDER: THE LOW BITS OF x AND y INTERLEAVED, THE EXTRA HIGH
+                BITS OF THE LONGER SIDE ON TOP. EVERY ALIGNED 2^k x 2^k
+                SQUARE IS CONTIGUOUS. EACH SIDE IS PADDED TO A POWER OF TWO
+                (UP TO 4x THE SLOTS FOR AN UNLUCKY SIZE, 1.64x FOR 400x400).
+    PADDING SLOTS ARE NEVER READ OR WRITTEN. qtableRow IS THE ONLY PLACE THAT
+    MAPS A CELL TO A SLOT; DYNA, SWEEP AND REPLAY KEEP THEIR OWN ROW MAJOR
+    CELL IDS AND GO THROUGH IT.
+
+    .qtable FILES ARE ALWAYS ROW MAJOR: agentSaveQtable WRITES THE ROWS IN
+    CELL ORDER, agentReadQtable CONVERTS TO THE LAYOUT THE AGENT HAD BEFORE
+    THE READ. agentSetQtableLayout CONVERTS A LIVE TABLE.
+*/
+#define QTABLE_TILE_SHIFT 3
+#define QTABLE_TILE_SIDE  (1u << QTABLE_TILE_SHIFT)
+
+/*
+    DOUBLE Q LAYOUT
+
+    THE A AND B ROWS OF A STATE ARE STORED NEXT TO EACH OTHER, SO ONE STATE
+    TAKES 2*n_actions VALUES (32 BYTES FOR 4 FLOAT ACTIONS) AND BOTH ROWS COME
+    IN WITH THE SAME CACHE LINE:
+        | A(s0) | B(s0) | A(s1) | B(s1) | ...
+
+    getQtableValue/qtableMaxValAction READ THE MEAN OF A AND B, SO ACTION
+    SELECTION AND THE VIEWERS SEE THE COMBINED TABLE.
+
+    .qtable HEADER: THE THIRD WORD IS n_actions | QTABLE_DOUBLE_FLAG FOR A
+    DOUBLE TABLE, THE VALUES FOLLOW IN THE INTERLEAVED ORDER ABOVE.
+*/
+// BUMP WHEN A CHANGE ALTERS WHAT TRAINING PRODUCES FOR THE SAME INPUTS, IT KEYS THE RESULT CACHE
+#define AGENT_ENGINE_VERSION 1
+
+#define QTABLE_DOUBLE_FLAG   (1ULL << 32)
+#define QTABLE_FIXED_FLAG    (1ULL << 33)
+#define QTABLE_ACTIONS_MASK  0xFFFFFFFFULL
+
+struct Agent;
+// PICKS THE STATE AN EPISODE STARTS FROM, ctx IS WHATEVER WAS GIVEN TO agentSetStartFn
+typedef state_t (*start_state_fn)(struct Agent* self, void* ctx);
+
+typedef struct Agent {
 	// MUTABLE STATE 
 	q_table_t q_table;
 	state_t current_s;
 	Action	policy_action;
 	float epsilon;
+	uint64_t rng_state;	// PER-AGENT RNG, USED BY PLANNING/SAMPLING CODE INSTEAD OF rand()
 	// STARTING PARAMETERS
 	state_t agent_start;
+	start_state_fn start_fn;	// NULL ALWAYS RESTARTS AT agent_start
+	void* start_ctx;
 	float accum_reward;
 	// HYPER PARAMETERS
 	float learning_rate;
@@ -92,20 +189,155 @@ typedef enum {
 state_t GetNextState(state_t s, Action a);
 
 Agent* newAgent(MazeEnv *env,float lr,float dr,double eps_decay, unsigned long seed);
+void agentInit(Agent* agent,MazeEnv* env,float lr,float dr,double eps_decay, unsigned long seed);
 void agentSetSeed(Agent* self,unsigned int seed);
+uint32_t agentRandU32(Agent* self);
+uint32_t agentRandRange(Agent* self,uint32_t n);
 void agentRestart(Agent* self);
+void agentSetStartFn(Agent* self,start_state_fn fn,void* ctx);
 void agentPolicy(Agent* self,MazeEnv* env);
 void agentUpdateState(Agent* a, state_t new_state);
 float agentQtableUpdate(Agent* self,state_t next,stepResult sr);
+float agentQtableUpdateAt(Agent* self,state_t s,Action a,state_t next,stepResult sr);
+int agentEnableDoubleQ(Agent* self);
+int agentEnableDoubleQIn(Agent* self,q_val_t* vals);
+int agentSetQtableLayout(Agent* self,qtable_layout_t layout);
+const char* qtableLayoutName(qtable_layout_t layout);
+int qtableParseLayout(const char* s,qtable_layout_t* out);
 void agentEpsilonDecay(Agent* self,decay_fn fn);
+float agentEpsilonSchedule(uint64_t env_steps,double eps_decay);
 int agentSaveQtable(Agent* agent,char* save_path);
 int agentReadQtable(Agent* agent, const char* load_path);
+void agentFreeQtable(Agent* agent);
 reward_t getCellReward(MazeEnv* env,GridCellType t, size_t wallsCount, size_t opensCount);
+reward_t getCellRewardUnscaled(MazeEnv* env,GridCellType t, size_t wallsCount, size_t opensCount);
 
 stepResult stepIntoState(MazeEnv* e,state_t s,size_t wallsCount, size_t opensCount);
+stepResult stepIntoStateUnscaled(MazeEnv* e,state_t s,size_t wallsCount, size_t opensCount);
 q_val_t getQtableValue(Agent* self,state_t s,Action a);
 void setQtableValue(Agent* self,state_t s,Action a, q_val_t q);
 ValAction qtableMaxValAction(Agent* a,state_t s);
+void qtableMaxValActionBatch(Agent* a,const state_t* s,size_t n,ValAction* out);
+
+#ifdef CQ_FIXED_POINT
+static inline q_val_t qvalSaturate(int64_t v){
+	return v > INT32_MAX ? INT32_MAX : v < INT32_MIN ? INT32_MIN : (q_val_t)v;
+}
+
+// ROUND HALF AWAY FROM ZERO, f*2^16 IS EXACT IN A double SO THIS IS TOO
+static inline q_val_t qvalFromFloat(float f){
+	double d = (double)f*QVAL_ONE;
+	if (d != d) return 0;
+	if (d >=  2147483647.0) return INT32_MAX;
+	if (d <= -2147483648.0) return INT32_MIN;
+	return qvalSaturate((int64_t)(d + (d >= 0.0 ? 0.5 : -0.5)));
+}
+
+static inline float qvalToFloat(q_val_t v){
+	return (float)v*(1.0f/QVAL_ONE);
+}
+
+static inline q_val_t qvalMul(q_val_t a,q_val_t b){
+	int64_t p = (int64_t)a*(int64_t)b;
+	return qvalSaturate((p + (1 << (QVAL_FRAC_BITS - 1))) >> QVAL_FRAC_BITS);
+}
+
+// floor((a+b)/2) WITHOUT OVERFLOW, THE SSE BATCH DOES THE SAME SHIFTS
+static inline q_val_t qvalMean(q_val_t a,q_val_t b){
+	return (a >> 1) + (b >> 1) + (a & b & 1);
+}
+
+static inline q_val_t qvalAbsDiff(q_val_t a,q_val_t b){
+	int64_t d = (int64_t)a - (int64_t)b;
+	return qvalSaturate(d < 0 ? -d : d);
+}
+#else
+static inline q_val_t qvalFromFloat(float f){ return f; }
+static inline float   qvalToFloat(q_val_t v){ return v; }
+static inline q_val_t qvalMean(q_val_t a,q_val_t b){ return 0.5f*(a + b); }
+static inline q_val_t qvalAbsDiff(q_val_t a,q_val_t b){ return a > b ? a - b : b - a; }
+#endif
+
+static inline size_t qtableCount(const q_table_t* t){
+	return t->n_tables == 2 ? 2 : 1;
+}
+
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+static inline uint8_t qtableLog2Ceil(size_t n){
+	uint8_t b = 0;
+	while (((size_t)1 << b) < n) b++;
+	return b;
+}
+
+// THE 32 LOW BITS OF v ON THE EVEN BITS, ONE pdep WITH BMI2 (-march=native)
+static inline uint64_t qtableSpreadBits(uint64_t v){
+#ifdef __BMI2__
+	return _pdep_u64(v,0x5555555555555555ULL);
+#endif
+	v &= 0xFFFFFFFFULL;
+	v = (v | (v << 16)) & 0x0000FFFF0000FFFFULL;
+	v = (v | (v << 8))  & 0x00FF00FF00FF00FFULL;
+	v = (v | (v << 4))  & 0x0F0F0F0F0F0F0F0FULL;
+	v = (v | (v << 2))  & 0x3333333333333333ULL;
+	v = (v | (v << 1))  & 0x5555555555555555ULL;
+	return v;
+}
+
+// SLOTS A n_x BY n_y TABLE TAKES IN layout, PADDING INCLUDED
+static inline size_t qtableSlots(size_t n_x,size_t n_y,qtable_layout_t layout){
+	switch (layout) {
+		case QTABLE_LAYOUT_TILED: {
+			size_t tx = (n_x + QTABLE_TILE_SIDE - 1) >> QTABLE_TILE_SHIFT;
+			size_t ty = (n_y + QTABLE_TILE_SIDE - 1) >> QTABLE_TILE_SHIFT;
+			return tx*ty*QTABLE_TILE_SIDE*QTABLE_TILE_SIDE;
+		}
+		case QTABLE_LAYOUT_MORTON:
+			return (size_t)1 << (qtableLog2Ceil(n_x) + qtableLog2Ceil(n_y));
+		default:
+			return n_x*n_y;
+	}
+}
+
+// VALUES OF THE WHOLE TABLE, EVERY TABLE AND THE PADDING INCLUDED
+static inline size_t qtableValCount(const q_table_t* t){
+	return qtableSlots(t->len_state_x,t->len_state_y,t->layout)*qtableCount(t)*t->len_state_actions;
+}
+
+// ONLY SETS THE FIELDS, vals MUST ALREADY BE IN layout (OR STILL ALL ZERO AND qtableValCount BIG)
+static inline void qtableSetLayout(q_table_t* t,qtable_layout_t layout){
+	t->layout = layout;
+	t->log_x = qtableLog2Ceil(t->len_state_x);
+	t->log_y = qtableLog2Ceil(t->len_state_y);
+}
+
+static inline size_t qtableSlot(const q_table_t* t,size_t x,size_t y){
+	switch (t->layout) {
+		case QTABLE_LAYOUT_TILED: {
+			size_t tiles_x = (t->len_state_x + QTABLE_TILE_SIDE - 1) >> QTABLE_TILE_SHIFT;
+			size_t tile = (y >> QTABLE_TILE_SHIFT)*tiles_x + (x >> QTABLE_TILE_SHIFT);
+			return (tile << (2*QTABLE_TILE_SHIFT)) +
+			       ((y & (QTABLE_TILE_SIDE - 1)) << QTABLE_TILE_SHIFT) + (x & (QTABLE_TILE_SIDE - 1));
+		}
+		case QTABLE_LAYOUT_MORTON: {
+			unsigned k = t->log_x < t->log_y ? t->log_x : t->log_y;
+			size_t low_mask = ((size_t)1 << k) - 1;
+			size_t z = (size_t)(qtableSpreadBits(x & low_mask) | (qtableSpreadBits(y & low_mask) << 1));
+			return z | ((t->log_x > t->log_y ? x >> k : y >> k) << (2*k));
+		}
+		default:
+			return y*t->len_state_x + x;
+	}
+}
+
+// FIRST ACTION OF ROW `table` (0 = A, 1 = B) FOR STATE s, NULL OUTSIDE THE GRID
+static inline q_val_t* qtableRow(q_table_t* t,state_t s,size_t table){
+	if (s.x < 0 || s.y < 0 || (size_t)s.x >= t->len_state_x || (size_t)s.y >= t->len_state_y) return NULL;
+	size_t slot = qtableSlot(t,(size_t)s.x,(size_t)s.y);
+	return t->vals + (slot*qtableCount(t) + table)*t->len_state_actions;
+}
 
 #endif
 
@@ -168,6 +400,27 @@ stepResult stepIntoStateUnscaled(MazeEnv* e,state_t s,size_t wallsCount, size_t
 void agentSetSeed(Agent* self,unsigned int seed){
 	self->seed = seed;
 	srand((unsigned int)self->seed);
+	// SPLITMIX64 SCRAMBLE SO SMALL SEEDS STILL GIVE A WELL MIXED, NON ZERO STATE
+	uint64_t z = (uint64_t)seed + 0x9E3779B97F4A7C15ULL;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	z = z ^ (z >> 31);
+	self->rng_state = z ? z : 0x9E3779B97F4A7C15ULL;
+};
+
+// XORSHIFT64*, RAND_MAX IS ONLY 0x7FFF ON WINDOWS SO rand() CANT INDEX BIG TABLES
+uint32_t agentRandU32(Agent* self){
+	uint64_t x = self->rng_state;
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	self->rng_state = x;
+	return (uint32_t)((x * 0x2545F4914F6CDD1DULL) >> 32);
+};
+
+// UNIFORM IN [0,n) WITHOUT THE MODULO, n == 0 RETURNS 0
+uint32_t agentRandRange(Agent* self,uint32_t n){
+	return (uint32_t)(((uint64_t)agentRandU32(self) * (uint64_t)n) >> 32);
 };
 
 void agentInit(Agent* agent,MazeEnv* env,float lr,float dr,double eps_decay, unsigned long seed){
@@ -197,47 +450,158 @@ Agent* newAgent(MazeEnv *env,float lr,float dr,double eps_decay, unsigned long s
 };
 
 q_val_t getQtableValue(Agent* self,state_t s,Action a){
-	size_t n_actions = self->q_table.len_state_actions;
-	size_t n_x = self->q_table.len_state_x;
-	size_t n_y = self->q_table.len_state_y;
-	if (s.x < 0 || s.y < 0 || s.x >= n_x || s.y >= n_y || a >= n_actions) return 0.0f;
-	return self->q_table.vals[n_actions*(((size_t)s.y*n_x)+s.x) + a];
+	q_table_t* t = &self->q_table;
+	q_val_t* row = qtableRow(t,s,0);
+	if (!row || a >= t->len_state_actions) return 0;
+	if (t->n_tables == 2) return qvalMean(row[a],row[t->len_state_actions + a]);
+	return row[a];
 }
 
+// WRITES EVERY TABLE, SO A DOUBLE TABLE STAYS CONSISTENT WITH getQtableValue
 void setQtableValue(Agent* self,state_t s,Action a, q_val_t q){
-	size_t n_actions = self->q_table.len_state_actions;
-	size_t n_x = self->q_table.len_state_x;
-	size_t n_y = self->q_table.len_state_y;
-	if (s.x < 0 || s.y < 0 || s.x >= n_x || s.y >= n_y || a >= n_actions) return;
-	self->q_table.vals[n_actions*(((size_t)s.y*n_x)+s.x) + a] = q;
+	q_table_t* t = &self->q_table;
+	q_val_t* row = qtableRow(t,s,0);
+	if (!row || a >= t->len_state_actions) return;
+	row[a] = q;
+	if (t->n_tables == 2) row[t->len_state_actions + a] = q;
 }
 
-ValAction qtableMaxValAction(Agent* a,state_t s){
-	float max_qval_t  = -FLT_MAX;
-	Action max_action = ACTION_NONE; 
-	for(int i = 0; i < ACTION_N_ACTIONS; i++){
-		q_val_t q = getQtableValue(a,s,i);
-		if(q > max_qval_t) {
-			max_qval_t = q;
+// FROM row[0], A ROW SATURATED AT QVAL_LOWEST STILL ANSWERS A REAL ACTION
+static ValAction qtableRowMax(const q_val_t* row){
+	q_val_t max_qval_t = row[0];
+	Action max_action  = ACTION_LEFT;
+	for(int i = 1; i < ACTION_N_ACTIONS; i++){
+		if(row[i] > max_qval_t) {
+			max_qval_t = row[i];
 			max_action = (Action)i;
 		}
 	}
 	return (ValAction){.v=max_qval_t,.a=max_action};
+}
+
+ValAction qtableMaxValAction(Agent* a,state_t s){
+	q_table_t* t = &a->q_table;
+	q_val_t* row = qtableRow(t,s,0);
+	// OUTSIDE THE GRID EVERY ACTION READS 0, KEEP THE OLD ANSWER
+	if (!row) return (ValAction){.v=0,.a=ACTION_LEFT};
+	if (t->n_tables != 2) return qtableRowMax(row);
+
+	// COMBINED ARGMAX OVER (A+B)/2
+	q_val_t sum[ACTION_N_ACTIONS];
+	for(int i = 0; i < ACTION_N_ACTIONS; i++) sum[i] = qvalMean(row[i],row[ACTION_N_ACTIONS + i]);
+	return qtableRowMax(sum);
+};
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define AGENT_BATCH_SSE
+#endif
+
+/*
+    BATCH ARGMAX
+
+    SAME ANSWER AS qtableMaxValAction FOR EVERY STATE, TIES INCLUDED. WITH SSE
+    FOUR STATES GO TOGETHER: THEIR 4 ACTION ROWS ARE TRANSPOSED SO EACH
+    REGISTER HOLDS ONE ACTION OF THE FOUR STATES, AND THE RUNNING MAX AND ITS
+    INDEX ARE KEPT WITH COMPARE + BLEND, NO BRANCH PER STATE. A GROUP WITH A
+    STATE OUTSIDE THE GRID AND THE TAIL GO THROUGH qtableMaxValAction.
+    FIXED POINT TABLES TAKE THE SAME PATH WITH INTEGER COMPARES (SIGNED
+    _mm_cmpgt_epi32) AND THE SHIFT FORM OF qvalMean.
+*/
+void qtableMaxValActionBatch(Agent* a,const state_t* s,size_t n,ValAction* out){
+	size_t i = 0;
+#ifdef AGENT_BATCH_SSE
+	q_table_t* t = &a->q_table;
+#ifdef CQ_FIXED_POINT
+	const __m128i one = _mm_set1_epi32(1);
+#else
+	const __m128 half = _mm_set1_ps(0.5f);
+#endif
+	for(; t->len_state_actions == ACTION_N_ACTIONS && i + 4 <= n; i += 4){
+		__m128 r[4];
+		int k = 0;
+		for(; k < 4; k++){
+			q_val_t* row = qtableRow(t,s[i + k],0);
+			if(!row) break;
+#ifdef CQ_FIXED_POINT
+			__m128i va = _mm_loadu_si128((const __m128i*)row);
+			if(t->n_tables == 2){
+				__m128i vb = _mm_loadu_si128((const __m128i*)(row + ACTION_N_ACTIONS));
+				va = _mm_add_epi32(_mm_add_epi32(_mm_srai_epi32(va,1),_mm_srai_epi32(vb,1)),
+				                   _mm_and_si128(_mm_and_si128(va,vb),one));
+			}
+			r[k] = _mm_castsi128_ps(va);
+#else
+			r[k] = _mm_loadu_ps(row);
+			if(t->n_tables == 2) r[k] = _mm_mul_ps(half,_mm_add_ps(r[k],_mm_loadu_ps(row + ACTION_N_ACTIONS)));
+#endif
+		}
+		if(k < 4){
+			for(k = 0; k < 4; k++) out[i + k] = qtableMaxValAction(a,s[i + k]);
+			continue;
+		}
+		// THE TRANSPOSE ONLY MOVES BITS, FINE FOR INTEGER LANES TOO
+		_MM_TRANSPOSE4_PS(r[0],r[1],r[2],r[3]);
+
+		// STRICT > FROM ACTION 0, LIKE qtableRowMax
+		__m128i idx  = _mm_set1_epi32((int)ACTION_LEFT);
+#ifdef CQ_FIXED_POINT
+		__m128i best = _mm_castps_si128(r[0]);
+		for(k = 1; k < ACTION_N_ACTIONS; k++){
+			__m128i rk = _mm_castps_si128(r[k]);
+			__m128i gt = _mm_cmpgt_epi32(rk,best);
+			best = _mm_or_si128(_mm_and_si128(gt,rk),_mm_andnot_si128(gt,best));
+			idx  = _mm_or_si128(_mm_and_si128(gt,_mm_set1_epi32(k)),_mm_andnot_si128(gt,idx));
+		}
+		q_val_t bv[4];
+		_mm_storeu_si128((__m128i*)bv,best);
+#else
+		__m128  best = r[0];
+		for(k = 1; k < ACTION_N_ACTIONS; k++){
+			__m128  gt  = _mm_cmpgt_ps(r[k],best);
+			__m128i gti = _mm_castps_si128(gt);
+			best = _mm_or_ps(_mm_and_ps(gt,r[k]),_mm_andnot_ps(gt,best));
+			idx  = _mm_or_si128(_mm_and_si128(gti,_mm_set1_epi32(k)),_mm_andnot_si128(gti,idx));
+		}
+		float   bv[4];
+		_mm_storeu_ps(bv,best);
+#endif
+		int32_t bi[4];
+		_mm_storeu_si128((__m128i*)bi,idx);
+		for(k = 0; k < 4; k++) out[i + k] = (ValAction){.v=bv[k],.a=(Action)bi[k]};
+	}
+#endif
+	for(; i < n; i++) out[i] = qtableMaxValAction(a,s[i]);
+}
+
+void agentSetStartFn(Agent* self,start_state_fn fn,void* ctx){
+	self->start_fn = fn;
+	self->start_ctx = ctx;
 };
 
 void agentRestart(Agent* self){
-	self->current_s = self->agent_start;
+	self->current_s = self->start_fn ? self->start_fn(self,self->start_ctx) : self->agent_start;
 	self->policy_action = ACTION_NONE;
 	self->accum_reward = 0.0f;
 };
 
 void agentPolicy(Agent* self,MazeEnv* env){
+#ifdef CQ_FIXED_POINT
+	// 24 RANDOM BITS SCALED BY 2^-24 IS AN EXACT float, rand() DIFFERS PER C LIBRARY
+	float r = (float)(agentRandU32(self) >> 8)*(1.0f/16777216.0f);
+	if(r > self->epsilon){
+		self->policy_action = qtableMaxValAction(self,self->current_s).a;
+	} else{
+		self->policy_action = (Action)agentRandRange(self,ACTION_N_ACTIONS);
+	}
+#else
 	float r = (float)rand()/RAND_MAX;
 	if(r > self->epsilon){
 		self->policy_action = qtableMaxValAction(self,self->current_s).a;
 	} else{
 		self->policy_action = (Action)(rand() % ACTION_N_ACTIONS);
 	}
+#endif
 };
 
 state_t GetNextState(state_t s, Action a){
@@ -257,7 +621,54 @@ void agentUpdateState(Agent* a, state_t new_state){
 };
 
 float agentQtableUpdate(Agent* self,state_t next,stepResult sr){
-	q_val_t old_q_val = getQtableValue(self,self->current_s,self->policy_action);
+	return agentQtableUpdateAt(self,self->current_s,self->policy_action,next,sr);
+}
+
+// DOUBLE Q: A COIN PICKS THE TABLE TO UPDATE, ITS OWN ARGMAX AT next IS
+// EVALUATED BY THE OTHER TABLE, WHICH REMOVES THE max OVERESTIMATION BIAS
+static float agentDoubleQtableUpdateAt(Agent* self,state_t s,Action a,state_t next,stepResult sr){
+	q_table_t* t = &self->q_table;
+	size_t upd = agentRandU32(self) & 1u;
+	q_val_t* row = qtableRow(t,s,upd);
+	if (!row || a >= t->len_state_actions) return 0.0f;
+
+#ifdef CQ_FIXED_POINT
+	int64_t target = qvalFromFloat(sr.reward);
+	if(sr.terminal == false){
+		q_val_t* next_upd  = qtableRow(t,next,upd);
+		q_val_t* next_eval = qtableRow(t,next,1 - upd);
+		if(next_upd) target += qvalMul(qvalFromFloat(self->discount_rate),next_eval[qtableRowMax(next_upd).a]);
+	}
+	q_val_t delta = qvalMul(qvalFromFloat(self->learning_rate),qvalSaturate(target - row[a]));
+	row[a] = qvalSaturate((int64_t)row[a] + delta);
+	return qvalToFloat(delta);
+#else
+	q_val_t target = sr.reward;
+	if(sr.terminal == false){
+		q_val_t* next_upd  = qtableRow(t,next,upd);
+		q_val_t* next_eval = qtableRow(t,next,1 - upd);
+		// OUTSIDE THE GRID BOTH TABLES READ 0, AS IN THE SINGLE TABLE CASE
+		if(next_upd) target += self->discount_rate*next_eval[qtableRowMax(next_upd).a];
+	}
+	q_val_t td_error = target - row[a];
+	row[a] += self->learning_rate*td_error;
+	return self->learning_rate*td_error;
+#endif
+}
+
+// SAME BACKUP AS agentQtableUpdate BUT FOR ANY (s,a), USED BY THE PLANNERS
+float agentQtableUpdateAt(Agent* self,state_t s,Action a,state_t next,stepResult sr){
+	if(self->q_table.n_tables == 2) return agentDoubleQtableUpdateAt(self,s,a,next,sr);
+#ifdef CQ_FIXED_POINT
+	// Q += lr*(target - Q), THE SAME BACKUP AS BELOW IN Q16.16
+	q_val_t old_q = getQtableValue(self,s,a);
+	int64_t target = qvalFromFloat(sr.reward);
+	if(sr.terminal == false) target += qvalMul(qvalFromFloat(self->discount_rate),qtableMaxValAction(self,next).v);
+	q_val_t delta = qvalMul(qvalFromFloat(self->learning_rate),qvalSaturate(target - old_q));
+	setQtableValue(self,s,a,qvalSaturate((int64_t)old_q + delta));
+	return qvalToFloat(delta);
+#else
+	q_val_t old_q_val = getQtableValue(self,s,a);
     q_val_t old_q_trace = (1-self->learning_rate)*old_q_val;
 	q_val_t TD = 0.0;
 	if(sr.terminal == true){
@@ -267,10 +678,81 @@ float agentQtableUpdate(Agent* self,state_t next,stepResult sr){
 		TD = self->learning_rate*(sr.reward+self->discount_rate*max_next_q_val);	
 	}
 	q_val_t new_q = old_q_trace + TD;
-	setQtableValue(self,self->current_s,self->policy_action,new_q);
+	setQtableValue(self,s,a,new_q);
 
     // Return TD error
     return TD - self->learning_rate*old_q_val; 
+#endif
+}
+
+// TURNS A SINGLE TABLE INTO AN INTERLEAVED A/B PAIR, BOTH STARTING AS A COPY OF IT
+int agentEnableDoubleQ(Agent* self){
+	q_table_t* t = &self->q_table;
+	if(t->n_tables == 2) return 0;
+	q_val_t* vals = (q_val_t*)malloc(qtableSlots(t->len_state_x,t->len_state_y,t->layout)*2*t->len_state_actions*sizeof(q_val_t));
+	if(!vals) return -1;
+	agentEnableDoubleQIn(self,vals);
+	t->borrowed = false;
+	return 0;
+}
+
+// THE SAME INTO vals (2*qtableSlots*n_actions VALUES) THAT THE CALLER OWNS, THE TABLE ENDS borrowed
+int agentEnableDoubleQIn(Agent* self,q_val_t* vals){
+	q_table_t* t = &self->q_table;
+	if(t->n_tables == 2) return 0;
+	if(!vals) return -1;
+	size_t n_cells = qtableSlots(t->len_state_x,t->len_state_y,t->layout);
+	size_t na = t->len_state_actions;
+	for(size_t c = 0; c < n_cells; c++){
+		memcpy(vals + (2*c)*na,    t->vals + c*na, na*sizeof(q_val_t));
+		memcpy(vals + (2*c + 1)*na, t->vals + c*na, na*sizeof(q_val_t));
+	}
+	if(!t->borrowed) free(t->vals);
+	t->vals = vals;
+	t->borrowed = true;
+	t->n_tables = 2;
+	return 0;
+}
+
+// REORDERS THE SLOTS INTO layout, THE TABLE GOES TO THE HEAP LIKE agentEnableDoubleQ
+int agentSetQtableLayout(Agent* self,qtable_layout_t layout){
+	q_table_t* t = &self->q_table;
+	if(layout >= QTABLE_LAYOUT_COUNT) return -1;
+	if(t->layout == layout) return 0;
+	q_table_t to = *t;
+	qtableSetLayout(&to,layout);
+	to.vals = (q_val_t*)calloc(qtableValCount(&to),sizeof(q_val_t));
+	if(!to.vals) return -1;
+	if(t->vals){
+		size_t row = qtableCount(t)*t->len_state_actions;
+		for(size_t y = 0; y < t->len_state_y; y++){
+			for(size_t x = 0; x < t->len_state_x; x++){
+				state_t s = {(int32_t)x,(int32_t)y};
+				memcpy(qtableRow(&to,s,0),qtableRow(t,s,0),row*sizeof(q_val_t));
+			}
+		}
+	}
+	if(!t->borrowed) free(t->vals);
+	to.borrowed = false;
+	*t = to;
+	return 0;
+}
+
+static const char* qtableLayoutNames[QTABLE_LAYOUT_COUNT] = {
+	[QTABLE_LAYOUT_ROW]    = "row",
+	[QTABLE_LAYOUT_TILED]  = "tiled",
+	[QTABLE_LAYOUT_MORTON] = "morton"
+};
+
+const char* qtableLayoutName(qtable_layout_t layout){
+	return layout < QTABLE_LAYOUT_COUNT ? qtableLayoutNames[layout] : "?";
+}
+
+int qtableParseLayout(const char* s,qtable_layout_t* out){
+	for(int i = 0; i < QTABLE_LAYOUT_COUNT; i++){
+		if(strcmp(s,qtableLayoutNames[i]) == 0){ *out = (qtable_layout_t)i; return 0; }
+	}
+	return -1;
 }
 
 float exp_epislon_decay(float epsilon,float decay){return epsilon*decay;}
@@ -292,6 +774,50 @@ void agentEpsilonDecay(Agent* self,decay_fn fn){
 	if(self->epsilon > 1.0f) self->epsilon = 1.0f;
 };
 
+#ifdef CQ_FIXED_POINT
+// exp(-16), exp(-8) .. exp(-1) AND exp(-2^-i) FOR i = 1..24, IN 0.32 FIXED POINT
+static const uint32_t agentExpNegInt[5]   = {483u,1440801u,78665070u,581260615u,1580030169u};
+static const uint32_t agentExpNegFrac[24] = {
+	2605029347u,3344923893u,3790295335u,4034748382u,4162825044u,4228380000u,
+	4261543595u,4278222805u,4286586875u,4290775039u,4292870656u,4293918848u,
+	4294443040u,4294705160u,4294836226u,4294901760u,4294934528u,4294950912u,
+	4294959104u,4294963200u,4294965248u,4294966272u,4294966784u,4294967040u
+};
+#endif
+
+// THE TRAINERS' SCHEDULE: 0.1 + 0.9*exp(-env_steps/eps_decay). THE FIXED POINT
+// BUILD SPLITS x = env_steps/eps_decay INTO BITS (eps_decay ROUNDED TO 1/256)
+// AND MULTIPLIES THE exp OF EACH SET BIT, INTEGER ONLY LIKE THE BACKUPS
+float agentEpsilonSchedule(uint64_t env_steps,double eps_decay){
+#ifdef CQ_FIXED_POINT
+	if(!(eps_decay > 0.0)) eps_decay = 1.0;
+	double scaled = eps_decay*256.0 + 0.5;
+	uint64_t d = scaled >= 4503599627370496.0 ? (uint64_t)1 << 52 : (uint64_t)scaled;
+	if(d == 0) d = 1;
+	// exp(-32) IS UNDER 2^-32, THE FLOOR
+	if(env_steps >= (d + 7)/8) return 0.1f;
+	uint64_t num = env_steps*256;
+	uint64_t whole = num/d, rem = num % d;
+	uint64_t acc = (uint64_t)1 << 32;
+	for(int k = 0; k < 5; k++)
+		if(whole & (16u >> k)) acc = (acc*agentExpNegInt[k] + (1u << 31)) >> 32;
+	for(int i = 0; i < 24; i++){
+		rem <<= 1;
+		if(rem < d) continue;
+		rem -= d;
+		acc = (acc*agentExpNegFrac[i] + (1u << 31)) >> 32;
+	}
+	uint64_t eps = 429496730u + ((acc*3865470566u + (1u << 31)) >> 32);
+	return (float)eps*(1.0f/4294967296.0f);
+#else
+	double decay = eps_decay > 0.0 ? eps_decay : 1.0;
+	double eps = 0.1 + 0.9*exp(-(double)env_steps/decay);
+	if(!isfinite(eps) || eps < 0.1) eps = 0.1;
+	if(eps > 1.0) eps = 1.0;
+	return (float)eps;
+#endif
+}
+
 
 int agentSaveQtable(Agent* agent, char* save_path){
     if(!agent || !save_path) return -1;
@@ -301,15 +827,38 @@ int agentSaveQtable(Agent* agent, char* save_path){
     uint64_t nx = (uint64_t)agent->q_table.len_state_x;
     uint64_t ny = (uint64_t)agent->q_table.len_state_y;
     uint64_t na = (uint64_t)agent->q_table.len_state_actions;
+    uint64_t nt = (uint64_t)qtableCount(&agent->q_table);
+    uint64_t na_word = na | (nt == 2 ? QTABLE_DOUBLE_FLAG : 0);
+#ifdef CQ_FIXED_POINT
+    na_word |= QTABLE_FIXED_FLAG;
+#endif
 
     if(fwrite(&nx, sizeof(uint64_t), 1, f) != 1) { fclose(f); return -1; }
     if(fwrite(&ny, sizeof(uint64_t), 1, f) != 1) { fclose(f); return -1; }
-    if(fwrite(&na, sizeof(uint64_t), 1, f) != 1) { fclose(f); return -1; }
+    if(fwrite(&na_word, sizeof(uint64_t), 1, f) != 1) { fclose(f); return -1; }
 
-    size_t q_table_len = (size_t)nx * (size_t)ny * (size_t)na;
+    size_t q_table_len = (size_t)nx * (size_t)ny * (size_t)na * (size_t)nt;
     if(q_table_len == 0){ fclose(f); return -1; }
 
-    size_t wrote = fwrite(agent->q_table.vals, sizeof(q_val_t), q_table_len, f);
+    size_t wrote = 0;
+    if(agent->q_table.layout == QTABLE_LAYOUT_ROW){
+        wrote = fwrite(agent->q_table.vals, sizeof(q_val_t), q_table_len, f);
+    } else {
+        // BACK TO ROW MAJOR ONE MAZE ROW AT A TIME
+        size_t row = (size_t)na*(size_t)nt;
+        q_val_t* line = (q_val_t*)malloc((size_t)nx*row*sizeof(q_val_t));
+        if(!line){ fclose(f); return -1; }
+        for(size_t y = 0; y < ny; y++){
+            for(size_t x = 0; x < nx; x++){
+                state_t s = {(int32_t)x,(int32_t)y};
+                memcpy(line + x*row, qtableRow(&agent->q_table,s,0), row*sizeof(q_val_t));
+            }
+            size_t n = fwrite(line, sizeof(q_val_t), (size_t)nx*row, f);
+            wrote += n;
+            if(n != (size_t)nx*row) break;
+        }
+        free(line);
+    }
     if(wrote != q_table_len){
         fprintf(stderr, "[ERROR] wrote %zu of %zu qvals\n", wrote, q_table_len);
         fclose(f);
@@ -333,17 +882,21 @@ int agentReadQtable(Agent* agent, const char* load_path){
         fprintf(stderr, "[ERROR] corrupt header\n"); fclose(f); return -1;
     }
 
+    uint64_t nt = (na & QTABLE_DOUBLE_FLAG) ? 2 : 1;
+    bool fixed_file = (na & QTABLE_FIXED_FLAG) != 0;
+    na &= QTABLE_ACTIONS_MASK;
+
     if(nx == 0 || ny == 0 || na == 0){ fclose(f); return -1; }
 
     fseek(f, 0, SEEK_END);
     long fsize = ftell(f);
-    long expected = (long)(3*sizeof(uint64_t) + (uint64_t)nx*ny*na*sizeof(q_val_t));
+    long expected = (long)(3*sizeof(uint64_t) + (uint64_t)nx*ny*na*nt*sizeof(q_val_t));
     if(fsize != expected){
         fprintf(stderr, "[WARN] file size mismatch: %ld != %ld (expected)\n", fsize, expected);
     }
     fseek(f, 3*sizeof(uint64_t), SEEK_SET);
 
-    size_t qlen = (size_t)nx * (size_t)ny * (size_t)na;
+    size_t qlen = (size_t)nx * (size_t)ny * (size_t)na * (size_t)nt;
     q_val_t *vals = malloc(sizeof(q_val_t) * qlen);
     if(!vals){ fclose(f); return -1; }
 
@@ -352,12 +905,36 @@ int agentReadQtable(Agent* agent, const char* load_path){
 
     fclose(f);
 
-    if(agent->q_table.vals) free(agent->q_table.vals);
+    // BOTH KINDS ARE 4 BYTES A VALUE, A TABLE FROM THE OTHER BUILD IS CONVERTED IN PLACE
+#ifdef CQ_FIXED_POINT
+    if(!fixed_file){
+        for(size_t i = 0; i < qlen; i++){ float v; memcpy(&v,&vals[i],sizeof(v)); vals[i] = qvalFromFloat(v); }
+    }
+#else
+    if(fixed_file){
+        for(size_t i = 0; i < qlen; i++){ int32_t v; memcpy(&v,&vals[i],sizeof(v)); vals[i] = (float)v/65536.0f; }
+    }
+#endif
+
+    qtable_layout_t layout = agent->q_table.layout;
+    agentFreeQtable(agent);
     agent->q_table.vals = vals;
     agent->q_table.len_state_x = (size_t)nx;
     agent->q_table.len_state_y = (size_t)ny;
     agent->q_table.len_state_actions = (size_t)na;
+    agent->q_table.n_tables = (size_t)nt;
+    agent->q_table.layout = QTABLE_LAYOUT_ROW;
+    // THE FILE IS ROW MAJOR, AN AGENT THAT WANTED ANOTHER LAYOUT KEEPS IT
+    if(layout != QTABLE_LAYOUT_ROW && agentSetQtableLayout(agent,layout) != 0) return -1;
     return 0;
 }
 
+// FREES THE TABLE UNLESS AN ARENA OR POOL OWNS IT, THE AGENT IS LEFT WITHOUT ONE
+void agentFreeQtable(Agent* agent){
+	if(!agent) return;
+	if(!agent->q_table.borrowed) free(agent->q_table.vals);
+	agent->q_table.vals = NULL;
+	agent->q_table.borrowed = false;
+}
+
 #endif
\ No newline at end of file
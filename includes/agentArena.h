@@ -0,0 +1,563 @@
+#ifndef AGENT_ARENA_H
+
+#define AGENT_ARENA_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "agent.h"
+
+/*
+    ARENAS AND AGENT POOLS
+
+    AN arena_t RESERVES ONE ANONYMOUS MAPPING UP FRONT (mmap) AND HANDS OUT
+    64 BYTE ALIGNED BLOCKS BY BUMPING AN OFFSET. NOTHING IS FREED ONE BY ONE:
+    arenaReset REWINDS THE OFFSET AND KEEPS THE PAGES MAPPED AND FAULTED IN,
+    SO THE NEXT RUN REUSES THEM IN PLACE INSTEAD OF GOING THROUGH THE
+    ALLOCATOR AND A NEW PAGE FAULT PER 4 KiB.
+
+    THE MAPPING IS ALIGNED TO 2 MiB AND ASKED FOR TRANSPARENT HUGE PAGES
+    (madvise MADV_HUGEPAGE, LINUX ONLY, A HINT THE KERNEL MAY IGNORE).
+
+    arenaCalloc ONLY CLEARS WHAT AN EARLIER RUN WROTE: BYTES PAST THE HIGH
+    WATER MARK (dirty) ARE STILL THE ZERO PAGES OF THE MAPPING. ON WINDOWS
+    THE BLOCK COMES FROM _aligned_malloc (windows.h CLASHES WITH raylib IN
+    THE GUI), ITS CONTENTS ARE UNKNOWN AND THE WHOLE BLOCK STARTS dirty.
+
+    PLACEMENT (arena_policy_t, LINUX ONLY, ZERO IS WHAT arenaInit DOES):
+        pages   ARENA_PAGES_THP      madvise(MADV_HUGEPAGE)
+                ARENA_PAGES_SMALL    NO HINT, BASE PAGES
+                ARENA_PAGES_HUGETLB  MAP_HUGETLB 2 MiB PAGES FROM THE RESERVED
+                                     POOL (vm.nr_hugepages), THP WHEN THE POOL
+                                     IS SHORT (arena_t.hugetlb SAYS WHICH)
+        numa    ARENA_NUMA_LOCAL       THE KERNEL DEFAULT, THE NODE OF THE
+                                       THREAD THAT FIRST WRITES A PAGE
+                ARENA_NUMA_INTERLEAVE  mbind(MPOL_INTERLEAVE) OVER EVERY
+                                       ONLINE NODE BEFORE ANY PAGE IS TOUCHED
+                ARENA_NUMA_FIRST_TOUCH NOTHING AT MAP TIME: THE OWNER DOES
+                                       arenaPinThreadToNode + arenaTouch ON ITS
+                                       PARTITION BEFORE ANYONE ELSE WRITES IT
+    mbind, move_pages AND sched_setaffinity ARE RAW SYSCALLS, NO libnuma.
+    arenaReport SAMPLES A RANGE WITH move_pages FOR THE NODE OF EACH PAGE
+    AND READS /proc/self/smaps FOR THE PAGE SIZE AND THE THP BYTES.
+
+    AN agent_pool_t IS A SLAB OF FIXED SIZE Agent STRUCTS AND ONE OF FIXED
+    SIZE Q-TABLES (ONE MAZE PER POOL), BOTH CARVED FROM AN ARENA, WITH A FREE
+    LIST EACH. agentPoolRelease PUTS BOTH BACK AND agentPoolNew TAKES THEM
+    AGAIN, ZEROING THE TABLE IN PLACE. POOLED AND ARENA TABLES ARE MARKED
+    q_table.borrowed, SO agentReadQtable/agentEnableDoubleQ/agentFreeQtable
+    NEVER free() THEM.
+*/
+
+#define ARENA_ALIGN       64
+#define ARENA_HUGE_PAGE   ((size_t)2 << 20)
+#define ARENA_MAX_NODES   64
+#define ARENA_REPORT_MAX_SAMPLES 4096
+
+typedef enum {
+	ARENA_PAGES_THP = 0,
+	ARENA_PAGES_SMALL,
+	ARENA_PAGES_HUGETLB
+} arena_pages_t;
+
+typedef enum {
+	ARENA_NUMA_LOCAL = 0,
+	ARENA_NUMA_INTERLEAVE,
+	ARENA_NUMA_FIRST_TOUCH
+} arena_numa_t;
+
+typedef struct {
+	arena_pages_t pages;
+	arena_numa_t  numa;
+} arena_policy_t;
+
+typedef struct {
+	size_t   bytes;
+	size_t   page_size;             // KernelPageSize OF THE MAPPING
+	size_t   huge_bytes;            // AnonHugePages OF THE WHOLE MAPPING (THP) OR THE RANGE (hugetlb)
+	size_t   sampled;               // PAGES ASKED TO move_pages
+	size_t   absent;                // NOT FAULTED IN YET
+	size_t   node_pages[ARENA_MAX_NODES];
+	size_t   n_nodes;               // ONLINE NODES
+	bool     nodes_known;           // FALSE WHEN move_pages IS UNAVAILABLE
+} arena_report_t;
+
+typedef struct {
+	uint8_t* map;           // WHAT WAS MAPPED
+	size_t   map_bytes;
+	uint8_t* base;          // map ROUNDED UP TO ARENA_HUGE_PAGE
+	size_t   capacity;
+	size_t   offset;
+	size_t   dirty;         // HIGH WATER MARK OF EVERY RUN SINCE arenaInit
+	size_t   peak;
+	arena_policy_t policy;
+	bool     hugetlb;       // MAPPED WITH MAP_HUGETLB
+	bool     interleaved;   // mbind(MPOL_INTERLEAVE) TOOK
+} arena_t;
+
+// FIXED SIZE OBJECTS OUT OF AN ARENA, A FREED OBJECT HOLDS THE NEXT FREE POINTER
+typedef struct {
+	arena_t* arena;
+	size_t   obj_size;
+	void*    free_list;
+	size_t   live;
+} slab_pool_t;
+
+typedef struct {
+	arena_t     arena;
+	slab_pool_t agents;
+	slab_pool_t tables;
+	size_t      len_state_x;
+	size_t      len_state_y;
+	qtable_layout_t layout;
+} agent_pool_t;
+
+int    arenaInit(arena_t* a, size_t capacity);
+// policy NULL IS arenaInit. A PLACEMENT THE SYSTEM REFUSES IS NOT AN ERROR, arena_t SAYS WHAT TOOK
+int    arenaInitPolicy(arena_t* a, size_t capacity, const arena_policy_t* policy);
+void*  arenaAlloc(arena_t* a, size_t bytes);
+void*  arenaCalloc(arena_t* a, size_t n, size_t size);
+void   arenaReset(arena_t* a);
+void   arenaFree(arena_t* a);
+// THE ARENA IS REUSED WHEN IT HOLDS capacity, ELSE IT IS MAPPED AGAIN BIGGER WITH THE SAME POLICY
+int    arenaReserve(arena_t* a, size_t capacity);
+
+// ONLINE NODES (AT LEAST 1) AND THEIR MASK
+size_t arenaNumaNodes(uint64_t* mask);
+// THE CALLING THREAD RUNS ONLY ON THE CPUS OF node FROM NOW ON, 0 ON SUCCESS
+int    arenaPinThreadToNode(size_t node);
+// WRITES A ZERO TO EVERY PAGE OF A ZEROED RANGE, FAULTING IT IN ON THE CALLER'S NODE
+void   arenaTouch(void* p, size_t bytes);
+void   arenaReport(const arena_t* a, const void* p, size_t bytes, arena_report_t* r);
+void   arenaPrintReport(FILE* f, const char* label, const arena_t* a, const arena_report_t* r);
+const char* arenaPagesName(arena_pages_t pages);
+const char* arenaNumaName(arena_numa_t numa);
+// "thp"/"small"/"hugetlb" AND "local"/"interleave"/"firsttouch", -1 FOR ANYTHING ELSE
+int    arenaParsePages(const char* s, arena_pages_t* out);
+int    arenaParseNuma(const char* s, arena_numa_t* out);
+
+void   slabInit(slab_pool_t* s, arena_t* arena, size_t obj_size);
+void*  slabGet(slab_pool_t* s);
+void*  slabCalloc(slab_pool_t* s);
+void   slabPut(slab_pool_t* s, void* obj);
+
+int    agentPoolInit(agent_pool_t* p, MazeEnv* env, size_t max_agents, qtable_layout_t layout);
+Agent* agentPoolNew(agent_pool_t* p, MazeEnv* env, float lr, float dr, double eps_decay, unsigned long seed);
+void   agentPoolRelease(agent_pool_t* p, Agent* agent);
+void   agentPoolReset(agent_pool_t* p);
+void   agentPoolFree(agent_pool_t* p);
+
+// Agent AND ITS TABLE (IN layout) FROM AN ARENA, GONE WITH THE NEXT arenaReset
+Agent* arenaNewAgent(arena_t* a, MazeEnv* env, float lr, float dr, double eps_decay, unsigned long seed, qtable_layout_t layout);
+// agentEnableDoubleQ WITH THE A/B TABLE FROM THE ARENA, SO IT KEEPS THE ARENA'S PLACEMENT
+int    arenaEnableDoubleQ(arena_t* a, Agent* agent);
+
+static inline size_t arenaAlignUp(size_t n, size_t align){
+	return (n + align - 1) & ~(align - 1);
+}
+
+#endif
+
+#ifdef AGENT_ARENA_IMPLEMENTATION
+
+#ifdef _WIN32
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#define ARENA_MPOL_INTERLEAVE 3
+
+int arenaInit(arena_t* a, size_t capacity){
+	return arenaInitPolicy(a,capacity,NULL);
+}
+
+int arenaInitPolicy(arena_t* a, size_t capacity, const arena_policy_t* policy){
+	memset(a,0,sizeof(*a));
+	if(policy) a->policy = *policy;
+	capacity = arenaAlignUp(capacity ? capacity : ARENA_ALIGN,ARENA_HUGE_PAGE);
+#ifdef _WIN32
+	void* m = _aligned_malloc(capacity,ARENA_HUGE_PAGE);
+	if(!m) return -1;
+	a->map       = (uint8_t*)m;
+	a->map_bytes = capacity;
+	a->base      = (uint8_t*)m;
+	a->dirty     = capacity;
+#else
+	void* m = MAP_FAILED;
+#if defined(MAP_HUGETLB)
+	if(a->policy.pages == ARENA_PAGES_HUGETLB){
+		int huge_flags = MAP_HUGETLB;
+#if defined(MAP_HUGE_SHIFT)
+		huge_flags |= 21 << MAP_HUGE_SHIFT;
+#endif
+		// NO MAP_NORESERVE: A SHORT POOL FAILS HERE INSTEAD OF A SIGBUS ON FIRST TOUCH
+		m = mmap(NULL,capacity,PROT_READ | PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS | huge_flags,-1,0);
+		if(m != MAP_FAILED){
+			a->map       = (uint8_t*)m;
+			a->map_bytes = capacity;
+			a->base      = (uint8_t*)m;
+			a->hugetlb   = true;
+		}
+	}
+#endif
+	if(m == MAP_FAILED){
+		size_t bytes = capacity + ARENA_HUGE_PAGE;
+		m = mmap(NULL,bytes,PROT_READ | PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,-1,0);
+		if(m == MAP_FAILED) return -1;
+		a->map       = (uint8_t*)m;
+		a->map_bytes = bytes;
+		a->base      = (uint8_t*)arenaAlignUp((size_t)(uintptr_t)m,ARENA_HUGE_PAGE);
+#if defined(MADV_HUGEPAGE)
+		if(a->policy.pages != ARENA_PAGES_SMALL) madvise(a->base,capacity,MADV_HUGEPAGE);
+#endif
+	}
+#if defined(__linux__) && defined(SYS_mbind)
+	uint64_t nodes = 0;
+	if(a->policy.numa == ARENA_NUMA_INTERLEAVE && arenaNumaNodes(&nodes) > 1){
+		unsigned long mask[ARENA_MAX_NODES/(8*sizeof(unsigned long))] = {0};
+		memcpy(mask,&nodes,sizeof(nodes));
+		a->interleaved = syscall(SYS_mbind,a->base,capacity,ARENA_MPOL_INTERLEAVE,mask,(unsigned long)ARENA_MAX_NODES + 1,0UL) == 0;
+	}
+#endif
+#endif
+	a->capacity = capacity;
+	return 0;
+}
+
+void* arenaAlloc(arena_t* a, size_t bytes){
+	size_t at = arenaAlignUp(a->offset,ARENA_ALIGN);
+	if(!a->base || bytes > a->capacity || at > a->capacity - bytes) return NULL;
+	a->offset = at + bytes;
+	if(a->offset > a->dirty) a->dirty = a->offset;
+	if(a->offset > a->peak)  a->peak  = a->offset;
+	return a->base + at;
+}
+
+void* arenaCalloc(arena_t* a, size_t n, size_t size){
+	if(size && n > SIZE_MAX/size) return NULL;
+	size_t was_dirty = a->dirty;
+	uint8_t* p = (uint8_t*)arenaAlloc(a,n*size);
+	if(!p) return NULL;
+	size_t at = (size_t)(p - a->base);
+	if(at < was_dirty){
+		size_t end = at + n*size;
+		memset(p,0,(end < was_dirty ? end : was_dirty) - at);
+	}
+	return p;
+}
+
+void arenaReset(arena_t* a){
+	a->offset = 0;
+}
+
+void arenaFree(arena_t* a){
+	if(a->map){
+#ifdef _WIN32
+		_aligned_free(a->map);
+#else
+		munmap(a->map,a->map_bytes);
+#endif
+	}
+	memset(a,0,sizeof(*a));
+}
+
+int arenaReserve(arena_t* a, size_t capacity){
+	if(a->base && a->capacity >= capacity){
+		arenaReset(a);
+		return 0;
+	}
+	arena_policy_t policy = a->policy;
+	arenaFree(a);
+	return arenaInitPolicy(a,capacity,&policy);
+}
+
+#ifdef __linux__
+// "0-3,8,10-11" OF A /sys LIST FILE AS A BIT MASK, ONLY THE FIRST max BITS
+static size_t arenaReadList(const char* path, uint64_t* bits, size_t words){
+	memset(bits,0,words*sizeof(uint64_t));
+	FILE* f = fopen(path,"r");
+	if(!f) return 0;
+	size_t count = 0;
+	unsigned long lo, hi;
+	int c = 0;
+	while(fscanf(f,"%lu",&lo) == 1){
+		hi = lo;
+		c = fgetc(f);
+		if(c == '-'){
+			if(fscanf(f,"%lu",&hi) != 1) break;
+			c = fgetc(f);
+		}
+		for(unsigned long i = lo; i <= hi && i < words*64; i++){
+			bits[i/64] |= 1ULL << (i%64);
+			count++;
+		}
+		if(c != ',') break;
+	}
+	fclose(f);
+	return count;
+}
+#endif
+
+size_t arenaNumaNodes(uint64_t* mask){
+	uint64_t m = 1;
+#ifdef __linux__
+	if(arenaReadList("/sys/devices/system/node/online",&m,1) == 0) m = 1;
+#endif
+	if(mask) *mask = m;
+	size_t n = 0;
+	for(uint64_t b = m; b; b &= b - 1) n++;
+	return n;
+}
+
+int arenaPinThreadToNode(size_t node){
+#if defined(__linux__) && defined(SYS_sched_setaffinity)
+	char path[64];
+	uint64_t cpus[16];
+	snprintf(path,sizeof(path),"/sys/devices/system/node/node%zu/cpulist",node);
+	if(arenaReadList(path,cpus,16) == 0) return -1;
+	// pid 0 IS THE CALLING THREAD
+	return syscall(SYS_sched_setaffinity,0,sizeof(cpus),cpus) == 0 ? 0 : -1;
+#else
+	(void)node;
+	return -1;
+#endif
+}
+
+void arenaTouch(void* p, size_t bytes){
+	volatile uint8_t* q = (volatile uint8_t*)p;
+	for(size_t i = 0; i < bytes; i += 4096) q[i] = 0;
+	if(bytes) q[bytes - 1] = 0;
+}
+
+void arenaReport(const arena_t* a, const void* p, size_t bytes, arena_report_t* r){
+	memset(r,0,sizeof(*r));
+	r->bytes     = bytes;
+	r->page_size = 4096;
+	r->n_nodes   = arenaNumaNodes(NULL);
+#ifdef __linux__
+	long ps = sysconf(_SC_PAGESIZE);
+	if(ps > 0) r->page_size = (size_t)ps;
+	if(a && a->hugetlb){
+		r->page_size  = ARENA_HUGE_PAGE;
+		r->huge_bytes = bytes;
+	}
+	// THE smaps ENTRY THAT HOLDS p
+	FILE* f = fopen("/proc/self/smaps","r");
+	if(f){
+		char line[256];
+		bool inside = false;
+		uintptr_t at = (uintptr_t)p;
+		while(fgets(line,sizeof(line),f)){
+			unsigned long lo, hi, kb;
+			if(sscanf(line,"%lx-%lx ",&lo,&hi) == 2 && strchr(line,'-') < strchr(line,' ')){
+				if(inside) break;
+				inside = at >= lo && at < hi;
+			} else if(inside && sscanf(line,"KernelPageSize: %lu kB",&kb) == 1){
+				r->page_size = (size_t)kb*1024;
+			} else if(inside && !(a && a->hugetlb) && sscanf(line,"AnonHugePages: %lu kB",&kb) == 1){
+				r->huge_bytes = (size_t)kb*1024;
+			}
+		}
+		fclose(f);
+	}
+#if defined(SYS_move_pages)
+	size_t n_pages = (bytes + r->page_size - 1)/r->page_size;
+	size_t n = n_pages < ARENA_REPORT_MAX_SAMPLES ? n_pages : ARENA_REPORT_MAX_SAMPLES;
+	if(n == 0) return;
+	void** pages  = (void**)malloc(n*sizeof(void*));
+	int*   status = (int*)malloc(n*sizeof(int));
+	if(pages && status){
+		uintptr_t first = (uintptr_t)p & ~(uintptr_t)(r->page_size - 1);
+		for(size_t i = 0; i < n; i++) pages[i] = (void*)(first + (i*n_pages/n)*r->page_size);
+		// nodes NULL: NOTHING MOVES, status GETS THE NODE OF EACH PAGE
+		if(syscall(SYS_move_pages,0,(unsigned long)n,pages,NULL,status,0) == 0){
+			r->nodes_known = true;
+			r->sampled = n;
+			for(size_t i = 0; i < n; i++){
+				if(status[i] >= 0 && status[i] < ARENA_MAX_NODES) r->node_pages[status[i]]++;
+				else r->absent++;
+			}
+		}
+	}
+	free(pages);
+	free(status);
+#endif
+#else
+	(void)a;
+	(void)p;
+#endif
+}
+
+void arenaPrintReport(FILE* f, const char* label, const arena_t* a, const arena_report_t* r){
+	double mb = (double)r->bytes/(1024.0*1024.0);
+	fprintf(f,"[MEM] %s: %.1f MB, pages=%s%s numa=%s%s, page size %zu KiB, %.1f MB of the mapping on huge pages\n",
+	        label,mb,arenaPagesName(a->policy.pages),
+	        a->policy.pages == ARENA_PAGES_HUGETLB && !a->hugetlb ? " (pool short, THP)" : "",
+	        arenaNumaName(a->policy.numa),
+	        a->policy.numa == ARENA_NUMA_INTERLEAVE && !a->interleaved ? " (single node or refused)" : "",
+	        r->page_size/1024,(double)r->huge_bytes/(1024.0*1024.0));
+	if(!r->nodes_known){
+		fprintf(f,"[MEM] %s: node placement unknown (no move_pages)\n",label);
+		return;
+	}
+	fprintf(f,"[MEM] %s: %zu pages sampled on %zu node(s):",label,r->sampled,r->n_nodes);
+	for(size_t i = 0; i < ARENA_MAX_NODES; i++){
+		if(r->node_pages[i]) fprintf(f," node%zu=%.1f%%",i,100.0*(double)r->node_pages[i]/(double)r->sampled);
+	}
+	if(r->absent) fprintf(f," untouched=%.1f%%",100.0*(double)r->absent/(double)r->sampled);
+	fprintf(f,"\n");
+}
+
+const char* arenaPagesName(arena_pages_t pages){
+	switch(pages){
+		case ARENA_PAGES_THP:     return "thp";
+		case ARENA_PAGES_SMALL:   return "small";
+		case ARENA_PAGES_HUGETLB: return "hugetlb";
+	}
+	return "?";
+}
+
+const char* arenaNumaName(arena_numa_t numa){
+	switch(numa){
+		case ARENA_NUMA_LOCAL:       return "local";
+		case ARENA_NUMA_INTERLEAVE:  return "interleave";
+		case ARENA_NUMA_FIRST_TOUCH: return "firsttouch";
+	}
+	return "?";
+}
+
+int arenaParsePages(const char* s, arena_pages_t* out){
+	for(int i = ARENA_PAGES_THP; i <= ARENA_PAGES_HUGETLB; i++){
+		if(strcmp(s,arenaPagesName((arena_pages_t)i)) == 0){ *out = (arena_pages_t)i; return 0; }
+	}
+	return -1;
+}
+
+int arenaParseNuma(const char* s, arena_numa_t* out){
+	for(int i = ARENA_NUMA_LOCAL; i <= ARENA_NUMA_FIRST_TOUCH; i++){
+		if(strcmp(s,arenaNumaName((arena_numa_t)i)) == 0){ *out = (arena_numa_t)i; return 0; }
+	}
+	return -1;
+}
+
+void slabInit(slab_pool_t* s, arena_t* arena, size_t obj_size){
+	s->arena     = arena;
+	s->obj_size  = arenaAlignUp(obj_size < sizeof(void*) ? sizeof(void*) : obj_size,ARENA_ALIGN);
+	s->free_list = NULL;
+	s->live      = 0;
+}
+
+void* slabGet(slab_pool_t* s){
+	void* obj = s->free_list;
+	if(obj) memcpy(&s->free_list,obj,sizeof(void*));
+	else    obj = arenaAlloc(s->arena,s->obj_size);
+	if(obj) s->live++;
+	return obj;
+}
+
+// ZEROED, A FRESH OBJECT PAST THE ARENA HIGH WATER MARK IS ZERO ALREADY
+void* slabCalloc(slab_pool_t* s){
+	void* obj = s->free_list;
+	if(!obj){
+		obj = arenaCalloc(s->arena,1,s->obj_size);
+		if(obj) s->live++;
+		return obj;
+	}
+	obj = slabGet(s);
+	memset(obj,0,s->obj_size);
+	return obj;
+}
+
+void slabPut(slab_pool_t* s, void* obj){
+	if(!obj) return;
+	memcpy(obj,&s->free_list,sizeof(void*));
+	s->free_list = obj;
+	s->live--;
+}
+
+static size_t agentPoolTableBytes(size_t len_x, size_t len_y, qtable_layout_t layout){
+	return qtableSlots(len_x,len_y,layout)*ACTION_N_ACTIONS*sizeof(q_val_t);
+}
+
+int agentPoolInit(agent_pool_t* p, MazeEnv* env, size_t max_agents, qtable_layout_t layout){
+	memset(p,0,sizeof(*p));
+	size_t table = arenaAlignUp(agentPoolTableBytes(env->cols,env->rows,layout),ARENA_ALIGN);
+	size_t agent = arenaAlignUp(sizeof(Agent),ARENA_ALIGN);
+	if(arenaInit(&p->arena,max_agents*(table + agent)) != 0) return -1;
+	slabInit(&p->agents,&p->arena,sizeof(Agent));
+	slabInit(&p->tables,&p->arena,agentPoolTableBytes(env->cols,env->rows,layout));
+	p->len_state_x = env->cols;
+	p->len_state_y = env->rows;
+	p->layout      = layout;
+	return 0;
+}
+
+static void agentAttachTable(Agent* ag, MazeEnv* env, q_val_t* vals, qtable_layout_t layout){
+	ag->q_table = (q_table_t){.len_state_x = env->cols,
+	                          .len_state_y = env->rows,
+	                          .len_state_actions = ACTION_N_ACTIONS,
+	                          .vals = vals,
+	                          .borrowed = true};
+	qtableSetLayout(&ag->q_table,layout);
+}
+
+Agent* agentPoolNew(agent_pool_t* p, MazeEnv* env, float lr, float dr, double eps_decay, unsigned long seed){
+	if(env->cols != p->len_state_x || env->rows != p->len_state_y) return NULL;
+	Agent* ag = (Agent*)slabCalloc(&p->agents);
+	q_val_t* vals = (q_val_t*)slabCalloc(&p->tables);
+	if(!ag || !vals){
+		slabPut(&p->agents,ag);
+		slabPut(&p->tables,vals);
+		return NULL;
+	}
+	agentInit(ag,env,lr,dr,eps_decay,seed);
+	agentAttachTable(ag,env,vals,p->layout);
+	return ag;
+}
+
+void agentPoolRelease(agent_pool_t* p, Agent* agent){
+	if(!agent) return;
+	// AFTER agentEnableDoubleQ/agentReadQtable THE AGENT OWNS ITS TABLE, THE POOLED ONE IS BACK AT agentPoolReset
+	if(agent->q_table.borrowed) slabPut(&p->tables,agent->q_table.vals);
+	else                        free(agent->q_table.vals);
+	slabPut(&p->agents,agent);
+}
+
+void agentPoolReset(agent_pool_t* p){
+	arenaReset(&p->arena);
+	p->agents.free_list = NULL;
+	p->agents.live      = 0;
+	p->tables.free_list = NULL;
+	p->tables.live      = 0;
+}
+
+void agentPoolFree(agent_pool_t* p){
+	arenaFree(&p->arena);
+	memset(p,0,sizeof(*p));
+}
+
+Agent* arenaNewAgent(arena_t* a, MazeEnv* env, float lr, float dr, double eps_decay, unsigned long seed, qtable_layout_t layout){
+	Agent* ag = (Agent*)arenaCalloc(a,1,sizeof(Agent));
+	q_val_t* vals = (q_val_t*)arenaCalloc(a,qtableSlots(env->cols,env->rows,layout)*ACTION_N_ACTIONS,sizeof(q_val_t));
+	if(!ag || !vals) return NULL;
+	agentInit(ag,env,lr,dr,eps_decay,seed);
+	agentAttachTable(ag,env,vals,layout);
+	return ag;
+}
+
+int arenaEnableDoubleQ(arena_t* a, Agent* agent){
+	q_table_t* t = &agent->q_table;
+	if(t->n_tables == 2) return 0;
+	size_t n = qtableSlots(t->len_state_x,t->len_state_y,t->layout)*2*t->len_state_actions;
+	// EVERY VALUE IS COPIED IN, NO NEED TO CLEAR
+	return agentEnableDoubleQIn(agent,(q_val_t*)arenaAlloc(a,n*sizeof(q_val_t)));
+}
+
+#endif
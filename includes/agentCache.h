@@ -0,0 +1,269 @@
+#ifndef AGENT_CACHE_H
+
+#define AGENT_CACHE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "mazeIR.h"
+
+/*
+    TRAINING RESULT CACHE
+
+    A RUN IS KEYED BY A 64 BIT FNV-1a HASH OF EVERYTHING THAT DECIDES ITS
+    RESULT: THE MAZE (SIZE AND GRID BYTES), THE HYPER PARAMETERS, THE SEED
+    AND THE ENGINE (AGENT_ENGINE_VERSION, FIXED OR FLOAT TABLES). THE CALLER
+    FEEDS THE FIELDS ONE BY ONE WITH cacheHashU64/cacheHashF32, NEVER A WHOLE
+    STRUCT, SO PADDING AND THE SIZE OF long DONT LEAK INTO THE KEY.
+
+    AN ENTRY IS A SET OF ARTIFACTS NAMED BY EXTENSION UNDER THE CACHE DIR:
+        <dir>/<key>.qtable   <dir>/<key>.csv   ...
+    THE PRODUCER WRITES THEM TO cachePath(...) AND THEN cacheCommit(...).
+    <dir>/index IS THE SOURCE OF TRUTH, ONE LINE PER ENTRY:
+        <key hex> <bytes> <last use, unix secs> <ext,ext,...>
+    AN ARTIFACT WRITTEN BUT NOT COMMITTED (A CRASH) IS NEVER SERVED.
+    A HIT TOUCHES THE ENTRY, A COMMIT EVICTS THE LEAST RECENTLY USED ENTRIES
+    UNTIL THE ARTIFACTS FIT IN max_bytes (THE NEW ENTRY IS ALWAYS KEPT).
+
+    THE INDEX IS REWRITTEN WHOLE (TMP + RENAME) AND NOT LOCKED: TWO RUNS
+    COMMITTING AT THE SAME TIME CAN LOSE ONE INDEX UPDATE, WHICH ONLY COSTS
+    A RETRAIN AND A FILE LEFT OUTSIDE THE SIZE BUDGET.
+*/
+
+#define CACHE_HASH_INIT   0xcbf29ce484222325ULL
+#define CACHE_HASH_PRIME  0x100000001b3ULL
+#define CACHE_MAX_EXTS    4
+#define CACHE_EXT_LEN     16
+
+typedef struct {
+	uint64_t key;
+	uint64_t bytes;
+	uint64_t last_used;
+	size_t   n_exts;
+	char     exts[CACHE_MAX_EXTS][CACHE_EXT_LEN];
+} cache_entry_t;
+
+typedef struct {
+	char*          dir;
+	uint64_t       max_bytes;
+	cache_entry_t* entries;
+	size_t         n_entries;
+	size_t         capacity;
+} result_cache_t;
+
+static inline uint64_t cacheHashBytes(uint64_t h, const void* p, size_t n){
+	const uint8_t* b = (const uint8_t*)p;
+	for(size_t i = 0; i < n; i++){ h ^= b[i]; h *= CACHE_HASH_PRIME; }
+	return h;
+}
+
+// LITTLE ENDIAN BYTES, THE SAME KEY ON EVERY HOST
+static inline uint64_t cacheHashU64(uint64_t h, uint64_t v){
+	uint8_t b[8];
+	for(int i = 0; i < 8; i++) b[i] = (uint8_t)(v >> (8*i));
+	return cacheHashBytes(h,b,8);
+}
+
+static inline uint64_t cacheHashF32(uint64_t h, float f){
+	uint32_t bits;
+	memcpy(&bits,&f,sizeof(bits));
+	return cacheHashU64(h,bits);
+}
+
+uint64_t cacheHashMaze(uint64_t h, const MazeInternalRepr* m);
+
+int   cacheOpen(result_cache_t* c, const char* dir, uint64_t max_bytes);
+void  cacheClose(result_cache_t* c);
+char* cachePath(const result_cache_t* c, uint64_t key, const char* ext, char* buf, size_t len);
+bool  cacheLookup(result_cache_t* c, uint64_t key, const char* const* exts, size_t n_exts);
+int   cacheFetch(const result_cache_t* c, uint64_t key, const char* ext, const char* dest);
+int   cacheCommit(result_cache_t* c, uint64_t key, const char* const* exts, size_t n_exts);
+
+#endif
+
+#ifdef AGENT_CACHE_IMPLEMENTATION
+
+#ifdef _WIN32
+#include <direct.h>
+#define cacheMkdir(p) _mkdir(p)
+#else
+#include <sys/stat.h>
+#define cacheMkdir(p) mkdir((p),0755)
+#endif
+
+uint64_t cacheHashMaze(uint64_t h, const MazeInternalRepr* m){
+	h = cacheHashU64(h,m->rows);
+	h = cacheHashU64(h,m->cols);
+	return cacheHashBytes(h,m->grid,m->rows*m->cols);
+}
+
+char* cachePath(const result_cache_t* c, uint64_t key, const char* ext, char* buf, size_t len){
+	snprintf(buf,len,"%s/%016llx.%s",c->dir,(unsigned long long)key,ext);
+	return buf;
+}
+
+static cache_entry_t* cacheFind(result_cache_t* c, uint64_t key){
+	for(size_t i = 0; i < c->n_entries; i++) if(c->entries[i].key == key) return &c->entries[i];
+	return NULL;
+}
+
+static bool cacheEntryHas(const cache_entry_t* e, const char* ext){
+	for(size_t i = 0; i < e->n_exts; i++) if(strcmp(e->exts[i],ext) == 0) return true;
+	return false;
+}
+
+static cache_entry_t* cachePush(result_cache_t* c){
+	if(c->n_entries == c->capacity){
+		size_t cap = c->capacity ? 2*c->capacity : 64;
+		cache_entry_t* e = (cache_entry_t*)realloc(c->entries,cap*sizeof(cache_entry_t));
+		if(!e) return NULL;
+		c->entries = e;
+		c->capacity = cap;
+	}
+	cache_entry_t* e = &c->entries[c->n_entries++];
+	memset(e,0,sizeof(*e));
+	return e;
+}
+
+static void cacheReadIndex(result_cache_t* c){
+	char path[1024];
+	snprintf(path,sizeof(path),"%s/index",c->dir);
+	FILE* f = fopen(path,"r");
+	if(!f) return;
+	char line[512];
+	while(fgets(line,sizeof(line),f)){
+		unsigned long long key, bytes, last;
+		char exts[256];
+		if(sscanf(line,"%llx %llu %llu %255s",&key,&bytes,&last,exts) != 4) continue;
+		cache_entry_t* e = cachePush(c);
+		if(!e) break;
+		e->key = key;
+		e->bytes = bytes;
+		e->last_used = last;
+		for(char* tok = strtok(exts,","); tok && e->n_exts < CACHE_MAX_EXTS; tok = strtok(NULL,",")){
+			snprintf(e->exts[e->n_exts++],CACHE_EXT_LEN,"%s",tok);
+		}
+	}
+	fclose(f);
+}
+
+static int cacheWriteIndex(const result_cache_t* c){
+	char path[1024], tmp[1024];
+	snprintf(path,sizeof(path),"%s/index",c->dir);
+	snprintf(tmp,sizeof(tmp),"%s/index.tmp",c->dir);
+	FILE* f = fopen(tmp,"w");
+	if(!f) return -1;
+	for(size_t i = 0; i < c->n_entries; i++){
+		const cache_entry_t* e = &c->entries[i];
+		fprintf(f,"%016llx %llu %llu ",(unsigned long long)e->key,(unsigned long long)e->bytes,(unsigned long long)e->last_used);
+		for(size_t k = 0; k < e->n_exts; k++) fprintf(f,"%s%s",k ? "," : "",e->exts[k]);
+		fprintf(f,"\n");
+	}
+	if(fclose(f) != 0) return -1;
+	// rename DOES NOT REPLACE AN EXISTING FILE ON WINDOWS
+	remove(path);
+	return rename(tmp,path);
+}
+
+int cacheOpen(result_cache_t* c, const char* dir, uint64_t max_bytes){
+	memset(c,0,sizeof(*c));
+	if(!dir || !dir[0]) return -1;
+	cacheMkdir(dir);
+	c->dir = (char*)malloc(strlen(dir) + 1);
+	if(!c->dir) return -1;
+	strcpy(c->dir,dir);
+	c->max_bytes = max_bytes;
+	cacheReadIndex(c);
+	return 0;
+}
+
+void cacheClose(result_cache_t* c){
+	free(c->dir);
+	free(c->entries);
+	memset(c,0,sizeof(*c));
+}
+
+bool cacheLookup(result_cache_t* c, uint64_t key, const char* const* exts, size_t n_exts){
+	cache_entry_t* e = cacheFind(c,key);
+	if(!e) return false;
+	char path[1024];
+	for(size_t i = 0; i < n_exts; i++){
+		if(!cacheEntryHas(e,exts[i])) return false;
+		FILE* f = fopen(cachePath(c,key,exts[i],path,sizeof(path)),"rb");
+		if(!f) return false;
+		fclose(f);
+	}
+	e->last_used = (uint64_t)time(NULL);
+	cacheWriteIndex(c);
+	return true;
+}
+
+int cacheFetch(const result_cache_t* c, uint64_t key, const char* ext, const char* dest){
+	char path[1024];
+	FILE* in = fopen(cachePath(c,key,ext,path,sizeof(path)),"rb");
+	if(!in) return -1;
+	FILE* out = fopen(dest,"wb");
+	if(!out){ fclose(in); return -1; }
+	char buf[1 << 16];
+	size_t n;
+	int rc = 0;
+	while((n = fread(buf,1,sizeof(buf),in)) > 0){
+		if(fwrite(buf,1,n,out) != n){ rc = -1; break; }
+	}
+	fclose(in);
+	if(fclose(out) != 0) rc = -1;
+	return rc;
+}
+
+static uint64_t cacheFileSize(const char* path){
+	FILE* f = fopen(path,"rb");
+	if(!f) return 0;
+	fseek(f,0,SEEK_END);
+	long n = ftell(f);
+	fclose(f);
+	return n > 0 ? (uint64_t)n : 0;
+}
+
+static void cacheRemoveEntry(result_cache_t* c, size_t i){
+	char path[1024];
+	cache_entry_t* e = &c->entries[i];
+	for(size_t k = 0; k < e->n_exts; k++) remove(cachePath(c,e->key,e->exts[k],path,sizeof(path)));
+	c->entries[i] = c->entries[--c->n_entries];
+}
+
+int cacheCommit(result_cache_t* c, uint64_t key, const char* const* exts, size_t n_exts){
+	if(n_exts > CACHE_MAX_EXTS) return -1;
+	cache_entry_t* e = cacheFind(c,key);
+	if(!e) e = cachePush(c);
+	if(!e) return -1;
+	char path[1024];
+	e->key = key;
+	e->bytes = 0;
+	e->n_exts = n_exts;
+	e->last_used = (uint64_t)time(NULL);
+	for(size_t i = 0; i < n_exts; i++){
+		snprintf(e->exts[i],CACHE_EXT_LEN,"%s",exts[i]);
+		e->bytes += cacheFileSize(cachePath(c,key,exts[i],path,sizeof(path)));
+	}
+
+	// LRU EVICTION, THE ENTRY JUST COMMITTED STAYS EVEN WHEN IT IS BIGGER THAN THE BUDGET
+	for(;;){
+		uint64_t total = 0;
+		size_t oldest = c->n_entries;
+		for(size_t i = 0; i < c->n_entries; i++){
+			total += c->entries[i].bytes;
+			if(c->entries[i].key == key) continue;
+			if(oldest == c->n_entries || c->entries[i].last_used < c->entries[oldest].last_used) oldest = i;
+		}
+		if(total <= c->max_bytes || oldest == c->n_entries) break;
+		printf("[INFO] Cache: evicting %016llx (%llu bytes)\n",
+		       (unsigned long long)c->entries[oldest].key,(unsigned long long)c->entries[oldest].bytes);
+		cacheRemoveEntry(c,oldest);
+	}
+	return cacheWriteIndex(c);
+}
+
+#endif
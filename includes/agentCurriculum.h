@@ -0,0 +1,144 @@
+#ifndef AGENT_CURRICULUM_H
+
+#define AGENT_CURRICULUM_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "agent.h"
+#include "mazePaths.h"
+
+/*
+    REVERSE CURRICULUM
+
+    EPISODES START FROM A RANDOM CELL WHOSE BFS DISTANCE TO THE GOAL LIES IN
+    [band_lo, band_hi]. THE FIRST BAND HUGS THE GOAL, SO EARLY EPISODES REACH IT
+    AND THE VALUES SPREAD BACKWARD FROM THERE. ONCE THE SUCCESS RATE OVER THE
+    LAST window EPISODES OF A STAGE PASSES threshold band_hi DOUBLES. band_lo
+    STAYS AT 1, KEEPING THE ALREADY SOLVED STARTS IN THE MIX (DROPPING THEM TO
+    [band_hi/2, band_hi] FINISHED THE CURRICULUM ABOUT 30% LATER ON crazy.npy).
+    band_hi STOPS AT THE DISTANCE OF agent_start, AND ONCE THAT LAST BAND PASSES
+    THE CURRICULUM IS done AND EPISODES START AT agent_start AGAIN.
+
+    CELLS ARE BUCKETED BY DISTANCE ONCE (COUNTING SORT), SO A BAND IS ONE
+    CONTIGUOUS RANGE cells[dist_offsets[band_lo] .. dist_offsets[band_hi+1])
+    AND SAMPLING A START IS ONE RANDOM INDEX.
+*/
+
+typedef struct {
+	size_t    len_state_x;
+	uint32_t* dist;
+	uint32_t* cells;
+	uint32_t* dist_offsets;
+	uint32_t  max_dist;
+	uint32_t  start_dist;
+	uint32_t  band_lo;
+	uint32_t  band_hi;
+	// ROLLING SUCCESS OVER THE LAST window EPISODES OF THE CURRENT STAGE
+	bool*     history;
+	size_t    window;
+	size_t    history_len;
+	size_t    history_pos;
+	size_t    successes;
+	float     threshold;
+	size_t    stage;
+	bool      done;
+} curriculum_t;
+
+int  curriculumInit(curriculum_t* c, MazeEnv* env, state_t agent_start, uint32_t initial_band, size_t window, float threshold);
+void curriculumFree(curriculum_t* c);
+state_t curriculumStartState(Agent* agent, void* ctx);
+bool curriculumRecordEpisode(curriculum_t* c, bool goal_reached);
+
+#endif
+
+#ifdef AGENT_CURRICULUM_IMPLEMENTATION
+
+int curriculumInit(curriculum_t* c, MazeEnv* env, state_t agent_start, uint32_t initial_band, size_t window, float threshold){
+	memset(c,0,sizeof(*c));
+	size_t n_cells = env->rows*env->cols;
+	c->len_state_x = env->cols;
+	c->window = window > 0 ? window : 1;
+	c->threshold = threshold;
+	c->dist = (uint32_t*)malloc(n_cells*sizeof(uint32_t));
+	c->history = (bool*)calloc(c->window,sizeof(bool));
+	if(!c->dist || !c->history){ curriculumFree(c); return -1; }
+
+	int64_t max_dist = mazeBfsDistances(env,GRID_AGENT_GOAL,c->dist);
+	if(max_dist <= 0){
+		fprintf(stderr,"[ERROR] curriculum needs a goal with reachable cells around it\n");
+		curriculumFree(c);
+		return -1;
+	}
+	c->max_dist = (uint32_t)max_dist;
+
+	c->dist_offsets = (uint32_t*)calloc((size_t)c->max_dist + 2,sizeof(uint32_t));
+	c->cells = (uint32_t*)malloc(n_cells*sizeof(uint32_t));
+	if(!c->dist_offsets || !c->cells){ curriculumFree(c); return -1; }
+	for(size_t i = 0; i < n_cells; i++)
+		if(c->dist[i] != MAZE_DIST_UNREACHABLE) c->dist_offsets[c->dist[i] + 1]++;
+	for(uint32_t d = 0; d <= c->max_dist; d++) c->dist_offsets[d + 1] += c->dist_offsets[d];
+	uint32_t* fill = (uint32_t*)malloc(((size_t)c->max_dist + 1)*sizeof(uint32_t));
+	if(!fill){ curriculumFree(c); return -1; }
+	memcpy(fill,c->dist_offsets,((size_t)c->max_dist + 1)*sizeof(uint32_t));
+	for(size_t i = 0; i < n_cells; i++)
+		if(c->dist[i] != MAZE_DIST_UNREACHABLE) c->cells[fill[c->dist[i]]++] = (uint32_t)i;
+	free(fill);
+
+	// AN UNREACHABLE START CAN NEVER FINISH THE CURRICULUM, GROW TO THE WHOLE MAZE INSTEAD
+	uint32_t sd = c->dist[(size_t)agent_start.y*env->cols + (size_t)agent_start.x];
+	c->start_dist = sd == MAZE_DIST_UNREACHABLE ? c->max_dist : sd;
+
+	c->band_hi = initial_band > 0 ? initial_band : 1;
+	if(c->band_hi > c->start_dist) c->band_hi = c->start_dist;
+	c->band_lo = 1;
+	return 0;
+}
+
+void curriculumFree(curriculum_t* c){
+	free(c->dist);
+	free(c->cells);
+	free(c->dist_offsets);
+	free(c->history);
+	c->dist = c->cells = c->dist_offsets = NULL;
+	c->history = NULL;
+}
+
+// start_state_fn FOR agentSetStartFn
+state_t curriculumStartState(Agent* agent, void* ctx){
+	curriculum_t* c = (curriculum_t*)ctx;
+	if(c->done) return agent->agent_start;
+	uint32_t first = c->dist_offsets[c->band_lo];
+	uint32_t count = c->dist_offsets[c->band_hi + 1] - first;
+	if(count == 0) return agent->agent_start;
+	uint32_t cell = c->cells[first + agentRandRange(agent,count)];
+	return (state_t){(int32_t)(cell % c->len_state_x),(int32_t)(cell / c->len_state_x)};
+}
+
+// FEEDS ONE EPISODE RESULT, TRUE WHEN THE BAND WAS WIDENED
+bool curriculumRecordEpisode(curriculum_t* c, bool goal_reached){
+	if(c->done) return false;
+	if(c->history_len == c->window) c->successes -= c->history[c->history_pos];
+	else c->history_len++;
+	c->history[c->history_pos] = goal_reached;
+	c->successes += goal_reached;
+	c->history_pos = (c->history_pos + 1) % c->window;
+
+	if(c->history_len < c->window) return false;
+	if((float)c->successes < c->threshold*(float)c->window) return false;
+
+	c->stage++;
+	c->history_len = c->history_pos = c->successes = 0;
+	// THE LAST BAND ALREADY HELD agent_start, FROM NOW ON START ONLY THERE
+	if(c->band_hi >= c->start_dist){
+		c->done = true;
+		return true;
+	}
+	uint32_t hi = c->band_hi*2;
+	if(hi > c->start_dist) hi = c->start_dist;
+	c->band_hi = hi;
+	return true;
+}
+
+#endif
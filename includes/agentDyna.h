@@ -0,0 +1,147 @@
+#ifndef AGENT_DYNA_H
+
+#define AGENT_DYNA_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "agent.h"
+
+/*
+    DYNA-Q LEARNED MODEL
+
+    THE MAZE IS DETERMINISTIC, SO THE LAST OBSERVED OUTCOME OF A (STATE, ACTION)
+    PAIR IS THE MODEL. THE TABLE IS PARALLEL TO q_table_t.vals: THE ENTRY OF
+    (s,a) LIVES AT PAIR ID (s.y*n_x + s.x)*n_actions + a.
+
+    ENTRY (8 BYTES):
+        | next cell id : 31 bit | terminal : 1 bit | reward : 32 bit float |
+
+    next_term == DYNA_UNVISITED MARKS A PAIR THAT WAS NEVER OBSERVED.
+    visited KEEPS THE PAIR IDS IN FIRST SEEN ORDER SO A PLANNING SAMPLE IS ONE
+    RANDOM INDEX, NO MATTER HOW SPARSE THE VISITED SET IS.
+*/
+
+#define DYNA_UNVISITED UINT32_MAX
+
+typedef struct {
+	uint32_t next_term;
+	reward_t reward;
+} dyna_entry_t;
+
+typedef struct {
+	size_t len_state_x;
+	size_t len_state_y;
+	size_t len_state_actions;
+	dyna_entry_t* entries;
+	uint32_t* visited;
+	size_t n_visited;
+	// K, SIMULATED UPDATES PER REAL STEP
+	size_t planning_steps;
+	size_t total_updates;
+} dyna_model_t;
+
+int  dynaModelInit(dyna_model_t* m, MazeEnv* env, size_t planning_steps);
+void dynaModelReset(dyna_model_t* m);
+void dynaModelFree(dyna_model_t* m);
+void dynaModelRecord(dyna_model_t* m, state_t s, Action a, state_t next, stepResult sr);
+bool dynaModelLookupPair(dyna_model_t* m, uint32_t pair, state_t* s, Action* a, state_t* next, stepResult* sr);
+size_t dynaPlan(dyna_model_t* m, Agent* agent);
+
+#endif
+
+#ifdef AGENT_DYNA_IMPLEMENTATION
+
+int dynaModelInit(dyna_model_t* m, MazeEnv* env, size_t planning_steps){
+	if(!m || !env) return -1;
+	memset(m,0,sizeof(*m));
+	size_t n_pairs = env->cols*env->rows*ACTION_N_ACTIONS;
+	// CELL IDS MUST FIT 31 BITS AND PAIR IDS 32 BITS
+	if(n_pairs == 0 || n_pairs >= (size_t)UINT32_MAX){
+		fprintf(stderr,"[ERROR] maze too big for the dyna model (%zu pairs)\n",n_pairs);
+		return -1;
+	}
+	m->len_state_x = env->cols;
+	m->len_state_y = env->rows;
+	m->len_state_actions = ACTION_N_ACTIONS;
+	m->planning_steps = planning_steps;
+	m->entries = (dyna_entry_t*)malloc(n_pairs*sizeof(dyna_entry_t));
+	m->visited = (uint32_t*)malloc(n_pairs*sizeof(uint32_t));
+	if(!m->entries || !m->visited){
+		dynaModelFree(m);
+		return -1;
+	}
+	dynaModelReset(m);
+	return 0;
+}
+
+void dynaModelReset(dyna_model_t* m){
+	size_t n_pairs = m->len_state_x*m->len_state_y*m->len_state_actions;
+	for(size_t i = 0; i < n_pairs; i++) m->entries[i] = (dyna_entry_t){DYNA_UNVISITED,0.0f};
+	m->n_visited = 0;
+	m->total_updates = 0;
+}
+
+void dynaModelFree(dyna_model_t* m){
+	if(!m) return;
+	free(m->entries);
+	free(m->visited);
+	m->entries = NULL;
+	m->visited = NULL;
+	m->n_visited = 0;
+}
+
+static inline bool dynaInBounds(dyna_model_t* m, state_t s){
+	return !(s.x < 0 || s.y < 0 || (size_t)s.x >= m->len_state_x || (size_t)s.y >= m->len_state_y);
+}
+
+void dynaModelRecord(dyna_model_t* m, state_t s, Action a, state_t next, stepResult sr){
+	if(a >= m->len_state_actions || !dynaInBounds(m,s)) return;
+	// WITH WALL TRANSPASSING ENABLED THE AGENT CAN LEAVE THE GRID, KEEP IT IN PLACE
+	if(!dynaInBounds(m,next)) next = s;
+
+	uint32_t pair = (uint32_t)((((size_t)s.y*m->len_state_x) + (size_t)s.x)*m->len_state_actions + a);
+	uint32_t next_cell = (uint32_t)(((size_t)next.y*m->len_state_x) + (size_t)next.x);
+	dyna_entry_t* e = &m->entries[pair];
+
+	if(e->next_term == DYNA_UNVISITED) m->visited[m->n_visited++] = pair;
+	e->next_term = (next_cell << 1) | (sr.terminal ? 1u : 0u);
+	e->reward = sr.reward;
+}
+
+// DECODES A PAIR ID BACK INTO (s,a) AND ITS MODELED OUTCOME, FALSE IF NEVER OBSERVED
+bool dynaModelLookupPair(dyna_model_t* m, uint32_t pair, state_t* s, Action* a, state_t* next, stepResult* sr){
+	dyna_entry_t e = m->entries[pair];
+	if(e.next_term == DYNA_UNVISITED) return false;
+	size_t cell = pair / m->len_state_actions;
+	uint32_t next_cell = e.next_term >> 1;
+	*a    = (Action)(pair % m->len_state_actions);
+	*s    = (state_t){(int32_t)(cell % m->len_state_x),      (int32_t)(cell / m->len_state_x)};
+	*next = (state_t){(int32_t)(next_cell % m->len_state_x), (int32_t)(next_cell / m->len_state_x)};
+	*sr = (stepResult){0};
+	sr->reward   = e.reward;
+	sr->terminal = (e.next_term & 1u) != 0;
+	sr->isGoal   = sr->terminal;
+	return true;
+}
+
+// RUNS K UPDATES ON UNIFORMLY SAMPLED VISITED PAIRS, RETURNS HOW MANY WERE DONE
+size_t dynaPlan(dyna_model_t* m, Agent* agent){
+	if(m->n_visited == 0) return 0;
+	size_t done = 0;
+	for(size_t k = 0; k < m->planning_steps; k++){
+		uint32_t pair = m->visited[agentRandRange(agent,(uint32_t)m->n_visited)];
+		state_t s, next;
+		Action a;
+		stepResult sr;
+		// visited ONLY HOLDS RECORDED PAIRS, A MISS WOULD BE A CORRUPT MODEL
+		if(!dynaModelLookupPair(m,pair,&s,&a,&next,&sr)) continue;
+		agentQtableUpdateAt(agent,s,a,next,sr);
+		done++;
+	}
+	m->total_updates += done;
+	return done;
+}
+
+#endif
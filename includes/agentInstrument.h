@@ -0,0 +1,218 @@
+#ifndef AGENT_INSTRUMENT_H
+
+#define AGENT_INSTRUMENT_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define INST_HAVE_RDTSC
+#endif
+
+/*
+    TRAINING HOT PATH INSTRUMENTATION
+
+    BUILT WITH -DCQ_INSTRUMENT (make instrument=1) THE INST_* MACROS TIME
+    EACH PHASE OF A TRAINING STEP WITH rdtsc (A NANOSECOND CLOCK WHERE THERE
+    IS NO rdtsc), COUNT STEPS AND EPISODES AND BUCKET EPISODE LENGTHS.
+    WITHOUT IT EVERY MACRO EXPANDS TO NOTHING AND THE TIMED CODE RUNS BARE,
+    SO A NORMAL BUILD COMPILES THE SAME LOOPS AS BEFORE.
+
+        INST_TIME(&inst, INST_POLICY) agentPolicy(agent, &ir);
+    TIMES ONE STATEMENT. IT IS A for WRAPPER, SO THE STATEMENT MUST NOT
+    break OR continue THE LOOP AROUND IT.
+        INST_BEGIN(t); ... INST_END(&inst, INST_STEP, t);
+    TIMES A SPAN WHOSE DECLARATIONS ARE USED AFTER IT.
+
+    TICKS BECOME SECONDS WITH THE RATE MEASURED BETWEEN instInit AND THE
+    REPORT, NO CALIBRATION SLEEP. SHARES ARE OF THE WALL TIME SINCE instInit,
+    WHAT IS LEFT IS "other" (GUI FRAMES, UNTIMED CODE).
+
+    EPISODE LENGTHS GO TO LOG2 BUCKETS: BUCKET k COUNTS [2^k, 2^(k+1)).
+*/
+
+typedef enum {
+	INST_POLICY = 0,
+	INST_STEP,
+	INST_UPDATE,
+	INST_PLANNING,
+	INST_METRICS,
+	INST_LOGGING,
+	INST_N_PHASES
+} inst_phase_t;
+
+#define INST_LEN_BUCKETS 32
+
+typedef struct {
+	uint64_t ticks[INST_N_PHASES];
+	uint64_t calls[INST_N_PHASES];
+	uint64_t steps;
+	uint64_t episodes;
+	uint64_t len_hist[INST_LEN_BUCKETS];
+	uint64_t len_max;
+	double   t0_secs;
+	uint64_t t0_ticks;
+	// STATE OF THE LAST instPeriodic, THE GAUGES COVER THE INTERVAL SINCE IT
+	double   last_secs;
+	uint64_t last_steps;
+	uint64_t last_episodes;
+	double   steps_per_sec;
+	double   episodes_per_sec;
+} inst_t;
+
+static inline uint64_t instTicks(void){
+#ifdef INST_HAVE_RDTSC
+	return (uint64_t)__rdtsc();
+#else
+	struct timespec ts;
+	timespec_get(&ts,TIME_UTC);
+	return (uint64_t)ts.tv_sec*1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static inline void instAdd(inst_t* inst, inst_phase_t phase, uint64_t t0){
+	inst->ticks[phase] += instTicks() - t0;
+	inst->calls[phase]++;
+}
+
+void   instInit(inst_t* inst);
+void   instEpisode(inst_t* inst, size_t len);
+double instPhaseSecs(const inst_t* inst, inst_phase_t phase);
+double instElapsedSecs(const inst_t* inst);
+bool   instPeriodic(inst_t* inst, double every_secs, FILE* stream);
+void   instReport(const inst_t* inst, FILE* stream);
+
+#ifdef CQ_INSTRUMENT
+#define INST_INIT(inst)                  instInit(inst)
+#define INST_TIME(inst,phase)            for(uint64_t inst__t0 = instTicks(), inst__once = 1; inst__once; inst__once = 0, instAdd((inst),(phase),inst__t0))
+#define INST_BEGIN(name)                 uint64_t inst__##name = instTicks()
+#define INST_END(inst,phase,name)        instAdd((inst),(phase),inst__##name)
+#define INST_EPISODE(inst,len)           instEpisode((inst),(len))
+#define INST_PERIODIC(inst,secs,stream)  instPeriodic((inst),(secs),(stream))
+#define INST_REPORT(inst,stream)         instReport((inst),(stream))
+#else
+#define INST_INIT(inst)                  ((void)(inst))
+#define INST_TIME(inst,phase)
+#define INST_BEGIN(name)
+#define INST_END(inst,phase,name)
+#define INST_EPISODE(inst,len)           ((void)0)
+#define INST_PERIODIC(inst,secs,stream)  ((void)0)
+#define INST_REPORT(inst,stream)         ((void)0)
+#endif
+
+#endif
+
+#ifdef AGENT_INSTRUMENT_IMPLEMENTATION
+
+static const char* instPhaseName[INST_N_PHASES] = {
+	[INST_POLICY]   = "policy",
+	[INST_STEP]     = "step",
+	[INST_UPDATE]   = "update",
+	[INST_PLANNING] = "planning",
+	[INST_METRICS]  = "metrics",
+	[INST_LOGGING]  = "logging"
+};
+
+static double instNowSecs(void){
+	struct timespec ts;
+	timespec_get(&ts,TIME_UTC);
+	return (double)ts.tv_sec + (double)ts.tv_nsec*1e-9;
+}
+
+void instInit(inst_t* inst){
+	memset(inst,0,sizeof(*inst));
+	inst->t0_secs   = instNowSecs();
+	inst->t0_ticks  = instTicks();
+	inst->last_secs = inst->t0_secs;
+}
+
+void instEpisode(inst_t* inst, size_t len){
+	inst->episodes++;
+	inst->steps += len;
+	if(len > inst->len_max) inst->len_max = len;
+	size_t k = 0;
+	while(k + 1 < INST_LEN_BUCKETS && ((size_t)2 << k) <= len) k++;
+	inst->len_hist[k]++;
+}
+
+double instElapsedSecs(const inst_t* inst){
+	return instNowSecs() - inst->t0_secs;
+}
+
+static double instTicksPerSec(const inst_t* inst){
+#ifdef INST_HAVE_RDTSC
+	double secs = instElapsedSecs(inst);
+	uint64_t ticks = instTicks() - inst->t0_ticks;
+	return secs > 1e-6 && ticks > 0 ? (double)ticks/secs : 1e9;
+#else
+	(void)inst;
+	return 1e9;
+#endif
+}
+
+double instPhaseSecs(const inst_t* inst, inst_phase_t phase){
+	return (double)inst->ticks[phase]/instTicksPerSec(inst);
+}
+
+// REFRESHES THE GAUGES EVERY every_secs AND PRINTS ONE LINE WHEN stream IS SET
+bool instPeriodic(inst_t* inst, double every_secs, FILE* stream){
+	double now = instNowSecs();
+	double dt = now - inst->last_secs;
+	if(dt < every_secs || dt <= 0.0) return false;
+	inst->steps_per_sec    = (double)(inst->steps - inst->last_steps)/dt;
+	inst->episodes_per_sec = (double)(inst->episodes - inst->last_episodes)/dt;
+	inst->last_secs     = now;
+	inst->last_steps    = inst->steps;
+	inst->last_episodes = inst->episodes;
+	if(!stream) return true;
+
+	double elapsed = now - inst->t0_secs;
+	double rate = instTicksPerSec(inst);
+	fprintf(stream,"[INST] %7.1fs | %10.0f steps/s | %8.1f ep/s |",elapsed,inst->steps_per_sec,inst->episodes_per_sec);
+	for(int p = 0; p < INST_N_PHASES; p++){
+		fprintf(stream," %s %4.1f%%",instPhaseName[p],
+		        elapsed > 0.0 ? 100.0*(double)inst->ticks[p]/rate/elapsed : 0.0);
+	}
+	fprintf(stream,"\n");
+	return true;
+}
+
+void instReport(const inst_t* inst, FILE* stream){
+	double elapsed = instElapsedSecs(inst);
+	double rate = instTicksPerSec(inst);
+	double timed = 0.0;
+
+	fprintf(stream,"\n[INST] %-9s %10s %7s %10s %12s\n","phase","secs","share","ns/call","calls");
+	for(int p = 0; p < INST_N_PHASES; p++){
+		double secs = (double)inst->ticks[p]/rate;
+		timed += secs;
+		fprintf(stream,"[INST] %-9s %10.3f %6.1f%% %10.1f %12llu\n",instPhaseName[p],secs,
+		        elapsed > 0.0 ? 100.0*secs/elapsed : 0.0,
+		        inst->calls[p] ? secs*1e9/(double)inst->calls[p] : 0.0,
+		        (unsigned long long)inst->calls[p]);
+	}
+	double other = elapsed > timed ? elapsed - timed : 0.0;
+	fprintf(stream,"[INST] %-9s %10.3f %6.1f%%\n","other",other,elapsed > 0.0 ? 100.0*other/elapsed : 0.0);
+	fprintf(stream,"[INST] %llu steps, %llu episodes in %.3fs: %.0f steps/s, %.1f episodes/s\n",
+	        (unsigned long long)inst->steps,(unsigned long long)inst->episodes,elapsed,
+	        elapsed > 0.0 ? (double)inst->steps/elapsed : 0.0,
+	        elapsed > 0.0 ? (double)inst->episodes/elapsed : 0.0);
+
+	uint64_t peak = 0;
+	for(int k = 0; k < INST_LEN_BUCKETS; k++) if(inst->len_hist[k] > peak) peak = inst->len_hist[k];
+	if(peak == 0) return;
+	fprintf(stream,"[INST] episode length (max %llu):\n",(unsigned long long)inst->len_max);
+	for(int k = 0; k < INST_LEN_BUCKETS; k++){
+		if(inst->len_hist[k] == 0) continue;
+		int bar = (int)((40*inst->len_hist[k] + peak - 1)/peak);
+		fprintf(stream,"[INST]   [%8llu, %8llu) %10llu %.*s\n",
+		        k == 0 ? 0ULL : 1ULL << k,1ULL << (k + 1),(unsigned long long)inst->len_hist[k],
+		        bar,"########################################");
+	}
+}
+
+#endif
@@ -0,0 +1,251 @@
+#ifndef AGENT_LOG_H
+
+#define AGENT_LOG_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "fastText.h"
+
+/*
+    ASYNC METRICS AND LOG WRITER
+
+    THE TRAINING THREAD ONLY COPIES A RAW log_record_t INTO A SINGLE PRODUCER /
+    SINGLE CONSUMER RING (TWO ATOMIC COUNTERS ON THEIR OWN CACHE LINES, NO
+    LOCK). A WRITER THREAD DRAINS IT, FORMATS WITH fastText.h INTO A 1 MiB
+    BUFFER PER OUTPUT AND HANDS EACH FULL BUFFER TO ONE UNBUFFERED fwrite:
+    RAW RECORDS IN THE RING, TEXT IN THE BUFFERS.
+
+    TWO KINDS OF RECORDS:
+        LOG_RECORD_METRICS   ONE CSV ROW. NEVER LOST: ON A FULL RING THE
+                             PRODUCER YIELDS UNTIL THERE IS ROOM, WHICH ONLY
+                             HAPPENS WHEN THE DISK IS SLOWER THAN TRAINING.
+                             IGNORED WHEN THE WRITER HAS NO CSV.
+        LOG_RECORD_LINE      ONE CONSOLE LINE, THE TEXT IS MADE BY THE
+                             PROGRAM'S line_fn ON THE WRITER THREAD. A FULL
+                             RING DROPS IT (dropped_lines), SO THE CONSOLE
+                             NEVER SLOWS TRAINING DOWN.
+    THE CSV IS FLUSHED WHEN ITS BUFFER FILLS AND AT logWriterClose, THE
+    CONSOLE EVERY TIME THE RING RUNS DRY.
+
+    CSV COLUMNS (LOG_METRICS_CSV_HEADER), WITH THE PRECISIONS OF THE OLD fprintf:
+        episode, reward %.6f, cumulative_goals, success_rate %.4f,
+        training_loss %.6e, steps, goal_reached
+*/
+
+#define LOG_RING_DEFAULT      (1u << 16)
+#define LOG_BUFFER_BYTES      (1u << 20)
+#define LOG_RECORD_MAX_TEXT   (8*FAST_TEXT_MAX_NUMBER)
+#define LOG_METRICS_CSV_HEADER "episode,reward,cumulative_goals,success_rate,training_loss,steps,goal_reached\n"
+
+typedef enum {
+	LOG_RECORD_METRICS = 0,
+	LOG_RECORD_LINE
+} log_record_kind_t;
+
+typedef struct {
+	uint32_t kind;
+	uint32_t goal_reached;
+	uint64_t episode;
+	uint64_t steps;
+	uint64_t cum_goals;
+	float    reward;
+	float    epsilon;
+	double   success_rate;
+	double   loss;
+} log_record_t;
+
+// WRITES ONE LINE AT p (AT MOST LOG_RECORD_MAX_TEXT BYTES) AND RETURNS ITS END
+typedef char* (*log_line_fn)(char* p, const log_record_t* r);
+
+typedef struct {
+	_Alignas(64) _Atomic uint64_t head;     // RECORDS PUSHED, ONLY THE PRODUCER WRITES IT
+	_Alignas(64) _Atomic uint64_t tail;     // RECORDS FORMATTED, ONLY THE WRITER THREAD WRITES IT
+	_Alignas(64) _Atomic bool     closing;
+	log_record_t* ring;
+	size_t        capacity;                 // POWER OF TWO
+	FILE*         csv;
+	FILE*         console;
+	log_line_fn   line_fn;
+	char*         csv_buf;
+	size_t        csv_len;
+	char*         line_buf;
+	size_t        line_len;
+	pthread_t     thread;
+	bool          started;
+	bool          io_error;
+	// PRODUCER SIDE COUNTERS, READ THEM AFTER logWriterClose
+	uint64_t      dropped_lines;
+	uint64_t      stalls;
+} log_writer_t;
+
+int   logWriterOpen(log_writer_t* w, const char* csv_path, FILE* console, log_line_fn line_fn, size_t capacity);
+bool  logWriterPush(log_writer_t* w, const log_record_t* r);
+int   logWriterClose(log_writer_t* w);
+char* logFormatMetricsRow(char* p, const log_record_t* r);
+
+#endif
+
+#ifdef AGENT_LOG_IMPLEMENTATION
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sched.h>
+#include <time.h>
+#endif
+
+static void logWriterYield(void){
+#ifdef _WIN32
+	Sleep(0);
+#else
+	sched_yield();
+#endif
+}
+
+// BACKS OFF FROM 50us TO 1ms WHILE THE RING STAYS EMPTY
+static void logWriterIdle(unsigned idle){
+	unsigned us = idle < 5 ? 50u << idle : 1000u;
+	if(us > 1000u) us = 1000u;
+#ifdef _WIN32
+	Sleep(us >= 1000u ? 1 : 0);
+#else
+	struct timespec ts = {0,(long)us*1000L};
+	nanosleep(&ts,NULL);
+#endif
+}
+
+char* logFormatMetricsRow(char* p, const log_record_t* r){
+	p = fastTextU64(p,r->episode);        *p++ = ',';
+	p = fastTextFixed(p,r->reward,6);     *p++ = ',';
+	p = fastTextU64(p,r->cum_goals);      *p++ = ',';
+	p = fastTextFixed(p,r->success_rate,4); *p++ = ',';
+	p = fastTextExp(p,r->loss,6);         *p++ = ',';
+	p = fastTextU64(p,r->steps);          *p++ = ',';
+	*p++ = r->goal_reached ? '1' : '0';
+	*p++ = '\n';
+	return p;
+}
+
+static void logWriterFlushTo(log_writer_t* w, FILE* f, char* buf, size_t* len){
+	if(*len == 0) return;
+	if(fwrite(buf,1,*len,f) != *len) w->io_error = true;
+	if(f == w->console) fflush(f);
+	*len = 0;
+}
+
+static void logWriterFormat(log_writer_t* w, const log_record_t* r){
+	if(r->kind == LOG_RECORD_METRICS){
+		if(!w->csv) return;
+		if(LOG_BUFFER_BYTES - w->csv_len < LOG_RECORD_MAX_TEXT) logWriterFlushTo(w,w->csv,w->csv_buf,&w->csv_len);
+		w->csv_len = (size_t)(logFormatMetricsRow(w->csv_buf + w->csv_len,r) - w->csv_buf);
+	} else {
+		if(!w->console || !w->line_fn) return;
+		if(LOG_BUFFER_BYTES - w->line_len < LOG_RECORD_MAX_TEXT) logWriterFlushTo(w,w->console,w->line_buf,&w->line_len);
+		w->line_len = (size_t)(w->line_fn(w->line_buf + w->line_len,r) - w->line_buf);
+	}
+}
+
+static void* logWriterMain(void* arg){
+	log_writer_t* w = (log_writer_t*)arg;
+	unsigned idle = 0;
+	for(;;){
+		uint64_t tail = atomic_load_explicit(&w->tail,memory_order_relaxed);
+		uint64_t head = atomic_load_explicit(&w->head,memory_order_acquire);
+		if(tail == head){
+			logWriterFlushTo(w,w->console,w->line_buf,&w->line_len);
+			// closing IS SET AFTER THE LAST PUSH, SO ONE MORE LOOK AT head SEES EVERYTHING
+			if(atomic_load_explicit(&w->closing,memory_order_acquire) &&
+			   atomic_load_explicit(&w->head,memory_order_acquire) == tail) break;
+			logWriterIdle(idle++);
+			continue;
+		}
+		idle = 0;
+		for(; tail != head; tail++){
+			logWriterFormat(w,&w->ring[tail & (w->capacity - 1)]);
+			// HAND SLOTS BACK AS WE GO, A WAITING PRODUCER DOESNT WAIT FOR THE WHOLE BATCH
+			if((tail & 1023) == 1023) atomic_store_explicit(&w->tail,tail + 1,memory_order_release);
+		}
+		atomic_store_explicit(&w->tail,tail,memory_order_release);
+	}
+	if(w->csv) logWriterFlushTo(w,w->csv,w->csv_buf,&w->csv_len);
+	return NULL;
+}
+
+int logWriterOpen(log_writer_t* w, const char* csv_path, FILE* console, log_line_fn line_fn, size_t capacity){
+	memset(w,0,sizeof(*w));
+	size_t cap = 1;
+	while(cap < (capacity ? capacity : LOG_RING_DEFAULT)) cap <<= 1;
+	w->capacity = cap;
+	w->console  = console;
+	w->line_fn  = line_fn;
+	w->ring     = (log_record_t*)malloc(cap*sizeof(log_record_t));
+	w->line_buf = (char*)malloc(LOG_BUFFER_BYTES);
+	if(csv_path) w->csv_buf = (char*)malloc(LOG_BUFFER_BYTES);
+	if(!w->ring || !w->line_buf || (csv_path && !w->csv_buf)) goto fail;
+
+	if(csv_path){
+		w->csv = fopen(csv_path,"w");
+		if(!w->csv) goto fail;
+		// THE BUFFER IS OURS, ONE fwrite IS ONE write
+		setvbuf(w->csv,NULL,_IONBF,0);
+		w->csv_len = (size_t)(FAST_TEXT_LIT(w->csv_buf,LOG_METRICS_CSV_HEADER) - w->csv_buf);
+	}
+	atomic_store(&w->head,0);
+	atomic_store(&w->tail,0);
+	atomic_store(&w->closing,false);
+	if(console) fflush(console);
+	if(pthread_create(&w->thread,NULL,logWriterMain,w) != 0) goto fail;
+	w->started = true;
+	return 0;
+
+fail:
+	if(w->csv) fclose(w->csv);
+	free(w->ring);
+	free(w->line_buf);
+	free(w->csv_buf);
+	memset(w,0,sizeof(*w));
+	return -1;
+}
+
+// PRODUCER ONLY (ONE THREAD). FALSE WHEN A LINE WAS DROPPED
+bool logWriterPush(log_writer_t* w, const log_record_t* r){
+	if(!w->started) return false;
+	if(r->kind == LOG_RECORD_METRICS && !w->csv) return true;
+	uint64_t head = atomic_load_explicit(&w->head,memory_order_relaxed);
+	if(head - atomic_load_explicit(&w->tail,memory_order_acquire) == w->capacity){
+		if(r->kind == LOG_RECORD_LINE){
+			w->dropped_lines++;
+			return false;
+		}
+		w->stalls++;
+		while(head - atomic_load_explicit(&w->tail,memory_order_acquire) == w->capacity) logWriterYield();
+	}
+	w->ring[head & (w->capacity - 1)] = *r;
+	atomic_store_explicit(&w->head,head + 1,memory_order_release);
+	return true;
+}
+
+// DRAINS THE RING, STOPS THE THREAD AND CLOSES THE CSV. 0 WHEN EVERY QUEUED RECORD WAS WRITTEN
+int logWriterClose(log_writer_t* w){
+	if(!w->started) return -1;
+	atomic_store_explicit(&w->closing,true,memory_order_release);
+	pthread_join(w->thread,NULL);
+	w->started = false;
+	if(w->csv && fclose(w->csv) != 0) w->io_error = true;
+	w->csv = NULL;
+	free(w->ring);
+	free(w->line_buf);
+	free(w->csv_buf);
+	w->ring = NULL;
+	w->line_buf = NULL;
+	w->csv_buf = NULL;
+	return w->io_error ? -1 : 0;
+}
+
+#endif
@@ -0,0 +1,456 @@
+#ifndef AGENT_PBT_H
+
+#define AGENT_PBT_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "agent.h"
+#include "agentArena.h"
+
+/*
+    POPULATION BASED TRAINING
+
+    n_members AGENTS TRAIN THE SAME MAZE ON A POOL OF n_threads WORKERS. A
+    ROUND IS interval EPISODES OF EVERY MEMBER FOLLOWED BY ONE GREEDY ROLLOUT
+    FROM agent_start THAT SCORES IT: GOAL REACHED FIRST, THEN FEWER STEPS,
+    THEN THE MEAN TRAINING REWARD OF THE ROUND. BETWEEN ROUNDS THE BOTTOM
+    truncation OF THE RANKING EXPLOITS A RANDOM MEMBER OF THE TOP truncation
+    (ITS Q-TABLE, HYPER PARAMETERS AND EPSILON SCHEDULE POSITION) AND EXPLORES
+    BY SCALING EACH HYPER PARAMETER BY 1 - perturb OR 1 + perturb. A MEMBER
+    THAT IS NOT STRICTLY WORSE THAN ITS DONOR KEEPS ITS OWN TABLE.
+
+    THE EXPLORED HYPER PARAMETERS ARE THE ONES THE AGENT RUNS WITH:
+        learning_rate   Agent.learning_rate, THE STEP SIZE (agentTrain --lr IS 1 - IT)
+        discount_rate   Agent.discount_rate
+        epsilon_decay   THE STEPS CONSTANT OF agentEpsilonSchedule
+
+    TABLES: ONE ARENA (agentArena.h) HOLDS EVERY MEMBER'S TABLE IN ITS OWN
+    SLOT, EACH SLOT STARTS ON A CACHE LINE SO TWO WORKERS NEVER WRITE THE SAME
+    LINE, NO MALLOC AFTER pbtInit. AN EXPLOIT IS A memcpy BETWEEN SLOTS, DONE BY THE
+    POOL (EACH LOSER COPIES ITS DONOR) BEFORE THE NEXT ROUND TRAINS. DONORS
+    AND LOSERS ARE DISJOINT, SO A DONOR IS ONLY READ WHILE IT IS COPIED.
+    WITH placement.numa == ARENA_NUMA_FIRST_TOUCH WORKER k IS PINNED TO NODE
+    k % NODES AND OWNS MEMBERS k, k + n_threads, ...: IT FAULTS THEIR TABLES
+    IN BEFORE THE FIRST ROUND AND IS THE ONLY ONE THAT TRAINS OR OVERWRITES
+    THEM, SO EVERY UPDATE STAYS ON ITS OWN NODE (A COPY READS THE DONOR
+    REMOTELY ONCE). OTHERWISE MEMBERS GO TO WHICHEVER WORKER IS FREE.
+
+    EVERY MEMBER HAS ITS OWN RNG (agentRandU32, NOT THE SHARED rand() OF
+    agentPolicy) AND THE RANKING AND PERTURBATIONS RUN ON THE CALLING THREAD,
+    SO A RUN IS THE SAME FOR A GIVEN SEED WHATEVER THE THREAD COUNT.
+    SINGLE TABLE Q-LEARNING ONLY, NO PLANNING, REPLAY OR CURRICULUM.
+*/
+
+#define PBT_DEFAULT_INTERVAL   50
+#define PBT_DEFAULT_TRUNCATION 0.25f
+#define PBT_DEFAULT_PERTURB    0.2f
+
+typedef struct {
+	size_t n_members;
+	size_t n_threads;           // 0 = ONE PER CPU, NEVER MORE THAN n_members
+	size_t interval;            // EPISODES PER MEMBER PER ROUND
+	size_t max_steps;
+	float  truncation;          // FRACTION THAT EXPLOITS / IS EXPLOITED, AT MOST 0.5
+	float  perturb;
+	bool   block_transpassing;
+	bool   distance_shaping;
+	size_t walls_count;
+	size_t opens_count;
+	arena_policy_t placement;   // OF THE TABLES, ARENA_NUMA_FIRST_TOUCH PINS THE WORKERS
+	qtable_layout_t layout;
+} pbt_params_t;
+
+typedef struct {
+	Agent    agent;             // q_table.vals POINTS INTO THE POOL
+	uint64_t env_steps;         // EPSILON SCHEDULE POSITION, INHERITED ON EXPLOIT
+	size_t   episodes;
+	size_t   goals;
+	uint32_t id;
+	uint32_t parent;            // LAST DONOR, id WHEN NEVER EXPLOITED
+	int64_t  donor;             // PENDING COPY, -1 NONE
+	// LAST ROUND
+	size_t   round_goals;
+	double   round_reward;
+	double   round_loss;
+	bool     eval_goal;
+	size_t   eval_steps;
+} pbt_member_t;
+
+struct pbt_t;
+
+typedef struct {
+	struct pbt_t* pbt;
+	size_t        index;
+	pthread_t     thread;
+	uint64_t*     visited;
+	uint32_t*     path;
+} pbt_worker_t;
+
+typedef struct pbt_t {
+	MazeEnv*        env;
+	pbt_params_t    params;
+	state_t         goal;
+	pbt_member_t*   members;
+	size_t*         ranking;    // MEMBER INDICES, BEST FIRST, AFTER pbtRound
+	arena_t         arena;
+	q_val_t*        pool;
+	size_t          table_vals;
+	size_t          table_stride;   // table_vals ROUNDED UP TO A CACHE LINE
+	Agent           rng;        // ONLY ITS RNG, FOR THE EXPLOIT PICKS AND PERTURBATIONS
+	// WORKER POOL
+	pbt_worker_t*   workers;
+	size_t          n_workers;
+	pthread_mutex_t lock;
+	pthread_cond_t  wake;
+	pthread_cond_t  idle;
+	uint64_t        job_id;
+	size_t          job_done;
+	void            (*job)(struct pbt_t* p, pbt_worker_t* w, size_t member);
+	atomic_size_t   next;
+	bool            quit;
+	// TOTALS
+	size_t          rounds;
+	size_t          exploits;
+	uint64_t        bytes_copied;
+	uint64_t        env_steps;
+} pbt_t;
+
+int           pbtInit(pbt_t* p, MazeEnv* env, const pbt_params_t* params, float lr, float dr, double eps_decay, unsigned long seed);
+void          pbtRound(pbt_t* p);
+pbt_member_t* pbtBest(pbt_t* p);
+void          pbtFree(pbt_t* p);
+
+#endif
+
+#ifdef AGENT_PBT_IMPLEMENTATION
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+static size_t pbtCpuCount(void){
+#ifdef _WIN32
+	SYSTEM_INFO si;
+	GetSystemInfo(&si);
+	return si.dwNumberOfProcessors > 0 ? (size_t)si.dwNumberOfProcessors : 1;
+#else
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n > 0 ? (size_t)n : 1;
+#endif
+}
+
+static float pbtRandUnit(Agent* a){
+	return (float)(agentRandU32(a) >> 8)*(1.0f/16777216.0f);
+}
+
+static void pbtExplore(pbt_t* p, Agent* a){
+	float f = p->params.perturb;
+	a->learning_rate *= (agentRandU32(&p->rng) & 1u) ? 1.0f + f : 1.0f - f;
+	a->discount_rate *= (agentRandU32(&p->rng) & 1u) ? 1.0f + f : 1.0f - f;
+	a->epsilon_decay *= (agentRandU32(&p->rng) & 1u) ? 1.0 + f : 1.0 - f;
+	if(a->learning_rate > 1.0f)    a->learning_rate = 1.0f;
+	if(a->learning_rate < 1e-4f)   a->learning_rate = 1e-4f;
+	if(a->discount_rate > 0.9999f) a->discount_rate = 0.9999f;
+	if(a->epsilon_decay < 1.0)     a->epsilon_decay = 1.0;
+}
+
+static float pbtHuber(float x){
+	float ax = fabsf(x);
+	return ax <= 1.0f ? 0.5f*x*x : ax - 0.5f;
+}
+
+// THE agentTrain EPISODE LOOP, WITH EPSILON GREEDY ON THE MEMBER RNG
+static void pbtTrainMember(pbt_t* p, pbt_worker_t* w, size_t i){
+	pbt_member_t* m = &p->members[i];
+	Agent* a = &m->agent;
+	MazeEnv* env = p->env;
+	const pbt_params_t* prm = &p->params;
+
+	m->round_goals  = 0;
+	m->round_reward = 0.0;
+	m->round_loss   = 0.0;
+	for(size_t e = 0; e < prm->interval; e++){
+		agentRestart(a);
+		reward_t ep_reward = 0.0f;
+		size_t steps = 0;
+		for(size_t step = 0; step < prm->max_steps; step++){
+			if(pbtRandUnit(a) > a->epsilon) a->policy_action = qtableMaxValAction(a,a->current_s).a;
+			else                            a->policy_action = (Action)agentRandRange(a,ACTION_N_ACTIONS);
+
+			state_t next = GetNextState(a->current_s,a->policy_action);
+			stepResult sr = stepIntoStateUnscaled(env,next,prm->walls_count,prm->opens_count);
+			state_t trans = (prm->block_transpassing && sr.invalidNext) ? a->current_s : next;
+			if(prm->distance_shaping && !sr.invalidNext){
+				float phi_s  = (float)(abs(a->current_s.x - p->goal.x) + abs(a->current_s.y - p->goal.y));
+				float phi_sp = (float)(abs(trans.x - p->goal.x) + abs(trans.y - p->goal.y));
+				sr.reward += a->discount_rate*(phi_s - phi_sp);
+			}
+			m->round_loss += pbtHuber(agentQtableUpdate(a,trans,sr));
+			ep_reward += sr.reward;
+			steps++;
+			if(sr.isGoal){ m->round_goals++; break; }
+			if(sr.terminal) break;
+			agentUpdateState(a,trans);
+		}
+		m->env_steps += steps;
+		m->episodes++;
+		m->round_reward += ep_reward;
+		a->epsilon = agentEpsilonSchedule(m->env_steps,a->epsilon_decay);
+	}
+	m->goals += m->round_goals;
+	if(prm->interval) m->round_reward /= (double)prm->interval;
+
+	// GREEDY ROLLOUT, A CELL SEEN TWICE IS A LOOP THAT NEVER ENDS
+	state_t s = a->agent_start;
+	size_t n_path = 0;
+	m->eval_goal  = false;
+	m->eval_steps = prm->max_steps;
+	for(size_t step = 0; step < prm->max_steps; step++){
+		uint32_t cell = (uint32_t)((size_t)s.y*env->cols + (size_t)s.x);
+		uint64_t bit = (uint64_t)1 << (cell & 63);
+		if(w->visited[cell >> 6] & bit) break;
+		w->visited[cell >> 6] |= bit;
+		w->path[n_path++] = cell;
+
+		state_t next = GetNextState(s,qtableMaxValAction(a,s).a);
+		stepResult sr = stepIntoState(env,next,0,0);
+		if(sr.isGoal){ m->eval_goal = true; m->eval_steps = step + 1; break; }
+		bool out_of_grid = next.x < 0 || next.y < 0 || (size_t)next.x >= env->cols || (size_t)next.y >= env->rows;
+		if(out_of_grid || (prm->block_transpassing && sr.invalidNext)) continue;
+		s = next;
+	}
+	for(size_t k = 0; k < n_path; k++) w->visited[w->path[k] >> 6] = 0;
+}
+
+static void pbtCopyMember(pbt_t* p, pbt_worker_t* w, size_t i){
+	(void)w;
+	pbt_member_t* m = &p->members[i];
+	if(m->donor < 0) return;
+	memcpy(m->agent.q_table.vals,p->members[m->donor].agent.q_table.vals,p->table_vals*sizeof(q_val_t));
+}
+
+// FAULTS THE MEMBER'S TABLE IN ON THE NODE OF ITS OWNER (THE SLOT IS STILL ZERO)
+static void pbtTouchMember(pbt_t* p, pbt_worker_t* w, size_t i){
+	(void)w;
+	arenaTouch(p->members[i].agent.q_table.vals,p->table_vals*sizeof(q_val_t));
+}
+
+static void* pbtWorkerMain(void* arg){
+	pbt_worker_t* w = (pbt_worker_t*)arg;
+	pbt_t* p = w->pbt;
+	uint64_t seen = 0;
+	bool owned = p->params.placement.numa == ARENA_NUMA_FIRST_TOUCH;
+	if(owned){
+		uint64_t mask;
+		size_t n_nodes = arenaNumaNodes(&mask);
+		// THE (index % n_nodes)-TH ONLINE NODE
+		size_t skip = w->index % n_nodes, node = 0;
+		for(; node < ARENA_MAX_NODES; node++){
+			if(!(mask >> node & 1)) continue;
+			if(skip-- == 0) break;
+		}
+		arenaPinThreadToNode(node);
+	}
+	for(;;){
+		pthread_mutex_lock(&p->lock);
+		while(p->job_id == seen && !p->quit) pthread_cond_wait(&p->wake,&p->lock);
+		if(p->quit){ pthread_mutex_unlock(&p->lock); break; }
+		seen = p->job_id;
+		void (*job)(pbt_t*,pbt_worker_t*,size_t) = p->job;
+		pthread_mutex_unlock(&p->lock);
+
+		if(owned){
+			for(size_t i = w->index; i < p->params.n_members; i += p->params.n_threads) job(p,w,i);
+		} else {
+			for(;;){
+				size_t i = atomic_fetch_add(&p->next,1);
+				if(i >= p->params.n_members) break;
+				job(p,w,i);
+			}
+		}
+
+		pthread_mutex_lock(&p->lock);
+		if(++p->job_done == p->n_workers) pthread_cond_signal(&p->idle);
+		pthread_mutex_unlock(&p->lock);
+	}
+	return NULL;
+}
+
+// RUNS job ON EVERY MEMBER AND WAITS FOR THE POOL TO GO IDLE
+static void pbtPoolRun(pbt_t* p, void (*job)(pbt_t*,pbt_worker_t*,size_t)){
+	pthread_mutex_lock(&p->lock);
+	p->job = job;
+	p->job_done = 0;
+	atomic_store(&p->next,0);
+	p->job_id++;
+	pthread_cond_broadcast(&p->wake);
+	while(p->job_done < p->n_workers) pthread_cond_wait(&p->idle,&p->lock);
+	pthread_mutex_unlock(&p->lock);
+}
+
+// >0 WHEN a SCORED BETTER THAN b: GREEDY GOAL, FEWER GREEDY STEPS, HIGHER ROUND REWARD
+static int pbtCompare(const pbt_member_t* a, const pbt_member_t* b){
+	if(a->eval_goal != b->eval_goal) return a->eval_goal ? 1 : -1;
+	if(a->eval_steps != b->eval_steps) return a->eval_steps < b->eval_steps ? 1 : -1;
+	if(a->round_reward != b->round_reward) return a->round_reward > b->round_reward ? 1 : -1;
+	return 0;
+}
+
+// BEST FIRST, EQUAL SCORES BY id
+static bool pbtBetter(const pbt_member_t* a, const pbt_member_t* b){
+	int c = pbtCompare(a,b);
+	return c != 0 ? c > 0 : a->id < b->id;
+}
+
+static void pbtRank(pbt_t* p){
+	size_t n = p->params.n_members;
+	for(size_t i = 0; i < n; i++) p->ranking[i] = i;
+	// INSERTION SORT, A POPULATION IS TENS OF MEMBERS
+	for(size_t i = 1; i < n; i++){
+		size_t v = p->ranking[i];
+		size_t j = i;
+		while(j > 0 && pbtBetter(&p->members[v],&p->members[p->ranking[j - 1]])){
+			p->ranking[j] = p->ranking[j - 1];
+			j--;
+		}
+		p->ranking[j] = v;
+	}
+}
+
+int pbtInit(pbt_t* p, MazeEnv* env, const pbt_params_t* params, float lr, float dr, double eps_decay, unsigned long seed){
+	memset(p,0,sizeof(*p));
+	if(params->n_members == 0 || params->interval == 0 || params->max_steps == 0) return -1;
+	p->env    = env;
+	p->params = *params;
+	if(p->params.truncation > 0.5f) p->params.truncation = 0.5f;
+	if(p->params.truncation < 0.0f) p->params.truncation = 0.0f;
+	cellId g = getFirstMatchingCell(env,GRID_AGENT_GOAL);
+	p->goal = (state_t){(int32_t)g.col,(int32_t)g.row};
+
+	size_t n = p->params.n_members;
+	size_t n_cells = env->rows*env->cols;
+	p->table_vals = qtableSlots(env->cols,env->rows,p->params.layout)*ACTION_N_ACTIONS;
+	p->members = (pbt_member_t*)calloc(n,sizeof(pbt_member_t));
+	p->ranking = (size_t*)calloc(n,sizeof(size_t));
+	p->table_stride = arenaAlignUp(p->table_vals*sizeof(q_val_t),ARENA_ALIGN)/sizeof(q_val_t);
+	if(arenaInitPolicy(&p->arena,n*p->table_stride*sizeof(q_val_t),&p->params.placement) == 0)
+		p->pool = (q_val_t*)arenaCalloc(&p->arena,n*p->table_stride,sizeof(q_val_t));
+	if(!p->members || !p->ranking || !p->pool){ pbtFree(p); return -1; }
+
+	agentSetSeed(&p->rng,(unsigned int)seed);
+	for(size_t i = 0; i < n; i++){
+		pbt_member_t* m = &p->members[i];
+		agentInit(&m->agent,env,lr,dr,eps_decay,seed + 7919UL*(i + 1));
+		m->agent.q_table = (q_table_t){.len_state_x = env->cols,
+		                               .len_state_y = env->rows,
+		                               .len_state_actions = ACTION_N_ACTIONS,
+		                               .vals = p->pool + i*p->table_stride,
+		                               .borrowed = true};
+		qtableSetLayout(&m->agent.q_table,p->params.layout);
+		m->id     = (uint32_t)i;
+		m->parent = (uint32_t)i;
+		m->donor  = -1;
+		// MEMBER 0 KEEPS THE GIVEN PARAMETERS, THE REST START ONE PERTURBATION AWAY
+		if(i > 0) pbtExplore(p,&m->agent);
+		p->ranking[i] = i;
+	}
+
+	size_t n_workers = p->params.n_threads ? p->params.n_threads : pbtCpuCount();
+	if(n_workers > n) n_workers = n;
+	p->params.n_threads = n_workers;
+	p->workers = (pbt_worker_t*)calloc(n_workers,sizeof(pbt_worker_t));
+	if(!p->workers){ pbtFree(p); return -1; }
+	size_t path_len = params->max_steps < n_cells ? params->max_steps : n_cells;
+	for(size_t k = 0; k < n_workers; k++){
+		p->workers[k].pbt     = p;
+		p->workers[k].index   = k;
+		p->workers[k].visited = (uint64_t*)calloc((n_cells + 63)/64,sizeof(uint64_t));
+		p->workers[k].path    = (uint32_t*)malloc(path_len*sizeof(uint32_t));
+		if(!p->workers[k].visited || !p->workers[k].path){ p->n_workers = 0; pbtFree(p); return -1; }
+	}
+
+	pthread_mutex_init(&p->lock,NULL);
+	pthread_cond_init(&p->wake,NULL);
+	pthread_cond_init(&p->idle,NULL);
+	atomic_init(&p->next,0);
+	for(size_t k = 0; k < n_workers; k++){
+		if(pthread_create(&p->workers[k].thread,NULL,pbtWorkerMain,&p->workers[k]) != 0){ pbtFree(p); return -1; }
+		p->n_workers++;
+	}
+	if(p->params.placement.numa == ARENA_NUMA_FIRST_TOUCH) pbtPoolRun(p,pbtTouchMember);
+	return 0;
+}
+
+void pbtRound(pbt_t* p){
+	size_t n = p->params.n_members;
+	pbtPoolRun(p,pbtTrainMember);
+	p->rounds++;
+	p->env_steps = 0;
+	for(size_t i = 0; i < n; i++) p->env_steps += p->members[i].env_steps;
+	pbtRank(p);
+
+	// EXPLOIT AND EXPLORE, DECIDED HERE, TABLES COPIED BY THE POOL
+	size_t n_trunc = (size_t)((float)n*p->params.truncation);
+	if(n_trunc == 0 && n >= 2 && p->params.truncation > 0.0f) n_trunc = 1;
+	bool any = false;
+	for(size_t k = 0; k < n_trunc; k++){
+		pbt_member_t* m = &p->members[p->ranking[n - 1 - k]];
+		size_t d = p->ranking[agentRandRange(&p->rng,(uint32_t)n_trunc)];
+		pbt_member_t* donor = &p->members[d];
+		if(pbtCompare(donor,m) <= 0) continue;
+		m->donor = (int64_t)d;
+		m->parent = donor->id;
+		m->env_steps = donor->env_steps;
+		m->agent.learning_rate = donor->agent.learning_rate;
+		m->agent.discount_rate = donor->agent.discount_rate;
+		m->agent.epsilon_decay = donor->agent.epsilon_decay;
+		pbtExplore(p,&m->agent);
+		m->agent.epsilon = agentEpsilonSchedule(m->env_steps,m->agent.epsilon_decay);
+		p->exploits++;
+		p->bytes_copied += p->table_vals*sizeof(q_val_t);
+		any = true;
+	}
+	if(!any) return;
+	pbtPoolRun(p,pbtCopyMember);
+	for(size_t i = 0; i < n; i++) p->members[i].donor = -1;
+}
+
+// BEST OF THE LAST ROUND (BEFORE ITS EXPLOITS, WHICH NEVER TOUCH THE TOP)
+pbt_member_t* pbtBest(pbt_t* p){
+	return p->members ? &p->members[p->ranking[0]] : NULL;
+}
+
+void pbtFree(pbt_t* p){
+	if(p->n_workers){
+		pthread_mutex_lock(&p->lock);
+		p->quit = true;
+		pthread_cond_broadcast(&p->wake);
+		pthread_mutex_unlock(&p->lock);
+		for(size_t k = 0; k < p->n_workers; k++) pthread_join(p->workers[k].thread,NULL);
+		pthread_mutex_destroy(&p->lock);
+		pthread_cond_destroy(&p->wake);
+		pthread_cond_destroy(&p->idle);
+	}
+	if(p->workers){
+		for(size_t k = 0; k < p->params.n_threads; k++){
+			free(p->workers[k].visited);
+			free(p->workers[k].path);
+		}
+	}
+	free(p->workers);
+	free(p->members);
+	free(p->ranking);
+	arenaFree(&p->arena);
+	memset(p,0,sizeof(*p));
+}
+
+#endif
@@ -0,0 +1,297 @@
+#ifndef AGENT_POLICY_H
+
+#define AGENT_POLICY_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "agent.h"
+
+/*
+    COMPILED GREEDY POLICY
+
+    THE GREEDY ACTION OF EVERY CELL PACKED IN 2 BITS, FOUR CELLS PER BYTE:
+    CELL c (= row*cols + col) LIVES IN packed[c >> 2] AT BITS (c & 3)*2.
+    A SINGLE FLOAT TABLE SPENDS 16 BYTES PER CELL AND THE MAP 2 BITS,
+    AND A LOOKUP IS A SHIFT AND A MASK INSTEAD OF AN ARGMAX OVER 4 FLOATS.
+
+    .policy FILE, LITTLE ENDIAN, MAPPABLE AS IS (policyMap):
+        | "CQPOLICY" | version u32 | reserved u32 | rows u64 | cols u64 | packed |
+    THE 32 BYTE HEADER KEEPS packed 8 BYTE ALIGNED INSIDE THE MAPPING.
+
+    CHAIN ANALYSIS (policyAnalyze)
+    UNDER A FIXED MAZE THE GREEDY POLICY MAKES EVERY CELL HAVE EXACTLY ONE
+    SUCCESSOR, SO THE CELLS FORM A FUNCTIONAL GRAPH: EVERY CHAIN EITHER ENDS
+    ON A GOAL OR FALLS INTO A CYCLE. ONE PASS WITH AN EXPLICIT STACK LABELS
+    EACH CELL WITH ITS STEP COUNT TO THE GOAL, OR POLICY_LOOPS, VISITING EVERY
+    CELL ONCE. AFTER THAT "DOES c LOOP FOREVER" IS ONE LOAD AND "PATH FROM c"
+    IS ONE SUCCESSOR WALK OF EXACTLY goal_dist[c] STEPS.
+
+    SUCCESSORS FOLLOW THE TRAINER TRANSITION RULE: MOVES OFF THE GRID STAY IN
+    PLACE, AND SO DO MOVES INTO WALLS WHEN block_transpassing IS SET.
+*/
+
+#define POLICY_MAGIC        "CQPOLICY"
+#define POLICY_VERSION      1
+#define POLICY_HEADER_SIZE  32
+#define POLICY_LOOPS        UINT32_MAX
+
+typedef struct {
+	size_t         rows;
+	size_t         cols;
+	const uint8_t* packed;
+	uint8_t*       owned;       // NON NULL WHEN packed WAS ALLOCATED HERE
+	void*          map_base;    // NON NULL WHEN packed POINTS INTO A FILE MAPPING
+	size_t         map_len;
+	void*          map_handle;  // WINDOWS FILE MAPPING HANDLE
+	// CHAIN ANALYSIS, NULL UNTIL policyAnalyze
+	uint32_t*      goal_dist;
+	size_t         n_loops;
+	size_t         n_reach;
+} compiled_policy_t;
+
+static inline size_t policyPackedSize(size_t rows, size_t cols){ return (rows*cols + 3) >> 2; }
+
+static inline Action policyAction(const compiled_policy_t* p, size_t cell){
+	return (Action)((p->packed[cell >> 2] >> ((cell & 3) << 1)) & 3);
+}
+
+// O(1) ONCE ANALYZED
+static inline bool policyLoops(const compiled_policy_t* p, size_t cell){
+	return p->goal_dist[cell] == POLICY_LOOPS;
+}
+
+int    policyCompile(compiled_policy_t* p, Agent* agent);
+void   policyFree(compiled_policy_t* p);
+size_t policyNextCell(const compiled_policy_t* p, MazeEnv* env, size_t cell, bool block_transpassing);
+int    policyAnalyze(compiled_policy_t* p, MazeEnv* env, bool block_transpassing);
+size_t policyPath(const compiled_policy_t* p, MazeEnv* env, bool block_transpassing, size_t start, uint32_t* out, size_t out_cap);
+int    policySave(const compiled_policy_t* p, const char* path);
+int    policyLoad(compiled_policy_t* p, const char* path);
+int    policyMap(compiled_policy_t* p, const char* path);
+
+#endif
+
+#ifdef AGENT_POLICY_IMPLEMENTATION
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+int policyCompile(compiled_policy_t* p, Agent* agent){
+	memset(p,0,sizeof(*p));
+	q_table_t* t = &agent->q_table;
+	if(!t->vals || t->len_state_actions != ACTION_N_ACTIONS) return -1;
+	size_t n_cells = t->len_state_x*t->len_state_y;
+	if(n_cells == 0 || n_cells >= (size_t)UINT32_MAX) return -1;
+
+	p->owned = (uint8_t*)calloc(policyPackedSize(t->len_state_y,t->len_state_x),1);
+	if(!p->owned) return -1;
+	for(size_t c = 0; c < n_cells; c++){
+		state_t s = {(int32_t)(c % t->len_state_x),(int32_t)(c / t->len_state_x)};
+		uint8_t a = (uint8_t)qtableMaxValAction(agent,s).a & 3;
+		p->owned[c >> 2] |= (uint8_t)(a << ((c & 3) << 1));
+	}
+	p->packed = p->owned;
+	p->rows = t->len_state_y;
+	p->cols = t->len_state_x;
+	return 0;
+}
+
+void policyFree(compiled_policy_t* p){
+	free(p->owned);
+	free(p->goal_dist);
+#ifdef _WIN32
+	if(p->map_base) UnmapViewOfFile(p->map_base);
+	if(p->map_handle) CloseHandle((HANDLE)p->map_handle);
+#else
+	if(p->map_base) munmap(p->map_base,p->map_len);
+#endif
+	memset(p,0,sizeof(*p));
+}
+
+size_t policyNextCell(const compiled_policy_t* p, MazeEnv* env, size_t cell, bool block_transpassing){
+	state_t s = {(int32_t)(cell % p->cols),(int32_t)(cell / p->cols)};
+	state_t next = GetNextState(s,policyAction(p,cell));
+	bool out = next.x < 0 || next.y < 0 || (size_t)next.x >= p->cols || (size_t)next.y >= p->rows;
+	if(out) return cell;
+	size_t nc = (size_t)next.y*p->cols + (size_t)next.x;
+	if(block_transpassing && env->grid[nc] == GRID_WALL) return cell;
+	return nc;
+}
+
+// goal_dist[c] = GREEDY STEPS FROM c UNTIL IT STEPS ON A GOAL, POLICY_LOOPS IF NEVER
+int policyAnalyze(compiled_policy_t* p, MazeEnv* env, bool block_transpassing){
+	if(env->rows != p->rows || env->cols != p->cols) return -1;
+	const uint32_t UNSEEN = POLICY_LOOPS - 1, ON_STACK = POLICY_LOOPS - 2;
+	size_t n_cells = p->rows*p->cols;
+	free(p->goal_dist);
+	p->goal_dist = (uint32_t*)malloc(n_cells*sizeof(uint32_t));
+	uint32_t* stack = (uint32_t*)malloc(n_cells*sizeof(uint32_t));
+	if(!p->goal_dist || !stack){
+		free(stack);
+		free(p->goal_dist);
+		p->goal_dist = NULL;
+		return -1;
+	}
+	uint32_t* dist = p->goal_dist;
+	for(size_t c = 0; c < n_cells; c++) dist[c] = env->grid[c] == GRID_AGENT_GOAL ? 0 : UNSEEN;
+
+	p->n_loops = p->n_reach = 0;
+	for(size_t c = 0; c < n_cells; c++){
+		if(dist[c] != UNSEEN) continue;
+		// WALK UNTIL A LABELED CELL (GOAL OR DONE) OR ONE ALREADY ON THIS WALK (CYCLE)
+		size_t top = 0, x = c;
+		while(dist[x] == UNSEEN){
+			dist[x] = ON_STACK;
+			stack[top++] = (uint32_t)x;
+			x = policyNextCell(p,env,x,block_transpassing);
+		}
+		uint32_t d = dist[x] == ON_STACK ? POLICY_LOOPS : dist[x];
+		while(top > 0){
+			uint32_t y = stack[--top];
+			if(d != POLICY_LOOPS) d++;
+			dist[y] = d;
+		}
+	}
+	for(size_t c = 0; c < n_cells; c++){
+		if(env->grid[c] == GRID_AGENT_GOAL) continue;
+		if(dist[c] == POLICY_LOOPS) p->n_loops++;
+		else p->n_reach++;
+	}
+	free(stack);
+	return 0;
+}
+
+// WRITES THE CELLS FROM start UP TO AND INCLUDING THE GOAL, 0 WHEN start LOOPS
+// OR out_cap IS TOO SMALL; NEEDS policyAnalyze
+size_t policyPath(const compiled_policy_t* p, MazeEnv* env, bool block_transpassing, size_t start, uint32_t* out, size_t out_cap){
+	uint32_t d = p->goal_dist[start];
+	if(d == POLICY_LOOPS || (size_t)d + 1 > out_cap) return 0;
+	size_t c = start;
+	for(uint32_t i = 0; i < d; i++){
+		out[i] = (uint32_t)c;
+		c = policyNextCell(p,env,c,block_transpassing);
+	}
+	out[d] = (uint32_t)c;
+	return (size_t)d + 1;
+}
+
+static void policyWriteHeader(uint8_t h[POLICY_HEADER_SIZE], uint64_t rows, uint64_t cols){
+	uint32_t version = POLICY_VERSION, reserved = 0;
+	memcpy(h,POLICY_MAGIC,8);
+	memcpy(h + 8,&version,4);
+	memcpy(h + 12,&reserved,4);
+	memcpy(h + 16,&rows,8);
+	memcpy(h + 24,&cols,8);
+}
+
+static int policyParseHeader(const uint8_t h[POLICY_HEADER_SIZE], size_t file_len, size_t* rows, size_t* cols){
+	uint32_t version;
+	uint64_t r, c;
+	memcpy(&version,h + 8,4);
+	memcpy(&r,h + 16,8);
+	memcpy(&c,h + 24,8);
+	if(memcmp(h,POLICY_MAGIC,8) != 0 || version != POLICY_VERSION){
+		fprintf(stderr,"[ERROR] not a policy file\n");
+		return -1;
+	}
+	if(r == 0 || c == 0 || r*c >= (uint64_t)UINT32_MAX ||
+	   file_len < POLICY_HEADER_SIZE + policyPackedSize((size_t)r,(size_t)c)){
+		fprintf(stderr,"[ERROR] corrupt policy header\n");
+		return -1;
+	}
+	*rows = (size_t)r;
+	*cols = (size_t)c;
+	return 0;
+}
+
+int policySave(const compiled_policy_t* p, const char* path){
+	FILE* f = fopen(path,"wb");
+	if(!f){ perror("fopen"); return -1; }
+	uint8_t h[POLICY_HEADER_SIZE];
+	policyWriteHeader(h,(uint64_t)p->rows,(uint64_t)p->cols);
+	size_t n = policyPackedSize(p->rows,p->cols);
+	if(fwrite(h,1,sizeof(h),f) != sizeof(h) || fwrite(p->packed,1,n,f) != n){
+		fprintf(stderr,"[ERROR] could not write %s\n",path);
+		fclose(f);
+		return -1;
+	}
+	fclose(f);
+	return 0;
+}
+
+int policyLoad(compiled_policy_t* p, const char* path){
+	memset(p,0,sizeof(*p));
+	FILE* f = fopen(path,"rb");
+	if(!f){ perror("fopen"); return -1; }
+	uint8_t h[POLICY_HEADER_SIZE];
+	fseek(f,0,SEEK_END);
+	long len = ftell(f);
+	fseek(f,0,SEEK_SET);
+	size_t rows, cols;
+	if(len < POLICY_HEADER_SIZE || fread(h,1,sizeof(h),f) != sizeof(h) ||
+	   policyParseHeader(h,(size_t)len,&rows,&cols) != 0){
+		fclose(f);
+		return -1;
+	}
+	size_t n = policyPackedSize(rows,cols);
+	p->owned = (uint8_t*)malloc(n);
+	if(!p->owned || fread(p->owned,1,n,f) != n){
+		fprintf(stderr,"[ERROR] could not read %s\n",path);
+		fclose(f);
+		policyFree(p);
+		return -1;
+	}
+	fclose(f);
+	p->packed = p->owned;
+	p->rows = rows;
+	p->cols = cols;
+	return 0;
+}
+
+// READ ONLY MAPPING, THE PAGES ARE SHARED WITH EVERY OTHER PROCESS MAPPING THE FILE
+int policyMap(compiled_policy_t* p, const char* path){
+	memset(p,0,sizeof(*p));
+	size_t len = 0;
+	uint8_t* base = NULL;
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path,GENERIC_READ,FILE_SHARE_READ,NULL,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+	if(file == INVALID_HANDLE_VALUE){ fprintf(stderr,"[ERROR] could not open %s\n",path); return -1; }
+	LARGE_INTEGER size;
+	if(!GetFileSizeEx(file,&size) || size.QuadPart < POLICY_HEADER_SIZE){ CloseHandle(file); return -1; }
+	len = (size_t)size.QuadPart;
+	HANDLE mapping = CreateFileMappingA(file,NULL,PAGE_READONLY,0,0,NULL);
+	CloseHandle(file);
+	if(!mapping) return -1;
+	base = (uint8_t*)MapViewOfFile(mapping,FILE_MAP_READ,0,0,0);
+	if(!base){ CloseHandle(mapping); return -1; }
+	p->map_handle = (void*)mapping;
+#else
+	int fd = open(path,O_RDONLY);
+	if(fd < 0){ perror("open"); return -1; }
+	struct stat st;
+	if(fstat(fd,&st) != 0 || st.st_size < POLICY_HEADER_SIZE){ close(fd); return -1; }
+	len = (size_t)st.st_size;
+	void* m = mmap(NULL,len,PROT_READ,MAP_SHARED,fd,0);
+	close(fd);
+	if(m == MAP_FAILED){ perror("mmap"); return -1; }
+	base = (uint8_t*)m;
+#endif
+	p->map_base = base;
+	p->map_len = len;
+	if(policyParseHeader(base,len,&p->rows,&p->cols) != 0){
+		policyFree(p);
+		return -1;
+	}
+	p->packed = base + POLICY_HEADER_SIZE;
+	return 0;
+}
+
+#endif
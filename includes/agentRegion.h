@@ -0,0 +1,593 @@
+#ifndef AGENT_REGION_H
+
+#define AGENT_REGION_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "agent.h"
+#include "agentArena.h"
+
+/*
+    REGION PARTITIONED TRAINING
+
+    ONE SHARED Q-TABLE, SPLIT INTO n_threads BANDS OF MAZE ROWS. EACH BAND IS
+    OWNED BY ONE WORKER AND ONLY THAT WORKER READS OR WRITES ITS ROWS, SO NO
+    CACHE LINE OF THE TABLE EVER MOVES BETWEEN CORES. BANDS HOLD ABOUT THE
+    SAME NUMBER OF OPEN CELLS AND THEIR EDGES ARE ON MULTIPLES OF
+    REGION_ROW_ALIGN ROWS: NO CACHE LINE (ROW LAYOUT, 4 ACTIONS), 8x8 TILE OR
+    ALIGNED MORTON BLOCK STRADDLES TWO BANDS.
+
+    AN EPISODE IN FLIGHT IS A WALKER. A WORKER STEPS THE WALKERS IN ITS BAND
+    WITH ITS OWN RNG AND THE agentTrain STEP RULE. A STEP THAT LANDS IN
+    ANOTHER BAND HANDS THE WALKER TO THAT BAND'S INBOX, A BOUNDED LOCK-FREE
+    MULTI PRODUCER / SINGLE CONSUMER RING (PER SLOT SEQUENCE NUMBERS, ONE CAS
+    PER PUSH). THE BACKUP OF THE CROSSING STEP NEEDS max Q OF A CELL THE
+    SENDER DOES NOT OWN, SO IT TRAVELS WITH THE WALKER: THE RECEIVER COMPUTES
+    r + discount*max Q(s') AND SENDS THE TARGET BACK AS A BACKUP MESSAGE, THE
+    SENDER APPLIES IT TO ITS OWN ROW. TERMINAL STEPS AND STEPS OUT OF THE
+    GRID NEVER READ s', THEY ARE APPLIED ON THE SPOT.
+
+    A WALKER HAS AT MOST ONE HANDOFF AND ONE BACKUP IN FLIGHT, SO AN INBOX OF
+    2*n_walkers SLOTS NEVER FILLS AND A PUSH NEVER WAITS ON ANOTHER WORKER.
+    FINISHED EPISODES GO TO THE CALLING THREAD THROUGH ONE MORE MPSC RING,
+    regionTrain HANDS THEM TO episode_fn IN COMPLETION ORDER. EPISODE COUNT
+    AND TOTAL STEPS (FOR THE EPSILON SCHEDULE, READ WHEN A WALKER STARTS) ARE
+    THE ONLY SHARED COUNTERS, TOUCHED ONCE PER EPISODE.
+
+    TRADE OFFS:
+        - A BOUNDARY BACKUP LANDS A FEW STEPS LATE AND ITS TD ERROR GOES INTO
+          THE WORKER'S boundary_loss, NOT INTO THE EPISODE'S loss.
+        - THE WORK FOLLOWS THE WALKERS. WITH EVERY EPISODE STARTING AT
+          agent_start ONLY THE BANDS THEY REACH ARE BUSY, random_starts
+          SPREADS THEM OVER THE OPEN CELLS (EXPLORING STARTS).
+        - THREAD TIMING DECIDES THE ORDER OF THE UPDATES, A RUN IS NOT
+          REPEATABLE FOR A SEED. SINGLE TABLE Q-LEARNING ONLY.
+    THE WIN IS ON MAZES WHOSE TABLE IS MUCH BIGGER THAN A CORE'S L2 AND WHOSE
+    BANDS FIT IN IT (A 2 MiB L2 HOLDS ~32 ROWS OF A 4096 WIDE MAZE).
+
+    WITH numa == ARENA_NUMA_FIRST_TOUCH WORKER k IS PINNED TO NODE k % NODES
+    AND FAULTS ITS BAND IN BEFORE THE FIRST STEP, THE TABLE MUST NOT HAVE BEEN
+    WRITTEN YET FOR THAT TO PLACE IT (A FRESH ARENA TABLE).
+*/
+
+#define REGION_ROW_ALIGN        8
+#define REGION_DEFAULT_WALKERS  4      // PER THREAD
+#define REGION_QUANTUM          256    // STEPS OF ONE WALKER BEFORE THE INBOX IS CHECKED AGAIN
+
+typedef enum {
+	REGION_MSG_WALKER = 0,      // A WALKER ENTERS THE BAND, MAYBE WITH A PENDING BACKUP
+	REGION_MSG_BACKUP,          // A TARGET FOR A ROW OF THE BAND
+	REGION_MSG_DONE             // A FINISHED EPISODE, TO THE CALLING THREAD
+} region_msg_kind_t;
+
+typedef struct {
+	state_t  s;
+	state_t  from;              // PENDING BACKUP: THE CELL AND ACTION OF THE CROSSING STEP
+	uint32_t from_action;
+	uint32_t steps;
+	bool     pending;
+	bool     goal;
+	float    pending_reward;
+	float    epsilon;
+	float    reward;
+	float    loss;
+} region_walker_t;
+
+typedef struct {
+	uint32_t kind;
+	union {
+		region_walker_t walker;
+		struct {
+			state_t  s;
+			uint32_t action;
+			q_val_t  target;
+		} backup;
+	};
+} region_msg_t;
+
+typedef struct {
+	_Atomic uint64_t seq;
+	region_msg_t     msg;
+} region_cell_t;
+
+typedef struct {
+	_Alignas(64) _Atomic uint64_t tail;    // PUSHES RESERVED, EVERY PRODUCER CAS'ES IT
+	_Alignas(64) uint64_t         head;    // POPS, ONLY THE CONSUMER
+	region_cell_t* cells;
+	size_t         mask;
+} region_queue_t;
+
+typedef struct {
+	size_t n_threads;           // 0 = ONE PER CPU, NEVER MORE THAN rows / REGION_ROW_ALIGN
+	size_t n_walkers;           // EPISODES IN FLIGHT, 0 = REGION_DEFAULT_WALKERS PER THREAD
+	size_t n_episodes;
+	size_t max_steps;
+	bool   random_starts;       // EPISODES START AT A RANDOM OPEN CELL INSTEAD OF agent_start
+	bool   block_transpassing;
+	bool   distance_shaping;
+	size_t walls_count;
+	size_t opens_count;
+	arena_numa_t numa;          // ARENA_NUMA_FIRST_TOUCH PINS THE WORKERS AND FAULTS THE BANDS IN
+} region_params_t;
+
+typedef struct {
+	uint64_t episode;           // COMPLETION ORDER
+	size_t   steps;
+	bool     goal;
+	float    reward;
+	float    loss;
+	float    epsilon;
+} region_episode_t;
+
+typedef void (*region_episode_fn)(void* ctx, const region_episode_t* ep);
+
+struct region_trainer_t;
+
+typedef struct {
+	region_queue_t inbox;
+	struct region_trainer_t* rt;
+	size_t           index;
+	pthread_t        thread;
+	Agent            agent;     // THE SHARED TABLE (borrowed) AND THE WORKER'S RNG
+	size_t           y0, y1;    // ROWS OF THE BAND
+	size_t           open_cells;
+	region_walker_t* local;     // WALKERS IN THE BAND, A STACK
+	size_t           n_local;
+	// READ THEM AFTER regionTrain
+	uint64_t         steps;
+	uint64_t         updates;
+	uint64_t         handoffs;  // WALKERS SENT TO ANOTHER BAND
+	uint64_t         backups;   // BOUNDARY BACKUPS APPLIED
+	uint64_t         idle;
+	double           boundary_loss;
+} region_worker_t;
+
+typedef struct region_trainer_t {
+	_Alignas(64) atomic_uint_fast64_t started;     // EPISODES HANDED TO A WALKER
+	_Alignas(64) atomic_uint_fast64_t env_steps;   // OF THE FINISHED EPISODES
+	_Alignas(64) atomic_size_t        live;        // WALKERS NOT RETIRED
+	_Alignas(64) atomic_bool          stop;        // A WORKER FAILED TO START, THE OTHERS QUIT WHERE THEY ARE
+	region_queue_t   done;
+	MazeEnv*         env;
+	Agent*           agent;
+	region_params_t  params;
+	state_t          goal;
+	arena_t          arena;     // WORKERS, QUEUES, STACKS AND MAPS, NO MALLOC AFTER regionInit
+	region_worker_t* workers;
+	size_t           n_workers;
+	uint32_t*        row_owner;
+	uint32_t*        open;      // OPEN CELLS, FOR random_starts
+	size_t           n_open;
+	size_t           n_walkers;
+	bool             running;
+} region_trainer_t;
+
+int  regionInit(region_trainer_t* rt, MazeEnv* env, Agent* agent, const region_params_t* params);
+int  regionTrain(region_trainer_t* rt, region_episode_fn episode_fn, void* ctx);
+void regionFree(region_trainer_t* rt);
+
+#endif
+
+#ifdef AGENT_REGION_IMPLEMENTATION
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <sched.h>
+#include <time.h>
+#endif
+
+static size_t regionCpuCount(void){
+#ifdef _WIN32
+	SYSTEM_INFO si;
+	GetSystemInfo(&si);
+	return si.dwNumberOfProcessors > 0 ? (size_t)si.dwNumberOfProcessors : 1;
+#else
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n > 0 ? (size_t)n : 1;
+#endif
+}
+
+// YIELDS A FEW TIMES, THEN BACKS OFF FROM 50us TO 1ms
+static void regionIdle(unsigned idle){
+#ifdef _WIN32
+	if(idle < 4) Sleep(0);
+	else         Sleep(1);
+#else
+	if(idle < 4){ sched_yield(); return; }
+	unsigned us = idle - 4 < 5 ? 50u << (idle - 4) : 1000u;
+	if(us > 1000u) us = 1000u;
+	struct timespec ts = {0,(long)us*1000L};
+	nanosleep(&ts,NULL);
+#endif
+}
+
+static float regionHuber(float x){
+	float ax = fabsf(x);
+	return ax <= 1.0f ? 0.5f*x*x : ax - 0.5f;
+}
+
+static void regionQueueInit(region_queue_t* q, region_cell_t* cells, size_t capacity){
+	q->cells = cells;
+	q->mask  = capacity - 1;
+	q->head  = 0;
+	atomic_init(&q->tail,0);
+	for(size_t i = 0; i < capacity; i++) atomic_init(&cells[i].seq,i);
+}
+
+// ANY THREAD. FALSE WHEN FULL
+static bool regionQueuePush(region_queue_t* q, const region_msg_t* m){
+	uint64_t pos = atomic_load_explicit(&q->tail,memory_order_relaxed);
+	region_cell_t* c;
+	for(;;){
+		c = &q->cells[pos & q->mask];
+		uint64_t seq = atomic_load_explicit(&c->seq,memory_order_acquire);
+		int64_t dif = (int64_t)(seq - pos);
+		if(dif == 0){
+			if(atomic_compare_exchange_weak_explicit(&q->tail,&pos,pos + 1,memory_order_relaxed,memory_order_relaxed)) break;
+		} else if(dif < 0){
+			return false;
+		} else {
+			pos = atomic_load_explicit(&q->tail,memory_order_relaxed);
+		}
+	}
+	c->msg = *m;
+	atomic_store_explicit(&c->seq,pos + 1,memory_order_release);
+	return true;
+}
+
+// CONSUMER ONLY
+static bool regionQueuePop(region_queue_t* q, region_msg_t* m){
+	region_cell_t* c = &q->cells[q->head & q->mask];
+	if(atomic_load_explicit(&c->seq,memory_order_acquire) != q->head + 1) return false;
+	*m = c->msg;
+	atomic_store_explicit(&c->seq,q->head + q->mask + 1,memory_order_release);
+	q->head++;
+	return true;
+}
+
+static inline region_worker_t* regionOwner(region_trainer_t* rt, state_t s){
+	return &rt->workers[rt->row_owner[s.y]];
+}
+
+static inline bool regionInGrid(const MazeEnv* env, state_t s){
+	return s.x >= 0 && s.y >= 0 && (size_t)s.x < env->cols && (size_t)s.y < env->rows;
+}
+
+// INBOXES NEVER FILL (SEE ABOVE), done CAN WHEN THE CALLING THREAD LAGS
+static void regionSend(region_queue_t* q, const region_msg_t* m){
+	unsigned idle = 0;
+	while(!regionQueuePush(q,m)) regionIdle(idle++);
+}
+
+// Q(s,a) <- Q(s,a) + lr*(target - Q(s,a)), THE BACKUP OF agentQtableUpdateAt WITH THE TARGET GIVEN
+static float regionApplyBackup(Agent* a, state_t s, Action act, q_val_t target){
+#ifdef CQ_FIXED_POINT
+	q_val_t old_q = getQtableValue(a,s,act);
+	q_val_t delta = qvalMul(qvalFromFloat(a->learning_rate),qvalSaturate((int64_t)target - old_q));
+	setQtableValue(a,s,act,qvalSaturate((int64_t)old_q + delta));
+	return qvalToFloat(delta);
+#else
+	q_val_t old_q = getQtableValue(a,s,act);
+	q_val_t td = a->learning_rate*target;
+	setQtableValue(a,s,act,(1 - a->learning_rate)*old_q + td);
+	return td - a->learning_rate*old_q;
+#endif
+}
+
+static void regionPlace(region_trainer_t* rt, region_worker_t* self, const region_walker_t* wk){
+	region_worker_t* owner = regionOwner(rt,wk->s);
+	if(owner == self){
+		self->local[self->n_local++] = *wk;
+		return;
+	}
+	region_msg_t m = {.kind = REGION_MSG_WALKER};
+	m.walker = *wk;
+	self->handoffs++;
+	regionSend(&owner->inbox,&m);
+}
+
+// NEXT EPISODE FOR A WALKER, FALSE WHEN EVERY EPISODE WAS HANDED OUT
+static bool regionStartWalker(region_trainer_t* rt, Agent* rng, region_walker_t* wk){
+	if(atomic_fetch_add_explicit(&rt->started,1,memory_order_relaxed) >= rt->params.n_episodes) return false;
+	memset(wk,0,sizeof(*wk));
+	if(rt->params.random_starts && rt->n_open){
+		uint32_t cell = rt->open[agentRandRange(rng,(uint32_t)rt->n_open)];
+		wk->s = (state_t){(int32_t)(cell % rt->env->cols),(int32_t)(cell / rt->env->cols)};
+	} else {
+		wk->s = rt->agent->agent_start;
+	}
+	wk->epsilon = agentEpsilonSchedule(atomic_load_explicit(&rt->env_steps,memory_order_relaxed),rt->agent->epsilon_decay);
+	return true;
+}
+
+static void regionFinish(region_trainer_t* rt, region_worker_t* w, region_walker_t* wk){
+	atomic_fetch_add_explicit(&rt->env_steps,wk->steps,memory_order_relaxed);
+	region_msg_t m = {.kind = REGION_MSG_DONE};
+	m.walker = *wk;
+	regionSend(&rt->done,&m);
+
+	region_walker_t next;
+	if(regionStartWalker(rt,&w->agent,&next)) regionPlace(rt,w,&next);
+	else atomic_fetch_sub_explicit(&rt->live,1,memory_order_release);
+}
+
+static void regionHandle(region_trainer_t* rt, region_worker_t* w, region_msg_t* m){
+	Agent* a = &w->agent;
+	if(m->kind == REGION_MSG_BACKUP){
+		w->boundary_loss += regionHuber(regionApplyBackup(a,m->backup.s,(Action)m->backup.action,m->backup.target));
+		w->backups++;
+		w->updates++;
+		return;
+	}
+	region_walker_t* wk = &m->walker;
+	if(wk->pending){
+		// THE CROSSING STEP'S TARGET, max Q(s') IS OURS NOW
+		q_val_t max_next = qtableMaxValAction(a,wk->s).v;
+		region_msg_t b = {.kind = REGION_MSG_BACKUP};
+		b.backup.s      = wk->from;
+		b.backup.action = wk->from_action;
+#ifdef CQ_FIXED_POINT
+		b.backup.target = qvalSaturate((int64_t)qvalFromFloat(wk->pending_reward) + qvalMul(qvalFromFloat(a->discount_rate),max_next));
+#else
+		b.backup.target = wk->pending_reward + a->discount_rate*max_next;
+#endif
+		wk->pending = false;
+		regionSend(&regionOwner(rt,wk->from)->inbox,&b);
+	}
+	w->local[w->n_local++] = *wk;
+}
+
+// STEPS ONE WALKER UNTIL IT LEAVES THE BAND, ENDS OR USES ITS QUANTUM
+static void regionStepWalker(region_trainer_t* rt, region_worker_t* w, region_walker_t* wk){
+	Agent* a = &w->agent;
+	MazeEnv* env = rt->env;
+	const region_params_t* prm = &rt->params;
+
+	for(size_t q = 0; q < REGION_QUANTUM; q++){
+		if(wk->steps >= prm->max_steps){ regionFinish(rt,w,wk); return; }
+		state_t s = wk->s;
+		Action act;
+		if((float)(agentRandU32(a) >> 8)*(1.0f/16777216.0f) > wk->epsilon) act = qtableMaxValAction(a,s).a;
+		else                                                              act = (Action)agentRandRange(a,ACTION_N_ACTIONS);
+
+		state_t next = GetNextState(s,act);
+		stepResult sr = stepIntoStateUnscaled(env,next,prm->walls_count,prm->opens_count);
+		state_t trans = (prm->block_transpassing && sr.invalidNext) ? s : next;
+		if(prm->distance_shaping && !sr.invalidNext){
+			float phi_s  = (float)(abs(s.x - rt->goal.x) + abs(s.y - rt->goal.y));
+			float phi_sp = (float)(abs(trans.x - rt->goal.x) + abs(trans.y - rt->goal.y));
+			sr.reward += a->discount_rate*(phi_s - phi_sp);
+		}
+		wk->reward += sr.reward;
+		wk->steps++;
+		w->steps++;
+
+		bool inside = regionInGrid(env,trans);
+		if(sr.terminal || !inside || regionOwner(rt,trans) == w){
+			wk->loss += regionHuber(agentQtableUpdateAt(a,s,act,trans,sr));
+			w->updates++;
+			if(sr.isGoal){ wk->goal = true; regionFinish(rt,w,wk); return; }
+			if(sr.terminal){ regionFinish(rt,w,wk); return; }
+			if(inside) wk->s = trans;
+			continue;
+		}
+		// ACROSS THE EDGE: THE WALKER CARRIES ITS BACKUP TO THE OWNER OF trans
+		wk->pending        = true;
+		wk->from           = s;
+		wk->from_action    = (uint32_t)act;
+		wk->pending_reward = sr.reward;
+		wk->s              = trans;
+		regionPlace(rt,w,wk);
+		return;
+	}
+	w->local[w->n_local++] = *wk;
+}
+
+// FAULTS THE BAND IN ON THIS THREAD'S NODE, KEEPING WHATEVER THE TABLE HOLDS
+static void regionTouchBand(region_worker_t* w){
+	q_table_t* t = &w->agent.q_table;
+	for(size_t y = w->y0; y < w->y1; y++){
+		for(size_t x = 0; x < t->len_state_x; x++){
+			volatile q_val_t* row = qtableRow(t,(state_t){(int32_t)x,(int32_t)y},0);
+			row[0] = row[0];
+		}
+	}
+}
+
+static void* regionWorkerMain(void* arg){
+	region_worker_t* w = (region_worker_t*)arg;
+	region_trainer_t* rt = w->rt;
+	if(rt->params.numa == ARENA_NUMA_FIRST_TOUCH){
+		uint64_t mask;
+		size_t n_nodes = arenaNumaNodes(&mask);
+		// THE (index % n_nodes)-TH ONLINE NODE
+		size_t skip = w->index % n_nodes, node = 0;
+		for(; node < ARENA_MAX_NODES; node++){
+			if(!(mask >> node & 1)) continue;
+			if(skip-- == 0) break;
+		}
+		arenaPinThreadToNode(node);
+		regionTouchBand(w);
+	}
+
+	unsigned idle = 0;
+	region_msg_t m;
+	for(;;){
+		if(atomic_load_explicit(&rt->stop,memory_order_relaxed)) break;
+		bool got = false;
+		while(regionQueuePop(&w->inbox,&m)){
+			regionHandle(rt,w,&m);
+			got = true;
+		}
+		if(w->n_local){
+			region_walker_t wk = w->local[--w->n_local];
+			regionStepWalker(rt,w,&wk);
+			idle = 0;
+			continue;
+		}
+		if(got){ idle = 0; continue; }
+		// EVERY BACKUP IS PUSHED BEFORE THE LAST WALKER RETIRES, AN EMPTY INBOX AFTER live == 0 STAYS EMPTY
+		if(atomic_load_explicit(&rt->live,memory_order_acquire) == 0){
+			if(!regionQueuePop(&w->inbox,&m)) break;
+			regionHandle(rt,w,&m);
+			continue;
+		}
+		w->idle++;
+		regionIdle(idle++);
+	}
+	return NULL;
+}
+
+static size_t regionPow2(size_t n){
+	size_t c = 1;
+	while(c < n) c <<= 1;
+	return c;
+}
+
+int regionInit(region_trainer_t* rt, MazeEnv* env, Agent* agent, const region_params_t* params){
+	memset(rt,0,sizeof(*rt));
+	if(params->n_episodes == 0 || params->max_steps == 0 || env->rows == 0 || env->cols == 0) return -1;
+	if(agent->q_table.n_tables == 2 || !agent->q_table.vals) return -1;
+	rt->env    = env;
+	rt->agent  = agent;
+	rt->params = *params;
+	cellId g = getFirstMatchingCell(env,GRID_AGENT_GOAL);
+	rt->goal = (state_t){(int32_t)g.col,(int32_t)g.row};
+
+	size_t max_bands = (env->rows + REGION_ROW_ALIGN - 1)/REGION_ROW_ALIGN;
+	size_t n_workers = params->n_threads ? params->n_threads : regionCpuCount();
+	if(n_workers > max_bands) n_workers = max_bands;
+	if(n_workers == 0) n_workers = 1;
+	rt->params.n_threads = n_workers;
+	size_t n_walkers = params->n_walkers ? params->n_walkers : REGION_DEFAULT_WALKERS*n_workers;
+	if(n_walkers > params->n_episodes) n_walkers = params->n_episodes;
+	rt->n_walkers = n_walkers;
+
+	size_t n_cells   = env->rows*env->cols;
+	size_t inbox_cap = regionPow2(2*n_walkers + 1);
+	size_t done_cap  = regionPow2(n_walkers > 1024 ? n_walkers : 1024);
+	size_t bytes = n_workers*(arenaAlignUp(sizeof(region_worker_t),ARENA_ALIGN)
+	                         + arenaAlignUp(inbox_cap*sizeof(region_cell_t),ARENA_ALIGN)
+	                         + arenaAlignUp(n_walkers*sizeof(region_walker_t),ARENA_ALIGN))
+	             + arenaAlignUp(done_cap*sizeof(region_cell_t),ARENA_ALIGN)
+	             + arenaAlignUp(env->rows*sizeof(uint32_t),ARENA_ALIGN)
+	             + (params->random_starts ? arenaAlignUp(n_cells*sizeof(uint32_t),ARENA_ALIGN) : 0);
+	if(arenaInit(&rt->arena,bytes) != 0) return -1;
+	rt->workers   = (region_worker_t*)arenaCalloc(&rt->arena,n_workers,sizeof(region_worker_t));
+	rt->row_owner = (uint32_t*)arenaCalloc(&rt->arena,env->rows,sizeof(uint32_t));
+	region_cell_t* done_cells = (region_cell_t*)arenaAlloc(&rt->arena,done_cap*sizeof(region_cell_t));
+	if(!rt->workers || !rt->row_owner || !done_cells){ regionFree(rt); return -1; }
+	regionQueueInit(&rt->done,done_cells,done_cap);
+
+	// BANDS OF ~EQUAL OPEN CELLS, CUT ONLY ON REGION_ROW_ALIGN ROWS
+	size_t total_open = 0;
+	for(size_t c = 0; c < n_cells; c++) total_open += env->grid[c] != GRID_WALL;
+	size_t block = 0, cum = 0;
+	for(size_t k = 0; k < n_workers; k++){
+		region_worker_t* w = &rt->workers[k];
+		w->rt    = rt;
+		w->index = k;
+		w->y0    = block*REGION_ROW_ALIGN;
+		size_t want = (total_open*(k + 1))/n_workers;
+		size_t bands_left = n_workers - k - 1;
+		// AT LEAST ONE BLOCK, AND ONE LEFT FOR EACH BAND STILL TO COME
+		do {
+			size_t y_end = (block + 1)*REGION_ROW_ALIGN < env->rows ? (block + 1)*REGION_ROW_ALIGN : env->rows;
+			for(size_t y = block*REGION_ROW_ALIGN; y < y_end; y++){
+				for(size_t x = 0; x < env->cols; x++) w->open_cells += env->grid[y*env->cols + x] != GRID_WALL;
+				rt->row_owner[y] = (uint32_t)k;
+			}
+			block++;
+		} while(block < max_bands && (bands_left == 0 || (max_bands - block > bands_left && cum + w->open_cells < want)));
+		cum += w->open_cells;
+		w->y1 = block*REGION_ROW_ALIGN < env->rows ? block*REGION_ROW_ALIGN : env->rows;
+
+		w->agent = *agent;
+		w->agent.q_table.borrowed = true;
+		agentSetSeed(&w->agent,(unsigned int)(agent->rng_state ^ (7919ULL*(k + 1))));
+		region_cell_t* cells = (region_cell_t*)arenaAlloc(&rt->arena,inbox_cap*sizeof(region_cell_t));
+		w->local = (region_walker_t*)arenaAlloc(&rt->arena,n_walkers*sizeof(region_walker_t));
+		if(!cells || !w->local){ regionFree(rt); return -1; }
+		regionQueueInit(&w->inbox,cells,inbox_cap);
+	}
+
+	if(params->random_starts){
+		rt->open = (uint32_t*)arenaAlloc(&rt->arena,n_cells*sizeof(uint32_t));
+		if(!rt->open){ regionFree(rt); return -1; }
+		for(size_t c = 0; c < n_cells; c++){
+			if(env->grid[c] == GRID_OPEN) rt->open[rt->n_open++] = (uint32_t)c;
+		}
+	}
+	rt->n_workers = n_workers;
+	return 0;
+}
+
+int regionTrain(region_trainer_t* rt, region_episode_fn episode_fn, void* ctx){
+	if(!rt->workers || rt->running) return -1;
+	atomic_store(&rt->started,0);
+	atomic_store(&rt->env_steps,0);
+	atomic_store(&rt->stop,false);
+
+	// THE FIRST WALKERS GO STRAIGHT INTO THE STACKS, NO WORKER RUNS YET
+	size_t live = 0;
+	for(size_t i = 0; i < rt->n_walkers; i++){
+		region_walker_t wk;
+		if(!regionStartWalker(rt,&rt->workers[i % rt->n_workers].agent,&wk)) break;
+		region_worker_t* owner = regionOwner(rt,wk.s);
+		owner->local[owner->n_local++] = wk;
+		live++;
+	}
+	atomic_store(&rt->live,live);
+
+	size_t n_started = 0;
+	for(; n_started < rt->n_workers; n_started++){
+		if(pthread_create(&rt->workers[n_started].thread,NULL,regionWorkerMain,&rt->workers[n_started]) != 0) break;
+	}
+	if(n_started < rt->n_workers){
+		// A BAND WITHOUT ITS WORKER NEVER DRAINS, STOP THE OTHERS WHERE THEY ARE
+		atomic_store(&rt->stop,true);
+		for(size_t k = 0; k < n_started; k++) pthread_join(rt->workers[k].thread,NULL);
+		return -1;
+	}
+	rt->running = true;
+
+	uint64_t finished = 0;
+	unsigned idle = 0;
+	region_msg_t m;
+	while(finished < rt->params.n_episodes){
+		if(!regionQueuePop(&rt->done,&m)){
+			regionIdle(idle++);
+			continue;
+		}
+		idle = 0;
+		region_episode_t ep = {
+			.episode = finished++,
+			.steps   = m.walker.steps,
+			.goal    = m.walker.goal,
+			.reward  = m.walker.reward,
+			.loss    = m.walker.loss,
+			.epsilon = m.walker.epsilon
+		};
+		if(episode_fn) episode_fn(ctx,&ep);
+	}
+	for(size_t k = 0; k < rt->n_workers; k++) pthread_join(rt->workers[k].thread,NULL);
+	rt->running = false;
+	rt->agent->epsilon = agentEpsilonSchedule(atomic_load(&rt->env_steps),rt->agent->epsilon_decay);
+	return 0;
+}
+
+void regionFree(region_trainer_t* rt){
+	arenaFree(&rt->arena);
+	memset(rt,0,sizeof(*rt));
+}
+
+#endif
@@ -0,0 +1,304 @@
+#ifndef AGENT_REPLAY_H
+
+#define AGENT_REPLAY_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "agent.h"
+
+/*
+    EXPERIENCE REPLAY BUFFER
+
+    FIXED CAPACITY RING OF PACKED TRANSITIONS, THE OLDEST IS OVERWRITTEN.
+
+    TRANSITION (12 BYTES):
+        | cell id : 30 bit | action : 2 bit | next cell id : 31 bit | terminal : 1 bit | reward : 32 bit float |
+
+    cell_action IS ALSO THE SORT KEY: ORDERING A BATCH BY IT GROUPS THE
+    UPDATES OF ONE STATE ROW TOGETHER AND WALKS THE Q-TABLE FORWARD.
+
+    PRIORITIZED MODE KEEPS A SUM-TREE OVER THE RING SLOTS (LEAF i = SLOT i),
+    SAMPLES PROPORTIONALLY TO (|td| + REPLAY_PRIORITY_EPS)^alpha AND SCALES
+    EACH UPDATE BY ITS IMPORTANCE SAMPLING WEIGHT (N*P(i))^-beta.
+*/
+
+#define REPLAY_MAX_BATCH       256
+#define REPLAY_PRIORITY_EPS    1e-3f
+#define REPLAY_DEFAULT_ALPHA   0.6f
+#define REPLAY_DEFAULT_BETA    0.4f
+
+typedef struct {
+	uint32_t cell_action;
+	uint32_t next_term;
+	reward_t reward;
+} replay_transition_t;
+
+typedef struct {
+	replay_transition_t* items;
+	size_t capacity;
+	size_t count;
+	size_t head;        // NEXT SLOT TO WRITE
+	size_t len_state_x;
+	size_t len_state_y;
+
+	// PRIORITIZED MODE, tree IS NULL WHEN DISABLED
+	float* tree;
+	size_t tree_leaves; // POWER OF TWO >= capacity
+	float  max_priority;
+	float  alpha;
+	float  beta;
+
+	size_t total_updates;
+} replay_buffer_t;
+
+int  replayBufferInit(replay_buffer_t* rb, MazeEnv* env, size_t capacity, bool prioritized);
+void replayBufferFree(replay_buffer_t* rb);
+void replayPush(replay_buffer_t* rb, state_t s, Action a, state_t next, stepResult sr);
+size_t replaySampleBatch(replay_buffer_t* rb, Agent* agent, size_t batch_size, uint32_t* slots, float* weights);
+float replayTrainBatch(replay_buffer_t* rb, Agent* agent, size_t batch_size);
+
+#endif
+
+#ifdef AGENT_REPLAY_IMPLEMENTATION
+
+int replayBufferInit(replay_buffer_t* rb, MazeEnv* env, size_t capacity, bool prioritized){
+	memset(rb,0,sizeof(*rb));
+	if(capacity == 0 || capacity >= (size_t)UINT32_MAX) return -1;
+	if(env->rows*env->cols >= ((size_t)1 << 30)){
+		fprintf(stderr,"[ERROR] maze too big for packed replay transitions\n");
+		return -1;
+	}
+	rb->items = (replay_transition_t*)malloc(capacity*sizeof(replay_transition_t));
+	if(!rb->items) return -1;
+	rb->capacity = capacity;
+	rb->len_state_x = env->cols;
+	rb->len_state_y = env->rows;
+	rb->alpha = REPLAY_DEFAULT_ALPHA;
+	rb->beta  = REPLAY_DEFAULT_BETA;
+
+	if(prioritized){
+		size_t leaves = 1;
+		while(leaves < capacity) leaves <<= 1;
+		rb->tree = (float*)calloc(2*leaves,sizeof(float));
+		if(!rb->tree){ replayBufferFree(rb); return -1; }
+		rb->tree_leaves = leaves;
+		rb->max_priority = 1.0f;
+	}
+	return 0;
+}
+
+void replayBufferFree(replay_buffer_t* rb){
+	free(rb->items);
+	free(rb->tree);
+	memset(rb,0,sizeof(*rb));
+}
+
+// SETS A LEAF AND RECOMPUTES ITS ANCESTORS FROM THEIR CHILDREN SO NO ROUNDING DRIFT BUILDS UP
+static void replayTreeSet(replay_buffer_t* rb, size_t slot, float priority){
+	size_t node = rb->tree_leaves + slot;
+	rb->tree[node] = priority;
+	for(node >>= 1; node >= 1; node >>= 1){
+		rb->tree[node] = rb->tree[2*node] + rb->tree[2*node + 1];
+	}
+}
+
+static size_t replayTreeFind(replay_buffer_t* rb, float u){
+	size_t node = 1;
+	while(node < rb->tree_leaves){
+		float left = rb->tree[2*node];
+		if(u < left){
+			node = 2*node;
+		} else {
+			u -= left;
+			node = 2*node + 1;
+		}
+	}
+	return node - rb->tree_leaves;
+}
+
+static inline bool replayInBounds(replay_buffer_t* rb, state_t s){
+	return !(s.x < 0 || s.y < 0 || (size_t)s.x >= rb->len_state_x || (size_t)s.y >= rb->len_state_y);
+}
+
+void replayPush(replay_buffer_t* rb, state_t s, Action a, state_t next, stepResult sr){
+	if(!replayInBounds(rb,s)) return;
+	// WITH WALL TRANSPASSING ENABLED THE AGENT CAN LEAVE THE GRID, KEEP IT IN PLACE
+	if(!replayInBounds(rb,next)) next = s;
+
+	uint32_t cell = (uint32_t)((size_t)s.y*rb->len_state_x + (size_t)s.x);
+	uint32_t next_cell = (uint32_t)((size_t)next.y*rb->len_state_x + (size_t)next.x);
+	rb->items[rb->head] = (replay_transition_t){
+		.cell_action = (cell << 2) | ((uint32_t)a & 3u),
+		.next_term   = (next_cell << 1) | (sr.terminal ? 1u : 0u),
+		.reward      = sr.reward
+	};
+	if(rb->tree) replayTreeSet(rb,rb->head,rb->max_priority);
+
+	rb->head = (rb->head + 1) % rb->capacity;
+	if(rb->count < rb->capacity) rb->count++;
+}
+
+static inline float replayRandUnit(Agent* agent){
+	return (float)(agentRandU32(agent) >> 8) * (1.0f / 16777216.0f);
+}
+
+// FILLS slots/weights WITH batch_size SAMPLES, STRATIFIED OVER THE SUM-TREE IN PRIORITIZED MODE
+size_t replaySampleBatch(replay_buffer_t* rb, Agent* agent, size_t batch_size, uint32_t* slots, float* weights){
+	if(rb->count == 0) return 0;
+	if(batch_size > REPLAY_MAX_BATCH) batch_size = REPLAY_MAX_BATCH;
+
+	if(!rb->tree){
+		for(size_t i = 0; i < batch_size; i++){
+			slots[i] = agentRandRange(agent,(uint32_t)rb->count);
+			weights[i] = 1.0f;
+		}
+		return batch_size;
+	}
+
+	float total = rb->tree[1];
+	float segment = total / (float)batch_size;
+	float max_w = 0.0f;
+	for(size_t i = 0; i < batch_size; i++){
+		float u = segment*((float)i + replayRandUnit(agent));
+		size_t slot = replayTreeFind(rb,u);
+		if(slot >= rb->count) slot = rb->count - 1;
+		float p = rb->tree[rb->tree_leaves + slot] / total;
+		slots[i] = (uint32_t)slot;
+		weights[i] = p > 0.0f ? powf((float)rb->count*p,-rb->beta) : 0.0f;
+		if(weights[i] > max_w) max_w = weights[i];
+	}
+	if(max_w > 0.0f)
+		for(size_t i = 0; i < batch_size; i++) weights[i] /= max_w;
+	return batch_size;
+}
+
+typedef struct { uint32_t key; uint32_t i; } replay_sort_item_t;
+
+static int replayCompareItems(const void* a, const void* b){
+	const replay_sort_item_t* x = (const replay_sort_item_t*)a;
+	const replay_sort_item_t* y = (const replay_sort_item_t*)b;
+	if(x->key != y->key) return x->key < y->key ? -1 : 1;
+	return x->i < y->i ? -1 : (x->i > y->i);
+}
+
+/*
+    ONE MINI-BATCH OF TABULAR Q-LEARNING UPDATES.
+    1. SAMPLE AND SORT BY cell_action (STATE ROW ORDER)
+    2. GATHER Q(s,a), max Q(next) AND REWARDS INTO FLAT ARRAYS
+    3. COMPUTE ALL TD ERRORS IN ONE BRANCH FREE LOOP
+    4. SCATTER, REPEATED PAIRS ARE REAPPLIED ON TOP OF THE PREVIOUS WRITE
+    RETURNS THE MEAN |TD ERROR| OF THE BATCH.
+*/
+float replayTrainBatch(replay_buffer_t* rb, Agent* agent, size_t batch_size){
+	uint32_t slots[REPLAY_MAX_BATCH];
+	float    weights[REPLAY_MAX_BATCH];
+	replay_sort_item_t order[REPLAY_MAX_BATCH];
+	q_val_t q_old[REPLAY_MAX_BATCH], q_next[REPLAY_MAX_BATCH], rewards[REPLAY_MAX_BATCH];
+	q_val_t not_term[REPLAY_MAX_BATCH], w[REPLAY_MAX_BATCH], td[REPLAY_MAX_BATCH];
+
+	size_t n = replaySampleBatch(rb,agent,batch_size,slots,weights);
+	if(n == 0) return 0.0f;
+
+	for(size_t i = 0; i < n; i++) order[i] = (replay_sort_item_t){rb->items[slots[i]].cell_action,(uint32_t)i};
+	qsort(order,n,sizeof(order[0]),replayCompareItems);
+
+	size_t n_x = rb->len_state_x;
+	if(agent->q_table.n_tables == 2){
+		// DOUBLE Q PICKS A TABLE PER BACKUP, SO THE FLAT GATHER/SCATTER DOES NOT
+		// APPLY. KEEP THE SORTED ORDER AND BACK UP ONE TRANSITION AT A TIME, THE
+		// IMPORTANCE WEIGHT SCALES THE LEARNING RATE OF ITS BACKUP
+		const float lr = agent->learning_rate;
+		float abs_td_sum = 0.0f;
+		for(size_t k = 0; k < n; k++){
+			replay_transition_t t = rb->items[slots[order[k].i]];
+			uint32_t cell = t.cell_action >> 2;
+			uint32_t next_cell = t.next_term >> 1;
+			state_t s    = {(int32_t)(cell % n_x),      (int32_t)(cell / n_x)};
+			state_t next = {(int32_t)(next_cell % n_x), (int32_t)(next_cell / n_x)};
+			stepResult sr = {0};
+			sr.reward   = t.reward;
+			sr.terminal = (t.next_term & 1u) != 0;
+			float lr_w = lr*weights[order[k].i];
+			agent->learning_rate = lr_w;
+			float scaled = fabsf(agentQtableUpdateAt(agent,s,(Action)(t.cell_action & 3u),next,sr));
+			agent->learning_rate = lr;
+			float td = lr_w > 0.0f ? scaled / lr_w : 0.0f;
+			abs_td_sum += td;
+			if(rb->tree){
+				float p = powf(td + REPLAY_PRIORITY_EPS,rb->alpha);
+				if(p > rb->max_priority) rb->max_priority = p;
+				replayTreeSet(rb,slots[order[k].i],p);
+			}
+		}
+		rb->total_updates += n;
+		return abs_td_sum / (float)n;
+	}
+
+	for(size_t k = 0; k < n; k++){
+		replay_transition_t t = rb->items[slots[order[k].i]];
+		uint32_t cell = t.cell_action >> 2;
+		uint32_t next_cell = t.next_term >> 1;
+		state_t s    = {(int32_t)(cell % n_x),      (int32_t)(cell / n_x)};
+		state_t next = {(int32_t)(next_cell % n_x), (int32_t)(next_cell / n_x)};
+		q_old[k]    = getQtableValue(agent,s,(Action)(t.cell_action & 3u));
+		q_next[k]   = qtableMaxValAction(agent,next).v;
+		rewards[k]  = qvalFromFloat(t.reward);
+		not_term[k] = (t.next_term & 1u) ? 0 : 1;
+		w[k]        = qvalFromFloat(weights[order[k].i]);
+	}
+
+#ifdef CQ_FIXED_POINT
+	// Q16.16 LIKE agentQtableUpdateAt, w IS ONE MORE Q16.16 FACTOR: Q += lr*(w*td).
+	// WITH UNIFORM SAMPLING w IS QVAL_ONE AND EVERY BACKUP MATCHES agentQtableUpdateAt
+	const q_val_t gamma = qvalFromFloat(agent->discount_rate);
+	for(size_t k = 0; k < n; k++){
+		int64_t target = (int64_t)rewards[k] + (not_term[k] ? qvalMul(gamma,q_next[k]) : 0);
+		td[k] = qvalSaturate(target - q_old[k]);
+	}
+#else
+	const float gamma = agent->discount_rate;
+	for(size_t k = 0; k < n; k++){
+		td[k] = rewards[k] + gamma*not_term[k]*q_next[k] - q_old[k];
+	}
+#endif
+
+#ifdef CQ_FIXED_POINT
+	const q_val_t lr = qvalFromFloat(agent->learning_rate);
+#else
+	const float lr = agent->learning_rate;
+#endif
+	float abs_td_sum = 0.0f;
+	for(size_t k = 0; k < n; k++){
+		uint32_t key = order[k].key;
+		uint32_t cell = key >> 2;
+		state_t s = {(int32_t)(cell % n_x),(int32_t)(cell / n_x)};
+		Action a = (Action)(key & 3u);
+		// SAME PAIR AS THE PREVIOUS ITEM: RE-READ SO BOTH UPDATES LAND
+		q_val_t q = getQtableValue(agent,s,a);
+#ifdef CQ_FIXED_POINT
+		q_val_t delta = td[k];
+		if(k > 0 && order[k-1].key == key) delta = qvalSaturate((int64_t)td[k] + q_old[k] - q);
+		setQtableValue(agent,s,a,qvalSaturate((int64_t)q + qvalMul(lr,qvalMul(w[k],delta))));
+#else
+		float delta = td[k];
+		if(k > 0 && order[k-1].key == key) delta = td[k] + q_old[k] - q;
+		setQtableValue(agent,s,a,q + lr*w[k]*delta);
+#endif
+		float abs_td = fabsf(qvalToFloat(td[k]));
+		abs_td_sum += abs_td;
+
+		if(rb->tree){
+			float p = powf(abs_td + REPLAY_PRIORITY_EPS,rb->alpha);
+			if(p > rb->max_priority) rb->max_priority = p;
+			replayTreeSet(rb,slots[order[k].i],p);
+		}
+	}
+
+	rb->total_updates += n;
+	return abs_td_sum / (float)n;
+}
+
+#endif
@@ -0,0 +1,221 @@
+#ifndef AGENT_RPC_H
+
+#define AGENT_RPC_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+    BATCHED ACTION QUERIES OVER A UNIX SOCKET
+
+    STANDALONE ON PURPOSE: A CLIENT ONLY NEEDS THIS HEADER, NOT agent.h.
+    rpc_state_t AND rpc_result_t HAVE THE LAYOUT OF state_t AND ValAction, SO
+    THE SERVER ANSWERS STRAIGHT INTO THE RESPONSE BUFFER.
+
+    FRAMING, NATIVE ENDIAN (THE SOCKET NEVER LEAVES THE MACHINE):
+        REQUEST   | rpc_request_t  | n_states x rpc_state_t  |
+        RESPONSE  | rpc_response_t | n_states x rpc_result_t |
+    ids ARE THE CLIENT'S, ECHOED BACK. A CLIENT MAY WRITE MANY REQUESTS
+    BEFORE READING (PIPELINING), RESPONSES COME BACK IN REQUEST ORDER.
+    THE SERVER STOPS READING A CLIENT WHILE ITS ANSWERS DO NOT FIT THE
+    SOCKET, SO A CLIENT THAT KEEPS MORE THAN rpcPipelineBytes OF ANSWERS
+    UNREAD CAN END UP BLOCKED IN write() AGAINST A BLOCKED SERVER.
+    status IS ALWAYS RPC_STATUS_OK, THE SERVER ONLY LISTENS ONCE ITS TABLE
+    IS LOADED.
+    AN EMPTY BATCH IS A PING THAT ALSO REPORTS THE TABLE SIZE.
+    STATES OUTSIDE THE TABLE ANSWER LIKE qtableMaxValAction: {0, LEFT}.
+
+    rpc_hist_t IS A LOG LINEAR LATENCY HISTOGRAM IN NANOSECONDS: 16 BUCKETS
+    PER POWER OF TWO, SO A PERCENTILE IS OFF BY AT MOST ~6%.
+*/
+
+#define RPC_REQUEST_MAGIC   0x51525143u   // "CQRQ"
+#define RPC_RESPONSE_MAGIC  0x53525143u   // "CQRS"
+#define RPC_MAX_BATCH       65536
+
+#define RPC_STATUS_OK       0
+
+#define RPC_HIST_SUB        16
+#define RPC_HIST_BUCKETS    (64*RPC_HIST_SUB)
+
+typedef struct { int32_t x; int32_t y; } rpc_state_t;
+typedef struct { float v; uint32_t a; } rpc_result_t;
+
+typedef struct {
+	uint32_t magic;
+	uint32_t id;
+	uint32_t n_states;
+	uint32_t reserved;
+} rpc_request_t;
+
+typedef struct {
+	uint32_t magic;
+	uint32_t id;
+	uint32_t n_states;
+	uint32_t status;
+	uint32_t rows;
+	uint32_t cols;
+} rpc_response_t;
+
+typedef struct {
+	uint64_t counts[RPC_HIST_BUCKETS];
+	uint64_t total;
+	uint64_t max_ns;
+} rpc_hist_t;
+
+void     rpcHistAdd(rpc_hist_t* h, uint64_t ns);
+uint64_t rpcHistPercentile(const rpc_hist_t* h, double q);
+void     rpcHistPrint(const rpc_hist_t* h, const char* label);
+
+int  rpcConnect(const char* path);
+int  rpcSendBatch(int fd, uint32_t id, const rpc_state_t* states, uint32_t n);
+int  rpcRecvBatch(int fd, rpc_response_t* resp, rpc_result_t* out, uint32_t cap);
+int  rpcWriteAll(int fd, const void* buf, size_t len);
+int  rpcReadAll(int fd, void* buf, size_t len);
+size_t rpcPipelineBytes(int fd);
+void rpcClose(int fd);
+
+#endif
+
+#ifdef AGENT_RPC_IMPLEMENTATION
+
+#ifndef _WIN32
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+static size_t rpcHistBucket(uint64_t ns){
+	if(ns < RPC_HIST_SUB) return (size_t)ns;
+	int msb = 63 - __builtin_clzll(ns);
+	int shift = msb - 4;   // 16 = 2^4 SUB BUCKETS
+	return (size_t)(msb - 3)*RPC_HIST_SUB + (size_t)((ns >> shift) & (RPC_HIST_SUB - 1));
+}
+
+// LOWER EDGE OF A BUCKET
+static uint64_t rpcHistValue(size_t b){
+	if(b < RPC_HIST_SUB) return (uint64_t)b;
+	size_t msb = b/RPC_HIST_SUB + 3;
+	return ((uint64_t)RPC_HIST_SUB + (b % RPC_HIST_SUB)) << (msb - 4);
+}
+
+void rpcHistAdd(rpc_hist_t* h, uint64_t ns){
+	size_t b = rpcHistBucket(ns);
+	if(b >= RPC_HIST_BUCKETS) b = RPC_HIST_BUCKETS - 1;
+	h->counts[b]++;
+	h->total++;
+	if(ns > h->max_ns) h->max_ns = ns;
+}
+
+uint64_t rpcHistPercentile(const rpc_hist_t* h, double q){
+	if(h->total == 0) return 0;
+	uint64_t rank = (uint64_t)(q*(double)h->total);
+	if(rank >= h->total) rank = h->total - 1;
+	uint64_t seen = 0;
+	for(size_t b = 0; b < RPC_HIST_BUCKETS; b++){
+		seen += h->counts[b];
+		if(seen > rank) return rpcHistValue(b);
+	}
+	return h->max_ns;
+}
+
+void rpcHistPrint(const rpc_hist_t* h, const char* label){
+	printf("[RESULT] %s: n=%llu p50=%.2fus p90=%.2fus p99=%.2fus p99.9=%.2fus max=%.2fus\n",
+	       label,(unsigned long long)h->total,
+	       rpcHistPercentile(h,0.50)/1e3,rpcHistPercentile(h,0.90)/1e3,
+	       rpcHistPercentile(h,0.99)/1e3,rpcHistPercentile(h,0.999)/1e3,h->max_ns/1e3);
+}
+
+#ifdef _WIN32
+
+// THE SERVER AND THE CLIENTS ARE POSIX ONLY FOR NOW
+int  rpcConnect(const char* path){ (void)path; return -1; }
+int  rpcSendBatch(int fd, uint32_t id, const rpc_state_t* states, uint32_t n){ (void)fd; (void)id; (void)states; (void)n; return -1; }
+int  rpcRecvBatch(int fd, rpc_response_t* resp, rpc_result_t* out, uint32_t cap){ (void)fd; (void)resp; (void)out; (void)cap; return -1; }
+int  rpcWriteAll(int fd, const void* buf, size_t len){ (void)fd; (void)buf; (void)len; return -1; }
+int  rpcReadAll(int fd, void* buf, size_t len){ (void)fd; (void)buf; (void)len; return -1; }
+size_t rpcPipelineBytes(int fd){ (void)fd; return 0; }
+
+#else
+
+int rpcConnect(const char* path){
+	struct sockaddr_un addr = {0};
+	addr.sun_family = AF_UNIX;
+	if(strlen(path) >= sizeof(addr.sun_path)) return -1;
+	strcpy(addr.sun_path,path);
+	int fd = socket(AF_UNIX,SOCK_STREAM,0);
+	if(fd < 0) return -1;
+	if(connect(fd,(struct sockaddr*)&addr,sizeof(addr)) != 0){ close(fd); return -1; }
+	return fd;
+}
+
+int rpcWriteAll(int fd, const void* buf, size_t len){
+	const uint8_t* p = (const uint8_t*)buf;
+	while(len > 0){
+		ssize_t w = write(fd,p,len);
+		if(w < 0 && errno == EINTR) continue;
+		if(w <= 0) return -1;
+		p += w;
+		len -= (size_t)w;
+	}
+	return 0;
+}
+
+int rpcReadAll(int fd, void* buf, size_t len){
+	uint8_t* p = (uint8_t*)buf;
+	while(len > 0){
+		ssize_t r = read(fd,p,len);
+		if(r < 0 && errno == EINTR) continue;
+		if(r <= 0) return -1;
+		p += r;
+		len -= (size_t)r;
+	}
+	return 0;
+}
+
+int rpcSendBatch(int fd, uint32_t id, const rpc_state_t* states, uint32_t n){
+	if(n > RPC_MAX_BATCH) return -1;
+	rpc_request_t req = {RPC_REQUEST_MAGIC,id,n,0};
+	// ONE WRITE FOR SMALL BATCHES, THE SERVER SEES THE WHOLE FRAME AT ONCE
+	uint8_t small[sizeof(rpc_request_t) + 256*sizeof(rpc_state_t)];
+	if(n <= 256){
+		memcpy(small,&req,sizeof(req));
+		if(n) memcpy(small + sizeof(req),states,n*sizeof(rpc_state_t));
+		return rpcWriteAll(fd,small,sizeof(req) + n*sizeof(rpc_state_t));
+	}
+	if(rpcWriteAll(fd,&req,sizeof(req)) != 0) return -1;
+	return rpcWriteAll(fd,states,n*sizeof(rpc_state_t));
+}
+
+// HALF THE SEND BUFFER, THE KERNEL CHARGES ITS OWN BOOKKEEPING TO IT TOO.
+// THE SERVER'S SIDE IS ASSUMED AS BIG AS THE CLIENT'S
+size_t rpcPipelineBytes(int fd){
+	int size = 0;
+	socklen_t len = sizeof(size);
+	if(getsockopt(fd,SOL_SOCKET,SO_SNDBUF,&size,&len) != 0 || size <= 0) return 0;
+	return (size_t)size/2;
+}
+
+// RETURNS THE NUMBER OF RESULTS, -1 ON A BROKEN STREAM OR A BATCH BIGGER THAN cap
+int rpcRecvBatch(int fd, rpc_response_t* resp, rpc_result_t* out, uint32_t cap){
+	if(rpcReadAll(fd,resp,sizeof(*resp)) != 0) return -1;
+	if(resp->magic != RPC_RESPONSE_MAGIC || resp->n_states > cap) return -1;
+	if(rpcReadAll(fd,out,resp->n_states*sizeof(rpc_result_t)) != 0) return -1;
+	return (int)resp->n_states;
+}
+
+#endif
+
+void rpcClose(int fd){
+#ifndef _WIN32
+	if(fd >= 0) close(fd);
+#else
+	(void)fd;
+#endif
+}
+
+#endif
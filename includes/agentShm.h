@@ -0,0 +1,308 @@
+#ifndef AGENT_SHM_H
+
+#define AGENT_SHM_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "agent.h"
+#include "agentPolicy.h"
+
+/*
+    SHARED MEMORY Q-TABLE SEGMENT
+
+    ONE WRITER (agentServe) PUBLISHES A Q-TABLE AND ITS COMPILED POLICY INTO A
+    NAMED SEGMENT, ANY NUMBER OF PROCESSES MAP IT READ ONLY AND READ THE
+    VALUES IN PLACE, NOTHING IS COPIED OR fread PER CONSUMER.
+
+    LAYOUT:
+        | header (4096) | slot 0 (slot_capacity) | slot 1 (slot_capacity) |
+    A SLOT HOLDS THE q_val_t VALUES (SAME ORDER AS THE .qtable BODY, SO A
+    DOUBLE TABLE STAYS INTERLEAVED) AND THEN THE 2 BIT POLICY, 64 ALIGNED.
+
+    DOUBLE BUFFER + PER SLOT SEQLOCK
+    header.active NAMES THE SLOT TO READ. A PUBLISH ALWAYS WRITES THE OTHER
+    SLOT: ITS seq GOES ODD, THE DATA IS COPIED, seq GOES EVEN AGAIN AND ONLY
+    THEN active FLIPS. READERS OF THE CURRENT TABLE ARE NEVER WAITED ON AND
+    NEVER RETRY. A READER THAT STILL HOLDS A VIEW TWO PUBLISHES LATER IS ON
+    THE SLOT BEING REWRITTEN, shmViewValid SEES THE seq CHANGE AND THE READER
+    TAKES A NEW VIEW (shmViewStale SAYS WHEN A NEWER TABLE IS OUT AT ALL).
+
+    A VIEW IS getQtableValue COMPATIBLE: PUT view.q_table IN AN Agent AND THE
+    USUAL getQtableValue/qtableMaxValAction READ THE SEGMENT. THE MAPPING IS
+    READ ONLY, SO A STRAY setQtableValue FAULTS INSTEAD OF CORRUPTING IT.
+
+    POSIX shm_open ON LINUX ("/cq_<name>"), A NAMED FILE MAPPING ON WINDOWS
+    ("Local\\cq_<name>"). THE SEGMENT IS ONLY AS OLD AS THE SERVING PROCESS.
+*/
+
+#define SHM_MAGIC        "CQSHMQT1"
+#define SHM_VERSION      1
+#define SHM_HEADER_SIZE  4096
+#define SHM_NAME_MAX     64
+
+typedef struct {
+	_Atomic uint64_t seq;          // ODD WHILE THE WRITER IS COPYING INTO THE SLOT
+	uint64_t generation;           // PUBLISH NUMBER OF THE TABLE IN THE SLOT
+	uint64_t rows;
+	uint64_t cols;
+	uint64_t n_actions;
+	uint64_t n_tables;
+	uint64_t policy_offset;        // FROM THE START OF THE SLOT
+	uint64_t policy_bytes;
+} shm_slot_t;
+
+typedef struct {
+	char             magic[8];
+	uint32_t         version;
+	uint32_t         reserved;
+	uint64_t         slot_capacity;
+	_Atomic uint64_t active;
+	_Atomic uint64_t generation;   // LAST PUBLISHED, 0 BEFORE THE FIRST
+	uint64_t         pad[3];
+	shm_slot_t       slots[2];
+} shm_header_t;
+
+typedef struct {
+	shm_header_t* header;
+	uint8_t*      base;
+	size_t        len;
+	bool          writer;
+	char          name[SHM_NAME_MAX];
+	void*         handle;          // WINDOWS FILE MAPPING HANDLE
+} qtable_shm_t;
+
+typedef struct {
+	q_table_t         q_table;     // vals POINTS INTO THE SEGMENT
+	compiled_policy_t policy;      // packed POINTS INTO THE SEGMENT
+	uint64_t          generation;
+	size_t            slot;
+	uint64_t          seq;
+} shm_view_t;
+
+// BYTES A SLOT NEEDS FOR A rows x cols TABLE, DOUBLE Q INCLUDED
+size_t shmSlotBytes(size_t rows, size_t cols, size_t n_actions, size_t n_tables);
+int    shmCreate(qtable_shm_t* shm, const char* name, size_t slot_capacity);
+int    shmPublish(qtable_shm_t* shm, const q_table_t* t, const compiled_policy_t* p);
+int    shmOpen(qtable_shm_t* shm, const char* name);
+int    shmAcquire(const qtable_shm_t* shm, shm_view_t* view);
+bool   shmViewValid(const qtable_shm_t* shm, const shm_view_t* view);
+bool   shmViewStale(const qtable_shm_t* shm, const shm_view_t* view);
+void   shmClose(qtable_shm_t* shm);
+
+#endif
+
+#ifdef AGENT_SHM_IMPLEMENTATION
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#define SHM_ALIGN(n,a) (((n) + (a) - 1) & ~((size_t)(a) - 1))
+
+size_t shmSlotBytes(size_t rows, size_t cols, size_t n_actions, size_t n_tables){
+	size_t qbytes = SHM_ALIGN(rows*cols*n_actions*n_tables*sizeof(q_val_t),64);
+	return SHM_ALIGN(qbytes + policyPackedSize(rows,cols),4096);
+}
+
+static uint8_t* shmSlotData(const qtable_shm_t* shm, size_t slot){
+	return shm->base + SHM_HEADER_SIZE + slot*shm->header->slot_capacity;
+}
+
+static int shmMapName(char* out, const char* name){
+#ifdef _WIN32
+	int n = snprintf(out,SHM_NAME_MAX,"Local\\cq_%s",name);
+#else
+	int n = snprintf(out,SHM_NAME_MAX,"/cq_%s",name);
+#endif
+	return (n <= 0 || n >= SHM_NAME_MAX || strchr(name,'/') || strchr(name,'\\')) ? -1 : 0;
+}
+
+static int shmMap(qtable_shm_t* shm, size_t len, bool create){
+#ifdef _WIN32
+	HANDLE h;
+	if(create){
+		h = CreateFileMappingA(INVALID_HANDLE_VALUE,NULL,PAGE_READWRITE,
+		                       (DWORD)((uint64_t)len >> 32),(DWORD)(len & 0xFFFFFFFFu),shm->name);
+	} else {
+		h = OpenFileMappingA(FILE_MAP_READ,FALSE,shm->name);
+	}
+	if(!h) return -1;
+	void* base = MapViewOfFile(h,create ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ,0,0,len);
+	if(!base){ CloseHandle(h); return -1; }
+	shm->handle = (void*)h;
+#else
+	int fd;
+	if(create){
+		// A SEGMENT LEFT BY A KILLED SERVER IS REPLACED, NOT REUSED
+		shm_unlink(shm->name);
+		fd = shm_open(shm->name,O_CREAT | O_EXCL | O_RDWR,0644);
+		if(fd < 0) return -1;
+		if(ftruncate(fd,(off_t)len) != 0){ close(fd); shm_unlink(shm->name); return -1; }
+	} else {
+		fd = shm_open(shm->name,O_RDONLY,0);
+		if(fd < 0) return -1;
+		struct stat st;
+		if(fstat(fd,&st) != 0 || (size_t)st.st_size < SHM_HEADER_SIZE){ close(fd); return -1; }
+		len = (size_t)st.st_size;
+	}
+	void* base = mmap(NULL,len,create ? PROT_READ | PROT_WRITE : PROT_READ,MAP_SHARED,fd,0);
+	close(fd);
+	if(base == MAP_FAILED){ if(create) shm_unlink(shm->name); return -1; }
+#endif
+	shm->base   = (uint8_t*)base;
+	shm->header = (shm_header_t*)base;
+	shm->len    = len;
+	shm->writer = create;
+	return 0;
+}
+
+int shmCreate(qtable_shm_t* shm, const char* name, size_t slot_capacity){
+	memset(shm,0,sizeof(*shm));
+	if(!name || slot_capacity == 0 || shmMapName(shm->name,name) != 0) return -1;
+	slot_capacity = SHM_ALIGN(slot_capacity,4096);
+	if(shmMap(shm,SHM_HEADER_SIZE + 2*slot_capacity,true) != 0){
+		fprintf(stderr,"[ERROR] could not create shared memory %s\n",shm->name);
+		return -1;
+	}
+	shm_header_t* h = shm->header;
+	h->version       = SHM_VERSION;
+	h->slot_capacity = slot_capacity;
+	atomic_store_explicit(&h->active,0,memory_order_relaxed);
+	atomic_store_explicit(&h->generation,0,memory_order_relaxed);
+	atomic_store_explicit(&h->slots[0].seq,0,memory_order_relaxed);
+	atomic_store_explicit(&h->slots[1].seq,0,memory_order_relaxed);
+	// THE MAGIC GOES LAST, A READER NEVER SEES A HALF BUILT HEADER
+	atomic_thread_fence(memory_order_release);
+	memcpy(h->magic,SHM_MAGIC,8);
+	return 0;
+}
+
+int shmPublish(qtable_shm_t* shm, const q_table_t* t, const compiled_policy_t* p){
+	if(!shm->writer || !t->vals || !p->packed) return -1;
+	// READERS INDEX THE SLOT ROW MAJOR (agentReadQtable TABLES ALWAYS ARE)
+	if(t->layout != QTABLE_LAYOUT_ROW) return -1;
+	if(p->rows != t->len_state_y || p->cols != t->len_state_x) return -1;
+	shm_header_t* h = shm->header;
+	size_t n_tables = qtableCount(t);
+	size_t qbytes   = t->len_state_x*t->len_state_y*t->len_state_actions*n_tables*sizeof(q_val_t);
+	size_t pbytes   = policyPackedSize(p->rows,p->cols);
+	size_t poff     = SHM_ALIGN(qbytes,64);
+	if(poff + pbytes > h->slot_capacity){
+		fprintf(stderr,"[ERROR] table needs %zu bytes, the shared slots hold %llu\n",
+		        poff + pbytes,(unsigned long long)h->slot_capacity);
+		return -1;
+	}
+
+	size_t next = (size_t)(atomic_load_explicit(&h->active,memory_order_relaxed) ^ 1);
+	uint64_t gen = atomic_load_explicit(&h->generation,memory_order_relaxed) + 1;
+	shm_slot_t* slot = &h->slots[next];
+	uint64_t seq = atomic_load_explicit(&slot->seq,memory_order_relaxed);
+
+	atomic_store_explicit(&slot->seq,seq + 1,memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	uint8_t* data = shmSlotData(shm,next);
+	memcpy(data,t->vals,qbytes);
+	memcpy(data + poff,p->packed,pbytes);
+	slot->generation    = gen;
+	slot->rows          = t->len_state_y;
+	slot->cols          = t->len_state_x;
+	slot->n_actions     = t->len_state_actions;
+	slot->n_tables      = n_tables;
+	slot->policy_offset = poff;
+	slot->policy_bytes  = pbytes;
+	atomic_store_explicit(&slot->seq,seq + 2,memory_order_release);
+
+	atomic_store_explicit(&h->active,next,memory_order_release);
+	atomic_store_explicit(&h->generation,gen,memory_order_release);
+	return 0;
+}
+
+int shmOpen(qtable_shm_t* shm, const char* name){
+	memset(shm,0,sizeof(*shm));
+	if(!name || shmMapName(shm->name,name) != 0) return -1;
+#ifdef _WIN32
+	// A VIEW OF THE HEADER FIRST, IT KNOWS HOW BIG THE SEGMENT IS
+	if(shmMap(shm,SHM_HEADER_SIZE,false) != 0) return -1;
+	size_t len = SHM_HEADER_SIZE + 2*(size_t)shm->header->slot_capacity;
+	shmClose(shm);
+	shmMapName(shm->name,name);
+	if(shmMap(shm,len,false) != 0) return -1;
+#else
+	if(shmMap(shm,0,false) != 0) return -1;
+#endif
+	shm_header_t* h = shm->header;
+	if(memcmp(h->magic,SHM_MAGIC,8) != 0 || h->version != SHM_VERSION ||
+	   shm->len < SHM_HEADER_SIZE + 2*h->slot_capacity){
+		fprintf(stderr,"[ERROR] %s is not a qtable segment\n",shm->name);
+		shmClose(shm);
+		return -1;
+	}
+	return 0;
+}
+
+int shmAcquire(const qtable_shm_t* shm, shm_view_t* view){
+	shm_header_t* h = shm->header;
+	// ONLY A WRITER THAT LAPPED US TWICE MAKES THIS RETRY
+	for(int tries = 0; tries < 1000; tries++){
+		if(atomic_load_explicit(&h->generation,memory_order_acquire) == 0) return -1;
+		size_t idx = (size_t)(atomic_load_explicit(&h->active,memory_order_acquire) & 1);
+		shm_slot_t* slot = &h->slots[idx];
+		uint64_t seq = atomic_load_explicit(&slot->seq,memory_order_acquire);
+		if(seq & 1) continue;
+		shm_view_t v = {0};
+		v.generation              = slot->generation;
+		v.q_table.len_state_y     = (size_t)slot->rows;
+		v.q_table.len_state_x     = (size_t)slot->cols;
+		v.q_table.len_state_actions = (size_t)slot->n_actions;
+		v.q_table.n_tables        = (size_t)slot->n_tables;
+		uint64_t poff = slot->policy_offset;
+		uint64_t pbytes = slot->policy_bytes;
+		atomic_thread_fence(memory_order_acquire);
+		if(atomic_load_explicit(&slot->seq,memory_order_relaxed) != seq) continue;
+
+		if(poff + pbytes > h->slot_capacity) return -1;
+		uint8_t* data = shmSlotData(shm,idx);
+		v.q_table.vals = (q_val_t*)data;
+		v.policy.rows   = v.q_table.len_state_y;
+		v.policy.cols   = v.q_table.len_state_x;
+		v.policy.packed = data + poff;
+		v.slot = idx;
+		v.seq  = seq;
+		*view = v;
+		return 0;
+	}
+	return -1;
+}
+
+// TRUE WHEN EVERY VALUE READ THROUGH view SINCE shmAcquire WAS CONSISTENT
+bool shmViewValid(const qtable_shm_t* shm, const shm_view_t* view){
+	atomic_thread_fence(memory_order_acquire);
+	return atomic_load_explicit(&shm->header->slots[view->slot].seq,memory_order_relaxed) == view->seq;
+}
+
+bool shmViewStale(const qtable_shm_t* shm, const shm_view_t* view){
+	return atomic_load_explicit(&shm->header->generation,memory_order_acquire) != view->generation;
+}
+
+void shmClose(qtable_shm_t* shm){
+	if(!shm->base) return;
+#ifdef _WIN32
+	UnmapViewOfFile(shm->base);
+	if(shm->handle) CloseHandle((HANDLE)shm->handle);
+#else
+	munmap(shm->base,shm->len);
+	if(shm->writer) shm_unlink(shm->name);
+#endif
+	memset(shm,0,sizeof(*shm));
+}
+
+#endif
@@ -0,0 +1,484 @@
+#ifndef AGENT_SWEEP_H
+
+#define AGENT_SWEEP_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "agent.h"
+#include "agentDyna.h"
+
+/*
+    PRIORITIZED SWEEPING
+
+    SAME LEARNED MODEL AS DYNA-Q, BUT INSTEAD OF SAMPLING VISITED PAIRS
+    UNIFORMLY THE PLANNER KEEPS AN INDEXED MAX-HEAP OF (STATE, ACTION) PAIRS
+    KEYED BY |TD ERROR|. EACH POP BACKS UP ONE PAIR AND THEN RE-SCORES EVERY
+    PAIR THAT LEADS INTO ITS STATE, SO VALUE CHANGES FLOW BACKWARD FROM THE GOAL.
+
+    pos[pair] IS THE HEAP SLOT OF A QUEUED PAIR (SWEEP_NOT_QUEUED OTHERWISE),
+    WHICH GIVES O(log n) DECREASE/INCREASE-KEY WITHOUT DUPLICATE ENTRIES.
+    PRIORITIES ARE q_val_t: IN THE FIXED POINT BUILD THE HEAP ORDER AND THE
+    theta CUTOFF ARE INTEGER, SO THE SAME BACKUPS RUN ON ANY MACHINE.
+
+    PREDECESSORS ARE BUILT ONCE FROM THE MAZE REVERSE TRANSITIONS IN CSR FORM:
+    pred_pairs[pred_offsets[cell] .. pred_offsets[cell+1]) ARE THE PAIR IDS
+    WHOSE MOVE ENDS IN cell. A MOVE BLOCKED BY A WALL ENDS IN ITS OWN CELL.
+*/
+
+#define SWEEP_NOT_QUEUED UINT32_MAX
+
+typedef struct {
+	uint32_t* heap;     // PAIR IDS, heap[0] HAS THE BIGGEST PRIORITY
+	q_val_t*  prio;     // PRIORITY OF heap[i]
+	uint32_t* pos;      // PAIR ID -> HEAP SLOT
+	size_t    count;
+	size_t    capacity;
+} sweep_queue_t;
+
+typedef struct {
+	dyna_model_t   model;
+	sweep_queue_t  queue;
+	uint32_t*      pred_offsets;
+	uint32_t*      pred_pairs;
+	// MAX BACKUPS PER REAL STEP AND MINIMUM PRIORITY WORTH QUEUEING
+	size_t         max_updates;
+	q_val_t        theta;
+	size_t         total_updates;
+} sweep_planner_t;
+
+int  sweepQueueInit(sweep_queue_t* q, size_t capacity);
+void sweepQueueFree(sweep_queue_t* q);
+void sweepQueuePush(sweep_queue_t* q, uint32_t pair, q_val_t priority);
+uint32_t sweepQueuePop(sweep_queue_t* q, q_val_t* priority);
+
+int  sweepPlannerInit(sweep_planner_t* p, MazeEnv* env, bool block_transpassing, size_t max_updates, float theta);
+void sweepPlannerFree(sweep_planner_t* p);
+size_t sweepPlannerStep(sweep_planner_t* p, Agent* agent, state_t s, Action a, state_t next, stepResult sr);
+
+/*
+    MAZE EDIT REPAIR
+
+    AFTER AN EDIT THE TABLE IS STILL RIGHT WHEREVER THE GREEDY PATH NEVER
+    CROSSES A CHANGED CELL, SO INSTEAD OF RETRAINING FROM ZERO:
+      1. DIFF THE OLD AND THE NEW GRID (SAME SIZE) INTO THE CHANGED CELLS.
+      2. REVERSE BFS FROM THEM OVER THE OLD GREEDY MOVES: A CELL WHOSE
+         argmax ACTION POINTS INTO AN INVALID CELL IS INVALID TOO. ONLY THIS
+         REGION IS RESET, TO "UNKNOWN" (QVAL_LOWEST).
+      3. RE-SOLVE IT FROM ITS FRONTIER WITH FULL BACKUPS ON THE KNOWN MODEL
+         (THE NEW GRID, DETERMINISTIC MOVES, THE TRAINER REWARDS):
+         UNKNOWN PAIRS ARE SETTLED HIGHEST TARGET FIRST (A DIJKSTRA ORDER, SO
+         EACH IS BACKED UP ABOUT ONCE), THEN THE PAIRS AROUND THE REGION
+         WHOSE VALUE MOVED ARE SWEPT BY |TD ERROR| ABOVE theta. OUTSIDE THE
+         REGION ONLY RISES SPREAD (A SHORTCUT THE EDIT OPENED), THE REST OF
+         THE LEARNED TABLE IS KEPT AS IT IS.
+    A BACKUP NEVER READS AN UNKNOWN VALUE, SO STALE VALUES CANT CHASE EACH
+    OTHER AROUND A LOOP. WHAT THE FRONTIER CANT REACH (A REGION WALLED OFF BY
+    THE EDIT) ENDS AT 0, LIKE A FRESH TABLE.
+
+    REWARDS ARE THE UNSHAPED ONES (NO DISTANCE SHAPING). max_updates 0 MEANS
+    RUN UNTIL BOTH QUEUES ARE EMPTY.
+*/
+
+typedef struct {
+	bool   block_transpassing;
+	bool   scaled_rewards;      // stepIntoState INSTEAD OF stepIntoStateUnscaled
+	size_t walls_count;
+	size_t opens_count;
+	float  theta;
+	size_t max_updates;
+} sweep_repair_params_t;
+
+typedef struct {
+	size_t changed_cells;
+	size_t invalidated_cells;
+	size_t updates;
+	size_t unreached_cells;
+} sweep_repair_stats_t;
+
+int sweepRepairEdit(Agent* agent, MazeEnv* old_env, MazeEnv* env, const sweep_repair_params_t* params, sweep_repair_stats_t* stats);
+
+#endif
+
+#ifdef AGENT_SWEEP_IMPLEMENTATION
+
+int sweepQueueInit(sweep_queue_t* q, size_t capacity){
+	memset(q,0,sizeof(*q));
+	q->heap = (uint32_t*)malloc(capacity*sizeof(uint32_t));
+	q->prio = (q_val_t*)malloc(capacity*sizeof(q_val_t));
+	q->pos  = (uint32_t*)malloc(capacity*sizeof(uint32_t));
+	if(!q->heap || !q->prio || !q->pos){
+		sweepQueueFree(q);
+		return -1;
+	}
+	for(size_t i = 0; i < capacity; i++) q->pos[i] = SWEEP_NOT_QUEUED;
+	q->capacity = capacity;
+	return 0;
+}
+
+void sweepQueueFree(sweep_queue_t* q){
+	free(q->heap);
+	free(q->prio);
+	free(q->pos);
+	memset(q,0,sizeof(*q));
+}
+
+static inline void sweepQueuePlace(sweep_queue_t* q, size_t i, uint32_t pair, q_val_t priority){
+	q->heap[i] = pair;
+	q->prio[i] = priority;
+	q->pos[pair] = (uint32_t)i;
+}
+
+static void sweepQueueSiftUp(sweep_queue_t* q, size_t i){
+	uint32_t pair = q->heap[i];
+	q_val_t priority = q->prio[i];
+	while(i > 0){
+		size_t parent = (i - 1) >> 1;
+		if(q->prio[parent] >= priority) break;
+		sweepQueuePlace(q,i,q->heap[parent],q->prio[parent]);
+		i = parent;
+	}
+	sweepQueuePlace(q,i,pair,priority);
+}
+
+static void sweepQueueSiftDown(sweep_queue_t* q, size_t i){
+	uint32_t pair = q->heap[i];
+	q_val_t priority = q->prio[i];
+	for(;;){
+		size_t child = 2*i + 1;
+		if(child >= q->count) break;
+		if(child + 1 < q->count && q->prio[child + 1] > q->prio[child]) child++;
+		if(q->prio[child] <= priority) break;
+		sweepQueuePlace(q,i,q->heap[child],q->prio[child]);
+		i = child;
+	}
+	sweepQueuePlace(q,i,pair,priority);
+}
+
+// INSERTS THE PAIR OR MOVES IT TO ITS NEW PRIORITY IF ALREADY QUEUED
+void sweepQueuePush(sweep_queue_t* q, uint32_t pair, q_val_t priority){
+	uint32_t i = q->pos[pair];
+	if(i == SWEEP_NOT_QUEUED){
+		i = (uint32_t)q->count++;
+		sweepQueuePlace(q,i,pair,priority);
+		sweepQueueSiftUp(q,i);
+		return;
+	}
+	q_val_t old = q->prio[i];
+	q->prio[i] = priority;
+	if(priority > old) sweepQueueSiftUp(q,i);
+	else               sweepQueueSiftDown(q,i);
+}
+
+uint32_t sweepQueuePop(sweep_queue_t* q, q_val_t* priority){
+	if(q->count == 0) return SWEEP_NOT_QUEUED;
+	uint32_t top = q->heap[0];
+	if(priority) *priority = q->prio[0];
+	q->pos[top] = SWEEP_NOT_QUEUED;
+	q->count--;
+	if(q->count > 0){
+		sweepQueuePlace(q,0,q->heap[q->count],q->prio[q->count]);
+		sweepQueueSiftDown(q,0);
+	}
+	return top;
+}
+
+// MIRRORS THE TRAINER TRANSITION RULE: BLOCKED MOVES AND GRID EXITS STAY IN PLACE
+static size_t sweepNextCell(MazeEnv* env, size_t row, size_t col, Action a, bool block_transpassing){
+	state_t next = GetNextState((state_t){(int32_t)col,(int32_t)row},a);
+	bool out = next.x < 0 || next.y < 0 || (size_t)next.x >= env->cols || (size_t)next.y >= env->rows;
+	if(out) return row*env->cols + col;
+	if(block_transpassing && getCell(env,(size_t)next.y,(size_t)next.x) == GRID_WALL) return row*env->cols + col;
+	return (size_t)next.y*env->cols + (size_t)next.x;
+}
+
+int sweepPlannerInit(sweep_planner_t* p, MazeEnv* env, bool block_transpassing, size_t max_updates, float theta){
+	memset(p,0,sizeof(*p));
+	if(dynaModelInit(&p->model,env,0) != 0) return -1;
+	size_t n_cells = env->rows*env->cols;
+	size_t n_pairs = n_cells*ACTION_N_ACTIONS;
+	p->max_updates = max_updates;
+	p->theta = qvalFromFloat(theta);
+	p->pred_offsets = (uint32_t*)calloc(n_cells + 1,sizeof(uint32_t));
+	p->pred_pairs   = (uint32_t*)malloc(n_pairs*sizeof(uint32_t));
+	if(!p->pred_offsets || !p->pred_pairs || sweepQueueInit(&p->queue,n_pairs) != 0){
+		sweepPlannerFree(p);
+		return -1;
+	}
+
+	// COUNT, PREFIX SUM, THEN FILL (CSR)
+	for(size_t row = 0; row < env->rows; row++)
+	for(size_t col = 0; col < env->cols; col++)
+	for(int a = 0; a < ACTION_N_ACTIONS; a++){
+		p->pred_offsets[sweepNextCell(env,row,col,(Action)a,block_transpassing) + 1]++;
+	}
+	for(size_t c = 0; c < n_cells; c++) p->pred_offsets[c + 1] += p->pred_offsets[c];
+
+	uint32_t* fill = (uint32_t*)malloc(n_cells*sizeof(uint32_t));
+	if(!fill){ sweepPlannerFree(p); return -1; }
+	memcpy(fill,p->pred_offsets,n_cells*sizeof(uint32_t));
+	for(size_t row = 0; row < env->rows; row++)
+	for(size_t col = 0; col < env->cols; col++)
+	for(int a = 0; a < ACTION_N_ACTIONS; a++){
+		size_t next = sweepNextCell(env,row,col,(Action)a,block_transpassing);
+		p->pred_pairs[fill[next]++] = (uint32_t)((row*env->cols + col)*ACTION_N_ACTIONS + a);
+	}
+	free(fill);
+	return 0;
+}
+
+void sweepPlannerFree(sweep_planner_t* p){
+	dynaModelFree(&p->model);
+	sweepQueueFree(&p->queue);
+	free(p->pred_offsets);
+	free(p->pred_pairs);
+	p->pred_offsets = NULL;
+	p->pred_pairs = NULL;
+}
+
+// |TARGET - Q(s,a)|, THE BELLMAN ERROR BEFORE SCALING BY THE LEARNING RATE
+static inline q_val_t sweepPriority(Agent* agent, state_t s, Action a, state_t next, stepResult sr){
+#ifdef CQ_FIXED_POINT
+	// THE TARGET OF agentQtableUpdateAt, IN Q16.16
+	int64_t target = qvalFromFloat(sr.reward);
+	if(!sr.terminal) target += qvalMul(qvalFromFloat(agent->discount_rate),qtableMaxValAction(agent,next).v);
+	return qvalAbsDiff(qvalSaturate(target),getQtableValue(agent,s,a));
+#else
+	float target = sr.reward;
+	if(!sr.terminal) target += agent->discount_rate*qtableMaxValAction(agent,next).v;
+	return fabsf(target - getQtableValue(agent,s,a));
+#endif
+}
+
+// RE-SCORES EVERY OBSERVED PAIR THAT LEADS INTO s AFTER Q(s,.) CHANGED
+static void sweepQueuePredecessors(sweep_planner_t* p, Agent* agent, state_t s){
+	dyna_model_t* m = &p->model;
+	size_t cell = (size_t)s.y*m->len_state_x + (size_t)s.x;
+	for(uint32_t i = p->pred_offsets[cell]; i < p->pred_offsets[cell + 1]; i++){
+		uint32_t pred = p->pred_pairs[i];
+		state_t bs, bnext;
+		Action ba;
+		stepResult bsr;
+		// ONLY PAIRS THE AGENT HAS ACTUALLY SEEN HAVE A KNOWN REWARD
+		if(!dynaModelLookupPair(m,pred,&bs,&ba,&bnext,&bsr)) continue;
+		if(bnext.x != s.x || bnext.y != s.y) continue;
+		q_val_t priority = sweepPriority(agent,bs,ba,bnext,bsr);
+		if(priority <= p->theta) continue;
+		uint32_t qi = p->queue.pos[pred];
+		if(qi == SWEEP_NOT_QUEUED || p->queue.prio[qi] < priority)
+			sweepQueuePush(&p->queue,pred,priority);
+	}
+}
+
+// RECORDS THE REAL TRANSITION (ALREADY BACKED UP BY THE CALLER) AND RUNS UP TO
+// max_updates PRIORITIZED BACKUPS STARTING FROM THE PAIRS THAT LEAD INTO s
+size_t sweepPlannerStep(sweep_planner_t* p, Agent* agent, state_t s, Action a, state_t next, stepResult sr){
+	dyna_model_t* m = &p->model;
+	dynaModelRecord(m,s,a,next,sr);
+
+	q_val_t priority = sweepPriority(agent,s,a,next,sr);
+	if(priority > p->theta){
+		uint32_t pair = (uint32_t)((((size_t)s.y*m->len_state_x) + (size_t)s.x)*m->len_state_actions + a);
+		sweepQueuePush(&p->queue,pair,priority);
+	}
+	sweepQueuePredecessors(p,agent,s);
+
+	size_t done = 0;
+	while(done < p->max_updates && p->queue.count > 0){
+		uint32_t pair = sweepQueuePop(&p->queue,NULL);
+		state_t ps, pnext;
+		Action pa;
+		stepResult psr;
+		if(!dynaModelLookupPair(m,pair,&ps,&pa,&pnext,&psr)) continue;
+		agentQtableUpdateAt(agent,ps,pa,pnext,psr);
+		done++;
+		sweepQueuePredecessors(p,agent,ps);
+	}
+
+	p->total_updates += done;
+	return done;
+}
+
+// UNKNOWN IS ANYTHING CLOSE TO QVAL_LOWEST, NO REAL VALUE GETS THAT LOW
+static inline bool sweepRepairKnown(q_val_t v){
+	return v > QVAL_LOWEST/2;
+}
+
+typedef struct {
+	Agent*                       agent;
+	MazeEnv*                     env;
+	const sweep_repair_params_t* params;
+	const uint8_t*               invalid;  // CELL -> 1 IF IN THE RESET REGION
+	sweep_queue_t                settle;   // UNKNOWN PAIRS BY TARGET
+	sweep_queue_t                sweep;    // KNOWN PAIRS BY |TD ERROR|
+} sweep_repair_t;
+
+static inline state_t sweepPairState(const MazeEnv* env, uint32_t pair){
+	size_t cell = pair/ACTION_N_ACTIONS;
+	return (state_t){(int32_t)(cell % env->cols),(int32_t)(cell/env->cols)};
+}
+
+// FULL BACKUP TARGET OF A PAIR ON THE NEW GRID, FALSE WHILE ITS NEXT STATE IS UNKNOWN
+static bool sweepRepairTarget(sweep_repair_t* r, uint32_t pair, q_val_t* target, size_t* next_cell){
+	MazeEnv* env = r->env;
+	state_t s = sweepPairState(env,pair);
+	Action a = (Action)(pair % ACTION_N_ACTIONS);
+	state_t moved = GetNextState(s,a);
+	stepResult sr = r->params->scaled_rewards
+	                ? stepIntoState(env,moved,r->params->walls_count,r->params->opens_count)
+	                : stepIntoStateUnscaled(env,moved,r->params->walls_count,r->params->opens_count);
+	size_t next = sweepNextCell(env,(size_t)s.y,(size_t)s.x,a,r->params->block_transpassing);
+	q_val_t next_max = 0;
+	if(next_cell) *next_cell = next;
+	if(!sr.terminal){
+		next_max = qtableMaxValAction(r->agent,(state_t){(int32_t)(next % env->cols),(int32_t)(next/env->cols)}).v;
+		if(!sweepRepairKnown(next_max)) return false;
+	}
+#ifdef CQ_FIXED_POINT
+	int64_t t = qvalFromFloat(sr.reward);
+	if(!sr.terminal) t += qvalMul(qvalFromFloat(r->agent->discount_rate),next_max);
+	*target = qvalSaturate(t);
+#else
+	*target = sr.terminal ? sr.reward : sr.reward + r->agent->discount_rate*next_max;
+#endif
+	return true;
+}
+
+// QUEUES A PAIR IN THE RIGHT QUEUE, NEVER LOWERING A PRIORITY IT ALREADY HAS
+static void sweepRepairScore(sweep_repair_t* r, uint32_t pair){
+	q_val_t target;
+	size_t next;
+	if(!sweepRepairTarget(r,pair,&target,&next)) return;
+	Action a = (Action)(pair % ACTION_N_ACTIONS);
+	q_val_t q = getQtableValue(r->agent,sweepPairState(r->env,pair),a);
+	sweep_queue_t* queue;
+	q_val_t priority;
+	if(!sweepRepairKnown(q)){
+		queue = &r->settle;
+		priority = target;
+	} else {
+		// OUTSIDE THE REGION ONLY IMPROVEMENTS SPREAD: THE LEARNED TABLE IS NOT
+		// BELLMAN EXACT, CHASING ITS DECREASES WOULD RE-SOLVE THE WHOLE MAZE
+		bool local = r->invalid[pair/ACTION_N_ACTIONS] || r->invalid[next];
+		if(!local && target <= q) return;
+		queue = &r->sweep;
+		priority = qvalAbsDiff(target,q);
+		if(priority <= qvalFromFloat(r->params->theta)) return;
+	}
+	uint32_t qi = queue->pos[pair];
+	if(qi == SWEEP_NOT_QUEUED || queue->prio[qi] < priority) sweepQueuePush(queue,pair,priority);
+}
+
+// THE PREDECESSORS OF A CELL ARE ITS NEIGHBOURS AND ITSELF (A BLOCKED MOVE),
+// FOUND ON THE FLY SO A SMALL REPAIR NEVER BUILDS THE WHOLE CSR LIST
+static void sweepRepairScorePredecessors(sweep_repair_t* r, size_t cell){
+	MazeEnv* env = r->env;
+	int32_t x = (int32_t)(cell % env->cols), y = (int32_t)(cell/env->cols);
+	for(int a = 0; a < ACTION_N_ACTIONS; a++){
+		if(sweepNextCell(env,(size_t)y,(size_t)x,(Action)a,r->params->block_transpassing) == cell)
+			sweepRepairScore(r,(uint32_t)(cell*ACTION_N_ACTIONS + a));
+		int32_t px = x - actionToDeltaMap[a].dx, py = y - actionToDeltaMap[a].dy;
+		if(px < 0 || py < 0 || (size_t)px >= env->cols || (size_t)py >= env->rows) continue;
+		if(sweepNextCell(env,(size_t)py,(size_t)px,(Action)a,r->params->block_transpassing) != cell) continue;
+		sweepRepairScore(r,(uint32_t)(((size_t)py*env->cols + (size_t)px)*ACTION_N_ACTIONS + a));
+	}
+}
+
+static void sweepRepairFree(sweep_repair_t* r){
+	sweepQueueFree(&r->settle);
+	sweepQueueFree(&r->sweep);
+}
+
+int sweepRepairEdit(Agent* agent, MazeEnv* old_env, MazeEnv* env, const sweep_repair_params_t* params, sweep_repair_stats_t* stats){
+	sweep_repair_stats_t st = {0};
+	if(stats) *stats = st;
+	q_table_t* t = &agent->q_table;
+	if(old_env->rows != env->rows || old_env->cols != env->cols) return -1;
+	if(t->len_state_x != env->cols || t->len_state_y != env->rows || t->len_state_actions != ACTION_N_ACTIONS) return -1;
+
+	size_t n_cells = env->rows*env->cols;
+	size_t n_pairs = n_cells*ACTION_N_ACTIONS;
+	uint8_t*  invalid = (uint8_t*)calloc(n_cells,sizeof(uint8_t));
+	uint32_t* region  = (uint32_t*)malloc(n_cells*sizeof(uint32_t));
+	sweep_repair_t r = {.agent = agent, .env = env, .params = params, .invalid = invalid};
+	if(!invalid || !region ||
+	   sweepQueueInit(&r.settle,n_pairs) != 0 || sweepQueueInit(&r.sweep,n_pairs) != 0){
+		free(invalid);
+		free(region);
+		sweepRepairFree(&r);
+		return -1;
+	}
+
+	// 1. DIFF
+	size_t n_region = 0;
+	for(size_t c = 0; c < n_cells; c++){
+		if(old_env->grid[c] == env->grid[c]) continue;
+		invalid[c] = 1;
+		region[n_region++] = (uint32_t)c;
+	}
+	st.changed_cells = n_region;
+
+	// 2. REVERSE BFS OVER THE OLD GREEDY MOVES, BEFORE ANY VALUE IS TOUCHED
+	for(size_t head = 0; head < n_region; head++){
+		size_t cell = region[head];
+		int32_t x = (int32_t)(cell % env->cols), y = (int32_t)(cell/env->cols);
+		for(int a = 0; a < ACTION_N_ACTIONS; a++){
+			// THE NEIGHBOUR THAT ACTION a TAKES INTO cell
+			int32_t px = x - actionToDeltaMap[a].dx, py = y - actionToDeltaMap[a].dy;
+			if(px < 0 || py < 0 || (size_t)px >= env->cols || (size_t)py >= env->rows) continue;
+			size_t pcell = (size_t)py*env->cols + (size_t)px;
+			if(invalid[pcell]) continue;
+			if(qtableMaxValAction(agent,(state_t){px,py}).a != (Action)a) continue;
+			invalid[pcell] = 1;
+			region[n_region++] = (uint32_t)pcell;
+		}
+	}
+	st.invalidated_cells = n_region;
+
+	for(size_t i = 0; i < n_region; i++){
+		state_t s = {(int32_t)(region[i] % env->cols),(int32_t)(region[i]/env->cols)};
+		for(int a = 0; a < ACTION_N_ACTIONS; a++) setQtableValue(agent,s,(Action)a,QVAL_LOWEST);
+	}
+
+	// 3. SEED WITH THE REGION AND EVERY PAIR LEADING INTO IT, ONLY THE ONES
+	//    WITH A KNOWN NEXT STATE (THE FRONTIER) GET QUEUED
+	for(size_t i = 0; i < n_region; i++){
+		for(int a = 0; a < ACTION_N_ACTIONS; a++) sweepRepairScore(&r,region[i]*ACTION_N_ACTIONS + (uint32_t)a);
+		sweepRepairScorePredecessors(&r,region[i]);
+	}
+
+	while(params->max_updates == 0 || st.updates < params->max_updates){
+		sweep_queue_t* queue = r.settle.count > 0 ? &r.settle : &r.sweep;
+		if(queue->count == 0) break;
+		uint32_t pair = sweepQueuePop(queue,NULL);
+		q_val_t target;
+		if(!sweepRepairTarget(&r,pair,&target,NULL)) continue;
+		state_t s = sweepPairState(env,pair);
+		q_val_t old_max = qtableMaxValAction(agent,s).v;
+		setQtableValue(agent,s,(Action)(pair % ACTION_N_ACTIONS),target);
+		st.updates++;
+		if(qtableMaxValAction(agent,s).v != old_max) sweepRepairScorePredecessors(&r,pair/ACTION_N_ACTIONS);
+	}
+
+	// WHAT STAYED UNKNOWN IS CUT OFF FROM THE GOAL (OR OUT OF BUDGET)
+	for(size_t i = 0; i < n_region; i++){
+		state_t s = {(int32_t)(region[i] % env->cols),(int32_t)(region[i]/env->cols)};
+		bool unreached = false;
+		for(int a = 0; a < ACTION_N_ACTIONS; a++){
+			if(sweepRepairKnown(getQtableValue(agent,s,(Action)a))) continue;
+			setQtableValue(agent,s,(Action)a,0);
+			unreached = true;
+		}
+		st.unreached_cells += unreached;
+	}
+
+	free(invalid);
+	free(region);
+	sweepRepairFree(&r);
+	if(stats) *stats = st;
+	return 0;
+}
+
+#endif
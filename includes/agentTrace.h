@@ -0,0 +1,232 @@
+#ifndef AGENT_TRACE_H
+
+#define AGENT_TRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdatomic.h>
+
+/*
+    TIMELINE TRACING (CHROME TRACE / PERFETTO)
+
+    BUILT WITH -DCQ_TRACE (make trace=1) THE TRACE_* MACROS RECORD SPANS
+    (EPISODES, CHECKPOINTS, FILE I/O, GUI FRAMES) AND traceDump WRITES THEM
+    AS CHROME TRACE JSON, OPEN IT IN ui.perfetto.dev OR chrome://tracing.
+    WITHOUT CQ_TRACE EVERY MACRO EXPANDS TO NOTHING.
+
+    EACH THREAD RECORDS INTO ITS OWN RING OF trace_event_t, CREATED ON ITS
+    FIRST EVENT AND PUSHED ON A LOCK FREE LIST (ONE CAS), SO RECORDING IS A
+    CLOCK READ AND A STORE WITH NO SHARED WRITE. A FULL RING OVERWRITES ITS
+    OLDEST EVENTS: A LONG RUN KEEPS THE LAST events_per_thread SPANS OF EACH
+    THREAD, LIKE A FLIGHT RECORDER. traceDump IS MEANT FOR WHEN THE TRACED
+    THREADS ARE DONE (OR AT LEAST IDLE).
+
+    SAMPLING: TRACE_BEGIN_SAMPLED(var, i) ONLY TIMES WHEN i % sample_every
+    IS 0, FOR THE HOT SPANS (EPISODES). RARE SPANS (CHECKPOINTS, I/O) USE
+    TRACE_BEGIN AND ARE ALWAYS KEPT.
+
+    ENVIRONMENT (READ BY traceInitFromEnv):
+        CQ_TRACE_FILE     OUTPUT PATH (DEFAULT GIVEN BY THE PROGRAM)
+        CQ_TRACE_SAMPLE   KEEP ONE HOT SPAN EVERY N (DEFAULT 1)
+        CQ_TRACE_EVENTS   RING SIZE PER THREAD (DEFAULT 1 << 18, 40 BYTES EACH)
+
+    names AND cats MUST BE STRING LITERALS (OR OUTLIVE THE DUMP), ONLY THE
+    POINTER IS STORED.
+*/
+
+#define TRACE_DEFAULT_EVENTS (1u << 18)
+
+typedef struct {
+	const char* name;
+	const char* cat;
+	uint64_t    ts_ns;      // FROM traceInit
+	uint64_t    dur_ns;
+	uint64_t    arg;
+} trace_event_t;
+
+typedef struct trace_buffer_t {
+	struct trace_buffer_t* next;
+	uint32_t               tid;
+	const char*            thread_name;
+	size_t                 capacity;
+	_Atomic uint64_t       written;     // EVENTS EVER RECORDED, RING INDEX IS written % capacity
+	trace_event_t          events[];
+} trace_buffer_t;
+
+uint64_t traceNow(void);
+bool     traceInit(size_t events_per_thread, uint32_t sample_every, const char* path);
+bool     traceInitFromEnv(const char* default_path);
+bool     traceSample(uint64_t i);
+void     traceThreadName(const char* name);
+void     traceComplete(const char* name, const char* cat, uint64_t t0, uint64_t arg);
+int      traceDump(void);
+void     traceShutdown(void);
+
+#ifdef CQ_TRACE
+#define TRACE_INIT(default_path)                traceInitFromEnv(default_path)
+#define TRACE_THREAD_NAME(name)                 traceThreadName(name)
+#define TRACE_BEGIN(var)                        uint64_t trace__##var = traceNow()
+#define TRACE_BEGIN_SAMPLED(var,i)              uint64_t trace__##var = traceSample(i) ? traceNow() : 0
+#define TRACE_END(var,name,cat,arg)             traceComplete((name),(cat),trace__##var,(uint64_t)(arg))
+#define TRACE_SPAN(name,cat)                    for(uint64_t trace__t0 = traceNow(), trace__once = 1; trace__once; trace__once = 0, traceComplete((name),(cat),trace__t0,0))
+#define TRACE_SHUTDOWN()                        (traceDump(), traceShutdown())
+#else
+#define TRACE_INIT(default_path)                ((void)0)
+#define TRACE_THREAD_NAME(name)                 ((void)0)
+#define TRACE_BEGIN(var)
+#define TRACE_BEGIN_SAMPLED(var,i)
+#define TRACE_END(var,name,cat,arg)
+#define TRACE_SPAN(name,cat)
+#define TRACE_SHUTDOWN()                        ((void)0)
+#endif
+
+#endif
+
+#ifdef AGENT_TRACE_IMPLEMENTATION
+
+static struct {
+	bool                     on;
+	uint64_t                 t0_ns;
+	size_t                   capacity;
+	uint32_t                 sample_every;
+	char*                    path;
+	_Atomic(trace_buffer_t*) buffers;
+	atomic_uint              next_tid;
+} trace_state;
+
+static _Thread_local trace_buffer_t* trace_local;
+
+static uint64_t traceClockNs(void){
+	struct timespec ts;
+	timespec_get(&ts,TIME_UTC);
+	return (uint64_t)ts.tv_sec*1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+uint64_t traceNow(void){
+	// 0 IS "NOT SAMPLED", A REAL TIMESTAMP NEVER IS
+	return traceClockNs() - trace_state.t0_ns + 1;
+}
+
+bool traceInit(size_t events_per_thread, uint32_t sample_every, const char* path){
+	if(trace_state.on || !path) return false;
+	trace_state.path = (char*)malloc(strlen(path) + 1);
+	if(!trace_state.path) return false;
+	strcpy(trace_state.path,path);
+	trace_state.capacity     = events_per_thread ? events_per_thread : TRACE_DEFAULT_EVENTS;
+	trace_state.sample_every = sample_every ? sample_every : 1;
+	trace_state.t0_ns        = traceClockNs();
+	atomic_store(&trace_state.buffers,NULL);
+	atomic_store(&trace_state.next_tid,1);
+	trace_state.on = true;
+	return true;
+}
+
+bool traceInitFromEnv(const char* default_path){
+	const char* path   = getenv("CQ_TRACE_FILE");
+	const char* sample = getenv("CQ_TRACE_SAMPLE");
+	const char* events = getenv("CQ_TRACE_EVENTS");
+	return traceInit(events ? (size_t)strtoull(events,NULL,10) : 0,
+	                 sample ? (uint32_t)strtoul(sample,NULL,10) : 1,
+	                 path && path[0] ? path : default_path);
+}
+
+bool traceSample(uint64_t i){
+	return trace_state.on && i % trace_state.sample_every == 0;
+}
+
+static trace_buffer_t* traceLocalBuffer(void){
+	if(trace_local || !trace_state.on) return trace_local;
+	trace_buffer_t* b = (trace_buffer_t*)calloc(1,sizeof(trace_buffer_t) + trace_state.capacity*sizeof(trace_event_t));
+	if(!b) return NULL;
+	b->capacity = trace_state.capacity;
+	b->tid      = atomic_fetch_add(&trace_state.next_tid,1);
+	b->next     = atomic_load_explicit(&trace_state.buffers,memory_order_relaxed);
+	while(!atomic_compare_exchange_weak_explicit(&trace_state.buffers,&b->next,b,
+	                                             memory_order_release,memory_order_relaxed));
+	trace_local = b;
+	return b;
+}
+
+void traceThreadName(const char* name){
+	trace_buffer_t* b = traceLocalBuffer();
+	if(b) b->thread_name = name;
+}
+
+void traceComplete(const char* name, const char* cat, uint64_t t0, uint64_t arg){
+	if(t0 == 0 || !trace_state.on) return;
+	trace_buffer_t* b = traceLocalBuffer();
+	if(!b) return;
+	uint64_t now = traceNow();
+	uint64_t w = atomic_load_explicit(&b->written,memory_order_relaxed);
+	trace_event_t* e = &b->events[w % b->capacity];
+	e->name   = name;
+	e->cat    = cat;
+	e->ts_ns  = t0 - 1;
+	e->dur_ns = now - t0;
+	e->arg    = arg;
+	atomic_store_explicit(&b->written,w + 1,memory_order_release);
+}
+
+static void traceJsonString(FILE* f, const char* s){
+	fputc('"',f);
+	for(; s && *s; s++){
+		if(*s == '"' || *s == '\\') fputc('\\',f);
+		if((unsigned char)*s >= 0x20) fputc(*s,f);
+	}
+	fputc('"',f);
+}
+
+int traceDump(void){
+	if(!trace_state.on) return -1;
+	FILE* f = fopen(trace_state.path,"w");
+	if(!f){ perror("fopen"); return -1; }
+
+	size_t n_events = 0;
+	bool first = true;
+	fprintf(f,"{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+	for(trace_buffer_t* b = atomic_load_explicit(&trace_state.buffers,memory_order_acquire); b; b = b->next){
+		if(b->thread_name){
+			fprintf(f,"%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":",
+			        first ? "" : ",\n",b->tid);
+			traceJsonString(f,b->thread_name);
+			fprintf(f,"}}");
+			first = false;
+		}
+		uint64_t written = atomic_load_explicit(&b->written,memory_order_acquire);
+		uint64_t from = written > b->capacity ? written - b->capacity : 0;
+		for(uint64_t i = from; i < written; i++){
+			const trace_event_t* e = &b->events[i % b->capacity];
+			fprintf(f,"%s{\"ph\":\"X\",\"name\":",first ? "" : ",\n");
+			traceJsonString(f,e->name);
+			fprintf(f,",\"cat\":");
+			traceJsonString(f,e->cat);
+			fprintf(f,",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"v\":%llu}}",
+			        b->tid,(double)e->ts_ns*1e-3,(double)e->dur_ns*1e-3,(unsigned long long)e->arg);
+			first = false;
+			n_events++;
+		}
+	}
+	fprintf(f,"\n]}\n");
+	fclose(f);
+	printf("[INFO] Trace: %zu events written to %s\n",n_events,trace_state.path);
+	return 0;
+}
+
+void traceShutdown(void){
+	trace_buffer_t* b = atomic_exchange(&trace_state.buffers,NULL);
+	while(b){
+		trace_buffer_t* next = b->next;
+		free(b);
+		b = next;
+	}
+	free(trace_state.path);
+	trace_state.path = NULL;
+	trace_state.on = false;
+	trace_local = NULL;
+}
+
+#endif
@@ -0,0 +1,175 @@
+#ifndef FAST_TEXT_H
+
+#define FAST_TEXT_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+/*
+    NUMBERS TO TEXT WITHOUT printf
+
+    EVERY FUNCTION WRITES AT p AND RETURNS THE END OF WHAT IT WROTE (NO NUL),
+    THE CALLER MAKES ROOM: FAST_TEXT_MAX_NUMBER BYTES PER NUMBER IS ALWAYS
+    ENOUGH, FALLBACKS INCLUDED.
+
+    INTEGERS GO OUT TWO DIGITS AT A TIME FROM A 200 BYTE TABLE.
+    fastTextFixed(v,d) AND fastTextExp(v,d) PRINT LIKE "%.{d}f" AND "%.{d}e":
+    THE VALUE IS SCALED BY ONE EXACT POWER OF TEN AND ROUNDED TO AN INTEGER.
+    THE SCALING ROUNDS ONCE, WHEN IT LANDS ON A .5 fma GIVES BACK THE EXACT
+    ERROR AND SETTLES THE SIDE, A TRUE TIE GOES TO EVEN: THE SAME DIGITS AS
+    printf (glibc, DEFAULT ROUNDING MODE). THE CSV COLUMNS KEEP THEIR FIXED
+    PRECISIONS, SO THIS IS NOT A SHORTEST ROUND TRIP (RYU) PRINT.
+    WHAT THE FAST PATH CANT TAKE (NAN, INF, d > 15, A SCALED VALUE PAST 2^52,
+    AN EXPONENT PAST 10^+-22 OF THE PRECISION) FALLS BACK TO snprintf.
+*/
+
+#define FAST_TEXT_MAX_NUMBER 352    // "%.15f" OF -DBL_MAX
+#define FAST_TEXT_LIT(p,lit)  fastTextCopy((p),(lit),sizeof(lit) - 1)
+
+static inline char* fastTextCopy(char* p, const char* s, size_t n){
+	memcpy(p,s,n);
+	return p + n;
+}
+
+char* fastTextU64(char* p, uint64_t v);
+char* fastTextI64(char* p, int64_t v);
+char* fastTextFixed(char* p, double v, int decimals);
+char* fastTextExp(char* p, double v, int decimals);
+char* fastTextPad(char* start, char* end, size_t width);
+
+#endif
+
+#ifdef FAST_TEXT_IMPLEMENTATION
+
+static const char fastTextDigits2[201] =
+	"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+	"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+// EXACT IN A double UP TO 1e22
+static const double fastTextPow10[23] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static const uint64_t fastTextPow10U[16] = {
+	1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+	100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+	10000000000000ULL, 100000000000000ULL, 1000000000000000ULL
+};
+
+char* fastTextU64(char* p, uint64_t v){
+	char tmp[20];
+	char* t = tmp + sizeof(tmp);
+	while(v >= 100){
+		uint64_t q = v/100;
+		t -= 2;
+		memcpy(t,fastTextDigits2 + 2*(v - 100*q),2);
+		v = q;
+	}
+	if(v >= 10){
+		t -= 2;
+		memcpy(t,fastTextDigits2 + 2*v,2);
+	} else {
+		*--t = (char)('0' + v);
+	}
+	size_t n = (size_t)(tmp + sizeof(tmp) - t);
+	memcpy(p,t,n);
+	return p + n;
+}
+
+char* fastTextI64(char* p, int64_t v){
+	if(v < 0){
+		*p++ = '-';
+		return fastTextU64(p,(uint64_t)0 - (uint64_t)v);
+	}
+	return fastTextU64(p,(uint64_t)v);
+}
+
+// EXACTLY n DIGITS, LEADING ZEROS INCLUDED
+static char* fastTextDigitsN(char* p, uint64_t v, int n){
+	for(int i = n - 1; i >= 0; i--){
+		p[i] = (char)('0' + v % 10);
+		v /= 10;
+	}
+	return p + n;
+}
+
+// a*10^shift ROUNDED TO THE NEAREST INTEGER AS IF IN EXACT ARITHMETIC
+static int fastTextScale(double a, int shift, uint64_t* out){
+	if(shift > 22 || shift < -22) return 0;
+	double p = fastTextPow10[shift < 0 ? -shift : shift];
+	double q = shift >= 0 ? a*p : a/p;
+	if(!(q < 4503599627370496.0)) return 0;   // 2^52, BELOW IT A ROUNDED q STILL SHOWS A .5
+	double r = nearbyint(q);
+	if(fabs(q - r) == 0.5){
+		// a*p - q AND a - q*p ARE EXACT WITH fma AND HAVE THE SIGN OF THE LOST PART
+		double err = shift >= 0 ? fma(a,p,-q) : fma(-q,p,a);
+		if(err > 0.0)      r = floor(q) + 1.0;
+		else if(err < 0.0) r = floor(q);
+	}
+	*out = (uint64_t)r;
+	return 1;
+}
+
+static char* fastTextFallback(char* p, const char* fmt, int decimals, double v){
+	int n = snprintf(p,FAST_TEXT_MAX_NUMBER,fmt,decimals,v);
+	if(n < 0) return p;
+	return p + (n < FAST_TEXT_MAX_NUMBER ? n : FAST_TEXT_MAX_NUMBER - 1);
+}
+
+char* fastTextFixed(char* p, double v, int decimals){
+	uint64_t r;
+	if(decimals < 0 || decimals > 15 || !isfinite(v) || !fastTextScale(fabs(v),decimals,&r))
+		return fastTextFallback(p,"%.*f",decimals,v);
+
+	if(signbit(v)) *p++ = '-';
+	p = fastTextU64(p,r/fastTextPow10U[decimals]);
+	if(decimals == 0) return p;
+	*p++ = '.';
+	return fastTextDigitsN(p,r % fastTextPow10U[decimals],decimals);
+}
+
+char* fastTextExp(char* p, double v, int decimals){
+	if(decimals < 0 || decimals > 15 || !isfinite(v)) return fastTextFallback(p,"%.*e",decimals,v);
+	double a = fabs(v);
+	int e = 0;
+	uint64_t digits = 0;
+	if(a != 0.0){
+		e = (int)floor(log10(a));
+		// log10 CAN BE OFF BY ONE AT THE EDGES, THE DIGIT COUNT DECIDES
+		for(int tries = 0; tries < 3; tries++){
+			if(!fastTextScale(a,decimals - e,&digits)) return fastTextFallback(p,"%.*e",decimals,v);
+			if(digits >= fastTextPow10U[decimals]*10)  { e++; continue; }
+			if(digits <  fastTextPow10U[decimals])     { e--; continue; }
+			break;
+		}
+	}
+
+	if(signbit(v)) *p++ = '-';
+	*p++ = (char)('0' + digits/fastTextPow10U[decimals]);
+	if(decimals > 0){
+		*p++ = '.';
+		p = fastTextDigitsN(p,digits % fastTextPow10U[decimals],decimals);
+	}
+	*p++ = 'e';
+	*p++ = e < 0 ? '-' : '+';
+	unsigned ue = (unsigned)(e < 0 ? -e : e);
+	if(ue < 10) *p++ = '0';
+	return fastTextU64(p,ue);
+}
+
+// RIGHT ALIGNS [start,end) IN width COLUMNS, LIKE printf'S "%{width}..."
+char* fastTextPad(char* start, char* end, size_t width){
+	size_t n = (size_t)(end - start);
+	if(n >= width) return end;
+	size_t pad = width - n;
+	memmove(start + pad,start,n);
+	memset(start,' ',pad);
+	return start + width;
+}
+
+#endif
@@ -6,6 +6,12 @@
 
 #include <time.h>
 
+MazeInternalRepr generateMaze(size_t rows, size_t cols);
+
+#endif
+
+#ifdef MAZE_GENERATION_IMPLEMENTATION
+
 // Estrutura auxiliar para paredes
 typedef struct {
     int r, c;
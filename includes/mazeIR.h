@@ -33,6 +33,11 @@ MazeInternalRepr newOpenMaze(size_t rows, size_t cols);
 
 void freeMaze(MazeInternalRepr* m);
 
+void debugMazeInternalRepr(MazeInternalRepr* m);
+int readMazeNumpy(char* file_path,MazeInternalRepr* m);
+int readMazeRaw(char* file_path,MazeInternalRepr *m);
+int writeMazeRaw(char* file_path,MazeInternalRepr *m);
+
 #endif
 
 #ifdef MAZE_IR_IMPLEMENTATION
@@ -0,0 +1,70 @@
+#ifndef MAZE_PATHS_H
+
+#define MAZE_PATHS_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "mazeIR.h"
+
+/*
+    SHORTEST PATH DISTANCES OVER THE MAZE GRID
+
+    BREADTH FIRST SEARCH FROM EVERY CELL OF ONE TYPE (USUALLY GRID_AGENT_GOAL)
+    OVER THE 4-CONNECTED NON WALL CELLS. dist IS rows*cols LONG, ROW MAJOR
+    (cell = row*cols + col), AND WALLS OR CUT OFF CELLS READ MAZE_DIST_UNREACHABLE.
+
+    MOVES ARE SYMMETRIC, SO THE DISTANCE FROM THE GOAL IS ALSO THE NUMBER OF
+    STEPS AN OPTIMAL AGENT NEEDS TO REACH IT FROM THAT CELL.
+*/
+
+#define MAZE_DIST_UNREACHABLE UINT32_MAX
+
+// RETURNS THE BIGGEST REACHABLE DISTANCE, -1 IF THERE IS NO SOURCE CELL OR ON ALLOCATION FAILURE
+int64_t mazeBfsDistances(MazeInternalRepr* m, GridCellType source, uint32_t* dist);
+
+#endif
+
+#ifdef MAZE_PATHS_IMPLEMENTATION
+
+int64_t mazeBfsDistances(MazeInternalRepr* m, GridCellType source, uint32_t* dist){
+	size_t n_cells = m->rows*m->cols;
+	if(n_cells == 0 || n_cells >= (size_t)UINT32_MAX) return -1;
+	uint32_t* queue = (uint32_t*)malloc(n_cells*sizeof(uint32_t));
+	if(!queue) return -1;
+
+	size_t head = 0, tail = 0;
+	for(size_t c = 0; c < n_cells; c++){
+		dist[c] = MAZE_DIST_UNREACHABLE;
+		if(m->grid[c] == source){
+			dist[c] = 0;
+			queue[tail++] = (uint32_t)c;
+		}
+	}
+	if(tail == 0){ free(queue); return -1; }
+
+	// EVERY CELL IS QUEUED AT MOST ONCE, SO THE QUEUE NEVER WRAPS
+	uint32_t max_dist = 0;
+	while(head < tail){
+		uint32_t c = queue[head++];
+		size_t row = c / m->cols, col = c % m->cols;
+		uint32_t d = dist[c] + 1;
+		uint32_t nbr[4];
+		int n = 0;
+		if(col > 0)           nbr[n++] = c - 1;
+		if(col + 1 < m->cols) nbr[n++] = c + 1;
+		if(row > 0)           nbr[n++] = c - (uint32_t)m->cols;
+		if(row + 1 < m->rows) nbr[n++] = c + (uint32_t)m->cols;
+		for(int i = 0; i < n; i++){
+			uint32_t nc = nbr[i];
+			if(dist[nc] != MAZE_DIST_UNREACHABLE || m->grid[nc] == GRID_WALL) continue;
+			dist[nc] = d;
+			if(d > max_dist) max_dist = d;
+			queue[tail++] = nc;
+		}
+	}
+	free(queue);
+	return (int64_t)max_dist;
+}
+
+#endif
@@ -0,0 +1,165 @@
+#ifndef METRIC_SERIES_H
+#define METRIC_SERIES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+
+/* Multi-resolution store for one per-episode metric.
+ *
+ * Level 0 is the raw sample array. Level k >= 1 holds one bucket per 2^k
+ * consecutive samples with their min, max and sum, so bucket b of level k
+ * covers samples [b << k, (b + 1) << k). Appending a sample touches one
+ * bucket per level: O(log n). A graph W pixels wide reads the first level
+ * with at most W buckets, so its draw cost does not depend on how long the
+ * run is, and min/max spikes survive the downsampling.
+ *
+ * prefix[i] is the sum of the first i samples, kept as samples arrive, so
+ * any trailing window mean is one subtraction. ema caches the exponential
+ * moving average for the last alpha asked for; it is only rebuilt from the
+ * start when alpha changes. */
+
+#define METRIC_SERIES_MAX_LEVELS 40
+
+typedef struct {
+    float  min;
+    float  max;
+    double sum;
+} metric_bucket_t;
+
+typedef struct {
+    float*           raw;
+    metric_bucket_t* levels[METRIC_SERIES_MAX_LEVELS];   /* levels[0] unused */
+    size_t           n_levels;
+    size_t           n;
+    size_t           capacity;
+    double*          prefix;      /* capacity + 1 entries */
+    float*           ema;
+    float            ema_alpha;
+    size_t           ema_n;       /* ema[0 .. ema_n) is valid for ema_alpha */
+} metric_series_t;
+
+/* one point of a downsampled view: samples [first, last] */
+typedef struct {
+    size_t first;
+    size_t last;
+    float  min;
+    float  max;
+    double sum;
+} metric_span_t;
+
+bool   metricSeriesInit(metric_series_t* s, size_t capacity);
+void   metricSeriesFree(metric_series_t* s);
+bool   metricSeriesAppend(metric_series_t* s, float v);
+size_t metricSeriesPickLevel(const metric_series_t* s, size_t max_points);
+size_t metricSeriesSpanCount(const metric_series_t* s, size_t level);
+metric_span_t metricSeriesSpan(const metric_series_t* s, size_t level, size_t i);
+float  metricSeriesWindowMean(const metric_series_t* s, size_t last, size_t win);
+float  metricSeriesEma(metric_series_t* s, size_t last, float alpha);
+
+#endif
+
+#ifdef METRIC_SERIES_IMPLEMENTATION
+
+bool metricSeriesInit(metric_series_t* s, size_t capacity) {
+    memset(s, 0, sizeof(*s));
+    if (capacity == 0) return false;
+    s->raw    = (float*) malloc(capacity * sizeof(float));
+    s->prefix = (double*)malloc((capacity + 1) * sizeof(double));
+    s->ema    = (float*) malloc(capacity * sizeof(float));
+    if (!s->raw || !s->prefix || !s->ema) { metricSeriesFree(s); return false; }
+    s->prefix[0] = 0.0;
+    s->capacity = capacity;
+    s->n_levels = 1;
+    for (size_t k = 1; k < METRIC_SERIES_MAX_LEVELS && (capacity >> (k - 1)) > 1; k++) {
+        size_t buckets = ((capacity - 1) >> k) + 1;
+        s->levels[k] = (metric_bucket_t*)malloc(buckets * sizeof(metric_bucket_t));
+        if (!s->levels[k]) { metricSeriesFree(s); return false; }
+        s->n_levels = k + 1;
+    }
+    return true;
+}
+
+void metricSeriesFree(metric_series_t* s) {
+    free(s->raw);
+    free(s->prefix);
+    free(s->ema);
+    for (size_t k = 1; k < METRIC_SERIES_MAX_LEVELS; k++) free(s->levels[k]);
+    memset(s, 0, sizeof(*s));
+}
+
+bool metricSeriesAppend(metric_series_t* s, float v) {
+    if (s->n >= s->capacity) return false;
+    size_t i = s->n++;
+    s->raw[i] = v;
+    s->prefix[i + 1] = s->prefix[i] + (double)v;
+    for (size_t k = 1; k < s->n_levels; k++) {
+        metric_bucket_t* b = &s->levels[k][i >> k];
+        /* first sample of the bucket resets it, the arrays are never cleared */
+        if ((i & (((size_t)1 << k) - 1)) == 0) {
+            *b = (metric_bucket_t){ v, v, (double)v };
+        } else {
+            if (v < b->min) b->min = v;
+            if (v > b->max) b->max = v;
+            b->sum += (double)v;
+        }
+    }
+    return true;
+}
+
+size_t metricSeriesSpanCount(const metric_series_t* s, size_t level) {
+    if (s->n == 0) return 0;
+    return ((s->n - 1) >> level) + 1;
+}
+
+/* lowest level that fits in max_points, i.e. the finest one that still
+ * gives at most one point per pixel */
+size_t metricSeriesPickLevel(const metric_series_t* s, size_t max_points) {
+    if (max_points == 0) max_points = 1;
+    size_t k = 0;
+    while (k + 1 < s->n_levels && metricSeriesSpanCount(s, k) > max_points) k++;
+    return k;
+}
+
+metric_span_t metricSeriesSpan(const metric_series_t* s, size_t level, size_t i) {
+    metric_span_t sp;
+    sp.first = i << level;
+    sp.last  = ((i + 1) << level) - 1;
+    if (sp.last >= s->n) sp.last = s->n - 1;
+    if (level == 0) {
+        sp.min = sp.max = s->raw[i];
+        sp.sum = (double)s->raw[i];
+    } else {
+        const metric_bucket_t* b = &s->levels[level][i];
+        sp.min = b->min;
+        sp.max = b->max;
+        sp.sum = b->sum;
+    }
+    return sp;
+}
+
+/* trailing mean over samples (last - win, last], zero padded before the
+ * first sample like the old per-frame smoothing */
+float metricSeriesWindowMean(const metric_series_t* s, size_t last, size_t win) {
+    if (win < 1) win = 1;
+    if (last >= s->n) return 0.0f;
+    size_t first = last + 1 >= win ? last + 1 - win : 0;
+    return (float)((s->prefix[last + 1] - s->prefix[first]) / (double)win);
+}
+
+/* ema[i] = alpha*raw[i] + (1 - alpha)*ema[i-1], seeded with raw[0] */
+float metricSeriesEma(metric_series_t* s, size_t last, float alpha) {
+    if (last >= s->n) return 0.0f;
+    if (alpha != s->ema_alpha) {
+        s->ema_alpha = alpha;
+        s->ema_n = 0;
+    }
+    for (size_t i = s->ema_n; i <= last; i++)
+        s->ema[i] = i == 0 ? s->raw[0] : alpha * s->raw[i] + (1.0f - alpha) * s->ema[i - 1];
+    if (last + 1 > s->ema_n) s->ema_n = last + 1;
+    return s->ema[last];
+}
+
+#endif
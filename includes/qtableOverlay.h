@@ -0,0 +1,287 @@
+#ifndef QTABLE_OVERLAY_H
+#define QTABLE_OVERLAY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+
+/* Note: like appContext.h this header expects raylib.h, mazeIR.h,
+ * mazeRender.h and agent.h to be included by the translation unit first. */
+
+/* Q-table overlay for the viewer.
+ *
+ * Two textures with one texel per maze cell: heat holds the max-Q color
+ * (RGBA, walls and never-updated cells transparent) and policy holds the
+ * greedy action + 1 (R8, 0 = no arrow). Both are drawn as a single quad
+ * stretched over the maze; a fragment shader picks the texel under each
+ * pixel and draws the arrow procedurally from the position inside the cell,
+ * so the draw cost is one quad no matter how many cells there are.
+ *
+ * The textures are rebuilt a few rows at a time (qtableOverlayRefresh) and
+ * uploaded with UpdateTextureRec, so a training run in the background shows
+ * up as a sweep that wraps around the maze. Colors are normalized with the
+ * min/max max-Q seen during the previous full sweep, which keeps the scale
+ * stable while a sweep is half done. */
+
+#define QTABLE_OVERLAY_MIN_ARROW_PX 6   /* arrows below this cell size are noise */
+
+typedef struct {
+    Texture2D heat;
+    Texture2D policy;
+    Shader    shader;
+    bool      shader_ok;
+    int       loc_policy, loc_grid, loc_heat_on, loc_arrows_on;
+
+    Color*    heat_px;      /* staging copies of both textures, row major */
+    uint8_t*  policy_px;
+    size_t    rows, cols;
+    const q_val_t* src;     /* q_table.vals the textures were built from */
+    bool      ready;
+
+    size_t    cursor;       /* next row to rebuild */
+    float     lo, hi;       /* max-Q range of the previous sweep */
+    float     next_lo, next_hi;
+    size_t    sweeps;
+
+    bool      show_heat;
+    bool      show_arrows;
+} QtableOverlay;
+
+void qtableOverlayInit   (QtableOverlay* o);
+void qtableOverlayFree   (QtableOverlay* o);
+bool qtableOverlaySync   (QtableOverlay* o, Agent* agent, MazeEnv* env);
+void qtableOverlayRefresh(QtableOverlay* o, Agent* agent, MazeEnv* env, size_t max_cells);
+void qtableOverlayDraw   (QtableOverlay* o, const MazeRenderCtx* r);
+void qtableOverlayDrawCells(const QtableOverlay* o, Texture2D heat, Texture2D policy,
+                            size_t rows, size_t cols, const MazeRenderCtx* r,
+                            bool heat_on, bool arrows_on);
+
+#endif
+
+#ifdef QTABLE_OVERLAY_IMPLEMENTATION
+
+static const char* QTABLE_OVERLAY_FS =
+    "#version 330\n"
+    "in vec2 fragTexCoord;\n"
+    "in vec4 fragColor;\n"
+    "uniform sampler2D texture0;\n"   /* heat */
+    "uniform sampler2D policyTex;\n"
+    "uniform vec2  gridSize;\n"
+    "uniform float heatOn;\n"
+    "uniform float arrowsOn;\n"
+    "out vec4 finalColor;\n"
+    /* same order and screen direction as actionToDeltaMap, rows grow downward */
+    "const vec2 dirs[4] = vec2[4](vec2(-1.0,0.0), vec2(1.0,0.0), vec2(0.0,1.0), vec2(0.0,-1.0));\n"
+    "void main(){\n"
+    "    vec4 heat = texture(texture0, fragTexCoord);\n"
+    "    heat.a *= heatOn;\n"
+    "    vec2 g = fragTexCoord*gridSize;\n"
+    "    vec2 q = fract(g) - 0.5;\n"
+    "    int  a = int(texture(policyTex, fragTexCoord).r*255.0 + 0.5) - 1;\n"
+    "    float cov = 0.0;\n"
+    "    if (arrowsOn > 0.5 && a >= 0 && a < 4) {\n"
+    "        vec2 d = dirs[a];\n"
+    "        vec2 p = vec2(dot(q, d), dot(q, vec2(-d.y, d.x)));\n"
+    "        float shaft = max(max(-0.35 - p.x, p.x - 0.05), abs(p.y) - 0.05);\n"
+    "        float head  = max(0.05 - p.x, abs(p.y) - (0.35 - p.x)*0.6);\n"
+    "        float aa = fwidth(g.x);\n"
+    "        cov = 0.85*(1.0 - smoothstep(-aa, aa, min(shaft, head)));\n"
+    "    }\n"
+    /* black arrow over the heat color, straight alpha */
+    "    float oa = cov + heat.a*(1.0 - cov);\n"
+    "    vec3 rgb = oa > 0.0 ? heat.rgb*heat.a*(1.0 - cov)/oa : vec3(0.0);\n"
+    "    finalColor = vec4(rgb, oa)*fragColor;\n"
+    "}\n";
+
+void qtableOverlayInit(QtableOverlay* o) {
+    memset(o, 0, sizeof(*o));
+    o->shader    = LoadShaderFromMemory(NULL, QTABLE_OVERLAY_FS);
+    o->loc_policy    = GetShaderLocation(o->shader, "policyTex");
+    o->loc_grid      = GetShaderLocation(o->shader, "gridSize");
+    o->loc_heat_on   = GetShaderLocation(o->shader, "heatOn");
+    o->loc_arrows_on = GetShaderLocation(o->shader, "arrowsOn");
+    /* a failed compile falls back to the default shader, which has none of
+     * our uniforms; the heat texture then draws plain and arrows are off */
+    o->shader_ok = IsShaderValid(o->shader) && o->loc_grid >= 0 && o->loc_policy >= 0;
+}
+
+static void qtableOverlayDropTextures(QtableOverlay* o) {
+    if (o->heat.id)   UnloadTexture(o->heat);
+    if (o->policy.id) UnloadTexture(o->policy);
+    free(o->heat_px);
+    free(o->policy_px);
+    o->heat = o->policy = (Texture2D){0};
+    o->heat_px   = NULL;
+    o->policy_px = NULL;
+    o->rows = o->cols = 0;
+    o->src   = NULL;
+    o->ready = false;
+}
+
+void qtableOverlayFree(QtableOverlay* o) {
+    qtableOverlayDropTextures(o);
+    if (IsShaderValid(o->shader)) UnloadShader(o->shader);
+    o->shader    = (Shader){0};
+    o->shader_ok = false;
+}
+
+static Texture2D qtableOverlayMakeTexture(void* px, size_t cols, size_t rows, int format) {
+    Image img = { .data = px, .width = (int)cols, .height = (int)rows,
+                  .mipmaps = 1, .format = format };
+    Texture2D t = LoadTextureFromImage(img);
+    if (t.id) {
+        SetTextureFilter(t, TEXTURE_FILTER_POINT);
+        SetTextureWrap(t, TEXTURE_WRAP_CLAMP);
+    }
+    return t;
+}
+
+/* blue -> teal -> yellow */
+static Color qtableOverlayHeatColor(float t) {
+    static const Color stops[3] = { {30, 50, 160, 220}, {40, 170, 150, 220}, {250, 220, 60, 220} };
+    if (t < 0.0f) t = 0.0f;
+    if (t > 1.0f) t = 1.0f;
+    int   i = t < 0.5f ? 0 : 1;
+    float f = (t - 0.5f*(float)i)*2.0f;
+    Color a = stops[i], b = stops[i + 1];
+    return (Color){ (unsigned char)(a.r + f*(b.r - a.r)),
+                    (unsigned char)(a.g + f*(b.g - a.g)),
+                    (unsigned char)(a.b + f*(b.b - a.b)), a.a };
+}
+
+/* (re)creates the textures when the table or maze changed shape, or the
+ * table was reallocated; false while there is nothing to draw */
+bool qtableOverlaySync(QtableOverlay* o, Agent* agent, MazeEnv* env) {
+    q_table_t* t = &agent->q_table;
+    bool match = t->vals && env->rows > 0 && env->cols > 0
+              && t->len_state_x == env->cols && t->len_state_y == env->rows
+              && t->len_state_actions == ACTION_N_ACTIONS;
+    if (!match) {
+        if (o->ready) qtableOverlayDropTextures(o);
+        return false;
+    }
+    if (o->ready && o->rows == env->rows && o->cols == env->cols && o->src == t->vals) return true;
+
+    qtableOverlayDropTextures(o);
+    size_t n = env->rows*env->cols;
+    o->heat_px   = (Color*)  calloc(n, sizeof(Color));
+    o->policy_px = (uint8_t*)calloc(n, sizeof(uint8_t));
+    if (!o->heat_px || !o->policy_px) { qtableOverlayDropTextures(o); return false; }
+    o->heat   = qtableOverlayMakeTexture(o->heat_px,   env->cols, env->rows, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+    o->policy = qtableOverlayMakeTexture(o->policy_px, env->cols, env->rows, PIXELFORMAT_UNCOMPRESSED_GRAYSCALE);
+    if (!o->heat.id || !o->policy.id) { qtableOverlayDropTextures(o); return false; }
+
+    o->rows   = env->rows;
+    o->cols   = env->cols;
+    o->src    = t->vals;
+    o->ready  = true;
+    o->cursor = 0;
+    o->sweeps = 0;
+    o->lo = o->hi = 0.0f;
+    o->next_lo =  FLT_MAX;
+    o->next_hi = -FLT_MAX;
+
+    /* the first sweep only finds the range, the second one colors with it */
+    qtableOverlayRefresh(o, agent, env, SIZE_MAX);
+    qtableOverlayRefresh(o, agent, env, SIZE_MAX);
+    return true;
+}
+
+static void qtableOverlayBuildRow(QtableOverlay* o, Agent* agent, MazeEnv* env, size_t row) {
+    q_table_t* t = &agent->q_table;
+    size_t per_cell = qtableCount(t)*t->len_state_actions;
+    float span = o->hi - o->lo;
+    float inv  = span > 0.0f ? 1.0f/span : 0.0f;
+    Color*   hp = o->heat_px   + row*o->cols;
+    uint8_t* pp = o->policy_px + row*o->cols;
+
+    for (size_t col = 0; col < o->cols; col++) {
+        hp[col] = (Color){0};
+        pp[col] = 0;
+        if (getCell(env, row, col) == GRID_WALL) continue;
+
+        state_t s = { (int32_t)col, (int32_t)row };
+        const q_val_t* q = qtableRow(t, s, 0);
+        bool touched = false;
+        for (size_t i = 0; i < per_cell; i++) touched |= q[i] != 0;
+        if (!touched) continue;
+
+        ValAction va = qtableMaxValAction(agent, s);
+        float v = qvalToFloat(va.v);
+        if (v < o->next_lo) o->next_lo = v;
+        if (v > o->next_hi) o->next_hi = v;
+        hp[col] = qtableOverlayHeatColor(span > 0.0f ? (v - o->lo)*inv : 0.5f);
+        pp[col] = (uint8_t)(va.a + 1);
+    }
+}
+
+/* rebuilds whole rows starting at the cursor until max_cells is spent
+ * (at least one row, at most one full sweep) and uploads only those rows */
+void qtableOverlayRefresh(QtableOverlay* o, Agent* agent, MazeEnv* env, size_t max_cells) {
+    if (!o->ready) return;
+    size_t budget = max_cells / o->cols;
+    if (budget == 0) budget = 1;
+    if (budget > o->rows) budget = o->rows;
+
+    while (budget > 0) {
+        size_t first = o->cursor;
+        size_t count = o->rows - first;
+        if (count > budget) count = budget;
+        for (size_t row = first; row < first + count; row++) qtableOverlayBuildRow(o, agent, env, row);
+
+        Rectangle rec = { 0.0f, (float)first, (float)o->cols, (float)count };
+        UpdateTextureRec(o->heat,   rec, o->heat_px   + first*o->cols);
+        UpdateTextureRec(o->policy, rec, o->policy_px + first*o->cols);
+
+        budget   -= count;
+        o->cursor = first + count;
+        if (o->cursor == o->rows) {
+            o->cursor = 0;
+            o->sweeps++;
+            if (o->next_lo <= o->next_hi) { o->lo = o->next_lo; o->hi = o->next_hi; }
+            o->next_lo =  FLT_MAX;
+            o->next_hi = -FLT_MAX;
+            break;
+        }
+    }
+}
+
+/* one quad over the maze with any pair of per-cell textures laid out like
+ * ours, also used by the viewer step trail */
+void qtableOverlayDrawCells(const QtableOverlay* o, Texture2D heat, Texture2D policy,
+                            size_t rows, size_t cols, const MazeRenderCtx* r,
+                            bool heat_on, bool arrows_on) {
+    if (r->cr_lenght <= 0) return;
+    arrows_on = arrows_on && o->shader_ok && r->cr_lenght >= QTABLE_OVERLAY_MIN_ARROW_PX;
+    if (!heat_on && !arrows_on) return;
+
+    Rectangle src = { 0.0f, 0.0f, (float)cols, (float)rows };
+    Rectangle dst = { (float)(r->offset_x + r->mouse_offset_x),
+                      (float)(r->offset_y + r->mouse_offset_y),
+                      (float)(cols*(size_t)r->cr_lenght),
+                      (float)(rows*(size_t)r->cr_lenght) };
+
+    if (!o->shader_ok) {
+        DrawTexturePro(heat, src, dst, (Vector2){0.0f, 0.0f}, 0.0f, WHITE);
+        return;
+    }
+    float grid[2] = { (float)cols, (float)rows };
+    float h = heat_on   ? 1.0f : 0.0f;
+    float a = arrows_on ? 1.0f : 0.0f;
+    BeginShaderMode(o->shader);
+        SetShaderValue(o->shader, o->loc_grid,      grid, SHADER_UNIFORM_VEC2);
+        SetShaderValue(o->shader, o->loc_heat_on,   &h,   SHADER_UNIFORM_FLOAT);
+        SetShaderValue(o->shader, o->loc_arrows_on, &a,   SHADER_UNIFORM_FLOAT);
+        SetShaderValueTexture(o->shader, o->loc_policy, policy);
+        DrawTexturePro(heat, src, dst, (Vector2){0.0f, 0.0f}, 0.0f, WHITE);
+    EndShaderMode();
+}
+
+void qtableOverlayDraw(QtableOverlay* o, const MazeRenderCtx* r) {
+    if (!o->ready) return;
+    qtableOverlayDrawCells(o, o->heat, o->policy, o->rows, o->cols, r, o->show_heat, o->show_arrows);
+}
+
+#endif
@@ -0,0 +1,167 @@
+#ifndef STEP_TRAIL_H
+#define STEP_TRAIL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Note: expects raylib.h, mazeRender.h, agent.h and qtableOverlay.h (whose
+ * shader draws the arrows) to be included by the translation unit first. */
+
+/* Capped history of the viewer's steps (T key).
+ *
+ * ring keeps the last `capacity` visited cells, oldest at head; pushing into
+ * a full ring evicts the oldest step. Steps are coalesced per cell: visits
+ * counts how many ring entries sit on each cell and the cell shows the most
+ * recent action taken there, so memory is fixed and a rollout that loops
+ * only deepens the tint of the cells it repeats.
+ *
+ * Like the Q-table overlay the trail lives in two one-texel-per-cell
+ * textures (tint by visit count, action + 1) drawn as one quad by the
+ * overlay shader. Pushes only touch the staging copies and widen a dirty
+ * row span that is uploaded once per draw, so frame time does not grow with
+ * the rollout length. */
+
+#define STEP_TRAIL_DEFAULT_CAPACITY 65536
+
+typedef struct {
+    uint32_t* ring;
+    size_t    capacity;
+    size_t    head;
+    size_t    count;
+
+    uint32_t* visits;       /* per cell, ring entries on that cell */
+    Color*    tint_px;
+    uint8_t*  dir_px;
+    Texture2D tint;
+    Texture2D dir;
+    size_t    rows, cols;
+    size_t    dirty_lo, dirty_hi;   /* rows to upload, empty when lo > hi */
+} StepTrail;
+
+bool stepTrailInit (StepTrail* t, size_t capacity);
+void stepTrailFree (StepTrail* t);
+bool stepTrailSync (StepTrail* t, size_t rows, size_t cols);
+void stepTrailPush (StepTrail* t, state_t s, Action a);
+void stepTrailClear(StepTrail* t);
+void stepTrailDraw (StepTrail* t, const QtableOverlay* o, const MazeRenderCtx* r);
+
+#endif
+
+#ifdef STEP_TRAIL_IMPLEMENTATION
+
+bool stepTrailInit(StepTrail* t, size_t capacity) {
+    memset(t, 0, sizeof(*t));
+    if (capacity == 0) capacity = STEP_TRAIL_DEFAULT_CAPACITY;
+    t->ring = (uint32_t*)malloc(capacity*sizeof(uint32_t));
+    if (!t->ring) return false;
+    t->capacity = capacity;
+    t->dirty_lo = SIZE_MAX;
+    return true;
+}
+
+static void stepTrailDropCells(StepTrail* t) {
+    if (t->tint.id) UnloadTexture(t->tint);
+    if (t->dir.id)  UnloadTexture(t->dir);
+    free(t->visits);
+    free(t->tint_px);
+    free(t->dir_px);
+    t->tint = t->dir = (Texture2D){0};
+    t->visits  = NULL;
+    t->tint_px = NULL;
+    t->dir_px  = NULL;
+    t->rows = t->cols = 0;
+    t->head = t->count = 0;
+    t->dirty_lo = SIZE_MAX;
+    t->dirty_hi = 0;
+}
+
+void stepTrailFree(StepTrail* t) {
+    stepTrailDropCells(t);
+    free(t->ring);
+    memset(t, 0, sizeof(*t));
+}
+
+/* (re)creates the per-cell state when the maze changed shape, dropping the
+ * trail; false when there is no maze or on allocation failure */
+bool stepTrailSync(StepTrail* t, size_t rows, size_t cols) {
+    if (rows == 0 || cols == 0 || rows*cols >= (size_t)UINT32_MAX) {
+        stepTrailDropCells(t);
+        return false;
+    }
+    if (t->visits && t->rows == rows && t->cols == cols) return true;
+
+    stepTrailDropCells(t);
+    size_t n = rows*cols;
+    t->visits  = (uint32_t*)calloc(n, sizeof(uint32_t));
+    t->tint_px = (Color*)   calloc(n, sizeof(Color));
+    t->dir_px  = (uint8_t*) calloc(n, sizeof(uint8_t));
+    if (!t->visits || !t->tint_px || !t->dir_px) { stepTrailDropCells(t); return false; }
+    t->tint = qtableOverlayMakeTexture(t->tint_px, cols, rows, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+    t->dir  = qtableOverlayMakeTexture(t->dir_px,  cols, rows, PIXELFORMAT_UNCOMPRESSED_GRAYSCALE);
+    if (!t->tint.id || !t->dir.id) { stepTrailDropCells(t); return false; }
+    t->rows = rows;
+    t->cols = cols;
+    return true;
+}
+
+static void stepTrailPaint(StepTrail* t, uint32_t cell) {
+    uint32_t v = t->visits[cell];
+    if (v == 0) {
+        t->tint_px[cell] = (Color){0};
+        t->dir_px[cell]  = 0;
+    } else {
+        uint32_t extra = v - 1 < 4 ? v - 1 : 4;
+        t->tint_px[cell] = (Color){255, 140, 0, (unsigned char)(70 + 30*extra)};
+    }
+    size_t row = cell / t->cols;
+    if (row < t->dirty_lo) t->dirty_lo = row;
+    if (row > t->dirty_hi) t->dirty_hi = row;
+}
+
+void stepTrailPush(StepTrail* t, state_t s, Action a) {
+    if (!t->visits || a >= ACTION_N_ACTIONS) return;
+    if (s.x < 0 || s.y < 0 || (size_t)s.x >= t->cols || (size_t)s.y >= t->rows) return;
+
+    if (t->count == t->capacity) {
+        uint32_t old = t->ring[t->head];
+        t->head = (t->head + 1) % t->capacity;
+        t->count--;
+        t->visits[old]--;
+        stepTrailPaint(t, old);
+    }
+    uint32_t cell = (uint32_t)((size_t)s.y*t->cols + (size_t)s.x);
+    t->ring[(t->head + t->count) % t->capacity] = cell;
+    t->count++;
+    t->visits[cell]++;
+    t->dir_px[cell] = (uint8_t)(a + 1);
+    stepTrailPaint(t, cell);
+}
+
+void stepTrailClear(StepTrail* t) {
+    if (!t->visits) return;
+    for (size_t i = 0; i < t->count; i++) {
+        uint32_t cell = t->ring[(t->head + i) % t->capacity];
+        if (t->visits[cell] == 0) continue;
+        t->visits[cell] = 0;
+        stepTrailPaint(t, cell);
+    }
+    t->head = t->count = 0;
+}
+
+void stepTrailDraw(StepTrail* t, const QtableOverlay* o, const MazeRenderCtx* r) {
+    if (!t->visits) return;
+    if (t->dirty_lo <= t->dirty_hi) {
+        size_t first = t->dirty_lo, count = t->dirty_hi - t->dirty_lo + 1;
+        Rectangle rec = { 0.0f, (float)first, (float)t->cols, (float)count };
+        UpdateTextureRec(t->tint, rec, t->tint_px + first*t->cols);
+        UpdateTextureRec(t->dir,  rec, t->dir_px  + first*t->cols);
+        t->dirty_lo = SIZE_MAX;
+        t->dirty_hi = 0;
+    }
+    if (t->count == 0) return;
+    qtableOverlayDrawCells(o, t->tint, t->dir, t->rows, t->cols, r, true, true);
+}
+
+#endif
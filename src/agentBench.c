@@ -0,0 +1,249 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+// IMPLEMENTED BY libcqcore (src/cqcore.c)
+#include "agent.h"
+#include "mazeIR.h"
+#include "agentArena.h"
+
+#define FLAG_IMPLEMENTATION
+#include "flag.h"
+
+/*
+    Q-TABLE LAYOUT BENCHMARK
+
+    TRAINS THE SAME MAZE ONCE PER LAYOUT (row, tiled, morton, agent.h) WITH
+    THE TRAINER'S STEP RULE AND A FIXED epsilon, -steps ENVIRONMENT STEPS
+    EACH, AND TIMES ONLY THE TRAINING LOOP. THE VALUES DO NOT DEPEND ON THE
+    LAYOUT AND EVERY RUN RESEEDS, SO ALL LAYOUTS WALK THE SAME TRAJECTORIES
+    AND END WITH THE SAME TABLE: THE CHECKSUM (OVER THE CELLS IN ROW MAJOR
+    ORDER) MUST MATCH, OR THE LAYOUT IS BROKEN.
+
+    EPISODES START FROM A RANDOM OPEN CELL (-from_start FOR agent_start), SO
+    THE WHOLE TABLE IS IN PLAY AS IT IS IN A LONG RUN ON A BIG MAZE. EACH
+    LAYOUT IS RUN -repeat TIMES AND THE FASTEST RUN IS KEPT.
+*/
+
+typedef struct {
+    char*  maze_file;
+    size_t steps;
+    size_t max_steps;
+    size_t repeat;
+    float  epsilon;
+    unsigned long seed;
+    bool   from_start;
+    bool   double_q;
+} ArgParameters;
+
+static ArgParameters ARG_PARAMS = {
+    .maze_file  = "mapas/crazy.npy",
+    .steps      = 20000000,
+    .max_steps  = 0,
+    .repeat     = 3,
+    .epsilon    = 0.1f,
+    .seed       = 67,
+    .from_start = false,
+    .double_q   = false
+};
+
+typedef struct {
+    uint32_t* open;
+    size_t    n_open;
+    size_t    cols;
+} BenchStarts;
+
+typedef struct {
+    double   seconds;
+    uint64_t checksum;
+    size_t   episodes;
+    size_t   goals;
+} BenchResult;
+
+void parse_cmd_arguments(int argc, char** argv);
+void debug_arg_parameters();
+
+static double now_seconds(void){
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec*1e-9;
+}
+
+static state_t bench_random_start(Agent* self, void* ctx){
+    BenchStarts* st = (BenchStarts*)ctx;
+    uint32_t cell = st->open[agentRandRange(self, (uint32_t)st->n_open)];
+    return (state_t){(int32_t)(cell % st->cols), (int32_t)(cell / st->cols)};
+}
+
+// FNV-1a OVER THE VALUES IN ROW MAJOR CELL ORDER, THE SAME FOR EVERY LAYOUT
+static uint64_t bench_checksum(q_table_t* t){
+    uint64_t h = 1469598103934665603ULL;
+    size_t row = qtableCount(t)*t->len_state_actions;
+    for (size_t y = 0; y < t->len_state_y; y++) {
+        for (size_t x = 0; x < t->len_state_x; x++) {
+            const q_val_t* q = qtableRow(t, (state_t){(int32_t)x, (int32_t)y}, 0);
+            const uint8_t* b = (const uint8_t*)q;
+            for (size_t i = 0; i < row*sizeof(q_val_t); i++) {
+                h ^= b[i];
+                h *= 1099511628211ULL;
+            }
+        }
+    }
+    return h;
+}
+
+static BenchResult bench_layout(MazeEnv* ir, BenchStarts* starts, arena_t* arena, qtable_layout_t layout,
+                                size_t walls_count, size_t opens_count){
+    BenchResult res = {0};
+    arenaReset(arena);
+    Agent* agent = arenaNewAgent(arena, ir, 0.5f, 0.99f, 1.0, ARG_PARAMS.seed, layout);
+    if (!agent || (ARG_PARAMS.double_q && arenaEnableDoubleQ(arena, agent) != 0)) {
+        printf("[ERROR] Could not allocate the %s table\n", qtableLayoutName(layout));
+        exit(-1);
+    }
+    if (!ARG_PARAMS.from_start) agentSetStartFn(agent, bench_random_start, starts);
+    agent->epsilon = ARG_PARAMS.epsilon;
+
+    size_t steps = 0;
+    double t0 = now_seconds();
+    while (steps < ARG_PARAMS.steps) {
+        agentRestart(agent);
+        res.episodes++;
+        for (size_t step = 0; step < ARG_PARAMS.max_steps && steps < ARG_PARAMS.steps; step++) {
+            agentPolicy(agent, ir);
+            state_t next = GetNextState(agent->current_s, agent->policy_action);
+            stepResult sr = stepIntoStateUnscaled(ir, next, walls_count, opens_count);
+            state_t trans_state = sr.invalidNext ? agent->current_s : next;
+            agentQtableUpdate(agent, trans_state, sr);
+            steps++;
+            if (sr.isGoal) res.goals++;
+            if (sr.isGoal || sr.terminal) break;
+            agentUpdateState(agent, trans_state);
+        }
+    }
+    res.seconds = now_seconds() - t0;
+    res.checksum = bench_checksum(&agent->q_table);
+    return res;
+}
+
+int main(int argc, char** argv)
+{
+    parse_cmd_arguments(argc, argv);
+    debug_arg_parameters();
+
+    MazeEnv ir = {0};
+    if (readMazeNumpy(ARG_PARAMS.maze_file, &ir) == -1 &&
+        readMazeRaw(ARG_PARAMS.maze_file, &ir)   == -1) {
+        printf("[ERROR] Invalid Maze File: %s\n", ARG_PARAMS.maze_file);
+        exit(-1);
+    }
+    if (ARG_PARAMS.max_steps == 0) ARG_PARAMS.max_steps = 4*ir.rows*ir.cols;
+
+    size_t n_cells = ir.rows*ir.cols;
+    BenchStarts starts = {(uint32_t*)malloc(n_cells*sizeof(uint32_t)), 0, ir.cols};
+    if (!starts.open) {
+        printf("[ERROR] Out of memory\n");
+        exit(-1);
+    }
+    for (size_t c = 0; c < n_cells; c++) {
+        if (ir.grid[c] == GRID_OPEN) starts.open[starts.n_open++] = (uint32_t)c;
+    }
+    if (starts.n_open == 0) {
+        printf("[ERROR] The maze has no open cell to start from\n");
+        exit(-1);
+    }
+    size_t walls_count = countAllMatchingCells(&ir, GRID_WALL);
+    size_t opens_count = countAllMatchingCells(&ir, GRID_OPEN);
+
+    size_t max_slots = 0;
+    for (int l = 0; l < QTABLE_LAYOUT_COUNT; l++) {
+        size_t slots = qtableSlots(ir.cols, ir.rows, (qtable_layout_t)l);
+        if (slots > max_slots) max_slots = slots;
+    }
+    arena_t arena;
+    // THE SINGLE TABLE, PLUS THE A/B PAIR THAT -double_q COPIES IT INTO
+    size_t table_bytes = max_slots*ACTION_N_ACTIONS*sizeof(q_val_t);
+    if (arenaInit(&arena, sizeof(Agent) + (ARG_PARAMS.double_q ? 3 : 1)*table_bytes + 3*ARENA_ALIGN) != 0) {
+        printf("[ERROR] Could not map the tables\n");
+        exit(-1);
+    }
+    printf("[INFO] Maze %zux%zu, %zu open cells, %.1f MB row major table%s\n",
+           ir.rows, ir.cols, starts.n_open,
+           (double)(n_cells*ACTION_N_ACTIONS*sizeof(q_val_t)*(ARG_PARAMS.double_q ? 2 : 1))/(1024.0*1024.0),
+           ARG_PARAMS.double_q ? " (double Q)" : "");
+
+    BenchResult best[QTABLE_LAYOUT_COUNT];
+    for (int l = 0; l < QTABLE_LAYOUT_COUNT; l++) {
+        for (size_t r = 0; r < ARG_PARAMS.repeat; r++) {
+            BenchResult res = bench_layout(&ir, &starts, &arena, (qtable_layout_t)l, walls_count, opens_count);
+            if (r == 0 || res.seconds < best[l].seconds) best[l] = res;
+        }
+    }
+
+    printf("\n%-8s %10s %10s %12s %9s %16s\n", "layout", "slots", "padding", "ns/step", "speedup", "checksum");
+    bool same = true;
+    for (int l = 0; l < QTABLE_LAYOUT_COUNT; l++) {
+        size_t slots = qtableSlots(ir.cols, ir.rows, (qtable_layout_t)l);
+        double ns = best[l].seconds*1e9/(double)ARG_PARAMS.steps;
+        printf("%-8s %10zu %9.2fx %12.2f %8.2fx %016llx\n",
+               qtableLayoutName((qtable_layout_t)l), slots, (double)slots/(double)n_cells, ns,
+               best[QTABLE_LAYOUT_ROW].seconds/best[l].seconds, (unsigned long long)best[l].checksum);
+        same &= best[l].checksum == best[QTABLE_LAYOUT_ROW].checksum;
+    }
+    printf("\n[INFO] %zu episodes, %zu goals per run\n", best[0].episodes, best[0].goals);
+    if (!same) {
+        printf("[ERROR] The layouts did not learn the same table\n");
+        exit(-1);
+    }
+
+    arenaFree(&arena);
+    free(starts.open);
+    freeMaze(&ir);
+    return 0;
+}
+
+void parse_cmd_arguments(int argc, char** argv){
+    char**    maze       = flag_str   ("maze",       "mapas/crazy.npy", "Path to the maze (.npy or .maze)");
+    size_t*   steps      = flag_size  ("steps",      20000000, "Environment steps per layout");
+    size_t*   max_steps  = flag_size  ("max_steps",  0,        "Max steps per episode (0 = 4 * rows * cols)");
+    size_t*   repeat     = flag_size  ("repeat",     3,        "Runs per layout, the fastest is kept");
+    char**    epsilon    = flag_str   ("epsilon",    "0.1",    "Random action probability");
+    uint64_t* seed       = flag_uint64("seed",       67,       "Seed of every run");
+    bool*     from_start = flag_bool  ("from_start", false,    "Start every episode at agent_start instead of a random open cell");
+    bool*     double_q   = flag_bool  ("double_q",   false,    "Benchmark interleaved Double Q tables");
+    bool*     help       = flag_bool  ("help",       false,    "Print this help");
+
+    if (!flag_parse(argc, argv)) {
+        flag_print_error(stderr);
+        exit(-1);
+    }
+    if (*help) {
+        fprintf(stderr, "Usage: %s [OPTIONS]\n", flag_program_name());
+        flag_print_options(stderr);
+        exit(0);
+    }
+
+    ARG_PARAMS.maze_file  = *maze;
+    ARG_PARAMS.steps      = *steps > 0 ? *steps : 1;
+    ARG_PARAMS.max_steps  = *max_steps;
+    ARG_PARAMS.repeat     = *repeat > 0 ? *repeat : 1;
+    ARG_PARAMS.epsilon    = strtof(*epsilon, NULL);
+    ARG_PARAMS.seed       = (unsigned long)*seed;
+    ARG_PARAMS.from_start = *from_start;
+    ARG_PARAMS.double_q   = *double_q;
+}
+
+void debug_arg_parameters(){
+    printf("ARG PARAMETERS:\n");
+    printf("\tmaze_file  = %s\n"  , ARG_PARAMS.maze_file);
+    printf("\tsteps      = %zu\n" , ARG_PARAMS.steps);
+    printf("\tmax_steps  = %zu\n" , ARG_PARAMS.max_steps);
+    printf("\trepeat     = %zu\n" , ARG_PARAMS.repeat);
+    printf("\tepsilon    = %.3f\n", (double)ARG_PARAMS.epsilon);
+    printf("\tseed       = %lu\n" , ARG_PARAMS.seed);
+    printf("\tfrom_start = %s\n"  , ARG_PARAMS.from_start ? "true" : "false");
+    printf("\tdouble_q   = %s\n"  , ARG_PARAMS.double_q ? "true" : "false");
+}
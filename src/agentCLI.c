@@ -19,15 +19,29 @@
 
 #define AGENT_IMPLEMENTATION
 #include "agent.h"
+#undef AGENT_IMPLEMENTATION
 
 #define MAZE_IR_IMPLEMENTATION
 #include "mazeIR.h"
 
+#define AGENT_DYNA_IMPLEMENTATION
+#include "agentDyna.h"
+#undef AGENT_DYNA_IMPLEMENTATION
+
+#define AGENT_INSTRUMENT_IMPLEMENTATION
+#include "agentInstrument.h"
+#undef AGENT_INSTRUMENT_IMPLEMENTATION
+
+#define AGENT_TRACE_IMPLEMENTATION
+#include "agentTrace.h"
+#undef AGENT_TRACE_IMPLEMENTATION
+
 
 #define AGENT_CLI_STATE_FILE (".agent_cli_state")
 #define NEXT_BEST_RATE_INCREMENT (0.1f)
 #define SUCCESS_WINDOW 100
 #define SUCCESS_THRESHOLD 0.8f
+#define INST_REPORT_EVERY_SECS 5.0
 
 // #define USE_DISTANCE_TO_GOAL_REWARD 1
 
@@ -127,7 +141,8 @@ int save_cli_state(const char* filename, const char* map_path,
                    float lr, float dr, float eps_decay,
                    int sucess_window_size, float sucess_treshold,
                    DecayType decay_type,
-                   bool useDistanceRewardShaping) // <-- novo param
+                   bool useDistanceRewardShaping, // <-- novo param
+                   int dyna_k)
 {
     if (!filename) return -1;
     FILE *f = fopen(filename, "w");
@@ -144,6 +159,7 @@ int save_cli_state(const char* filename, const char* map_path,
     fprintf(f, "sucess_treshold=%g\n", (double)sucess_treshold);
     fprintf(f, "decay_type=%d\n", (int)decay_type);
     fprintf(f, "useDistanceRewardShaping=%d\n", useDistanceRewardShaping ? 1 : 0); // <-- novo
+    fprintf(f, "dyna_k=%d\n", dyna_k);
 
     fflush(f);
     fclose(f);
@@ -154,7 +170,8 @@ int read_cli_state(const char* filename, char** out_map_path,
                    float* out_lr, float* out_dr, float* out_eps_decay,
                    int* out_sucess_window_size, float* out_sucess_treshold,
                    DecayType* out_decay_type,
-                   bool* out_useDistanceRewardShaping) // <-- novo
+                   bool* out_useDistanceRewardShaping, // <-- novo
+                   int* out_dyna_k)
 {
     if (!filename) return -1;
     FILE *f = fopen(filename, "r");
@@ -194,13 +211,15 @@ int read_cli_state(const char* filename, char** out_map_path,
             }
         } else if (strcmp(key, "useDistanceRewardShaping") == 0) { // <-- novo
             if (out_useDistanceRewardShaping) *out_useDistanceRewardShaping = (atoi(val) != 0);
+        } else if (strcmp(key, "dyna_k") == 0) {
+            if (out_dyna_k) *out_dyna_k = (int)strtol(val, NULL, 10);
         }
     }
     fclose(f);
     return 0;
 }
 
-inline float manhatan_distance(state_t s1, state_t s2) {
+static inline float manhatan_distance(state_t s1, state_t s2) {
 	return abs(s1.x - s2.x) + abs(s1.y - s2.y);
 }
 
@@ -209,7 +228,9 @@ inline float manhatan_distance(state_t s1, state_t s2) {
         if ((xs)->count >= (xs)->capacity) {                                         \
             if ((xs)->capacity == 0) (xs)->capacity = 256;                           \
             else (xs)->capacity *= 2;                                                \
+            TRACE_BEGIN(da_grow);                                                    \
             (xs)->items = realloc((xs)->items, (xs)->capacity*sizeof(*(xs)->items)); \
+            TRACE_END(da_grow, "da_append realloc", "alloc", (xs)->capacity);        \
         }                                                                            \
                                                                                      \
         (xs)->items[(xs)->count++] = (x);                                            \
@@ -233,6 +254,7 @@ Agent* run_training(MazeEnv* ir,const char* map_path,
 				  int sucess_window_size, float sucess_treshold, 
 				  DecayType current_decay_type, 
 				  bool useDistanceRewardShaping, bool blockTranspassing,
+				  int dyna_k,
 				  trainMetrics* metrics
 				) {
 
@@ -253,6 +275,13 @@ Agent* run_training(MazeEnv* ir,const char* map_path,
 	size_t wallsCount = countAllMatchingCells(ir,GRID_WALL);
 	size_t opensCount = countAllMatchingCells(ir,GRID_OPEN);
 
+	dyna_model_t dyna = {0};
+	bool use_dyna = dyna_k > 0 && dynaModelInit(&dyna,ir,(size_t)dyna_k) == 0;
+	size_t total_steps = 0;
+	clock_t clock_start = clock();
+	inst_t inst;
+	INST_INIT(&inst);
+
 	if(useDistanceRewardShaping) {
 		cellId c = getFirstMatchingCell(ir,GRID_AGENT_GOAL);
 		goal_state.x = c.col; goal_state.y = c.row;
@@ -264,12 +293,14 @@ Agent* run_training(MazeEnv* ir,const char* map_path,
     printf("Agent start: x=%u y=%u\n", (unsigned)agent->agent_start.x, (unsigned)agent->agent_start.y);
 
     while(current_episode < SIZE_MAX && !stop_train){
+        TRACE_BEGIN_SAMPLED(episode, current_episode);
         agentRestart(agent);
         size_t steps_taken = 0;
         bool reached_goal = false;
 
         for(int step = 0; step < (int)MAX_STEPS_PER_EPISODE; step++){
-            agentPolicy(agent,ir);
+            INST_TIME(&inst,INST_POLICY) agentPolicy(agent,ir);
+            INST_BEGIN(step);
             state_t next = GetNextState(agent->current_s,agent->policy_action);
             stepResult sr = stepIntoState(ir,next,wallsCount,opensCount);
 			
@@ -287,8 +318,15 @@ Agent* run_training(MazeEnv* ir,const char* map_path,
 				float shaping = dr * (phi_s - phi_sp); 
 				sr.reward += shaping;
 			}
+			INST_END(&inst,INST_STEP,step);
 
-            agentQtableUpdate(agent,trans_state,sr);
+            INST_TIME(&inst,INST_UPDATE) agentQtableUpdate(agent,trans_state,sr);
+			INST_BEGIN(planning);
+			if(use_dyna){
+				dynaModelRecord(&dyna,agent->current_s,agent->policy_action,trans_state,sr);
+				dynaPlan(&dyna,agent);
+			}
+			INST_END(&inst,INST_PLANNING,planning);
             agent->accum_reward += sr.reward;
             steps_taken++;
 
@@ -301,6 +339,9 @@ Agent* run_training(MazeEnv* ir,const char* map_path,
             agentUpdateState(agent,trans_state);
         }
 
+		total_steps += steps_taken;
+		INST_EPISODE(&inst,steps_taken);
+		INST_BEGIN(metrics);
 		da_append(&metrics->rewards_acumm_by_episode,agent->accum_reward);
 
         success_history[success_index] = reached_goal ? 1 : 0;
@@ -309,12 +350,16 @@ Agent* run_training(MazeEnv* ir,const char* map_path,
         int sum = 0;
         for(int i=0; i<sucess_window_size; i++) sum += success_history[i];
         float success_rate = (float)sum / sucess_window_size;
+		INST_END(&inst,INST_METRICS,metrics);
 
+		INST_BEGIN(logging);
         if( success_rate >= next_best_sucess_rate || flag_char == 'v') {
             printf("Episode %zu end | steps=%zu accum_reward=%.2f | epsilon=%.2f | success_rate=%.2f\n",
                 current_episode, steps_taken, (double)agent->accum_reward,agent->epsilon,success_rate);
 			next_best_sucess_rate += NEXT_BEST_RATE_INCREMENT;
         }
+		INST_END(&inst,INST_LOGGING,logging);
+		INST_PERIODIC(&inst,INST_REPORT_EVERY_SECS,stdout);
 
         if(success_rate >= sucess_treshold && agent->accum_reward > 0) {
             printf("Policy converged with %.1f%% success.\n", success_rate*100);
@@ -335,10 +380,17 @@ Agent* run_training(MazeEnv* ir,const char* map_path,
 		temp_flag = '\0';
 
         agentEpsilonDecay(agent,decayTypeToFn[current_decay_type]);
+        TRACE_END(episode, "episode", "train", steps_taken);
         current_episode++;
     }
 
-    printf("Training finished after %zu episodes.\n", current_episode);
+    printf("Training finished after %zu episodes, %zu environment steps, %.2fs.\n", current_episode,
+	       total_steps, (double)(clock() - clock_start) / CLOCKS_PER_SEC);
+	if(use_dyna){
+		printf("Dyna-Q: k=%d, %zu planning updates over %zu modeled pairs\n",dyna_k,dyna.total_updates,dyna.n_visited);
+		dynaModelFree(&dyna);
+	}
+	INST_REPORT(&inst,stdout);
 	metrics->last_episode = current_episode;
 
     // Simula melhor trajetória (epsilon=0)
@@ -374,7 +426,8 @@ void prompt_training_params(double sugested_epsilon_decay_exp,double sugested_ep
                             int* sucess_window_size, float* sucess_treshold,
                             DecayType* out_decay_type,
                             bool* out_useDistanceRewardShaping,
-							bool* block_transspassing_walls
+							bool* block_transspassing_walls,
+							int* out_dyna_k
 						) 
 {
     printf("Train Parameters (enter => current value):\n");
@@ -408,6 +461,9 @@ void prompt_training_params(double sugested_epsilon_decay_exp,double sugested_ep
     read_int(" Block wall transpassing (0/1)", &transpassing_int, transpassing_int); 
     *block_transspassing_walls = (transpassing_int != 0);
 
+    read_int(" Dyna-Q planning steps per real step (0 = off)", out_dyna_k, *out_dyna_k);
+    if(*out_dyna_k < 0) *out_dyna_k = 0;
+
 }
 
 static char temp_format_buf[512];
@@ -425,8 +481,11 @@ int main(int argc, char** argv){
 	
 	bool useDistanceRewardShaping = false;
 	bool blockTranspassingWalls = true;
+	int dyna_k = 0;
 
-	read_cli_state(AGENT_CLI_STATE_FILE, &map_path, &lr, &dr, &eps_decay, &sucess_window_size, &sucess_treshold,&current_decay_type,&useDistanceRewardShaping);
+	TRACE_INIT("agentCLI.trace.json");
+	TRACE_THREAD_NAME("cli");
+	read_cli_state(AGENT_CLI_STATE_FILE, &map_path, &lr, &dr, &eps_decay, &sucess_window_size, &sucess_treshold,&current_decay_type,&useDistanceRewardShaping,&dyna_k);
 	if(map_path){
 		if(readMazeNumpy(map_path,&ir) == -1 && readMazeRaw(map_path,&ir) == -1){
 			free(map_path);
@@ -440,6 +499,7 @@ int main(int argc, char** argv){
 		printf("learning rate = %.2f, discount factor = %.2f, epsilon decay = %.2e\n",lr, dr, eps_decay);
 		printf("Distance reward shaping: %s\n",useDistanceRewardShaping ? "Yes" : "No");
 		printf("Block Walls Transpassing: %s\n",blockTranspassingWalls ? "Yes" : "No");
+		printf("Dyna-Q planning steps: %d\n",dyna_k);
 		printf("decay type = %s\n",decayTypeToStr[current_decay_type]);
 		printf("sucess window size = %u, sucess treshold = %.2f\n",sucess_window_size,sucess_treshold);
         
@@ -469,7 +529,7 @@ int main(int argc, char** argv){
 				}
 				train_metrics.last_episode = 0;
 				train_metrics.rewards_acumm_by_episode.count= 0;
-				current_agent = run_training(&ir,map_path, lr, dr, eps_decay,sucess_window_size, sucess_treshold,current_decay_type,useDistanceRewardShaping,blockTranspassingWalls,&train_metrics);
+				current_agent = run_training(&ir,map_path, lr, dr, eps_decay,sucess_window_size, sucess_treshold,current_decay_type,useDistanceRewardShaping,blockTranspassingWalls,dyna_k,&train_metrics);
 			} else {
 				printf("Select an valid map path\n");
 			}
@@ -477,10 +537,13 @@ int main(int argc, char** argv){
 			if(current_agent) {
 				Basename b = getFilepathBasename(map_path);
 				sprintf(temp_format_buf, "metrics/%s_%zu.csv", b.str, train_metrics.last_episode);
-				save_csv_reward_accum_by_episode(temp_format_buf, train_metrics.rewards_acumm_by_episode.items, train_metrics.last_episode);
+				TRACE_SPAN("save metrics", "io") save_csv_reward_accum_by_episode(temp_format_buf, train_metrics.rewards_acumm_by_episode.items, train_metrics.last_episode);
 				freeBasename(&b);
 				char* save_path = windows_open_file_dialog(qtable_filter,NULL,true);
-				if(agentSaveQtable(current_agent,save_path) == 0){
+				TRACE_BEGIN(save);
+				int saved = agentSaveQtable(current_agent,save_path);
+				TRACE_END(save, "checkpoint qtable", "io", 0);
+				if(saved == 0){
 					printf("[INFO] Agent Q table Saved\n");
 				}
 			} else {
@@ -501,7 +564,7 @@ int main(int argc, char** argv){
 			#endif
 			
 			if(map_path){
-            	save_cli_state(AGENT_CLI_STATE_FILE, map_path, lr, dr, eps_decay, sucess_window_size, sucess_treshold,current_decay_type,useDistanceRewardShaping);
+            	save_cli_state(AGENT_CLI_STATE_FILE, map_path, lr, dr, eps_decay, sucess_window_size, sucess_treshold,current_decay_type,useDistanceRewardShaping,dyna_k);
 			} else {
 				printf("\n[ERROR] No Maze Given\n");
 			}
@@ -517,8 +580,8 @@ int main(int argc, char** argv){
 			}
 			// TODO: ENHANCE THE SUGESTED SUGESTED DECAY FOR EXPONENCIAL DECAY
 			// suggested_decay_exp = 0.9999f;
-			prompt_training_params(suggested_decay_exp,suggested_decay_linear,&lr,&dr,&eps_decay,&sucess_window_size,&sucess_treshold,&current_decay_type,&useDistanceRewardShaping,&blockTranspassingWalls);
-			save_cli_state(AGENT_CLI_STATE_FILE, map_path, lr, dr, eps_decay, sucess_window_size, sucess_treshold,current_decay_type,useDistanceRewardShaping);
+			prompt_training_params(suggested_decay_exp,suggested_decay_linear,&lr,&dr,&eps_decay,&sucess_window_size,&sucess_treshold,&current_decay_type,&useDistanceRewardShaping,&blockTranspassingWalls,&dyna_k);
+			save_cli_state(AGENT_CLI_STATE_FILE, map_path, lr, dr, eps_decay, sucess_window_size, sucess_treshold,current_decay_type,useDistanceRewardShaping,dyna_k);
 		}
 
 		else if(choice == 5){
@@ -530,5 +593,6 @@ int main(int argc, char** argv){
     }
 
     free(map_path);
+    TRACE_SHUTDOWN();
     return 0;
 }
\ No newline at end of file
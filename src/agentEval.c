@@ -0,0 +1,446 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+// IMPLEMENTED BY libcqcore (src/cqcore.c)
+#include "agent.h"
+#include "mazeIR.h"
+#include "mazePaths.h"
+#include "agentPolicy.h"
+#include "agentShm.h"
+
+#define AGENT_TRACE_IMPLEMENTATION
+#include "agentTrace.h"
+#undef AGENT_TRACE_IMPLEMENTATION
+
+#define FLAG_IMPLEMENTATION
+#include "flag.h"
+
+/*
+    HEADLESS BATCH POLICY EVALUATION
+
+    LOADS A MAZE AND A .qtable (COMPILED TO A 2 BIT GREEDY MAP, agentPolicy.h)
+    OR AN ALREADY COMPILED .policy (MAPPED, NOT READ) OR THE POLICY AN
+    agentServe PUBLISHES (-shm, READ IN PLACE) AND ROLLS THE POLICY OUT
+    FROM EVERY OPEN START CELL (OR A SEEDED SAMPLE OF THEM) ON A POOL OF
+    THREADS. THE MAZE AND THE MAP ARE SHARED READ ONLY, EACH WORKER ONLY OWNS
+    ITS RNG AND A VISITED BITSET, AND PULLS STARTS IN CHUNKS FROM AN ATOMIC
+    CURSOR. THE CHAIN ANALYSIS OF THE MAP CROSS CHECKS THE GREEDY OUTCOMES.
+
+    A GREEDY ROLLOUT IS DETERMINISTIC, SO STEPPING ON A CELL TWICE IS A LOOP
+    THAT WILL NEVER REACH THE GOAL AND THE ROLLOUT STOPS THERE. THE BITSET IS
+    CLEARED BY WALKING THE CELLS OF THE ROLLOUT, NOT THE WHOLE MAZE. WITH
+    epsilon > 0 REVISITS ARE EXPECTED AND ONLY max_steps ENDS A ROLLOUT.
+
+    path_ratio IS STEPS TAKEN / BFS SHORTEST DISTANCE FOR THE SUCCESSFUL STARTS.
+    THE BFS WALKS OPEN CELLS ONLY, SO WITH -transpassing THE RATIO CAN DROP
+    BELOW 1.
+*/
+
+#define EVAL_CHUNK 64
+
+typedef enum {
+    EVAL_GOAL = 0,
+    EVAL_LOOP,
+    EVAL_MAX_STEPS,
+    EVAL_N_OUTCOMES
+} EvalOutcome;
+
+typedef struct {
+    size_t   outcomes[EVAL_N_OUTCOMES];
+    uint64_t steps;              // EVERY STEP OF EVERY ROLLOUT
+    uint64_t goal_steps;         // STEPS OF THE SUCCESSFUL ROLLOUTS
+    uint64_t goal_optimal;       // BFS DISTANCE OF THE SUCCESSFUL STARTS
+    double   ratio_sum;
+    double   ratio_max;
+} EvalStats;
+
+typedef struct {
+    MazeEnv*        env;
+    const compiled_policy_t* policy;   // SHARED, NEVER WRITTEN
+    const uint32_t* starts;
+    size_t          n_starts;
+    const uint32_t* dist;
+    size_t          max_steps;
+    float           epsilon;
+    bool            block_transpassing;
+    atomic_size_t   next;
+} EvalJob;
+
+typedef struct {
+    EvalJob*        job;
+    unsigned long   seed;
+    EvalStats       stats;
+} EvalWorker;
+
+typedef struct {
+    char*  maze_file;
+    char*  qtable_file;
+    char*  policy_file;
+    char*  shm_name;
+    char*  save_policy_path;
+    size_t n_starts;
+    size_t threads;
+    size_t max_steps;
+    float  epsilon;
+    unsigned long seed;
+    bool   block_transpassing_walls;
+} ArgParameters;
+
+static ArgParameters ARG_PARAMS = {
+    .maze_file                = NULL,
+    .qtable_file              = NULL,
+    .policy_file              = NULL,
+    .shm_name                 = NULL,
+    .save_policy_path         = NULL,
+    .n_starts                 = 0,
+    .threads                  = 0,
+    .max_steps                = 0,
+    .epsilon                  = 0.0f,
+    .seed                     = 67,
+    .block_transpassing_walls = true
+};
+
+void parse_cmd_arguments(int argc, char** argv);
+void debug_arg_parameters();
+
+static double now_seconds(void){
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec*1e-9;
+}
+
+static size_t cpu_count(void){
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return si.dwNumberOfProcessors > 0 ? (size_t)si.dwNumberOfProcessors : 1;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (size_t)n : 1;
+#endif
+}
+
+// SAME STEP RULE AS THE TRAINER GREEDY ROLLOUT, self ONLY HOLDS THE WORKER RNG
+static EvalOutcome eval_rollout(EvalJob* job, Agent* self, uint64_t* visited, uint32_t* path,
+                                uint32_t start, size_t* steps_out){
+    MazeEnv* env = job->env;
+    bool detect_loops = job->epsilon <= 0.0f;
+    state_t s = {(int32_t)(start % env->cols), (int32_t)(start / env->cols)};
+    size_t n_path = 0;
+    size_t steps = 0;
+    EvalOutcome out = EVAL_MAX_STEPS;
+
+    while (steps < job->max_steps) {
+        uint32_t cell = (uint32_t)((size_t)s.y*env->cols + (size_t)s.x);
+        if (detect_loops) {
+            uint64_t bit = (uint64_t)1 << (cell & 63);
+            if (visited[cell >> 6] & bit) { out = EVAL_LOOP; break; }
+            visited[cell >> 6] |= bit;
+            path[n_path++] = cell;
+        }
+
+        Action a;
+        if (job->epsilon > 0.0f && (float)agentRandU32(self)*(1.0f/4294967296.0f) < job->epsilon)
+            a = (Action)agentRandRange(self, ACTION_N_ACTIONS);
+        else
+            a = policyAction(job->policy, cell);
+
+        state_t next = GetNextState(s, a);
+        stepResult sr = stepIntoState(env, next, 0, 0);
+        steps++;
+        if (sr.isGoal) { out = EVAL_GOAL; break; }
+
+        bool out_of_grid = next.x < 0 || next.y < 0 || (size_t)next.x >= env->cols || (size_t)next.y >= env->rows;
+        if (out_of_grid || (job->block_transpassing && sr.invalidNext)) continue;
+        s = next;
+    }
+
+    for (size_t i = 0; i < n_path; i++) visited[path[i] >> 6] = 0;
+    *steps_out = steps;
+    return out;
+}
+
+static void* eval_worker(void* arg){
+    EvalWorker* w = (EvalWorker*)arg;
+    EvalJob* job = w->job;
+    size_t n_cells = job->env->rows*job->env->cols;
+
+    Agent self = {0};
+    agentSetSeed(&self, (unsigned int)w->seed);
+    TRACE_THREAD_NAME("eval worker");
+
+    uint64_t* visited = (uint64_t*)calloc((n_cells + 63)/64, sizeof(uint64_t));
+    uint32_t* path    = (uint32_t*)malloc((job->max_steps < n_cells ? job->max_steps : n_cells)*sizeof(uint32_t));
+    if (!visited || !path) {
+        fprintf(stderr, "[ERROR] worker out of memory\n");
+        free(visited); free(path);
+        return NULL;
+    }
+
+    for (;;) {
+        size_t first = atomic_fetch_add(&job->next, EVAL_CHUNK);
+        if (first >= job->n_starts) break;
+        size_t last = first + EVAL_CHUNK < job->n_starts ? first + EVAL_CHUNK : job->n_starts;
+        TRACE_BEGIN(chunk);
+        for (size_t i = first; i < last; i++) {
+            uint32_t start = job->starts[i];
+            size_t steps = 0;
+            EvalOutcome out = eval_rollout(job, &self, visited, path, start, &steps);
+            w->stats.outcomes[out]++;
+            w->stats.steps += steps;
+            if (out != EVAL_GOAL) continue;
+            uint32_t opt = job->dist[start];
+            double ratio = (double)steps/(double)opt;
+            w->stats.goal_steps   += steps;
+            w->stats.goal_optimal += opt;
+            w->stats.ratio_sum    += ratio;
+            if (ratio > w->stats.ratio_max) w->stats.ratio_max = ratio;
+        }
+        TRACE_END(chunk, "rollout chunk", "eval", last - first);
+    }
+
+    free(visited);
+    free(path);
+    return NULL;
+}
+
+int main(int argc, char** argv)
+{
+    parse_cmd_arguments(argc, argv);
+    debug_arg_parameters();
+    TRACE_INIT("agentEval.trace.json");
+    TRACE_THREAD_NAME("main");
+
+    MazeEnv ir = {0};
+    if (readMazeNumpy(ARG_PARAMS.maze_file, &ir) == -1 &&
+        readMazeRaw(ARG_PARAMS.maze_file, &ir)   == -1) {
+        printf("[ERROR] Invalid Maze File: %s\n", ARG_PARAMS.maze_file);
+        exit(-1);
+    }
+
+    compiled_policy_t policy;
+    qtable_shm_t shm = {0};
+    shm_view_t   view = {0};
+    if (ARG_PARAMS.shm_name) {
+        if (shmOpen(&shm, ARG_PARAMS.shm_name) != 0 || shmAcquire(&shm, &view) != 0) {
+            printf("[ERROR] No table served as %s\n", ARG_PARAMS.shm_name);
+            exit(-1);
+        }
+        policy = view.policy;
+        printf("[INFO] Using generation %llu served as %s\n", (unsigned long long)view.generation, shm.name);
+    } else if (ARG_PARAMS.policy_file) {
+        if (policyMap(&policy, ARG_PARAMS.policy_file) != 0) {
+            printf("[ERROR] Invalid Policy File: %s\n", ARG_PARAMS.policy_file);
+            exit(-1);
+        }
+    } else {
+        Agent* agent = newAgent(&ir, 0.0f, 0.0f, 0.0, ARG_PARAMS.seed);
+        if (agentReadQtable(agent, ARG_PARAMS.qtable_file) != 0) {
+            printf("[ERROR] Invalid Qtable File: %s\n", ARG_PARAMS.qtable_file);
+            exit(-1);
+        }
+        if (agent->q_table.len_state_x != ir.cols || agent->q_table.len_state_y != ir.rows ||
+            agent->q_table.len_state_actions != ACTION_N_ACTIONS) {
+            printf("[ERROR] Qtable is %zux%zux%zu but the maze is %zux%zu\n",
+                   agent->q_table.len_state_y, agent->q_table.len_state_x,
+                   agent->q_table.len_state_actions, ir.rows, ir.cols);
+            exit(-1);
+        }
+        if (policyCompile(&policy, agent) != 0) {
+            printf("[ERROR] Could not compile the qtable policy\n");
+            exit(-1);
+        }
+        free(agent->q_table.vals);
+        free(agent);
+    }
+    if (policy.rows != ir.rows || policy.cols != ir.cols) {
+        printf("[ERROR] Policy is %zux%zu but the maze is %zux%zu\n", policy.rows, policy.cols, ir.rows, ir.cols);
+        exit(-1);
+    }
+    if (ARG_PARAMS.save_policy_path) {
+        if (policySave(&policy, ARG_PARAMS.save_policy_path) != 0) exit(-1);
+        printf("[INFO] Policy saved to %s (%zu bytes of actions)\n",
+               ARG_PARAMS.save_policy_path, policyPackedSize(policy.rows, policy.cols));
+    }
+
+    size_t n_cells = ir.rows*ir.cols;
+    uint32_t* dist   = (uint32_t*)malloc(n_cells*sizeof(uint32_t));
+    uint32_t* starts = (uint32_t*)malloc(n_cells*sizeof(uint32_t));
+    if (!dist || !starts || mazeBfsDistances(&ir, GRID_AGENT_GOAL, dist) < 0) {
+        printf("[ERROR] Maze needs a goal cell\n");
+        exit(-1);
+    }
+
+    // EVERY OPEN CELL THAT CAN REACH THE GOAL IS A START
+    size_t n_starts = 0, unreachable = 0;
+    for (size_t c = 0; c < n_cells; c++) {
+        uint8_t t = ir.grid[c];
+        if (t != GRID_OPEN && t != GRID_AGENT_START) continue;
+        if (dist[c] == MAZE_DIST_UNREACHABLE) { unreachable++; continue; }
+        starts[n_starts++] = (uint32_t)c;
+    }
+    if (n_starts == 0) {
+        printf("[ERROR] No open cell can reach the goal\n");
+        exit(-1);
+    }
+
+    // PARTIAL FISHER-YATES FOR A SEEDED SUBSET
+    if (ARG_PARAMS.n_starts > 0 && ARG_PARAMS.n_starts < n_starts) {
+        Agent rng = {0};
+        agentSetSeed(&rng, (unsigned int)ARG_PARAMS.seed);
+        for (size_t i = 0; i < ARG_PARAMS.n_starts; i++) {
+            size_t j = i + agentRandRange(&rng, (uint32_t)(n_starts - i));
+            uint32_t tmp = starts[i]; starts[i] = starts[j]; starts[j] = tmp;
+        }
+        n_starts = ARG_PARAMS.n_starts;
+    }
+
+    size_t n_threads = ARG_PARAMS.threads > 0 ? ARG_PARAMS.threads : cpu_count();
+    if (n_threads > n_starts) n_threads = n_starts;
+
+    EvalJob job = {
+        .env                = &ir,
+        .policy             = &policy,
+        .starts             = starts,
+        .n_starts           = n_starts,
+        .dist               = dist,
+        .max_steps          = ARG_PARAMS.max_steps > 0 ? ARG_PARAMS.max_steps : 4*n_cells,
+        .epsilon            = ARG_PARAMS.epsilon,
+        .block_transpassing = ARG_PARAMS.block_transpassing_walls
+    };
+    atomic_init(&job.next, 0);
+
+    EvalWorker* workers = (EvalWorker*)calloc(n_threads, sizeof(EvalWorker));
+    pthread_t*  tids    = (pthread_t*) calloc(n_threads, sizeof(pthread_t));
+    if (!workers || !tids) {
+        printf("[ERROR] Out of memory\n");
+        exit(-1);
+    }
+
+    printf("[INFO] Evaluating %zu starts (%zu unreachable skipped) on %zu threads, max_steps=%zu, epsilon=%g\n",
+           n_starts, unreachable, n_threads, job.max_steps, (double)job.epsilon);
+
+    double t0 = now_seconds();
+    for (size_t i = 0; i < n_threads; i++) {
+        workers[i].job  = &job;
+        workers[i].seed = ARG_PARAMS.seed + 7919UL*(i + 1);
+        if (pthread_create(&tids[i], NULL, eval_worker, &workers[i]) != 0) {
+            printf("[ERROR] Could not start worker %zu\n", i);
+            exit(-1);
+        }
+    }
+    for (size_t i = 0; i < n_threads; i++) pthread_join(tids[i], NULL);
+    double elapsed = now_seconds() - t0;
+
+    EvalStats total = {0};
+    for (size_t i = 0; i < n_threads; i++) {
+        EvalStats* s = &workers[i].stats;
+        for (int k = 0; k < EVAL_N_OUTCOMES; k++) total.outcomes[k] += s->outcomes[k];
+        total.steps        += s->steps;
+        total.goal_steps   += s->goal_steps;
+        total.goal_optimal += s->goal_optimal;
+        total.ratio_sum    += s->ratio_sum;
+        if (s->ratio_max > total.ratio_max) total.ratio_max = s->ratio_max;
+    }
+
+    size_t goals = total.outcomes[EVAL_GOAL];
+    printf("\n[RESULT] success ratio   = %.4f (%zu / %zu)\n", (double)goals/(double)n_starts, goals, n_starts);
+    printf("[RESULT] loops           = %zu\n", total.outcomes[EVAL_LOOP]);
+    printf("[RESULT] max steps hit   = %zu\n", total.outcomes[EVAL_MAX_STEPS]);
+    if (goals > 0) {
+        printf("[RESULT] path ratio mean = %.4f (steps / BFS optimal, per start)\n", total.ratio_sum/(double)goals);
+        printf("[RESULT] path ratio agg  = %.4f (total steps / total optimal)\n",
+               (double)total.goal_steps/(double)total.goal_optimal);
+        printf("[RESULT] path ratio max  = %.4f\n", total.ratio_max);
+    }
+    printf("[RESULT] states/sec      = %.0f (%llu steps in %.3fs)\n",
+           elapsed > 0.0 ? (double)total.steps/elapsed : 0.0,
+           (unsigned long long)total.steps, elapsed);
+
+    if (shm.base && !shmViewValid(&shm, &view)) {
+        printf("[WARN] The served table was replaced twice during the run, results mix generations\n");
+    }
+
+    // THE GREEDY OUTCOME OF EVERY CELL IN ONE PASS, THEN ONE LOAD PER START
+    t0 = now_seconds();
+    if (policyAnalyze(&policy, &ir, job.block_transpassing) == 0) {
+        size_t start_loops = 0;
+        for (size_t i = 0; i < n_starts; i++) start_loops += policyLoops(&policy, starts[i]);
+        printf("[RESULT] greedy chains   = %zu of %zu starts loop, %zu of %zu cells overall (%.3fs)\n",
+               start_loops, n_starts, policy.n_loops, policy.n_loops + policy.n_reach, now_seconds() - t0);
+    }
+
+    free(workers);
+    free(tids);
+    free(dist);
+    free(starts);
+    policyFree(&policy);
+    shmClose(&shm);
+    free(ir.grid);
+    TRACE_SHUTDOWN();
+    return 0;
+}
+
+void parse_cmd_arguments(int argc, char** argv){
+    char**    maze      = flag_str   ("maze",        NULL, "Path to the maze (.npy or .maze)");
+    char**    qtable    = flag_str   ("qtable",      NULL, "Path to the trained .qtable");
+    char**    pfile     = flag_str   ("policy",      NULL, "Path to a compiled .policy, used instead of -qtable");
+    char**    shm_name  = flag_str   ("shm",         NULL, "Read the policy an agentServe publishes under this name");
+    char**    psave     = flag_str   ("save_policy", NULL, "Write the compiled greedy policy to this .policy file");
+    size_t*   n_starts  = flag_size  ("starts",      0,    "Evaluate a seeded sample of this many start cells (0 = every open cell)");
+    size_t*   threads   = flag_size  ("threads",     0,    "Worker threads (0 = one per CPU)");
+    size_t*   max_steps = flag_size  ("max_steps",   0,    "Max steps per rollout (0 = 4 * rows * cols)");
+    char**    epsilon   = flag_str   ("epsilon",     "0",  "Random action probability, 0 is the greedy policy");
+    uint64_t* seed      = flag_uint64("seed",        67,   "Seed for the start sample and the epsilon policy");
+    bool*     transpass = flag_bool  ("transpassing", false, "Let the agent walk onto walls (the trainer --enable_transpasing)");
+    bool*     help      = flag_bool  ("help",        false, "Print this help");
+
+    if (!flag_parse(argc, argv)) {
+        flag_print_error(stderr);
+        exit(-1);
+    }
+    if (*help || !*maze || (!*qtable && !*pfile && !*shm_name)) {
+        fprintf(stderr, "Usage: %s -maze <maze> (-qtable <qtable> | -policy <policy> | -shm <name>) [OPTIONS]\n", flag_program_name());
+        flag_print_options(stderr);
+        exit(*help ? 0 : -1);
+    }
+
+    ARG_PARAMS.maze_file                = *maze;
+    ARG_PARAMS.qtable_file              = *qtable;
+    ARG_PARAMS.policy_file              = *pfile;
+    ARG_PARAMS.shm_name                 = *shm_name;
+    ARG_PARAMS.save_policy_path         = *psave;
+    ARG_PARAMS.n_starts                 = *n_starts;
+    ARG_PARAMS.threads                  = *threads;
+    ARG_PARAMS.max_steps                = *max_steps;
+    ARG_PARAMS.epsilon                  = (float)atof(*epsilon);
+    ARG_PARAMS.seed                     = (unsigned long)*seed;
+    ARG_PARAMS.block_transpassing_walls = !*transpass;
+    if (ARG_PARAMS.epsilon < 0.0f) ARG_PARAMS.epsilon = 0.0f;
+    if (ARG_PARAMS.epsilon > 1.0f) ARG_PARAMS.epsilon = 1.0f;
+}
+
+void debug_arg_parameters(){
+    printf("ARG PARAMETERS:\n");
+    printf("\tmaze_file   = %s\n" , ARG_PARAMS.maze_file);
+    printf("\tqtable_file = %s\n" , ARG_PARAMS.qtable_file ? ARG_PARAMS.qtable_file : "(null)");
+    printf("\tpolicy_file = %s\n" , ARG_PARAMS.policy_file ? ARG_PARAMS.policy_file : "(null)");
+    printf("\tstarts      = %zu\n", ARG_PARAMS.n_starts);
+    printf("\tthreads     = %zu\n", ARG_PARAMS.threads);
+    printf("\tmax_steps   = %zu\n", ARG_PARAMS.max_steps);
+    printf("\tepsilon     = %g\n" , (double)ARG_PARAMS.epsilon);
+    printf("\tseed        = %lu\n", ARG_PARAMS.seed);
+    printf("\ttranspass   = %s\n" , ARG_PARAMS.block_transpassing_walls ? "false" : "true");
+}
@@ -0,0 +1,169 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+// IMPLEMENTED BY libcqcore (src/cqcore.c)
+#include "agentRpc.h"
+
+#define FLAG_IMPLEMENTATION
+#include "flag.h"
+
+/*
+    LOAD GENERATOR FOR agentServe -socket
+
+    ONLY agentRpc.h, LIKE ANY DOWNSTREAM CLIENT. A PING LEARNS THE TABLE
+    SIZE, THEN -requests BATCHES OF -batch RANDOM STATES ARE SENT KEEPING
+    -depth OF THEM IN FLIGHT. THE LATENCY OF A BATCH IS FROM ITS WRITE TO
+    THE END OF ITS ANSWER, SO WITH -depth > 1 IT INCLUDES THE QUEUEING
+    BEHIND THE BATCHES AHEAD OF IT. -depth IS CAPPED SO THE UNREAD ANSWERS
+    FIT rpcPipelineBytes, PAST THAT CLIENT AND SERVER DEADLOCK IN write().
+*/
+
+typedef struct {
+    char*  socket_path;
+    size_t batch;
+    size_t requests;
+    size_t depth;
+    unsigned long seed;
+} ArgParameters;
+
+static ArgParameters ARG_PARAMS = {
+    .socket_path = NULL,
+    .batch       = 64,
+    .requests    = 100000,
+    .depth       = 1,
+    .seed        = 67
+};
+
+void parse_cmd_arguments(int argc, char** argv);
+void debug_arg_parameters();
+
+static double now_seconds(void){
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec*1e-9;
+}
+
+static uint64_t xorshift64(uint64_t* s){
+    uint64_t x = *s;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *s = x;
+}
+
+int main(int argc, char** argv)
+{
+    parse_cmd_arguments(argc, argv);
+    debug_arg_parameters();
+
+    int fd = rpcConnect(ARG_PARAMS.socket_path);
+    if (fd < 0) {
+        printf("[ERROR] Could not connect to %s\n", ARG_PARAMS.socket_path);
+        exit(-1);
+    }
+
+    rpc_response_t resp;
+    rpc_result_t*  results = (rpc_result_t*)malloc(ARG_PARAMS.batch*sizeof(rpc_result_t));
+    if (!results || rpcSendBatch(fd, 0, NULL, 0) != 0 || rpcRecvBatch(fd, &resp, results, 0) != 0 ||
+        resp.rows == 0 || resp.cols == 0) {
+        printf("[ERROR] The server did not answer the ping\n");
+        exit(-1);
+    }
+    printf("[INFO] Server table is %ux%u\n", resp.rows, resp.cols);
+
+    size_t answer_bytes = sizeof(rpc_response_t) + ARG_PARAMS.batch*sizeof(rpc_result_t);
+    size_t max_depth = rpcPipelineBytes(fd)/answer_bytes;
+    if (max_depth < 1) max_depth = 1;
+    if (ARG_PARAMS.depth > max_depth) {
+        printf("[WARN] -depth %zu does not fit the socket buffer, using %zu\n", ARG_PARAMS.depth, max_depth);
+        ARG_PARAMS.depth = max_depth;
+    }
+
+    // A RING OF PREBUILT BATCHES, GENERATING STATES IS NOT WHAT IS MEASURED
+    size_t n_batches = 64;
+    rpc_state_t* states = (rpc_state_t*)malloc(n_batches*ARG_PARAMS.batch*sizeof(rpc_state_t));
+    double*      sent   = (double*)malloc(ARG_PARAMS.depth*sizeof(double));
+    if (!states || !sent) {
+        printf("[ERROR] Out of memory\n");
+        exit(-1);
+    }
+    uint64_t rng = ARG_PARAMS.seed*2654435761ULL + 1;
+    for (size_t i = 0; i < n_batches*ARG_PARAMS.batch; i++) {
+        states[i].x = (int32_t)(xorshift64(&rng) % resp.cols);
+        states[i].y = (int32_t)(xorshift64(&rng) % resp.rows);
+    }
+
+    rpc_hist_t hist = {0};
+    size_t issued = 0, done = 0;
+    uint64_t checksum = 0;
+    double t0 = now_seconds();
+    while (done < ARG_PARAMS.requests) {
+        while (issued < ARG_PARAMS.requests && issued - done < ARG_PARAMS.depth) {
+            const rpc_state_t* b = states + (issued % n_batches)*ARG_PARAMS.batch;
+            sent[issued % ARG_PARAMS.depth] = now_seconds();
+            if (rpcSendBatch(fd, (uint32_t)issued, b, (uint32_t)ARG_PARAMS.batch) != 0) {
+                printf("[ERROR] Send failed after %zu requests\n", issued);
+                exit(-1);
+            }
+            issued++;
+        }
+        int n = rpcRecvBatch(fd, &resp, results, (uint32_t)ARG_PARAMS.batch);
+        if (n != (int)ARG_PARAMS.batch || resp.id != (uint32_t)done) {
+            printf("[ERROR] Bad answer for request %zu\n", done);
+            exit(-1);
+        }
+        rpcHistAdd(&hist, (uint64_t)((now_seconds() - sent[done % ARG_PARAMS.depth])*1e9));
+        for (int i = 0; i < n; i++) checksum += results[i].a;
+        done++;
+    }
+    double elapsed = now_seconds() - t0;
+
+    printf("\n[RESULT] requests/sec = %.0f (%zu batches of %zu in %.3fs)\n",
+           (double)done/elapsed, done, ARG_PARAMS.batch, elapsed);
+    printf("[RESULT] states/sec   = %.0f\n", (double)(done*ARG_PARAMS.batch)/elapsed);
+    rpcHistPrint(&hist, "batch latency");
+    printf("[INFO] Action checksum %llu\n", (unsigned long long)checksum);
+
+    free(states);
+    free(sent);
+    free(results);
+    rpcClose(fd);
+    return 0;
+}
+
+void parse_cmd_arguments(int argc, char** argv){
+    char**    sock     = flag_str   ("socket",   NULL,   "Unix socket agentServe listens on");
+    size_t*   batch    = flag_size  ("batch",    64,     "States per request");
+    size_t*   requests = flag_size  ("requests", 100000, "Requests to send");
+    size_t*   depth    = flag_size  ("depth",    1,      "Requests kept in flight (1 = strict request/answer)");
+    uint64_t* seed     = flag_uint64("seed",     67,     "Seed for the random states");
+    bool*     help     = flag_bool  ("help",     false,  "Print this help");
+
+    if (!flag_parse(argc, argv)) {
+        flag_print_error(stderr);
+        exit(-1);
+    }
+    if (*help || !*sock) {
+        fprintf(stderr, "Usage: %s -socket <path> [OPTIONS]\n", flag_program_name());
+        flag_print_options(stderr);
+        exit(*help ? 0 : -1);
+    }
+
+    ARG_PARAMS.socket_path = *sock;
+    ARG_PARAMS.batch       = *batch > 0 ? (*batch < RPC_MAX_BATCH ? *batch : RPC_MAX_BATCH) : 1;
+    ARG_PARAMS.requests    = *requests;
+    ARG_PARAMS.depth       = *depth > 0 ? *depth : 1;
+    ARG_PARAMS.seed        = (unsigned long)*seed;
+}
+
+void debug_arg_parameters(){
+    printf("ARG PARAMETERS:\n");
+    printf("\tsocket_path = %s\n" , ARG_PARAMS.socket_path);
+    printf("\tbatch       = %zu\n", ARG_PARAMS.batch);
+    printf("\trequests    = %zu\n", ARG_PARAMS.requests);
+    printf("\tdepth       = %zu\n", ARG_PARAMS.depth);
+}
@@ -0,0 +1,425 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <signal.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+// IMPLEMENTED BY libcqcore (src/cqcore.c)
+#include "agent.h"
+#include "mazeIR.h"
+#include "agentPolicy.h"
+#include "agentShm.h"
+#include "agentRpc.h"
+
+#define FLAG_IMPLEMENTATION
+#include "flag.h"
+
+/*
+    LOCAL Q-TABLE SERVER
+
+    LOADS A .qtable, COMPILES ITS GREEDY POLICY AND PUBLISHES BOTH INTO A
+    SHARED MEMORY SEGMENT (agentShm.h) THAT THE VIEWER, agentEval -shm AND
+    ANY OTHER LOCAL CONSUMER MAP READ ONLY.
+
+    THE FILE IS POLLED EVERY -poll_ms: WHEN ITS SIZE OR MTIME CHANGES (THE
+    TRAINER SAVED A NEW TABLE) IT IS RELOADED AND HOT SWAPPED INTO THE IDLE
+    SLOT. A FILE THAT FAILS TO LOAD (STILL BEING WRITTEN) IS RETRIED ON THE
+    NEXT POLL AND THE OLD TABLE STAYS PUBLISHED.
+
+    THE SLOTS ARE SIZED FOR A DOUBLE TABLE OF max(-max_cells, FIRST TABLE)
+    CELLS, SO LATER TABLES MAY GROW UP TO THAT WITHOUT RESTARTING READERS.
+
+    WITH -socket THE SAME PROCESS ALSO ANSWERS BATCHED ACTION QUERIES
+    (agentRpc.h) ON A UNIX SOCKET, ONE poll() LOOP FOR EVERY CLIENT. EACH
+    READ PARSES EVERY COMPLETE FRAME IN THE CLIENT BUFFER, SO PIPELINED
+    REQUESTS ARE ANSWERED BY ONE qtableMaxValActionBatch EACH AND FLUSHED
+    WITH ONE WRITE. A CLIENT WITH UNSENT ANSWERS IS NOT READ UNTIL THEY
+    DRAIN. service IS THE ARGMAX TIME OF A REQUEST, turnaround IS FROM THE
+    READ THAT COMPLETED IT TO THE WRITE THAT SENT ITS ANSWER.
+*/
+
+#define SERVE_MAX_CLIENTS 64
+
+typedef struct {
+    int      fd;
+    uint8_t* in;
+    size_t   in_len, in_cap;
+    uint8_t* out;
+    size_t   out_len, out_off, out_cap;
+    size_t   pending;          // REQUESTS IN out NOT SENT YET
+    double   read_at;          // WHEN THEIR LAST BYTES ARRIVED
+} RpcClient;
+
+typedef struct {
+    int        listen_fd;
+    char*      path;
+    RpcClient  clients[SERVE_MAX_CLIENTS];
+    size_t     n_clients;
+    rpc_hist_t service;
+    rpc_hist_t turnaround;
+    uint64_t   states;
+} RpcServer;
+
+typedef struct {
+    char*  qtable_file;
+    char*  name;
+    char*  socket_path;
+    size_t max_cells;
+    size_t poll_ms;
+} ArgParameters;
+
+static ArgParameters ARG_PARAMS = {
+    .qtable_file = NULL,
+    .name        = "default",
+    .socket_path = NULL,
+    .max_cells   = 0,
+    .poll_ms     = 500
+};
+
+static volatile sig_atomic_t g_stop = 0;
+
+void parse_cmd_arguments(int argc, char** argv);
+void debug_arg_parameters();
+
+static void on_signal(int sig){
+    (void)sig;
+    g_stop = 1;
+}
+
+static double now_seconds(void){
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec*1e-9;
+}
+
+static void sleep_ms(size_t ms){
+#ifdef _WIN32
+    Sleep((DWORD)ms);
+#else
+    usleep((useconds_t)(ms*1000));
+#endif
+}
+
+// SIZE AND MTIME, ENOUGH TO NOTICE A NEW SAVE WITHOUT READING THE FILE
+static bool file_signature(const char* path, long long* size, long long* mtime){
+    struct stat st;
+    if (stat(path, &st) != 0) return false;
+    *size  = (long long)st.st_size;
+    *mtime = (long long)st.st_mtime;
+    return true;
+}
+
+#ifndef _WIN32
+
+static bool buffer_reserve(uint8_t** buf, size_t* cap, size_t need){
+    if (need <= *cap) return true;
+    size_t n = *cap ? *cap : 4096;
+    while (n < need) n *= 2;
+    uint8_t* p = (uint8_t*)realloc(*buf, n);
+    if (!p) return false;
+    *buf = p;
+    *cap = n;
+    return true;
+}
+
+static bool rpc_listen(RpcServer* srv, char* path){
+    memset(srv, 0, sizeof(*srv));
+    srv->listen_fd = -1;
+    struct sockaddr_un addr = {0};
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) return false;
+    strcpy(addr.sun_path, path);
+    unlink(path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return false;
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, SERVE_MAX_CLIENTS) != 0) {
+        close(fd);
+        return false;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    srv->listen_fd = fd;
+    srv->path = path;
+    return true;
+}
+
+static void rpc_drop(RpcServer* srv, size_t i){
+    RpcClient* c = &srv->clients[i];
+    close(c->fd);
+    free(c->in);
+    free(c->out);
+    srv->clients[i] = srv->clients[--srv->n_clients];
+}
+
+// ANSWERS EVERY COMPLETE FRAME IN c->in, false ON A MALFORMED STREAM
+static bool rpc_answer(RpcServer* srv, RpcClient* c, Agent* agent){
+    size_t off = 0;
+    while (c->in_len - off >= sizeof(rpc_request_t)) {
+        rpc_request_t req;
+        memcpy(&req, c->in + off, sizeof(req));
+        if (req.magic != RPC_REQUEST_MAGIC || req.n_states > RPC_MAX_BATCH) return false;
+        size_t frame = sizeof(req) + (size_t)req.n_states*sizeof(rpc_state_t);
+        if (c->in_len - off < frame) break;
+
+        size_t bytes = sizeof(rpc_response_t) + (size_t)req.n_states*sizeof(rpc_result_t);
+        if (!buffer_reserve(&c->out, &c->out_cap, c->out_len + bytes)) return false;
+        rpc_response_t resp = {
+            .magic    = RPC_RESPONSE_MAGIC,
+            .id       = req.id,
+            .n_states = req.n_states,
+            .status   = RPC_STATUS_OK,
+            .rows     = (uint32_t)agent->q_table.len_state_y,
+            .cols     = (uint32_t)agent->q_table.len_state_x
+        };
+        memcpy(c->out + c->out_len, &resp, sizeof(resp));
+
+        // FRAMES ARE MULTIPLES OF 8 BYTES, BOTH ARRAYS STAY ALIGNED
+        double t0 = now_seconds();
+        ValAction* results = (ValAction*)(c->out + c->out_len + sizeof(resp));
+        qtableMaxValActionBatch(agent, (const state_t*)(c->in + off + sizeof(req)), req.n_states, results);
+#ifdef CQ_FIXED_POINT
+        // THE WIRE CARRIES float VALUES WHATEVER THE TABLE IS
+        for (uint32_t i = 0; i < req.n_states; i++) {
+            float v = qvalToFloat(results[i].v);
+            memcpy(&results[i].v, &v, sizeof(v));
+        }
+#endif
+        rpcHistAdd(&srv->service, (uint64_t)((now_seconds() - t0)*1e9));
+
+        c->out_len += bytes;
+        c->pending++;
+        srv->states += req.n_states;
+        off += frame;
+    }
+    memmove(c->in, c->in + off, c->in_len - off);
+    c->in_len -= off;
+    return true;
+}
+
+// false WHEN THE CLIENT WENT AWAY
+static bool rpc_flush(RpcServer* srv, RpcClient* c){
+    while (c->out_off < c->out_len) {
+        ssize_t w = write(c->fd, c->out + c->out_off, c->out_len - c->out_off);
+        if (w < 0 && errno == EINTR) continue;
+        if (w < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+        if (w <= 0) return false;
+        c->out_off += (size_t)w;
+    }
+    uint64_t ns = (uint64_t)((now_seconds() - c->read_at)*1e9);
+    for (size_t k = 0; k < c->pending; k++) rpcHistAdd(&srv->turnaround, ns);
+    c->pending = 0;
+    c->out_off = c->out_len = 0;
+    return true;
+}
+
+static bool rpc_read(RpcServer* srv, RpcClient* c, Agent* agent){
+    for (;;) {
+        if (!buffer_reserve(&c->in, &c->in_cap, c->in_len + 65536)) return false;
+        size_t room = c->in_cap - c->in_len;
+        ssize_t r = read(c->fd, c->in + c->in_len, room);
+        if (r < 0 && errno == EINTR) continue;
+        if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (r <= 0) return false;
+        c->in_len += (size_t)r;
+        // A SHORT READ DRAINED THE SOCKET
+        if ((size_t)r < room) break;
+    }
+    c->read_at = now_seconds();
+    return rpc_answer(srv, c, agent) && rpc_flush(srv, c);
+}
+
+// ONE poll() OF UP TO timeout_ms OVER THE LISTENER AND EVERY CLIENT
+static void rpc_serve(RpcServer* srv, Agent* agent, int timeout_ms){
+    struct pollfd fds[SERVE_MAX_CLIENTS + 1];
+    size_t n = srv->n_clients;
+    for (size_t i = 0; i < n; i++) {
+        fds[i].fd = srv->clients[i].fd;
+        fds[i].events = srv->clients[i].out_off < srv->clients[i].out_len ? POLLOUT : POLLIN;
+        fds[i].revents = 0;
+    }
+    fds[n] = (struct pollfd){ .fd = srv->listen_fd, .events = POLLIN };
+    if (poll(fds, n + 1, timeout_ms) <= 0) return;
+
+    // BACKWARDS, rpc_drop MOVES THE LAST CLIENT INTO THE HOLE
+    for (size_t i = n; i-- > 0;) {
+        RpcClient* c = &srv->clients[i];
+        bool ok = true;
+        if (fds[i].revents & (POLLERR | POLLNVAL)) ok = false;
+        else if (fds[i].revents & POLLOUT)         ok = rpc_flush(srv, c);
+        else if (fds[i].revents & (POLLIN | POLLHUP)) ok = rpc_read(srv, c, agent);
+        if (!ok) rpc_drop(srv, i);
+    }
+    if (fds[n].revents & POLLIN) {
+        int fd;
+        while ((fd = accept(srv->listen_fd, NULL, NULL)) >= 0) {
+            if (srv->n_clients == SERVE_MAX_CLIENTS) { close(fd); continue; }
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+            srv->clients[srv->n_clients++] = (RpcClient){ .fd = fd };
+        }
+    }
+}
+
+static void rpc_close(RpcServer* srv){
+    while (srv->n_clients > 0) rpc_drop(srv, srv->n_clients - 1);
+    if (srv->listen_fd >= 0) close(srv->listen_fd);
+    if (srv->path) unlink(srv->path);
+    rpcHistPrint(&srv->service,    "rpc service   ");
+    rpcHistPrint(&srv->turnaround, "rpc turnaround");
+    printf("[RESULT] rpc states answered = %llu\n", (unsigned long long)srv->states);
+}
+
+#endif
+
+// LOADS AND COMPILES path INTO agent/policy, false LEAVES BOTH UNTOUCHED
+static bool load_table(const char* path, Agent* agent, compiled_policy_t* policy){
+    Agent tmp = {0};
+    if (agentReadQtable(&tmp, path) != 0) return false;
+    compiled_policy_t p;
+    if (tmp.q_table.len_state_actions != ACTION_N_ACTIONS || policyCompile(&p, &tmp) != 0) {
+        free(tmp.q_table.vals);
+        return false;
+    }
+    free(agent->q_table.vals);
+    agent->q_table = tmp.q_table;
+    policyFree(policy);
+    *policy = p;
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    parse_cmd_arguments(argc, argv);
+    debug_arg_parameters();
+
+    Agent agent = {0};
+    compiled_policy_t policy = {0};
+    long long size = 0, mtime = 0;
+    if (!file_signature(ARG_PARAMS.qtable_file, &size, &mtime) ||
+        !load_table(ARG_PARAMS.qtable_file, &agent, &policy)) {
+        printf("[ERROR] Invalid Qtable File: %s\n", ARG_PARAMS.qtable_file);
+        exit(-1);
+    }
+
+    size_t cells = agent.q_table.len_state_x*agent.q_table.len_state_y;
+    if (ARG_PARAMS.max_cells > cells) cells = ARG_PARAMS.max_cells;
+    size_t slot_bytes = shmSlotBytes(1, cells, ACTION_N_ACTIONS, 2);
+
+    qtable_shm_t shm;
+    if (shmCreate(&shm, ARG_PARAMS.name, slot_bytes) != 0) exit(-1);
+    if (shmPublish(&shm, &agent.q_table, &policy) != 0) {
+        shmClose(&shm);
+        exit(-1);
+    }
+    printf("[INFO] Serving %s as %s: %zux%zu, %zu table(s), slots of %zu bytes\n",
+           ARG_PARAMS.qtable_file, shm.name, agent.q_table.len_state_y, agent.q_table.len_state_x,
+           qtableCount(&agent.q_table), slot_bytes);
+
+#ifndef _WIN32
+    RpcServer srv = { .listen_fd = -1 };
+    if (ARG_PARAMS.socket_path) {
+        if (!rpc_listen(&srv, ARG_PARAMS.socket_path)) {
+            printf("[ERROR] Could not listen on %s\n", ARG_PARAMS.socket_path);
+            shmClose(&shm);
+            exit(-1);
+        }
+        signal(SIGPIPE, SIG_IGN);
+        printf("[INFO] Answering action queries on %s\n", ARG_PARAMS.socket_path);
+    }
+#else
+    if (ARG_PARAMS.socket_path) printf("[WARN] -socket needs a POSIX system, ignored\n");
+#endif
+    fflush(stdout);
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    double next_check = now_seconds() + ARG_PARAMS.poll_ms*1e-3;
+    while (!g_stop) {
+        double left = next_check - now_seconds();
+        if (left > 0.0) {
+#ifndef _WIN32
+            if (srv.listen_fd >= 0) {
+                rpc_serve(&srv, &agent, (int)(left*1e3) + 1);
+                continue;
+            }
+#endif
+            sleep_ms((size_t)(left*1e3) + 1);
+            continue;
+        }
+        next_check = now_seconds() + ARG_PARAMS.poll_ms*1e-3;
+
+        long long s, m;
+        if (!file_signature(ARG_PARAMS.qtable_file, &s, &m) || (s == size && m == mtime)) continue;
+
+        double t0 = now_seconds();
+        if (!load_table(ARG_PARAMS.qtable_file, &agent, &policy)) continue;
+        if (shmPublish(&shm, &agent.q_table, &policy) != 0) {
+            // TOO BIG FOR THE SLOTS, READERS KEEP THE LAST TABLE
+            size = s;
+            mtime = m;
+            continue;
+        }
+        size = s;
+        mtime = m;
+        printf("[INFO] Published generation %llu (%zux%zu) in %.3fs\n",
+               (unsigned long long)atomic_load(&shm.header->generation),
+               agent.q_table.len_state_y, agent.q_table.len_state_x, now_seconds() - t0);
+        fflush(stdout);
+    }
+
+    printf("[INFO] Shutting down %s\n", shm.name);
+#ifndef _WIN32
+    if (srv.listen_fd >= 0) rpc_close(&srv);
+#endif
+    shmClose(&shm);
+    policyFree(&policy);
+    free(agent.q_table.vals);
+    return 0;
+}
+
+void parse_cmd_arguments(int argc, char** argv){
+    char**  qtable    = flag_str ("qtable",    NULL,      "Path to the .qtable to serve");
+    char**  name      = flag_str ("name",      "default", "Segment name, readers open the same name");
+    char**  sock      = flag_str ("socket",    NULL,      "Also answer batched action queries on this Unix socket");
+    size_t* max_cells = flag_size("max_cells", 0,         "Reserve slots for tables up to this many cells (0 = the first table)");
+    size_t* poll_ms   = flag_size("poll_ms",   500,       "How often the .qtable is checked for a new save");
+    bool*   help      = flag_bool("help",      false,     "Print this help");
+
+    if (!flag_parse(argc, argv)) {
+        flag_print_error(stderr);
+        exit(-1);
+    }
+    if (*help || !*qtable) {
+        fprintf(stderr, "Usage: %s -qtable <qtable> [OPTIONS]\n", flag_program_name());
+        flag_print_options(stderr);
+        exit(*help ? 0 : -1);
+    }
+
+    ARG_PARAMS.qtable_file = *qtable;
+    ARG_PARAMS.name        = *name;
+    ARG_PARAMS.socket_path = *sock;
+    ARG_PARAMS.max_cells   = *max_cells;
+    ARG_PARAMS.poll_ms     = *poll_ms > 0 ? *poll_ms : 1;
+}
+
+void debug_arg_parameters(){
+    printf("ARG PARAMETERS:\n");
+    printf("\tqtable_file = %s\n" , ARG_PARAMS.qtable_file);
+    printf("\tname        = %s\n" , ARG_PARAMS.name);
+    printf("\tsocket_path = %s\n" , ARG_PARAMS.socket_path ? ARG_PARAMS.socket_path : "(null)");
+    printf("\tmax_cells   = %zu\n", ARG_PARAMS.max_cells);
+    printf("\tpoll_ms     = %zu\n", ARG_PARAMS.poll_ms);
+}
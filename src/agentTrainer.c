@@ -4,11 +4,27 @@
 #include <time.h>
 #include <math.h>
 
-#define AGENT_IMPLEMENTATION
+// IMPLEMENTED BY libcqcore (src/cqcore.c)
 #include "agent.h"
-
-#define MAZE_IR_IMPLEMENTATION
 #include "mazeIR.h"
+#include "agentDyna.h"
+#include "agentSweep.h"
+#include "agentReplay.h"
+#include "mazePaths.h"
+#include "agentCurriculum.h"
+#include "agentCache.h"
+#include "agentLog.h"
+#include "agentPBT.h"
+#include "agentArena.h"
+#include "agentRegion.h"
+
+#define AGENT_INSTRUMENT_IMPLEMENTATION
+#include "agentInstrument.h"
+#undef AGENT_INSTRUMENT_IMPLEMENTATION
+
+#define AGENT_TRACE_IMPLEMENTATION
+#include "agentTrace.h"
+#undef AGENT_TRACE_IMPLEMENTATION
 
 #include "argparse.h"
 
@@ -30,6 +46,8 @@ typedef struct
     // OPTIONAL PARAMETERS
     char*  qtable_save_path;
     char*  metrics_save_path; 
+    char*  cache_dir;
+    size_t cache_max_mb;
     float  learning_rate  ;
     float  discount_factor;
     float  epsilon_decay  ;
@@ -38,12 +56,36 @@ typedef struct
     unsigned long seed;
     bool   distance_reward_shaping;
     bool   block_transpassing_walls;
+    size_t dyna_planning_steps;
+    size_t sweep_max_updates;
+    float  sweep_theta;
+    size_t replay_capacity;
+    size_t replay_batch;
+    bool   replay_prioritized;
+    bool   double_q;
+    bool   curriculum;
+    size_t curriculum_band;
+    size_t curriculum_window;
+    float  curriculum_success_rate;
+    size_t pbt_population;
+    size_t pbt_threads;
+    size_t pbt_interval;
+    float  pbt_perturb;
+    char*  mem_pages;
+    char*  mem_numa;
+    bool   mem_report;
+    char*  qtable_layout;
+    size_t region_threads;
+    size_t region_walkers;
+    bool   region_random_starts;
 } ArgParameters;
 
 static ArgParameters ARG_PARAMS = {
     .maze_file               = NULL,
     .qtable_save_path        = NULL,
     .metrics_save_path       = NULL,
+    .cache_dir               = NULL,
+    .cache_max_mb            = 1024,
     .learning_rate           = 5e-4,
     .discount_factor         = 0.99,
     .epsilon_decay           = 37001.0,
@@ -51,10 +93,37 @@ static ArgParameters ARG_PARAMS = {
     .max_steps               = 856,
     .seed                    = 67,
     .distance_reward_shaping = false,
-    .block_transpassing_walls = true 
+    .block_transpassing_walls = true,
+    .dyna_planning_steps     = 0,
+    .sweep_max_updates       = 0,
+    .sweep_theta             = 1e-4,
+    .replay_capacity         = 0,
+    .replay_batch            = 32,
+    .replay_prioritized      = false,
+    .double_q                = false,
+    .curriculum              = false,
+    .curriculum_band         = 8,
+    .curriculum_window       = 20,
+    .curriculum_success_rate = 80.0,
+    .pbt_population          = 0,
+    .pbt_threads             = 0,
+    .pbt_interval            = PBT_DEFAULT_INTERVAL,
+    .pbt_perturb             = PBT_DEFAULT_PERTURB,
+    .mem_pages               = NULL,
+    .mem_numa                = NULL,
+    .mem_report              = false,
+    .qtable_layout           = NULL,
+    .region_threads          = 0,
+    .region_walkers          = 0,
+    .region_random_starts    = false
 };
 
-inline float manhatan_distance(state_t s1, state_t s2) {
+// WHERE THE Q-TABLES LIVE, FROM --mem_pages AND --mem_numa
+static arena_policy_t MEM_POLICY = {ARENA_PAGES_THP, ARENA_NUMA_LOCAL};
+// SLOT ORDER OF THE TABLES IN MEMORY, THE SAVED .qtable IS ROW MAJOR ANYWAY
+static qtable_layout_t QTABLE_LAYOUT = QTABLE_LAYOUT_ROW;
+
+static inline float manhatan_distance(state_t s1, state_t s2) {
 	return abs(s1.x - s2.x) + abs(s1.y - s2.y);
 }
 
@@ -71,32 +140,126 @@ float huber_loss(float x)
 
 void debug_arg_parameters();
 void parse_cmd_arguments(int argc ,char** argv);
-TrainMetrics* alloc_train_metrics(size_t num_episodes);
+TrainMetrics* alloc_train_metrics(arena_t* arena, size_t num_episodes);
 void save_metrics_csv(const char* path, const TrainMetrics* m);
+uint64_t train_cache_key(const MazeEnv* ir);
+char* train_log_line(char* p, const log_record_t* r);
+void train_pbt(MazeEnv* ir, Agent* agent, size_t wallsCount, size_t opensCount);
+void train_regions(MazeEnv* ir, Agent* agent, arena_t* run_arena, size_t wallsCount, size_t opensCount);
+void report_table_placement(const char* label, const arena_t* arena, const void* vals, size_t bytes);
 
-const int ROLLING_WINDOW_SIZE = 20;
+#define ROLLING_WINDOW_SIZE 20
 const int LOG_EVERY_EPISODES = 10;
+const double CONVERGED_SUCCESS_RATE = 80.0;
+const double INST_REPORT_EVERY_SECS = 5.0;
 
 int main(int argc ,char** argv)
 {
     parse_cmd_arguments(argc,argv);
     debug_arg_parameters();
+    if (ARG_PARAMS.mem_pages && arenaParsePages(ARG_PARAMS.mem_pages, &MEM_POLICY.pages) != 0) {
+        printf("[ERROR] --mem_pages takes thp, small or hugetlb, not %s\n", ARG_PARAMS.mem_pages);
+        exit(-1);
+    }
+    if (ARG_PARAMS.mem_numa && arenaParseNuma(ARG_PARAMS.mem_numa, &MEM_POLICY.numa) != 0) {
+        printf("[ERROR] --mem_numa takes local, interleave or firsttouch, not %s\n", ARG_PARAMS.mem_numa);
+        exit(-1);
+    }
+    if (ARG_PARAMS.qtable_layout && qtableParseLayout(ARG_PARAMS.qtable_layout, &QTABLE_LAYOUT) != 0) {
+        printf("[ERROR] --qtable_layout takes row, tiled or morton, not %s\n", ARG_PARAMS.qtable_layout);
+        exit(-1);
+    }
+    TRACE_INIT("agentTrain.trace.json");
+    TRACE_THREAD_NAME("train");
 
     MazeEnv ir = {0};
     if (ARG_PARAMS.maze_file) {
+        TRACE_BEGIN(load);
         if (readMazeNumpy(ARG_PARAMS.maze_file,&ir) == -1 &&
             readMazeRaw(ARG_PARAMS.maze_file,&ir)   == -1) {
             printf("[ERROR] Invalid Maze File: %s\n", ARG_PARAMS.maze_file);
             exit(-1);
         }
+        TRACE_END(load, "load maze", "io", ir.rows*ir.cols);
     }
 
-    TrainMetrics* metrics = alloc_train_metrics(ARG_PARAMS.num_episodes);
-    Agent* agent = newAgent(&ir,
-                            1.0f - ARG_PARAMS.learning_rate,
-                            ARG_PARAMS.discount_factor,
-                            ARG_PARAMS.epsilon_decay,
-                            ARG_PARAMS.seed);
+    // SAME MAZE + PARAMETERS + SEED + ENGINE ALREADY TRAINED: HAND BACK THE STORED ARTIFACTS
+    static const char* cache_exts[] = {"qtable", "csv"};
+    result_cache_t cache = {0};
+    uint64_t cache_key = 0;
+    bool use_cache = ARG_PARAMS.cache_dir != NULL;
+    bool use_pbt   = ARG_PARAMS.pbt_population > 0;
+    bool use_regions = ARG_PARAMS.region_threads > 0;
+    if (use_regions && (use_pbt || ARG_PARAMS.double_q || ARG_PARAMS.dyna_planning_steps > 0 ||
+                        ARG_PARAMS.sweep_max_updates > 0 || ARG_PARAMS.replay_capacity > 0 || ARG_PARAMS.curriculum)) {
+        printf("[ERROR] --region_threads trains plain Q-learning, drop --pbt_population, --double_q, --dyna_k, "
+               "--sweep_n, --replay_capacity and --curriculum\n");
+        exit(-1);
+    }
+    if (use_pbt && (ARG_PARAMS.double_q || ARG_PARAMS.dyna_planning_steps > 0 || ARG_PARAMS.sweep_max_updates > 0 ||
+                    ARG_PARAMS.replay_capacity > 0 || ARG_PARAMS.curriculum)) {
+        printf("[ERROR] --pbt_population trains plain Q-learning, drop --double_q, --dyna_k, --sweep_n, "
+               "--replay_capacity and --curriculum\n");
+        exit(-1);
+    }
+    if (use_pbt && use_cache) {
+        printf("[WARN] --cache_dir is ignored with --pbt_population\n");
+        use_cache = false;
+    }
+    if (use_regions && use_cache) {
+        printf("[WARN] --cache_dir is ignored with --region_threads, the runs are not repeatable\n");
+        use_cache = false;
+    }
+    if (use_cache) {
+        if (cacheOpen(&cache, ARG_PARAMS.cache_dir, (uint64_t)ARG_PARAMS.cache_max_mb << 20) != 0) {
+            printf("[ERROR] Could not open the cache directory: %s\n", ARG_PARAMS.cache_dir);
+            exit(-1);
+        }
+        cache_key = train_cache_key(&ir);
+        if (cacheLookup(&cache, cache_key, cache_exts, 2)) {
+            printf("[INFO] Cache hit %016llx, skipping training\n", (unsigned long long)cache_key);
+            if (ARG_PARAMS.qtable_save_path && cacheFetch(&cache, cache_key, "qtable", ARG_PARAMS.qtable_save_path) != 0) {
+                printf("[ERROR] Could not copy the cached qtable to %s\n", ARG_PARAMS.qtable_save_path);
+                exit(-1);
+            }
+            if (ARG_PARAMS.metrics_save_path && cacheFetch(&cache, cache_key, "csv", ARG_PARAMS.metrics_save_path) != 0) {
+                printf("[ERROR] Could not copy the cached metrics to %s\n", ARG_PARAMS.metrics_save_path);
+                exit(-1);
+            }
+            cacheClose(&cache);
+            TRACE_SHUTDOWN();
+            return 0;
+        }
+        printf("[INFO] Cache miss %016llx\n", (unsigned long long)cache_key);
+    }
+
+    // THE METRICS, THE AGENT AND ITS TABLE IN ONE MAPPING, LIVE UNTIL EXIT. DOUBLE Q
+    // COPIES THE TABLE INTO AN A/B PAIR FROM THE SAME MAPPING, THE SINGLE ONE STAYS UNUSED
+    arena_t run_arena;
+    size_t n_eps = ARG_PARAMS.num_episodes;
+    size_t table_bytes = qtableSlots(ir.cols, ir.rows, QTABLE_LAYOUT)*ACTION_N_ACTIONS*sizeof(q_val_t);
+    size_t run_bytes = sizeof(TrainMetrics) + sizeof(Agent)
+                     + n_eps*(sizeof(bool) + sizeof(reward_t) + 3*sizeof(size_t) + 2*sizeof(double))
+                     + (ARG_PARAMS.double_q ? 3 : 1)*table_bytes + 10*ARENA_ALIGN;
+    if (arenaInitPolicy(&run_arena, run_bytes, &MEM_POLICY) != 0) {
+        printf("[ERROR] Could not map %zu bytes for the training run\n", run_bytes);
+        exit(-1);
+    }
+    TrainMetrics* metrics = alloc_train_metrics(&run_arena, n_eps);
+    Agent* agent = arenaNewAgent(&run_arena, &ir,
+                                 1.0f - ARG_PARAMS.learning_rate,
+                                 ARG_PARAMS.discount_factor,
+                                 ARG_PARAMS.epsilon_decay,
+                                 ARG_PARAMS.seed,
+                                 QTABLE_LAYOUT);
+    if (!metrics || !agent) {
+        printf("[ERROR] Could not allocate the %s\n", !metrics ? "training metrics" : "agent");
+        exit(-1);
+    }
+    if (ARG_PARAMS.double_q && arenaEnableDoubleQ(&run_arena, agent) != 0) {
+        printf("[ERROR] Could not allocate the Double Q-learning tables\n");
+        exit(-1);
+    }
 
     state_t goal_state = {0,0};
     cellId c = getFirstMatchingCell(&ir, GRID_AGENT_GOAL);
@@ -111,11 +274,74 @@ int main(int argc ,char** argv)
            (unsigned)agent->agent_start.x,
            (unsigned)agent->agent_start.y);
 
+    if (use_pbt) {
+        train_pbt(&ir, agent, wallsCount, opensCount);
+        goto greedy_rollout;
+    }
+    if (use_regions) {
+        train_regions(&ir, agent, &run_arena, wallsCount, opensCount);
+        goto greedy_rollout;
+    }
+
+    dyna_model_t dyna = {0};
+    bool use_dyna = ARG_PARAMS.dyna_planning_steps > 0;
+    if (use_dyna && dynaModelInit(&dyna, &ir, ARG_PARAMS.dyna_planning_steps) != 0) {
+        printf("[ERROR] Could not allocate the Dyna-Q model\n");
+        exit(-1);
+    }
+
+    sweep_planner_t sweep = {0};
+    bool use_sweep = ARG_PARAMS.sweep_max_updates > 0;
+    if (use_sweep && sweepPlannerInit(&sweep, &ir, ARG_PARAMS.block_transpassing_walls,
+                                      ARG_PARAMS.sweep_max_updates, ARG_PARAMS.sweep_theta) != 0) {
+        printf("[ERROR] Could not allocate the prioritized sweeping planner\n");
+        exit(-1);
+    }
+
+    replay_buffer_t replay = {0};
+    bool use_replay = ARG_PARAMS.replay_capacity > 0 && ARG_PARAMS.replay_batch > 0;
+    if (use_replay && replayBufferInit(&replay, &ir, ARG_PARAMS.replay_capacity,
+                                       ARG_PARAMS.replay_prioritized) != 0) {
+        printf("[ERROR] Could not allocate the replay buffer\n");
+        exit(-1);
+    }
+
+    curriculum_t curriculum = {0};
+    bool use_curriculum = ARG_PARAMS.curriculum;
+    int  curriculum_done_episode = 0;
+    if (use_curriculum) {
+        if (curriculumInit(&curriculum, &ir, agent->agent_start, (uint32_t)ARG_PARAMS.curriculum_band,
+                           ARG_PARAMS.curriculum_window, ARG_PARAMS.curriculum_success_rate / 100.0f) != 0) {
+            printf("[ERROR] Could not build the reverse curriculum\n");
+            exit(-1);
+        }
+        agentSetStartFn(agent, curriculumStartState, &curriculum);
+        printf("[INFO] Curriculum: start at distance %u of %u, first band [%u,%u]\n",
+               curriculum.start_dist, curriculum.max_dist, curriculum.band_lo, curriculum.band_hi);
+    }
+
     unsigned int goals_count = 0;
     unsigned int total_training_steps = 0;
+    size_t total_updates = 0;
+    int    converged_episode = -1;
+    size_t converged_steps   = 0;
+    size_t converged_updates = 0;
+    double converged_secs    = 0.0;
+    clock_t train_clock_start = clock();
+    inst_t inst;
+    INST_INIT(&inst);
+
+    // CSV ROWS AND EPISODE LINES ARE FORMATTED AND WRITTEN OFF THE TRAINING THREAD
+    log_writer_t log_writer;
+    if (logWriterOpen(&log_writer, ARG_PARAMS.metrics_save_path, stdout, train_log_line, 0) != 0) {
+        printf("[ERROR] Could not open metrics file: %s\n",
+               ARG_PARAMS.metrics_save_path ? ARG_PARAMS.metrics_save_path : "(null)");
+        exit(-1);
+    }
 
     for (int episode = 0; episode < ARG_PARAMS.num_episodes; episode++) {
 
+        TRACE_BEGIN_SAMPLED(episode, (uint64_t)episode);
         agentRestart(agent);
 
         size_t steps_taken_episode = 0;
@@ -125,8 +351,9 @@ int main(int argc ,char** argv)
 
         for (int step = 0; step < ARG_PARAMS.max_steps; step++) {
 
-            agentPolicy(agent, &ir);
+            INST_TIME(&inst, INST_POLICY) agentPolicy(agent, &ir);
 
+            INST_BEGIN(step);
             state_t next = GetNextState(agent->current_s, agent->policy_action);
             stepResult sr = stepIntoStateUnscaled(&ir, next, wallsCount, opensCount);
 
@@ -141,9 +368,32 @@ int main(int argc ,char** argv)
                 float phi_sp = (float)manhatan_distance(trans_state, goal_state);
                 sr.reward += ARG_PARAMS.discount_factor * (phi_s - phi_sp);
             }
+            INST_END(&inst, INST_STEP, step);
 
+            INST_BEGIN(update);
             float td_error = agentQtableUpdate(agent, trans_state, sr);
             model_loss += huber_loss(td_error);
+            total_updates++;
+            INST_END(&inst, INST_UPDATE, update);
+
+            INST_BEGIN(planning);
+            if (use_dyna) {
+                dynaModelRecord(&dyna, agent->current_s, agent->policy_action, trans_state, sr);
+                total_updates += dynaPlan(&dyna, agent);
+            }
+            if (use_sweep) {
+                total_updates += sweepPlannerStep(&sweep, agent, agent->current_s,
+                                                  agent->policy_action, trans_state, sr);
+            }
+            if (use_replay) {
+                replayPush(&replay, agent->current_s, agent->policy_action, trans_state, sr);
+                if (replay.count >= ARG_PARAMS.replay_batch) {
+                    size_t before = replay.total_updates;
+                    replayTrainBatch(&replay, agent, ARG_PARAMS.replay_batch);
+                    total_updates += replay.total_updates - before;
+                }
+            }
+            INST_END(&inst, INST_PLANNING, planning);
 
             total_episode_reward += sr.reward;
             steps_taken_episode++;
@@ -160,23 +410,19 @@ int main(int argc ,char** argv)
         }
 
         total_training_steps += steps_taken_episode;
-
-        /* -------- epsilon update (safe) -------- */
-        const double eps_final = 0.1;
-        const double eps_start = 1.0;
-        double decay = ARG_PARAMS.epsilon_decay > 0.0
-                       ? ARG_PARAMS.epsilon_decay
-                       : 1.0;
-
-        double eps = eps_final +
-                     (eps_start - eps_final) *
-                     exp(-(double)total_training_steps / decay);
-
-        if (!isfinite(eps)) eps = eps_final;
-        if (eps < eps_final) eps = eps_final;
-        if (eps > 1.0) eps = 1.0;
-
-        agent->epsilon = (float)eps;
+        INST_EPISODE(&inst, steps_taken_episode);
+        INST_BEGIN(metrics);
+
+        /* -------- epsilon update -------- */
+        agent->epsilon = agentEpsilonSchedule(total_training_steps, ARG_PARAMS.epsilon_decay);
+
+        /* -------- curriculum stage -------- */
+        if (use_curriculum && curriculumRecordEpisode(&curriculum, goal_reached)) {
+            printf("[INFO] Curriculum stage %zu at episode %d: band [%u,%u]%s\n",
+                   curriculum.stage, episode, curriculum.band_lo, curriculum.band_hi,
+                   curriculum.done ? ", back to agent_start" : "");
+            if (curriculum.done) curriculum_done_episode = episode + 1;
+        }
 
         /* -------- success rate (rolling window) -------- */
         metrics->goal_reached[episode] = goal_reached;
@@ -193,42 +439,115 @@ int main(int argc ,char** argv)
         double success_rate = 100.0 * (double)window_goals / (double)window_len;
         metrics->succes_rate[episode] = success_rate;
 
+        // CURRICULUM EPISODES START CLOSER TO THE GOAL, ONLY A FULL WINDOW FROM agent_start COUNTS
+        bool window_from_start = !use_curriculum ||
+            (curriculum.done && episode - curriculum_done_episode + 1 >= ROLLING_WINDOW_SIZE);
+
+        if (converged_episode < 0 && window_len == ROLLING_WINDOW_SIZE && window_from_start &&
+            success_rate >= CONVERGED_SUCCESS_RATE) {
+            converged_episode = episode;
+            converged_steps   = total_training_steps;
+            converged_updates = total_updates;
+            converged_secs    = (double)(clock() - train_clock_start) / CLOCKS_PER_SEC;
+        }
+
         /* -------- store metrics -------- */
         metrics->rewards_acumm[episode]      = total_episode_reward;
         metrics->cummulative_goals[episode]  = goals_count;
         metrics->training_loss[episode]      = model_loss;
         metrics->episode_step_count[episode] = steps_taken_episode;
+        INST_END(&inst, INST_METRICS, metrics);
 
         /* -------- logging -------- */
+        INST_BEGIN(logging);
+        log_record_t record = {
+            .kind         = LOG_RECORD_METRICS,
+            .goal_reached = goal_reached,
+            .episode      = (uint64_t)episode,
+            .steps        = steps_taken_episode,
+            .cum_goals    = goals_count,
+            .reward       = total_episode_reward,
+            .epsilon      = agent->epsilon,
+            .success_rate = success_rate,
+            .loss         = model_loss
+        };
+        logWriterPush(&log_writer, &record);
         if (episode % LOG_EVERY_EPISODES == 0 ||
             episode == ARG_PARAMS.num_episodes - 1) {
-
-            printf(
-                "[EP %4d] steps=%4zu | reward=%9.3f | loss=%9.3e | "
-                "eps=%5.3f | goal=%d | SR=%6.2f%%\n",
-                episode,
-                steps_taken_episode,
-                total_episode_reward,
-                model_loss,
-                agent->epsilon,
-                goal_reached,
-                success_rate
-            );
+            record.kind = LOG_RECORD_LINE;
+            logWriterPush(&log_writer, &record);
         }
+        INST_END(&inst, INST_LOGGING, logging);
+        INST_PERIODIC(&inst, INST_REPORT_EVERY_SECS, stdout);
+        TRACE_END(episode, "episode", "train", steps_taken_episode);
     }
 
-    
+    double train_secs = (double)(clock() - train_clock_start) / CLOCKS_PER_SEC;
+
+    int log_rc;
+    TRACE_SPAN("flush log writer", "io") log_rc = logWriterClose(&log_writer);
+    if (log_rc != 0) {
+        printf("[ERROR] Could not write every metrics row to %s\n",
+               ARG_PARAMS.metrics_save_path ? ARG_PARAMS.metrics_save_path : "(null)");
+    } else if (ARG_PARAMS.metrics_save_path) {
+        printf("[INFO] Metrics saved to %s\n", ARG_PARAMS.metrics_save_path);
+    }
+    if (log_writer.dropped_lines > 0 || log_writer.stalls > 0) {
+        printf("[WARN] Log writer: %llu console lines dropped, %llu waits for a full queue\n",
+               (unsigned long long)log_writer.dropped_lines, (unsigned long long)log_writer.stalls);
+    }
+    printf("\n[INFO] Training took %.3fs for %u environment steps\n", train_secs, total_training_steps);
+    printf("[INFO] Q-table updates: %zu (%.0f updates/s)\n",
+           total_updates, train_secs > 0.0 ? (double)total_updates / train_secs : 0.0);
+    if (converged_episode >= 0) {
+        printf("[INFO] SR >= %.0f%% first reached at episode %d after %zu environment steps, "
+               "%zu updates (%.3fs)\n",
+               CONVERGED_SUCCESS_RATE, converged_episode, converged_steps, converged_updates, converged_secs);
+    } else {
+        printf("[INFO] SR never reached %.0f%%\n", CONVERGED_SUCCESS_RATE);
+    }
+    if (use_dyna) {
+        printf("[INFO] Dyna-Q: k=%zu, %zu planning updates over %zu modeled pairs\n",
+               dyna.planning_steps, dyna.total_updates, dyna.n_visited);
+        dynaModelFree(&dyna);
+    }
+    if (use_sweep) {
+        printf("[INFO] Prioritized sweeping: n=%zu theta=%g, %zu planning updates, %zu still queued\n",
+               sweep.max_updates, (double)qvalToFloat(sweep.theta), sweep.total_updates, sweep.queue.count);
+        sweepPlannerFree(&sweep);
+    }
+    if (use_replay) {
+        printf("[INFO] Replay: capacity=%zu batch=%zu%s, %zu replayed updates, %zu stored transitions\n",
+               replay.capacity, ARG_PARAMS.replay_batch, replay.tree ? " prioritized" : "",
+               replay.total_updates, replay.count);
+        replayBufferFree(&replay);
+    }
+    if (use_curriculum) {
+        printf("[INFO] Curriculum: %zu stages, %s\n", curriculum.stage,
+               curriculum.done ? "finished at agent_start" : "not finished");
+        agentSetStartFn(agent, NULL, NULL);
+        curriculumFree(&curriculum);
+    }
+    INST_REPORT(&inst, stdout);
+    if (ARG_PARAMS.mem_report) {
+        report_table_placement("qtable", &run_arena, agent->q_table.vals, qtableValCount(&agent->q_table)*sizeof(q_val_t));
+    }
 
     /* ================== GREEDY EVALUATION RUN ================== */
+greedy_rollout:
 
     printf("\n[INFO] Starting greedy rollout (epsilon = 0)\n");
+    TRACE_BEGIN(rollout);
 
     agent->epsilon = 0.0f;
     agentRestart(agent);
 
-    /* visited map for loop detection */
-    bool visited[ir.rows][ir.cols];
-    memset(visited, 0, sizeof(visited));
+    /* visited bitset for loop detection, one bit per cell on the heap */
+    uint64_t* visited = (uint64_t*)calloc((ir.rows*ir.cols + 63)/64, sizeof(uint64_t));
+    if (!visited) {
+        printf("[ERROR] Could not allocate the rollout visited map\n");
+        exit(-1);
+    }
 
     printf("PATH:\n");
 
@@ -239,11 +558,12 @@ int main(int argc ,char** argv)
         printf("(%d,%d)\n", s.x, s.y);
 
         /* loop detection */
-        if (visited[s.y][s.x]) {
+        size_t cell = (size_t)s.y*ir.cols + (size_t)s.x;
+        if (visited[cell >> 6] & ((uint64_t)1 << (cell & 63))) {
             printf("[STOP] Loop detected at (%d,%d)\n", s.x, s.y);
             break;
         }
-        visited[s.y][s.x] = true;
+        visited[cell >> 6] |= (uint64_t)1 << (cell & 63);
 
         agentPolicy(agent, &ir);
 
@@ -273,29 +593,45 @@ int main(int argc ,char** argv)
             printf("[STOP] Max steps reached\n");
         }
     }
-    
+    free(visited);
+    TRACE_END(rollout, "greedy rollout", "eval", 0);
+
     // SAVING AGENT QTABLE
     if(ARG_PARAMS.qtable_save_path){
-        agentSaveQtable(agent,ARG_PARAMS.qtable_save_path);
+        TRACE_SPAN("checkpoint qtable", "io") agentSaveQtable(agent,ARG_PARAMS.qtable_save_path);
     }
 
-    if(ARG_PARAMS.metrics_save_path) {
-        save_metrics_csv(ARG_PARAMS.metrics_save_path, metrics);
+    if (use_cache) {
+        char path[1024];
+        if (agentSaveQtable(agent, cachePath(&cache, cache_key, "qtable", path, sizeof(path))) != 0) {
+            printf("[WARN] Could not store the qtable in the cache\n");
+        } else {
+            save_metrics_csv(cachePath(&cache, cache_key, "csv", path, sizeof(path)), metrics);
+            if (cacheCommit(&cache, cache_key, cache_exts, 2) == 0)
+                printf("[INFO] Cache stored %016llx\n", (unsigned long long)cache_key);
+        }
+        cacheClose(&cache);
     }
+    TRACE_SHUTDOWN();
 
 
 }
 
 
-TrainMetrics* alloc_train_metrics(size_t num_episodes){
-    TrainMetrics* train_metrics = (TrainMetrics*)calloc(1,sizeof(TrainMetrics));
+TrainMetrics* alloc_train_metrics(arena_t* arena, size_t num_episodes){
+    TrainMetrics* train_metrics = (TrainMetrics*)arenaCalloc(arena,1,sizeof(TrainMetrics));
+    if (!train_metrics) return NULL;
     train_metrics->num_of_episodes = num_episodes;
-    train_metrics->goal_reached = (bool*)calloc(num_episodes,sizeof(bool));
-    train_metrics->rewards_acumm = (reward_t*)calloc(num_episodes,sizeof(reward_t));
-    train_metrics->cummulative_goals =  (size_t*)calloc(num_episodes,sizeof(size_t));
-    train_metrics->succes_rate =  (double*)calloc(num_episodes,sizeof(double));
-    train_metrics->training_loss =  (double*)calloc(num_episodes,sizeof(double));
-    train_metrics->episode_step_count =  (size_t*)calloc(num_episodes,sizeof(size_t));
+    train_metrics->goal_reached = (bool*)arenaCalloc(arena,num_episodes,sizeof(bool));
+    train_metrics->rewards_acumm = (reward_t*)arenaCalloc(arena,num_episodes,sizeof(reward_t));
+    train_metrics->cummulative_goals =  (size_t*)arenaCalloc(arena,num_episodes,sizeof(size_t));
+    train_metrics->succes_rate =  (double*)arenaCalloc(arena,num_episodes,sizeof(double));
+    train_metrics->training_loss =  (double*)arenaCalloc(arena,num_episodes,sizeof(double));
+    train_metrics->episode_step_count =  (size_t*)arenaCalloc(arena,num_episodes,sizeof(size_t));
+    if (!train_metrics->goal_reached || !train_metrics->rewards_acumm || !train_metrics->cummulative_goals ||
+        !train_metrics->succes_rate || !train_metrics->training_loss || !train_metrics->episode_step_count) {
+        return NULL;
+    }
     return train_metrics;
 }
 
@@ -327,6 +663,72 @@ void parse_cmd_arguments(int argc ,char** argv){
     argparse_arg_t arg_block_transpassing = ARGPARSE_FLAG_FALSE(
         NO_FLAG, "--enable_transpasing", &ARG_PARAMS.block_transpassing_walls, "Agent training enables walls transpassing"
     );
+    argparse_arg_t arg_dyna_k       = ARGPARSE_OPTION(
+        INT, 'k', "--dyna_k", &ARG_PARAMS.dyna_planning_steps, "Dyna-Q planning updates per real step (0 disables)"
+    );
+    argparse_arg_t arg_sweep_n      = ARGPARSE_OPTION(
+        INT, NO_FLAG, "--sweep_n", &ARG_PARAMS.sweep_max_updates, "Prioritized sweeping backups per real step (0 disables)"
+    );
+    argparse_arg_t arg_sweep_theta  = ARGPARSE_OPTION(
+        FLOAT, NO_FLAG, "--sweep_theta", &ARG_PARAMS.sweep_theta, "Prioritized sweeping minimum |TD error| to queue a pair"
+    );
+    argparse_arg_t arg_replay_cap   = ARGPARSE_OPTION(
+        INT, NO_FLAG, "--replay_capacity", &ARG_PARAMS.replay_capacity, "Experience replay buffer size in transitions (0 disables)"
+    );
+    argparse_arg_t arg_replay_batch = ARGPARSE_OPTION(
+        INT, NO_FLAG, "--replay_batch", &ARG_PARAMS.replay_batch, "Experience replay mini-batch size per real step (max 256)"
+    );
+    argparse_arg_t arg_replay_prio  = ARGPARSE_FLAG_TRUE(
+        NO_FLAG, "--replay_prioritized", &ARG_PARAMS.replay_prioritized, "Sample replay transitions proportionally to |TD error|"
+    );
+    argparse_arg_t arg_double_q     = ARGPARSE_FLAG_TRUE(
+        NO_FLAG, "--double_q", &ARG_PARAMS.double_q, "Train two interleaved Q-tables with Double Q-learning"
+    );
+    argparse_arg_t arg_curriculum   = ARGPARSE_FLAG_TRUE(
+        NO_FLAG, "--curriculum", &ARG_PARAMS.curriculum, "Start episodes near the goal and move the starts back as the agent succeeds"
+    );
+    argparse_arg_t arg_curr_band    = ARGPARSE_OPTION(
+        INT, NO_FLAG, "--curriculum_band", &ARG_PARAMS.curriculum_band, "Curriculum first band max BFS distance to the goal"
+    );
+    argparse_arg_t arg_curr_window  = ARGPARSE_OPTION(
+        INT, NO_FLAG, "--curriculum_window", &ARG_PARAMS.curriculum_window, "Curriculum episodes per success rate check"
+    );
+    argparse_arg_t arg_curr_sr      = ARGPARSE_OPTION(
+        FLOAT, NO_FLAG, "--curriculum_sr", &ARG_PARAMS.curriculum_success_rate, "Curriculum success rate (%) that widens the band"
+    );
+    argparse_arg_t arg_pbt_pop      = ARGPARSE_OPTION(
+        INT, NO_FLAG, "--pbt_population", &ARG_PARAMS.pbt_population, "Population based training with this many agents (0 disables)"
+    );
+    argparse_arg_t arg_pbt_threads  = ARGPARSE_OPTION(
+        INT, NO_FLAG, "--pbt_threads", &ARG_PARAMS.pbt_threads, "Population based training worker threads (0 = one per CPU)"
+    );
+    argparse_arg_t arg_pbt_interval = ARGPARSE_OPTION(
+        INT, NO_FLAG, "--pbt_interval", &ARG_PARAMS.pbt_interval, "Episodes each agent trains between exploit/explore rounds"
+    );
+    argparse_arg_t arg_pbt_perturb  = ARGPARSE_OPTION(
+        FLOAT, NO_FLAG, "--pbt_perturb", &ARG_PARAMS.pbt_perturb, "Explore scales each hyper parameter by 1 - p or 1 + p"
+    );
+    argparse_arg_t arg_mem_pages    = ARGPARSE_OPTION(
+        STRING, NO_FLAG, "--mem_pages", &ARG_PARAMS.mem_pages, "Q-table pages: thp (default), small or hugetlb (reserved 2 MiB pages)"
+    );
+    argparse_arg_t arg_mem_numa     = ARGPARSE_OPTION(
+        STRING, NO_FLAG, "--mem_numa", &ARG_PARAMS.mem_numa, "Q-table NUMA placement: local (default), interleave or firsttouch (per PBT worker)"
+    );
+    argparse_arg_t arg_mem_report   = ARGPARSE_FLAG_TRUE(
+        NO_FLAG, "--mem_report", &ARG_PARAMS.mem_report, "Print the page size and NUMA nodes the Q-tables ended up on"
+    );
+    argparse_arg_t arg_qt_layout    = ARGPARSE_OPTION(
+        STRING, NO_FLAG, "--qtable_layout", &ARG_PARAMS.qtable_layout, "Q-table memory layout: row (default), tiled (8x8 cells) or morton"
+    );
+    argparse_arg_t arg_reg_threads  = ARGPARSE_OPTION(
+        INT, NO_FLAG, "--region_threads", &ARG_PARAMS.region_threads, "Split the maze in bands of rows, one training thread owns each (0 disables)"
+    );
+    argparse_arg_t arg_reg_walkers  = ARGPARSE_OPTION(
+        INT, NO_FLAG, "--region_walkers", &ARG_PARAMS.region_walkers, "Region training episodes in flight (0 = 4 per thread)"
+    );
+    argparse_arg_t arg_reg_starts   = ARGPARSE_FLAG_TRUE(
+        NO_FLAG, "--region_random_starts", &ARG_PARAMS.region_random_starts, "Region training episodes start at a random open cell"
+    );
     argparse_arg_t arg_seed         = ARGPARSE_OPTION(
         INT, NO_FLAG, "--seed", &ARG_PARAMS.seed, "Agent training seed for random"
     );
@@ -336,6 +738,12 @@ void parse_cmd_arguments(int argc ,char** argv){
     argparse_arg_t arg_metrics_path = ARGPARSE_OPTION(
         STRING, NO_FLAG, "--metrics_path", &ARG_PARAMS.metrics_save_path, "Path to save agent metrics"
     );
+    argparse_arg_t arg_cache_dir    = ARGPARSE_OPTION(
+        STRING, NO_FLAG, "--cache_dir", &ARG_PARAMS.cache_dir, "Reuse finished runs with the same maze, parameters and seed from this directory"
+    );
+    argparse_arg_t arg_cache_max_mb = ARGPARSE_OPTION(
+        INT, NO_FLAG, "--cache_max_mb", &ARG_PARAMS.cache_max_mb, "Cache size budget in MB, least recently used runs are evicted"
+    );
     
     argparse_add_argument(&parser, &arg_maze);
     argparse_add_argument(&parser, &arg_lr);
@@ -345,9 +753,33 @@ void parse_cmd_arguments(int argc ,char** argv){
     argparse_add_argument(&parser, &arg_max_steps);
     argparse_add_argument(&parser, &arg_reward_shaping);
     argparse_add_argument(&parser, &arg_block_transpassing);
+    argparse_add_argument(&parser, &arg_dyna_k);
+    argparse_add_argument(&parser, &arg_sweep_n);
+    argparse_add_argument(&parser, &arg_sweep_theta);
+    argparse_add_argument(&parser, &arg_replay_cap);
+    argparse_add_argument(&parser, &arg_replay_batch);
+    argparse_add_argument(&parser, &arg_replay_prio);
+    argparse_add_argument(&parser, &arg_double_q);
+    argparse_add_argument(&parser, &arg_curriculum);
+    argparse_add_argument(&parser, &arg_curr_band);
+    argparse_add_argument(&parser, &arg_curr_window);
+    argparse_add_argument(&parser, &arg_curr_sr);
+    argparse_add_argument(&parser, &arg_pbt_pop);
+    argparse_add_argument(&parser, &arg_pbt_threads);
+    argparse_add_argument(&parser, &arg_pbt_interval);
+    argparse_add_argument(&parser, &arg_pbt_perturb);
+    argparse_add_argument(&parser, &arg_mem_pages);
+    argparse_add_argument(&parser, &arg_mem_numa);
+    argparse_add_argument(&parser, &arg_mem_report);
+    argparse_add_argument(&parser, &arg_qt_layout);
+    argparse_add_argument(&parser, &arg_reg_threads);
+    argparse_add_argument(&parser, &arg_reg_walkers);
+    argparse_add_argument(&parser, &arg_reg_starts);
     argparse_add_argument(&parser, &arg_seed);
     argparse_add_argument(&parser, &arg_qtable_path);
     argparse_add_argument(&parser, &arg_metrics_path);
+    argparse_add_argument(&parser, &arg_cache_dir);
+    argparse_add_argument(&parser, &arg_cache_max_mb);
     
     auto error = argparse_parse_args(&parser);
 
@@ -362,6 +794,72 @@ void debug_arg_parameters(){
     printf("\tepsilon_decay   = %.3f\n",ARG_PARAMS.epsilon_decay);
     printf("\tnum_episodes    = %d\n"  ,ARG_PARAMS.num_episodes);
     printf("\tmax_steps       = %d\n"  ,ARG_PARAMS.max_steps);
+    printf("\tdyna_k          = %zu\n" ,ARG_PARAMS.dyna_planning_steps);
+    printf("\tsweep_n         = %zu\n" ,ARG_PARAMS.sweep_max_updates);
+    printf("\tsweep_theta     = %g\n"  ,(double)ARG_PARAMS.sweep_theta);
+    printf("\treplay_capacity = %zu\n" ,ARG_PARAMS.replay_capacity);
+    printf("\treplay_batch    = %zu\n" ,ARG_PARAMS.replay_batch);
+    printf("\treplay_prio     = %s\n"  ,ARG_PARAMS.replay_prioritized ? "true" : "false");
+    printf("\tdouble_q        = %s\n"  ,ARG_PARAMS.double_q ? "true" : "false");
+    printf("\tcurriculum      = %s\n"  ,ARG_PARAMS.curriculum ? "true" : "false");
+    printf("\tcurriculum_band = %zu\n" ,ARG_PARAMS.curriculum_band);
+    printf("\tcurriculum_win  = %zu\n" ,ARG_PARAMS.curriculum_window);
+    printf("\tcurriculum_sr   = %.1f\n",ARG_PARAMS.curriculum_success_rate);
+    printf("\tpbt_population  = %zu\n" ,ARG_PARAMS.pbt_population);
+    printf("\tpbt_threads     = %zu\n" ,ARG_PARAMS.pbt_threads);
+    printf("\tpbt_interval    = %zu\n" ,ARG_PARAMS.pbt_interval);
+    printf("\tpbt_perturb     = %.3f\n",ARG_PARAMS.pbt_perturb);
+    printf("\tcache_dir       = %s\n"  ,ARG_PARAMS.cache_dir == NULL ? "(null)" : ARG_PARAMS.cache_dir);
+    printf("\tmem_pages       = %s\n"  ,ARG_PARAMS.mem_pages == NULL ? "thp" : ARG_PARAMS.mem_pages);
+    printf("\tmem_numa        = %s\n"  ,ARG_PARAMS.mem_numa == NULL ? "local" : ARG_PARAMS.mem_numa);
+    printf("\tqtable_layout   = %s\n"  ,ARG_PARAMS.qtable_layout == NULL ? "row" : ARG_PARAMS.qtable_layout);
+    printf("\tregion_threads  = %zu\n" ,ARG_PARAMS.region_threads);
+    printf("\tregion_walkers  = %zu\n" ,ARG_PARAMS.region_walkers);
+    printf("\tregion_starts   = %s\n"  ,ARG_PARAMS.region_random_starts ? "random" : "agent_start");
+}
+
+void report_table_placement(const char* label, const arena_t* arena, const void* vals, size_t bytes)
+{
+    const uint8_t* at = (const uint8_t*)vals;
+    if (at < arena->base || at >= arena->base + arena->capacity) {
+        printf("[MEM] %s: on the heap, outside the placement policy\n", label);
+        return;
+    }
+    arena_report_t report;
+    arenaReport(arena, vals, bytes, &report);
+    arenaPrintReport(stdout, label, arena, &report);
+}
+
+// EVERY PARAMETER THAT CHANGES THE RESULT, ONE FIELD AT A TIME; PATHS AND THE CACHE ITSELF STAY OUT
+uint64_t train_cache_key(const MazeEnv* ir){
+    uint64_t h = CACHE_HASH_INIT;
+    h = cacheHashU64(h, AGENT_ENGINE_VERSION);
+#ifdef CQ_FIXED_POINT
+    h = cacheHashU64(h, 1);
+#else
+    h = cacheHashU64(h, 0);
+#endif
+    h = cacheHashMaze(h, ir);
+    h = cacheHashF32(h, ARG_PARAMS.learning_rate);
+    h = cacheHashF32(h, ARG_PARAMS.discount_factor);
+    h = cacheHashF32(h, ARG_PARAMS.epsilon_decay);
+    h = cacheHashU64(h, ARG_PARAMS.num_episodes);
+    h = cacheHashU64(h, ARG_PARAMS.max_steps);
+    h = cacheHashU64(h, ARG_PARAMS.seed);
+    h = cacheHashU64(h, ARG_PARAMS.distance_reward_shaping);
+    h = cacheHashU64(h, ARG_PARAMS.block_transpassing_walls);
+    h = cacheHashU64(h, ARG_PARAMS.dyna_planning_steps);
+    h = cacheHashU64(h, ARG_PARAMS.sweep_max_updates);
+    h = cacheHashF32(h, ARG_PARAMS.sweep_theta);
+    h = cacheHashU64(h, ARG_PARAMS.replay_capacity);
+    h = cacheHashU64(h, ARG_PARAMS.replay_batch);
+    h = cacheHashU64(h, ARG_PARAMS.replay_prioritized);
+    h = cacheHashU64(h, ARG_PARAMS.double_q);
+    h = cacheHashU64(h, ARG_PARAMS.curriculum);
+    h = cacheHashU64(h, ARG_PARAMS.curriculum_band);
+    h = cacheHashU64(h, ARG_PARAMS.curriculum_window);
+    h = cacheHashF32(h, ARG_PARAMS.curriculum_success_rate);
+    return h;
 }
 
 void save_metrics_csv(const char* path, const TrainMetrics* m)
@@ -369,34 +867,318 @@ void save_metrics_csv(const char* path, const TrainMetrics* m)
     if (!path || !m) return;
 
     FILE* f = fopen(path, "w");
-    if (!f) {
+    char* buf = (char*)malloc(LOG_BUFFER_BYTES);
+    if (!f || !buf) {
         printf("[ERROR] Could not open metrics file: %s\n", path);
+        if (f) fclose(f);
+        free(buf);
         return;
     }
 
-    /* CSV header */
-    fprintf(f,
-        "episode,"
-        "reward,"
-        "cumulative_goals,"
-        "success_rate,"
-        "training_loss,"
-        "steps\n"
-    );
-
+    /* same rows as the log writer, one fwrite per full buffer */
+    char* p = FAST_TEXT_LIT(buf, LOG_METRICS_CSV_HEADER);
     for (size_t i = 0; i < m->num_of_episodes; i++) {
-        fprintf(
-            f,
-            "%zu,%.6f,%zu,%.4f,%.6e,%zu,%d\n",
-            i,
-            (double)m->rewards_acumm[i],
-            m->cummulative_goals[i],
-            m->succes_rate[i],
-            m->training_loss[i],
-            m->episode_step_count[i]
-        );
+        if ((size_t)(buf + LOG_BUFFER_BYTES - p) < LOG_RECORD_MAX_TEXT) {
+            fwrite(buf, 1, (size_t)(p - buf), f);
+            p = buf;
+        }
+        log_record_t r = {
+            .kind         = LOG_RECORD_METRICS,
+            .goal_reached = m->goal_reached[i],
+            .episode      = i,
+            .steps        = m->episode_step_count[i],
+            .cum_goals    = m->cummulative_goals[i],
+            .reward       = m->rewards_acumm[i],
+            .success_rate = m->succes_rate[i],
+            .loss         = m->training_loss[i]
+        };
+        p = logFormatMetricsRow(p, &r);
     }
+    fwrite(buf, 1, (size_t)(p - buf), f);
 
     fclose(f);
+    free(buf);
     printf("[INFO] Metrics saved to %s\n", path);
-}
\ No newline at end of file
+}
+
+/* "[EP %4d] steps=%4zu | reward=%9.3f | loss=%9.3e | eps=%5.3f | goal=%d | SR=%6.2f%%", on the writer thread */
+char* train_log_line(char* p, const log_record_t* r)
+{
+    char* s;
+    p = FAST_TEXT_LIT(p, "[EP ");
+    s = p; p = fastTextU64(p, r->episode);            p = fastTextPad(s, p, 4);
+    p = FAST_TEXT_LIT(p, "] steps=");
+    s = p; p = fastTextU64(p, r->steps);              p = fastTextPad(s, p, 4);
+    p = FAST_TEXT_LIT(p, " | reward=");
+    s = p; p = fastTextFixed(p, r->reward, 3);        p = fastTextPad(s, p, 9);
+    p = FAST_TEXT_LIT(p, " | loss=");
+    s = p; p = fastTextExp(p, r->loss, 3);            p = fastTextPad(s, p, 9);
+    p = FAST_TEXT_LIT(p, " | eps=");
+    s = p; p = fastTextFixed(p, r->epsilon, 3);       p = fastTextPad(s, p, 5);
+    p = FAST_TEXT_LIT(p, " | goal=");
+    *p++ = r->goal_reached ? '1' : '0';
+    p = FAST_TEXT_LIT(p, " | SR=");
+    s = p; p = fastTextFixed(p, r->success_rate, 2);  p = fastTextPad(s, p, 6);
+    p = FAST_TEXT_LIT(p, "%\n");
+    return p;
+}
+static double wall_seconds(void){
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec*1e-9;
+}
+
+/*
+    population based training: rounds of --pbt_interval episodes per agent until
+    each one trained --episodes, then the best agent's table and hyper parameters
+    go into agent for the greedy rollout and the saved qtable. clock() sums every
+    thread, so "cpu" below is what the population cost, not the wall time.
+    the metrics csv gets one row per round for the best agent of that round.
+*/
+void train_pbt(MazeEnv* ir, Agent* agent, size_t wallsCount, size_t opensCount)
+{
+    pbt_params_t params = {
+        .n_members          = ARG_PARAMS.pbt_population,
+        .n_threads          = ARG_PARAMS.pbt_threads,
+        .interval           = ARG_PARAMS.pbt_interval > 0 ? ARG_PARAMS.pbt_interval : PBT_DEFAULT_INTERVAL,
+        .max_steps          = ARG_PARAMS.max_steps,
+        .truncation         = PBT_DEFAULT_TRUNCATION,
+        .perturb            = ARG_PARAMS.pbt_perturb,
+        .block_transpassing = ARG_PARAMS.block_transpassing_walls,
+        .distance_shaping   = ARG_PARAMS.distance_reward_shaping,
+        .walls_count        = wallsCount,
+        .opens_count        = opensCount,
+        .placement          = MEM_POLICY,
+        .layout             = QTABLE_LAYOUT
+    };
+    pbt_t pbt;
+    if (pbtInit(&pbt, ir, &params, agent->learning_rate, agent->discount_rate, agent->epsilon_decay, ARG_PARAMS.seed) != 0) {
+        printf("[ERROR] Could not start population based training\n");
+        exit(-1);
+    }
+    log_writer_t log_writer;
+    if (logWriterOpen(&log_writer, ARG_PARAMS.metrics_save_path, NULL, NULL, 0) != 0) {
+        printf("[ERROR] Could not open metrics file: %s\n",
+               ARG_PARAMS.metrics_save_path ? ARG_PARAMS.metrics_save_path : "(null)");
+        exit(-1);
+    }
+
+    size_t rounds = (ARG_PARAMS.num_episodes + params.interval - 1) / params.interval;
+    if (rounds == 0) rounds = 1;
+    printf("[INFO] PBT: %zu agents on %zu threads, %zu rounds of %zu episodes, %.1f MB of tables\n",
+           params.n_members, pbt.params.n_threads, rounds, params.interval,
+           (double)(params.n_members*pbt.table_vals*sizeof(q_val_t)) / (1024.0*1024.0));
+
+    clock_t cpu_start = clock();
+    double  wall_start = wall_seconds();
+    size_t  best_steps = 0;
+    double  best_cpu = 0.0;
+    size_t  best_round = 0;
+
+    for (size_t r = 0; r < rounds; r++) {
+        TRACE_BEGIN(round);
+        pbtRound(&pbt);
+        TRACE_END(round, "pbt round", "train", r);
+
+        pbt_member_t* best = pbtBest(&pbt);
+        double cpu = (double)(clock() - cpu_start) / CLOCKS_PER_SEC;
+        double sr = 100.0 * (double)best->round_goals / (double)params.interval;
+        if (best->eval_goal && (best_steps == 0 || best->eval_steps < best_steps)) {
+            best_steps = best->eval_steps;
+            best_cpu   = cpu;
+            best_round = r;
+        }
+
+        log_record_t record = {
+            .kind         = LOG_RECORD_METRICS,
+            .goal_reached = best->eval_goal,
+            .episode      = best->episodes - 1,
+            .steps        = best->eval_steps,
+            .cum_goals    = best->goals,
+            .reward       = (float)best->round_reward,
+            .epsilon      = best->agent.epsilon,
+            .success_rate = sr,
+            .loss         = best->round_loss
+        };
+        logWriterPush(&log_writer, &record);
+
+        printf("[PBT %3zu] best=#%-3u parent=#%-3u greedy=%s %4zu steps | SR=%6.2f%% | "
+               "lr=%.4f df=%.4f decay=%.0f | cpu=%.2fs\n",
+               r, best->id, best->parent, best->eval_goal ? "goal" : "miss", best->eval_steps, sr,
+               best->agent.learning_rate, best->agent.discount_rate, best->agent.epsilon_decay, cpu);
+    }
+
+    double cpu_secs  = (double)(clock() - cpu_start) / CLOCKS_PER_SEC;
+    double wall_secs = wall_seconds() - wall_start;
+
+    int log_rc;
+    TRACE_SPAN("flush log writer", "io") log_rc = logWriterClose(&log_writer);
+    if (log_rc != 0) {
+        printf("[ERROR] Could not write every metrics row to %s\n",
+               ARG_PARAMS.metrics_save_path ? ARG_PARAMS.metrics_save_path : "(null)");
+    } else if (ARG_PARAMS.metrics_save_path) {
+        printf("[INFO] Metrics saved to %s\n", ARG_PARAMS.metrics_save_path);
+    }
+
+    pbt_member_t* best = pbtBest(&pbt);
+    memcpy(agent->q_table.vals, best->agent.q_table.vals, pbt.table_vals*sizeof(q_val_t));
+    agent->learning_rate = best->agent.learning_rate;
+    agent->discount_rate = best->agent.discount_rate;
+    agent->epsilon_decay = best->agent.epsilon_decay;
+
+    printf("\n[INFO] PBT took %.3fs wall, %.3fs cpu for %llu environment steps\n",
+           wall_secs, cpu_secs, (unsigned long long)pbt.env_steps);
+    printf("[INFO] PBT: %zu exploits, %.1f MB of tables copied\n",
+           pbt.exploits, (double)pbt.bytes_copied / (1024.0*1024.0));
+    if (best_steps > 0) {
+        printf("[INFO] PBT: best greedy path %zu steps, first found in round %zu after %.3fs cpu\n",
+               best_steps, best_round, best_cpu);
+    } else {
+        printf("[INFO] PBT: no agent reached the goal greedily\n");
+    }
+    printf("[INFO] PBT: keeping agent #%u, lr=%.4f df=%.4f decay=%.0f\n",
+           best->id, best->agent.learning_rate, best->agent.discount_rate, best->agent.epsilon_decay);
+    if (ARG_PARAMS.mem_report) {
+        report_table_placement("pbt tables", &pbt.arena, pbt.pool, params.n_members*pbt.table_stride*sizeof(q_val_t));
+    }
+    pbtFree(&pbt);
+}
+
+typedef struct {
+    log_writer_t* log_writer;
+    bool          window[ROLLING_WINDOW_SIZE];
+    size_t        window_goals;
+    size_t        goals;
+    int64_t       converged_episode;
+    uint64_t      converged_steps;
+    double        converged_wall;
+    uint64_t      steps;
+    double        wall_start;
+} RegionLogCtx;
+
+/* the rolling success rate and the log rows of agentTrain, over episodes in completion order */
+static void region_log_episode(void* ctx, const region_episode_t* ep)
+{
+    RegionLogCtx* c = (RegionLogCtx*)ctx;
+    size_t slot = ep->episode % ROLLING_WINDOW_SIZE;
+    if (ep->episode >= (uint64_t)ROLLING_WINDOW_SIZE) c->window_goals -= c->window[slot];
+    c->window[slot] = ep->goal;
+    c->window_goals += ep->goal;
+    c->goals += ep->goal;
+    c->steps += ep->steps;
+    size_t window_len = ep->episode + 1 < (uint64_t)ROLLING_WINDOW_SIZE ? (size_t)ep->episode + 1 : ROLLING_WINDOW_SIZE;
+    double success_rate = 100.0 * (double)c->window_goals / (double)window_len;
+    if (c->converged_episode < 0 && window_len == ROLLING_WINDOW_SIZE && success_rate >= CONVERGED_SUCCESS_RATE) {
+        c->converged_episode = (int64_t)ep->episode;
+        c->converged_steps   = c->steps;
+        c->converged_wall    = wall_seconds() - c->wall_start;
+    }
+
+    log_record_t record = {
+        .kind         = LOG_RECORD_METRICS,
+        .goal_reached = ep->goal,
+        .episode      = ep->episode,
+        .steps        = ep->steps,
+        .cum_goals    = c->goals,
+        .reward       = ep->reward,
+        .epsilon      = ep->epsilon,
+        .success_rate = success_rate,
+        .loss         = ep->loss
+    };
+    logWriterPush(c->log_writer, &record);
+    if (ep->episode % LOG_EVERY_EPISODES == 0 || ep->episode == ARG_PARAMS.num_episodes - 1) {
+        record.kind = LOG_RECORD_LINE;
+        logWriterPush(c->log_writer, &record);
+    }
+}
+
+/*
+    region partitioned training: --region_threads workers each own a band of
+    rows of agent's table and hand the episodes to each other at the band
+    edges (agentRegion.h), the table is trained in place. episodes are logged
+    in the order they finish, so the csv episode column is that order.
+*/
+void train_regions(MazeEnv* ir, Agent* agent, arena_t* run_arena, size_t wallsCount, size_t opensCount)
+{
+    region_params_t params = {
+        .n_threads          = ARG_PARAMS.region_threads,
+        .n_walkers          = ARG_PARAMS.region_walkers,
+        .n_episodes         = ARG_PARAMS.num_episodes,
+        .max_steps          = ARG_PARAMS.max_steps,
+        .random_starts      = ARG_PARAMS.region_random_starts,
+        .block_transpassing = ARG_PARAMS.block_transpassing_walls,
+        .distance_shaping   = ARG_PARAMS.distance_reward_shaping,
+        .walls_count        = wallsCount,
+        .opens_count        = opensCount,
+        .numa               = MEM_POLICY.numa
+    };
+    region_trainer_t rt;
+    if (regionInit(&rt, ir, agent, &params) != 0) {
+        printf("[ERROR] Could not start region partitioned training\n");
+        exit(-1);
+    }
+    log_writer_t log_writer;
+    if (logWriterOpen(&log_writer, ARG_PARAMS.metrics_save_path, stdout, train_log_line, 0) != 0) {
+        printf("[ERROR] Could not open metrics file: %s\n",
+               ARG_PARAMS.metrics_save_path ? ARG_PARAMS.metrics_save_path : "(null)");
+        exit(-1);
+    }
+
+    size_t band_bytes = 0;
+    for (size_t k = 0; k < rt.n_workers; k++) {
+        size_t b = (rt.workers[k].y1 - rt.workers[k].y0)*ir->cols*ACTION_N_ACTIONS*sizeof(q_val_t);
+        if (b > band_bytes) band_bytes = b;
+    }
+    printf("[INFO] Regions: %zu bands on %zu threads, %zu episodes in flight, largest band %.2f MB of table\n",
+           rt.n_workers, rt.n_workers, rt.n_walkers, (double)band_bytes / (1024.0*1024.0));
+
+    RegionLogCtx ctx = {.log_writer = &log_writer, .converged_episode = -1};
+    clock_t cpu_start = clock();
+    ctx.wall_start = wall_seconds();
+    int rc;
+    TRACE_SPAN("region training", "train") rc = regionTrain(&rt, region_log_episode, &ctx);
+    if (rc != 0) {
+        printf("[ERROR] Could not start the region training threads\n");
+        exit(-1);
+    }
+    double wall_secs = wall_seconds() - ctx.wall_start;
+    double cpu_secs  = (double)(clock() - cpu_start) / CLOCKS_PER_SEC;
+
+    int log_rc;
+    TRACE_SPAN("flush log writer", "io") log_rc = logWriterClose(&log_writer);
+    if (log_rc != 0) {
+        printf("[ERROR] Could not write every metrics row to %s\n",
+               ARG_PARAMS.metrics_save_path ? ARG_PARAMS.metrics_save_path : "(null)");
+    } else if (ARG_PARAMS.metrics_save_path) {
+        printf("[INFO] Metrics saved to %s\n", ARG_PARAMS.metrics_save_path);
+    }
+    if (log_writer.dropped_lines > 0 || log_writer.stalls > 0) {
+        printf("[WARN] Log writer: %llu console lines dropped, %llu waits for a full queue\n",
+               (unsigned long long)log_writer.dropped_lines, (unsigned long long)log_writer.stalls);
+    }
+
+    uint64_t updates = 0, handoffs = 0;
+    for (size_t k = 0; k < rt.n_workers; k++) {
+        region_worker_t* w = &rt.workers[k];
+        updates  += w->updates;
+        handoffs += w->handoffs;
+        printf("[REGION %2zu] rows [%zu,%zu) %zu open cells | %llu steps | %llu handoffs out | %llu boundary backups | %llu idle waits\n",
+               k, w->y0, w->y1, w->open_cells, (unsigned long long)w->steps, (unsigned long long)w->handoffs,
+               (unsigned long long)w->backups, (unsigned long long)w->idle);
+    }
+    printf("\n[INFO] Region training took %.3fs wall, %.3fs cpu for %llu environment steps (%.0f steps/s)\n",
+           wall_secs, cpu_secs, (unsigned long long)ctx.steps, wall_secs > 0.0 ? (double)ctx.steps / wall_secs : 0.0);
+    printf("[INFO] Q-table updates: %llu, %llu handoffs between bands\n",
+           (unsigned long long)updates, (unsigned long long)handoffs);
+    if (ctx.converged_episode >= 0) {
+        printf("[INFO] SR >= %.0f%% first reached at finished episode %lld after %llu environment steps (%.3fs)\n",
+               CONVERGED_SUCCESS_RATE, (long long)ctx.converged_episode,
+               (unsigned long long)ctx.converged_steps, ctx.converged_wall);
+    } else {
+        printf("[INFO] SR never reached %.0f%%\n", CONVERGED_SUCCESS_RATE);
+    }
+    if (ARG_PARAMS.mem_report) {
+        report_table_placement("qtable", run_arena, agent->q_table.vals, qtableValCount(&agent->q_table)*sizeof(q_val_t));
+    }
+    regionFree(&rt);
+}
@@ -133,7 +133,7 @@ bool isAgentRunable(MazeInternalRepr* ir,Agent* agent){
 };
 
 void updateAgent(Agent* agent, MazeInternalRepr* ir, size_t* steps_taken, bool* isGoal,
-				 size_t wallsCount,size_t opensCount, q_val_t* accum_q_val,
+				 size_t wallsCount,size_t opensCount, float* accum_q_val,
 				 Action manual_chosed_action,
 				 bool track_agent_steps, agentSteps* agent_steps
 				){
@@ -155,7 +155,7 @@ void updateAgent(Agent* agent, MazeInternalRepr* ir, size_t* steps_taken, bool*
 	} else {
 		agent->policy_action = manual_chosed_action;
 	}
-	*accum_q_val += getQtableValue(agent,agent->current_s,agent->policy_action);
+	*accum_q_val += qvalToFloat(getQtableValue(agent,agent->current_s,agent->policy_action));
 	if(track_agent_steps){
 		da_append(agent_steps,((agentStep){.s=agent->current_s,.a=agent->policy_action}));
 	}
@@ -266,7 +266,7 @@ int main(int argc, char const *argv[])
 	DIALOG_TARGET dialog_target = MAZE;
 	
 	size_t steps_taken = 0;
-	q_val_t accum_path_q_val = 0.0f;	
+	float accum_path_q_val = 0.0f;	
 	bool isAgentGoal = false;
 	
 	load_viewer_state(".agent_viewer_state", maze_path, sizeof(maze_path),
@@ -0,0 +1,92 @@
+/*
+    LIBCQCORE
+
+    THE ONE TRANSLATION UNIT THAT COMPILES THE HEADLESS CORE: ENVIRONMENT,
+    MAZE I/O AND GENERATION, AGENT AND TABLES, PLANNING, REPLAY, CURRICULUM,
+    POPULATION BASED TRAINING, COMPILED POLICIES, SHARED MEMORY, THE RPC
+    CLIENT, THE RESULT CACHE, THE ASYNC LOG WRITER, THE ARENAS AND REGION
+    PARTITIONED TRAINING. NO raylib, NO GUI, SO IT BUILDS ON LINUX (make core)
+    AS libcqcore.a AND libcqcore.so.
+
+    PROGRAMS THAT LINK IT INCLUDE THE SAME HEADERS WITHOUT THE *_IMPLEMENTATION
+    MACROS. THE HOT CALLS (stepIntoState, qtableMaxValAction, ...) ARE THEN
+    ACROSS TRANSLATION UNITS, BUILD WITH lto=1 TO GET THEM INLINED BACK.
+
+    THE GUI PROGRAMS AND agentCLI KEEP DEFINING THE IMPLEMENTATIONS THEMSELVES.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+
+#define MAZE_IR_IMPLEMENTATION
+#include "mazeIR.h"
+#undef MAZE_IR_IMPLEMENTATION
+
+#define MAZE_GENERATION_IMPLEMENTATION
+#include "mazeGeneration.h"
+#undef MAZE_GENERATION_IMPLEMENTATION
+
+#define MAZE_PATHS_IMPLEMENTATION
+#include "mazePaths.h"
+#undef MAZE_PATHS_IMPLEMENTATION
+
+#define AGENT_IMPLEMENTATION
+#include "agent.h"
+#undef AGENT_IMPLEMENTATION
+
+#define AGENT_DYNA_IMPLEMENTATION
+#include "agentDyna.h"
+#undef AGENT_DYNA_IMPLEMENTATION
+
+#define AGENT_SWEEP_IMPLEMENTATION
+#include "agentSweep.h"
+#undef AGENT_SWEEP_IMPLEMENTATION
+
+#define AGENT_REPLAY_IMPLEMENTATION
+#include "agentReplay.h"
+#undef AGENT_REPLAY_IMPLEMENTATION
+
+#define AGENT_CURRICULUM_IMPLEMENTATION
+#include "agentCurriculum.h"
+#undef AGENT_CURRICULUM_IMPLEMENTATION
+
+#define AGENT_POLICY_IMPLEMENTATION
+#include "agentPolicy.h"
+#undef AGENT_POLICY_IMPLEMENTATION
+
+#define AGENT_SHM_IMPLEMENTATION
+#include "agentShm.h"
+#undef AGENT_SHM_IMPLEMENTATION
+
+#define AGENT_RPC_IMPLEMENTATION
+#include "agentRpc.h"
+#undef AGENT_RPC_IMPLEMENTATION
+
+#define AGENT_CACHE_IMPLEMENTATION
+#include "agentCache.h"
+#undef AGENT_CACHE_IMPLEMENTATION
+
+#define AGENT_PBT_IMPLEMENTATION
+#include "agentPBT.h"
+#undef AGENT_PBT_IMPLEMENTATION
+
+#define FAST_TEXT_IMPLEMENTATION
+#include "fastText.h"
+#undef FAST_TEXT_IMPLEMENTATION
+
+#define AGENT_LOG_IMPLEMENTATION
+#include "agentLog.h"
+#undef AGENT_LOG_IMPLEMENTATION
+
+#define AGENT_ARENA_IMPLEMENTATION
+#include "agentArena.h"
+#undef AGENT_ARENA_IMPLEMENTATION
+
+#define AGENT_REGION_IMPLEMENTATION
+#include "agentRegion.h"
+#undef AGENT_REGION_IMPLEMENTATION
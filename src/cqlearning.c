@@ -26,6 +26,7 @@
 
 #define AGENT_IMPLEMENTATION
 #include "agent.h"
+#undef AGENT_IMPLEMENTATION
 
 #define UI_IMPLEMENTATION
 #include "UI.h"
@@ -33,38 +34,48 @@
 #define GUI_WINDOW_FILE_DIALOG_IMPLEMENTATION
 #include "gui_window_file_dialog.h"
 
+#define MAZE_GENERATION_IMPLEMENTATION
 #include "mazeGeneration.h"
+#undef MAZE_GENERATION_IMPLEMENTATION
 
 #define APP_CONTEXT_IMPLEMENTATION
 #include "appContext.h"
 
-#define WINDOW_W 1280U
-#define WINDOW_H  720U
-#define ROLLING_WIN 20
+#define METRIC_SERIES_IMPLEMENTATION
+#include "metricSeries.h"
 
-/* ------------------------------------------------------------------ */
-/*  Dynamic array for agent step tracking (T key)                     */
-/* ------------------------------------------------------------------ */
-#define da_append(xs, x)                                                             \
-    do {                                                                             \
-        if ((xs)->count >= (xs)->capacity) {                                         \
-            if ((xs)->capacity == 0) (xs)->capacity = 256;                           \
-            else (xs)->capacity *= 2;                                                \
-            (xs)->items = realloc((xs)->items, (xs)->capacity*sizeof(*(xs)->items)); \
-        }                                                                            \
-        (xs)->items[(xs)->count++] = (x);                                            \
-    } while (0)
+#define QTABLE_OVERLAY_IMPLEMENTATION
+#include "qtableOverlay.h"
 
-typedef struct {
-    state_t s;
-    Action  a;
-} agentStep;
+#define STEP_TRAIL_IMPLEMENTATION
+#include "stepTrail.h"
 
-typedef struct {
-    agentStep* items;
-    size_t     count;
-    size_t     capacity;
-} agentSteps;
+#define AGENT_INSTRUMENT_IMPLEMENTATION
+#include "agentInstrument.h"
+
+#define AGENT_TRACE_IMPLEMENTATION
+#include "agentTrace.h"
+
+#define AGENT_DYNA_IMPLEMENTATION
+#include "agentDyna.h"
+#undef AGENT_DYNA_IMPLEMENTATION
+
+#define AGENT_SWEEP_IMPLEMENTATION
+#include "agentSweep.h"
+#undef AGENT_SWEEP_IMPLEMENTATION
+
+#define FAST_TEXT_IMPLEMENTATION
+#include "fastText.h"
+#undef FAST_TEXT_IMPLEMENTATION
+
+#define AGENT_ARENA_IMPLEMENTATION
+#include "agentArena.h"
+#undef AGENT_ARENA_IMPLEMENTATION
+
+#define WINDOW_W 1280U
+#define WINDOW_H  720U
+#define ROLLING_WIN 20
+#define OVERLAY_CELLS_PER_FRAME 65536   /* overlay texture rebuild budget */
 
 /* ------------------------------------------------------------------ */
 /*  Module-scope persistent UI state                                  */
@@ -101,10 +112,33 @@ typedef struct {
     size_t* cum_goals;
     bool*   goal_reached;
 
-    int episodes_per_frame;
+    /* graph pyramids, appended with the arrays above */
+    metric_series_t g_rewards;
+    metric_series_t g_success;
+    metric_series_t g_loss;
+    metric_series_t g_steps;
+
+    int  episodes_per_frame;
+    bool smooth_ema;   /* graphs: EMA instead of the trailing window mean */
 } TrainState;
 
 static TrainState g_train;
+static inst_t     g_inst;   /* phase timers, live only with -DCQ_INSTRUMENT */
+
+/* Incremental retrain ------------------------------------------------ */
+/* base is the grid the current table was trained (or last repaired) on.
+ * With incremental mode on, an editor click diffs the maze against it and
+ * re-solves only the region the edit invalidated (sweepRepairEdit). */
+typedef struct {
+    bool     enabled;
+    uint8_t* base;
+    size_t   rows, cols;
+    bool     has_stats;
+    sweep_repair_stats_t stats;
+    double   ms;
+} RepairState;
+
+static RepairState g_repair;
 
 /* Viewer ------------------------------------------------------------- */
 typedef struct {
@@ -114,11 +148,10 @@ typedef struct {
     double  update_interval;
     size_t  steps_taken;
     bool    is_goal;
-    q_val_t accum_q;
+    float   accum_q;
 
-    /* T — step tracking */
+    /* T — step tracking, the trail itself is g_trail */
     bool       track_steps;
-    agentSteps agent_steps;
 
     /* Z — lock camera to agent */
     bool   lock_camera;
@@ -136,6 +169,11 @@ typedef struct {
 
 static ViewerState g_view;
 
+/* H / G — Q-table overlay and the T trail, kept out of g_view since
+ * "Open in Viewer" clears that and both own GPU resources */
+static QtableOverlay g_overlay;
+static StepTrail     g_trail;
+
 /* ------------------------------------------------------------------ */
 /*  Helpers                                                            */
 /* ------------------------------------------------------------------ */
@@ -155,66 +193,51 @@ static void drawPopup(AppContext* ctx) {
     setCustomStyle();
 }
 
-static void smoothToF_from_f(const float*  src, float* dst, size_t n, int win) {
-    if (!src || !dst || n == 0) return;
-    if (win < 1) win = 1;
-    for (size_t i = 0; i < n; i++) {
-        float sum = 0.0f;
-        for (int j = 0; j < win; j++) {
-            int idx = (int)i - j;
-            sum += (idx >= 0) ? src[idx] : 0.0f;
-        }
-        dst[i] = sum / (float)win;
-    }
-}
-static void smoothToF_from_d(const double* src, float* dst, size_t n, int win) {
-    if (!src || !dst || n == 0) return;
-    if (win < 1) win = 1;
-    for (size_t i = 0; i < n; i++) {
-        double sum = 0.0;
-        for (int j = 0; j < win; j++) {
-            int idx = (int)i - j;
-            sum += (idx >= 0) ? src[idx] : 0.0;
-        }
-        dst[i] = (float)(sum / (double)win);
-    }
-}
-static void smoothToF_from_z(const size_t* src, float* dst, size_t n, int win) {
-    if (!src || !dst || n == 0) return;
-    if (win < 1) win = 1;
-    for (size_t i = 0; i < n; i++) {
-        double sum = 0.0;
-        for (int j = 0; j < win; j++) {
-            int idx = (int)i - j;
-            sum += (idx >= 0) ? (double)src[idx] : 0.0;
-        }
-        dst[i] = (float)(sum / (double)win);
-    }
-}
-
-static void drawLineGraphF(Rectangle r, const float* vals, size_t n,
-                           const char* title, Color col, size_t x_offset)
+/* Draws one metric from its resolution pyramid: a faded min/max bar per
+ * point keeps spikes visible, the line is the trailing mean over
+ * max(win, samples per point) episodes, or an EMA with the same span
+ * (alpha = 2/(span+1)). At most one point per pixel, O(1) each. */
+static void drawSeriesGraph(Rectangle r, metric_series_t* s, int win, bool ema,
+                            const char* title, Color col)
 {
     DrawRectangleLines((int)r.x, (int)r.y, (int)r.width, (int)r.height, GRAY);
     DrawText(title, (int)r.x + 6, (int)r.y + 4, 14, RAYWHITE);
-    if (n < 2) return;
-
-    float minv = vals[0], maxv = vals[0];
-    for (size_t i = 1; i < n; i++) {
-        if (vals[i] < minv) minv = vals[i];
-        if (vals[i] > maxv) maxv = vals[i];
-    }
-    if (maxv - minv < 1e-6f) maxv = minv + 1.0f;
+    if (!s || s->n < 2) return;
 
     float pad_top = 22.0f, pad_bot = 8.0f;
     float hh = r.height - pad_top - pad_bot;
     float ww = r.width - 12.0f;
 
+    size_t level = metricSeriesPickLevel(s, ww > 2.0f ? (size_t)ww : 2);
+    size_t np    = metricSeriesSpanCount(s, level);
+    if (np < 2) level = 0, np = s->n;
+
+    static metric_span_t spans[4096];
+    static float         line[4096];
+    if (np > 4096) np = 4096;   /* only reachable on screens wider than 4096 px */
+
+    float minv = FLT_MAX, maxv = -FLT_MAX;
+    for (size_t i = 0; i < np; i++) {
+        spans[i] = metricSeriesSpan(s, level, i);
+        size_t width = spans[i].last - spans[i].first + 1;
+        size_t span  = (size_t)win > ((size_t)1 << level) ? (size_t)win : ((size_t)1 << level);
+        if (ema) line[i] = metricSeriesEma(s, spans[i].last, 2.0f / ((float)span + 1.0f));
+        else     line[i] = metricSeriesWindowMean(s, spans[i].last, width > span ? width : span);
+        if (spans[i].min < minv) minv = spans[i].min;
+        if (spans[i].max > maxv) maxv = spans[i].max;
+    }
+    if (maxv - minv < 1e-6f) maxv = minv + 1.0f;
+
+    #define GRAPH_X(i) (r.x + 6 + ((float)(i) / (float)(np - 1)) * ww)
+    #define GRAPH_Y(v) (r.y + pad_top + (1.0f - ((v) - minv) / (maxv - minv)) * hh)
+
+    Color band = Fade(col, 0.25f);
     Vector2 prev = {0};
-    for (size_t i = 0; i < n; i++) {
-        float t = (n == 1) ? 0.0f : (float)i / (float)(n - 1);
-        float v = (vals[i] - minv) / (maxv - minv);
-        Vector2 p = { r.x + 6 + t * ww, r.y + pad_top + (1.0f - v) * hh };
+    for (size_t i = 0; i < np; i++) {
+        float x = GRAPH_X(i);
+        if (spans[i].max > spans[i].min)
+            DrawLineV((Vector2){ x, GRAPH_Y(spans[i].max) }, (Vector2){ x, GRAPH_Y(spans[i].min) }, band);
+        Vector2 p = { x, GRAPH_Y(line[i]) };
         if (i > 0) DrawLineEx(prev, p, 1.5f, col);
         prev = p;
     }
@@ -222,18 +245,16 @@ static void drawLineGraphF(Rectangle r, const float* vals, size_t n,
     DrawText(TextFormat("%.2f", maxv), (int)(r.x + r.width - 70), (int)(r.y + 4), 12, GRAY);
     DrawText(TextFormat("%.2f", minv), (int)(r.x + r.width - 70), (int)(r.y + r.height - 16), 12, GRAY);
 
-    /* hover tooltip — nearest sample under mouse x */
+    /* hover tooltip — nearest point under mouse x */
     Vector2 mp = GetMousePosition();
     if (CheckCollisionPointRec(mp, r)) {
         float t = (mp.x - r.x - 6.0f) / ww;
         if (t < 0.0f) t = 0.0f;
         if (t > 1.0f) t = 1.0f;
-        size_t i = (size_t)(t * (float)(n - 1) + 0.5f);
-        if (i >= n) i = n - 1;
+        size_t i = (size_t)(t * (float)(np - 1) + 0.5f);
+        if (i >= np) i = np - 1;
 
-        float t_i = (float)i / (float)(n - 1);
-        float v   = (vals[i] - minv) / (maxv - minv);
-        Vector2 sp = { r.x + 6 + t_i * ww, r.y + pad_top + (1.0f - v) * hh };
+        Vector2 sp = { GRAPH_X(i), GRAPH_Y(line[i]) };
 
         DrawLineEx((Vector2){ sp.x, r.y + pad_top },
                    (Vector2){ sp.x, r.y + r.height - pad_bot },
@@ -244,8 +265,13 @@ static void drawLineGraphF(Rectangle r, const float* vals, size_t n,
         const int tip_font   = 22;
         const int tip_pad_x  = 10;
         const int tip_pad_y  = 6;
-        char buf[64];
-        snprintf(buf, sizeof(buf), "x=%zu  y=%.4g", i + x_offset, (double)vals[i]);
+        char buf[96];
+        if (spans[i].first == spans[i].last)
+            snprintf(buf, sizeof(buf), "x=%zu  y=%.4g", spans[i].last, (double)line[i]);
+        else
+            snprintf(buf, sizeof(buf), "x=%zu..%zu  y=%.4g  [%.4g, %.4g]",
+                     spans[i].first, spans[i].last, (double)line[i],
+                     (double)spans[i].min, (double)spans[i].max);
         int tw = MeasureText(buf, tip_font);
         int box_w = tw + tip_pad_x * 2;
         int box_h = tip_font + tip_pad_y * 2;
@@ -257,28 +283,8 @@ static void drawLineGraphF(Rectangle r, const float* vals, size_t n,
         DrawRectangleLines(tx, ty, box_w, box_h, GRAY);
         DrawText(buf, tx + tip_pad_x, ty + tip_pad_y, tip_font, RAYWHITE);
     }
-}
-
-static void drawLineGraphD(Rectangle r, const double* vals, size_t n,
-                           const char* title, Color col)
-{
-    if (n == 0) { drawLineGraphF(r, NULL, 0, title, col, 0); return; }
-    static float buf[8192];
-    size_t take = n > 8192 ? 8192 : n;
-    size_t skip = n - take;
-    for (size_t i = 0; i < take; i++) buf[i] = (float)vals[skip + i];
-    drawLineGraphF(r, buf, take, title, col, skip);
-}
-
-static void drawLineGraphZ(Rectangle r, const size_t* vals, size_t n,
-                           const char* title, Color col)
-{
-    if (n == 0) { drawLineGraphF(r, NULL, 0, title, col, 0); return; }
-    static float buf[8192];
-    size_t take = n > 8192 ? 8192 : n;
-    size_t skip = n - take;
-    for (size_t i = 0; i < take; i++) buf[i] = (float)vals[skip + i];
-    drawLineGraphF(r, buf, take, title, col, skip);
+    #undef GRAPH_X
+    #undef GRAPH_Y
 }
 
 static float huber(float x) {
@@ -316,102 +322,48 @@ static void compute_camera_target_for_agent(MazeRenderCtx *render, MazeInternalR
     }
 }
 
-/* ------------------------------------------------------------------ */
-/*  Arrow rendering for T (track steps)                               */
-/* ------------------------------------------------------------------ */
-static void renderTrackedArrows(const agentSteps* steps, const MazeRenderCtx* render) {
-    if (!steps || steps->count == 0) return;
-
-    const float arrow_pad_percent        = 0.1f;
-    const float arrow_body_width_percent = 0.10f;
-    const float arrow_head_width_percent = 0.35f;
-    const float arrow_body_height_percent = 0.75f;
-
-    float arrow_total_height = render->cr_lenght * (1.0f - 2 * arrow_pad_percent);
-    float arrow_body_height  = arrow_total_height * arrow_body_height_percent;
-    float arrow_body_width   = render->cr_lenght * arrow_body_width_percent;
-    float arrow_head_width   = render->cr_lenght * arrow_head_width_percent;
-
-    const Color arrow_color = BLACK;
-
-    for (size_t i = 0; i < steps->count; i++) {
-        state_t _s = steps->items[i].s;
-        Action act = steps->items[i].a;
-
-        Vector2 s_to_pixel = mazeCellToPixel(render, _s.y, _s.x);
-
-        if (act >= ACTION_N_ACTIONS) continue;
-        if (s_to_pixel.x < 0.0f || s_to_pixel.y < 0.0f) continue;
-
-        Vector2 center = {
-            s_to_pixel.x + (float)render->cr_lenght * 0.5f,
-            s_to_pixel.y + (float)render->cr_lenght * 0.5f
-        };
-
-        float ux = (float)actionToDeltaMap[act].dx;
-        float uy = (float)actionToDeltaMap[act].dy;
-        if (ux == 0.0f && uy == 0.0f) continue;
-
-        float px = -uy;
-        float py =  ux;
-
-        float half_body_w = arrow_body_width * 0.5f;
-        float half_head_w = arrow_head_width * 0.5f;
-
-        Vector2 body_start = {
-            center.x - ux * (arrow_total_height * 0.5f),
-            center.y - uy * (arrow_total_height * 0.5f)
-        };
-        Vector2 body_end = {
-            body_start.x + ux * arrow_body_height,
-            body_start.y + uy * arrow_body_height
-        };
-
-        Vector2 neck = body_end;
-        Vector2 head_tip = {
-            neck.x + ux * (arrow_total_height * 0.25f),
-            neck.y + uy * (arrow_total_height * 0.25f)
-        };
-        Vector2 head_left  = { neck.x + px * half_head_w, neck.y + py * half_head_w };
-        Vector2 head_right = { neck.x - px * half_head_w, neck.y - py * half_head_w };
-
-        Vector2 p1 = { body_start.x + px * half_body_w, body_start.y + py * half_body_w };
-        Vector2 p2 = { body_end.x   + px * half_body_w, body_end.y   + py * half_body_w };
-        Vector2 p3 = { body_end.x   - px * half_body_w, body_end.y   - py * half_body_w };
-        Vector2 p4 = { body_start.x - px * half_body_w, body_start.y - py * half_body_w };
-
-        DrawTriangle(p1, p2, p3, arrow_color);
-        DrawTriangle(p1, p3, p4, arrow_color);
-        DrawTriangle(head_left, head_tip, head_right, arrow_color);
-    }
-}
-
 /* ------------------------------------------------------------------ */
 /*  Trainer mode                                                       */
 /* ------------------------------------------------------------------ */
+/* the metric arrays and the q-table of the current run, rewound and reused by the next one */
+static arena_t g_train_arena;
+
 static void trainFreeMetrics(TrainState* t) {
     if (!t->allocated) return;
     int epf = t->episodes_per_frame; 
-    free(t->rewards);
-    free(t->success_rate);
-    free(t->loss);
-    free(t->steps);
-    free(t->cum_goals);
-    free(t->goal_reached);
+    bool ema = t->smooth_ema;
+    /* the arrays stay in g_train_arena until the next trainAllocMetrics */
+    metricSeriesFree(&t->g_rewards);
+    metricSeriesFree(&t->g_success);
+    metricSeriesFree(&t->g_loss);
+    metricSeriesFree(&t->g_steps);
     memset(t, 0, sizeof(*t));
     t->episodes_per_frame = epf > 0 ? epf : 5;
+    t->smooth_ema = ema;
+}
+
+/* a run in progress trains ctx->agent against ctx->ir, drop it before either is replaced */
+static void trainStop(void) {
+    if (g_train.running) trainFreeMetrics(&g_train);
 }
 
-static bool trainAllocMetrics(TrainState* t, size_t n) {
+/* rewinds g_train_arena: the caller must be done with the previous run's table */
+static bool trainAllocMetrics(TrainState* t, size_t n, size_t table_bytes) {
     trainFreeMetrics(t);
-    t->rewards      = (float*) calloc(n, sizeof(float));
-    t->success_rate = (double*)calloc(n, sizeof(double));
-    t->loss         = (double*)calloc(n, sizeof(double));
-    t->steps        = (size_t*)calloc(n, sizeof(size_t));
-    t->cum_goals    = (size_t*)calloc(n, sizeof(size_t));
-    t->goal_reached = (bool*)  calloc(n, sizeof(bool));
+    size_t bytes = n * (sizeof(float) + 2 * sizeof(double) + 2 * sizeof(size_t) + sizeof(bool))
+                 + table_bytes + 7 * ARENA_ALIGN;
+    if (arenaReserve(&g_train_arena, bytes) != 0) return false;
+    t->rewards      = (float*) arenaCalloc(&g_train_arena, n, sizeof(float));
+    t->success_rate = (double*)arenaCalloc(&g_train_arena, n, sizeof(double));
+    t->loss         = (double*)arenaCalloc(&g_train_arena, n, sizeof(double));
+    t->steps        = (size_t*)arenaCalloc(&g_train_arena, n, sizeof(size_t));
+    t->cum_goals    = (size_t*)arenaCalloc(&g_train_arena, n, sizeof(size_t));
+    t->goal_reached = (bool*)  arenaCalloc(&g_train_arena, n, sizeof(bool));
+    bool series_ok = metricSeriesInit(&t->g_rewards, n) && metricSeriesInit(&t->g_success, n) &&
+                     metricSeriesInit(&t->g_loss,    n) && metricSeriesInit(&t->g_steps,   n);
     if (!t->rewards || !t->success_rate || !t->loss ||
-        !t->steps   || !t->cum_goals    || !t->goal_reached) {
+        !t->steps   || !t->cum_goals    || !t->goal_reached || !series_ok) {
+        t->allocated = true;   /* so trainFreeMetrics releases the partial allocation */
         trainFreeMetrics(t);
         return false;
     }
@@ -419,18 +371,42 @@ static bool trainAllocMetrics(TrainState* t, size_t n) {
     return true;
 }
 
+/* the table now matches the maze as it is */
+static void repairSnapshot(const MazeInternalRepr* ir) {
+    size_t n = ir->rows * ir->cols;
+    uint8_t* base = (uint8_t*)realloc(g_repair.base, n ? n : 1);
+    if (!base) return;
+    memcpy(base, ir->grid, n);
+    g_repair.base = base;
+    g_repair.rows = ir->rows;
+    g_repair.cols = ir->cols;
+}
+
+/* the table and the maze are unrelated (new maze or new qtable) */
+static void repairForget(void) {
+    free(g_repair.base);
+    g_repair.base      = NULL;
+    g_repair.rows      = 0;
+    g_repair.cols      = 0;
+    g_repair.has_stats = false;
+}
+
 static bool trainStart(AppContext* ctx) {
     if (!ctx->maze_loaded || ctx->ir.rows == 0 || ctx->ir.cols == 0) {
         APP_POPUP(ctx, "Load a maze first");
         return false;
     }
-    if (!trainAllocMetrics(&g_train, ctx->num_episodes)) {
+    size_t table_n = ctx->ir.cols * ctx->ir.rows * ACTION_N_ACTIONS;
+
+    /* the old table may live in g_train_arena, let it go before the arena is rewound */
+    agentFreeQtable(&ctx->agent);
+    ctx->agent_loaded = false;
+    if (!trainAllocMetrics(&g_train, ctx->num_episodes, table_n * sizeof(q_val_t))) {
         APP_POPUP(ctx, "Failed to allocate training metrics");
         return false;
     }
 
     /* fresh agent backed by ctx */
-    if (ctx->agent.q_table.vals) free(ctx->agent.q_table.vals);
     memset(&ctx->agent, 0, sizeof(ctx->agent));
 
     agentInit(&ctx->agent, &ctx->ir,
@@ -441,18 +417,21 @@ static bool trainStart(AppContext* ctx) {
     ctx->agent.q_table.len_state_x       = ctx->ir.cols;
     ctx->agent.q_table.len_state_y       = ctx->ir.rows;
     ctx->agent.q_table.len_state_actions = ACTION_N_ACTIONS;
-    ctx->agent.q_table.vals = (q_val_t*)calloc(ctx->ir.cols * ctx->ir.rows * ACTION_N_ACTIONS,
-                                               sizeof(q_val_t));
+    ctx->agent.q_table.vals = (q_val_t*)arenaCalloc(&g_train_arena, table_n, sizeof(q_val_t));
+    ctx->agent.q_table.borrowed = true;
     ctx->agent_loaded = true;
 
     appContextRefreshSize(ctx);
 
+    g_view.running      = false;   /* the viewer steps the same agent */
     g_train.running     = true;
     g_train.paused      = false;
     g_train.done        = false;
     g_train.cur_episode = 0;
     g_train.goals_count = 0;
     g_train.total_training_steps = 0;
+    repairSnapshot(&ctx->ir);
+    INST_INIT(&g_inst);
     return true;
 }
 
@@ -466,6 +445,7 @@ static void trainOneEpisode(AppContext* ctx) {
     goal.x = (int32_t)gc.col;
     goal.y = (int32_t)gc.row;
 
+    TRACE_BEGIN_SAMPLED(episode, t->cur_episode);
     agentRestart(ag);
 
     size_t   steps_done   = 0;
@@ -474,7 +454,9 @@ static void trainOneEpisode(AppContext* ctx) {
     float    model_loss   = 0.0f;
 
     for (size_t s = 0; s < ctx->max_steps; s++) {
-        agentPolicy(ag, env);
+        INST_TIME(&g_inst, INST_POLICY) agentPolicy(ag, env);
+
+        INST_BEGIN(step);
         state_t next = GetNextState(ag->current_s, ag->policy_action);
         stepResult sr = stepIntoStateUnscaled(env, next, ctx->walls_count, ctx->opens_count);
 
@@ -487,9 +469,12 @@ static void trainOneEpisode(AppContext* ctx) {
             float phi_sp = (float)manhattan(trans, goal);
             sr.reward += ctx->discount_factor * (phi_s - phi_sp);
         }
+        INST_END(&g_inst, INST_STEP, step);
 
+        INST_BEGIN(update);
         float td = agentQtableUpdate(ag, trans, sr);
         model_loss += huber(td);
+        INST_END(&g_inst, INST_UPDATE, update);
 
         total_reward += sr.reward;
         steps_done++;
@@ -501,16 +486,11 @@ static void trainOneEpisode(AppContext* ctx) {
     }
 
     t->total_training_steps += (unsigned int)steps_done;
+    INST_EPISODE(&g_inst, steps_done);
+    INST_BEGIN(metrics);
 
     /* epsilon */
-    const double eps_final = 0.1, eps_start = 1.0;
-    double decay = ctx->epsilon_decay > 0.0 ? ctx->epsilon_decay : 1.0;
-    double eps = eps_final + (eps_start - eps_final) *
-                 exp(-(double)t->total_training_steps / decay);
-    if (!isfinite(eps)) eps = eps_final;
-    if (eps < eps_final) eps = eps_final;
-    if (eps > 1.0)       eps = 1.0;
-    ag->epsilon = (float)eps;
+    ag->epsilon = agentEpsilonSchedule(t->total_training_steps, ctx->epsilon_decay);
 
     /* metrics */
     size_t ep = t->cur_episode;
@@ -528,31 +508,63 @@ static void trainOneEpisode(AppContext* ctx) {
     t->loss[ep]      = (double)model_loss;
     t->steps[ep]     = steps_done;
 
+    metricSeriesAppend(&t->g_rewards, (float)total_reward);
+    metricSeriesAppend(&t->g_success, (float)t->success_rate[ep]);
+    metricSeriesAppend(&t->g_loss,    model_loss);
+    metricSeriesAppend(&t->g_steps,   (float)steps_done);
+    INST_END(&g_inst, INST_METRICS, metrics);
+    TRACE_END(episode, "episode", "train", steps_done);
+
     t->cur_episode++;
     if (t->cur_episode >= ctx->num_episodes) {
         t->running = false;
         t->done    = true;
         ag->epsilon = 0.0f;   /* greedy after training */
+        INST_REPORT(&g_inst, stdout);
+    }
+}
+
+/* called every frame whatever the mode, so a run keeps going while the
+ * viewer watches its Q-table overlay */
+static void trainTick(AppContext* ctx) {
+    if (!g_train.running || g_train.paused) return;
+    TRACE_BEGIN(tick);
+    for (int i = 0; i < g_train.episodes_per_frame && g_train.running; i++) {
+        trainOneEpisode(ctx);
     }
+    TRACE_END(tick, "train tick", "gui", g_train.episodes_per_frame);
+    INST_PERIODIC(&g_inst, 0.5, NULL);   /* gauges for the trainer strip */
 }
 
 static bool saveMetricsCSV(AppContext* ctx, const char* path) {
     if (!g_train.allocated) return false;
     FILE* f = fopen(path, "w");
     if (!f) return false;
-    fprintf(f, "episode,reward,cumulative_goals,success_rate,training_loss,steps,goal_reached\n");
+
+    /* rows are formatted with fastText into one buffer, one fwrite per 1 MiB */
+    enum { CSV_BUF = 1 << 20, CSV_ROW_MAX = 8 * FAST_TEXT_MAX_NUMBER };
+    char* buf = (char*)malloc(CSV_BUF);
+    if (!buf) { fclose(f); return false; }
+    bool ok = true;
+    char* p = FAST_TEXT_LIT(buf, "episode,reward,cumulative_goals,success_rate,training_loss,steps,goal_reached\n");
     for (size_t i = 0; i < g_train.cur_episode; i++) {
-        fprintf(f, "%zu,%.6f,%zu,%.4f,%.6e,%zu,%d\n",
-                i,
-                (double)g_train.rewards[i],
-                g_train.cum_goals[i],
-                g_train.success_rate[i],
-                g_train.loss[i],
-                g_train.steps[i],
-                g_train.goal_reached[i] ? 1 : 0);
+        if ((size_t)(buf + CSV_BUF - p) < CSV_ROW_MAX) {
+            ok &= fwrite(buf, 1, (size_t)(p - buf), f) == (size_t)(p - buf);
+            p = buf;
+        }
+        p = fastTextU64(p, i);                                  *p++ = ',';
+        p = fastTextFixed(p, (double)g_train.rewards[i], 6);    *p++ = ',';
+        p = fastTextU64(p, g_train.cum_goals[i]);               *p++ = ',';
+        p = fastTextFixed(p, g_train.success_rate[i], 4);       *p++ = ',';
+        p = fastTextExp(p, g_train.loss[i], 6);                 *p++ = ',';
+        p = fastTextU64(p, g_train.steps[i]);                   *p++ = ',';
+        *p++ = g_train.goal_reached[i] ? '1' : '0';
+        *p++ = '\n';
     }
-    fclose(f);
-    return true;
+    ok &= fwrite(buf, 1, (size_t)(p - buf), f) == (size_t)(p - buf);
+    free(buf);
+    ok &= fclose(f) == 0;
+    return ok;
 }
 
 /* ------------------------------------------------------------------ */
@@ -630,10 +642,50 @@ static int drawEditorTopBar(AppContext* ctx, bool* lockEdit) {
     if (GuiButton((Rectangle){x, y, lscale*180, bh}, GuiIconText(ICON_FILE_SAVE, "Save Maze"))) {
         openFileDialog(DLG_SAVE_MAZE, true, ctx->maze_path); *lockEdit = true;
     } EADV(lscale*180);
+    if (GuiButton((Rectangle){x, y, lscale*220, bh},
+                  GuiIconText(ICON_REDO, g_repair.enabled ? "Incremental: On" : "Incremental: Off"))) {
+        g_repair.enabled = !g_repair.enabled;
+    } EADV(lscale*220);
     #undef EADV
     return y + bh + UI_BTN_SPACING;
 }
 
+/* diff against the base grid and repair the table in place, milliseconds
+ * where a retrain from zero takes minutes */
+static void repairAfterEdit(AppContext* ctx) {
+    if (!g_repair.enabled || !ctx->agent_loaded || !ctx->agent.q_table.vals) return;
+    if (!g_repair.base || g_repair.rows != ctx->ir.rows || g_repair.cols != ctx->ir.cols) return;
+    if (ctx->agent.q_table.len_state_x != ctx->ir.cols || ctx->agent.q_table.len_state_y != ctx->ir.rows) return;
+    if (ctx->distance_reward_shaping) {
+        APP_POPUP(ctx, "Incremental retrain needs distance shaping off");
+        g_repair.enabled = false;
+        return;
+    }
+
+    MazeInternalRepr base = { g_repair.rows, g_repair.cols, g_repair.base };
+    sweep_repair_params_t params = {
+        .block_transpassing = ctx->block_transpassing_walls,
+        .scaled_rewards     = false,   /* trainOneEpisode steps with stepIntoStateUnscaled */
+        .walls_count        = ctx->walls_count,
+        .opens_count        = ctx->opens_count,
+        .theta              = 1e-4f,
+        .max_updates        = 0
+    };
+    ctx->agent.discount_rate = ctx->discount_factor;   /* a loaded table never went through agentInit */
+
+    double t0 = GetTime();
+    TRACE_BEGIN(repair);
+    int rc = sweepRepairEdit(&ctx->agent, &base, &ctx->ir, &params, &g_repair.stats);
+    TRACE_END(repair, "incremental retrain", "train", g_repair.stats.updates);
+    if (rc != 0) {
+        APP_POPUP(ctx, "Incremental retrain failed");
+        return;
+    }
+    g_repair.ms        = (GetTime() - t0) * 1000.0;
+    g_repair.has_stats = true;
+    repairSnapshot(&ctx->ir);
+}
+
 static void runEditor(AppContext* ctx) {
     static bool lockEdit = false;
 
@@ -643,9 +695,11 @@ static void runEditor(AppContext* ctx) {
         int rows = atoi(g_genForm.rowsText);
         int cols = atoi(g_genForm.colsText);
         if (rows > 0 && cols > 0) {
+            trainStop();
             if (ctx->maze_loaded) freeMaze(&ctx->ir);
             ctx->ir = generateMaze(rows, cols);
             ctx->maze_loaded = true;
+            repairForget();
             strncpy(ctx->maze_path, g_genForm.mazeName, sizeof(ctx->maze_path) - 1);
             appContextRefreshSize(ctx);
             g_genForm.windowActive = false;
@@ -660,8 +714,14 @@ static void runEditor(AppContext* ctx) {
         lockEdit = false;
     }
 
+    /* the first edit after a load takes the table as matching the maze */
+    if (ctx->agent_loaded && (!g_repair.base || g_repair.rows != ctx->ir.rows
+                                             || g_repair.cols != ctx->ir.cols)) {
+        repairSnapshot(&ctx->ir);
+    }
     if (updateMazeClickedCell(&ctx->render, &ctx->ir)) {
         appContextRefreshSize(ctx);
+        repairAfterEdit(ctx);
     }
 
     /* render */
@@ -676,7 +736,12 @@ static void runEditor(AppContext* ctx) {
         DrawText(TextFormat("Rows: %zu", ctx->ir.rows),
                  ix, iy, LABEL_TEXT_SIZE, WHITE); iy += LABEL_TEXT_SIZE + 8;
         DrawText(TextFormat("Cols: %zu", ctx->ir.cols),
-                 ix, iy, LABEL_TEXT_SIZE, WHITE);
+                 ix, iy, LABEL_TEXT_SIZE, WHITE); iy += LABEL_TEXT_SIZE + 8;
+        if (g_repair.enabled && g_repair.has_stats) {
+            DrawText(TextFormat("Retrain: %zu reset, %zu backups, %.2f ms",
+                                g_repair.stats.invalidated_cells, g_repair.stats.updates, g_repair.ms),
+                     ix, iy, LABEL_TEXT_SIZE, WHITE);
+        }
     GuiUnlock();
 
     drawGenerateFormWindow(&g_genForm);
@@ -722,16 +787,15 @@ static void viewerStepOnce(AppContext* ctx) {
         g_view.accum_q     = 0.0f;
         g_view.steps_taken = 0;
         g_view.is_goal     = false;
-        g_view.agent_steps.count = 0;
+        stepTrailClear(&g_trail);
         return;
     }
     agentPolicy(ag, env);
-    g_view.accum_q += getQtableValue(ag, ag->current_s, ag->policy_action);
+    g_view.accum_q += qvalToFloat(getQtableValue(ag, ag->current_s, ag->policy_action));
 
     /* record step if tracking */
     if (g_view.track_steps) {
-        da_append(&g_view.agent_steps,
-                  ((agentStep){.s = ag->current_s, .a = ag->policy_action}));
+        stepTrailPush(&g_trail, ag->current_s, ag->policy_action);
     }
 
     state_t next = GetNextState(ag->current_s, ag->policy_action);
@@ -760,9 +824,13 @@ static void runViewer(AppContext* ctx) {
     /* T — toggle step tracking */
     if (IsKeyPressed(KEY_T)) {
         g_view.track_steps = !g_view.track_steps;
-        if (!g_view.track_steps) g_view.agent_steps.count = 0;
+        if (!g_view.track_steps) stepTrailClear(&g_trail);
     }
 
+    /* H / G — max-Q heatmap and greedy policy arrows */
+    if (IsKeyPressed(KEY_H)) g_overlay.show_heat   = !g_overlay.show_heat;
+    if (IsKeyPressed(KEY_G)) g_overlay.show_arrows = !g_overlay.show_arrows;
+
     /* Z — toggle lock camera to agent */
     if (IsKeyPressed(KEY_Z)) {
         g_view.lock_camera = !g_view.lock_camera;
@@ -795,7 +863,7 @@ static void runViewer(AppContext* ctx) {
             g_view.steps_taken       = 0;
             g_view.is_goal           = false;
             g_view.accum_q           = 0.0f;
-            g_view.agent_steps.count = 0;
+            stepTrailClear(&g_trail);
 
             if (g_view.lock_camera) {
                 g_view.cam_from_x = ctx->render.mouse_offset_x;
@@ -814,6 +882,7 @@ static void runViewer(AppContext* ctx) {
     }
 
     /* ---- step the agent ---- */
+    if (g_view.track_steps) stepTrailSync(&g_trail, ctx->ir.rows, ctx->ir.cols);
     if (g_view.running) {
         double now = GetTime();
         if (now - g_view.last_update >= g_view.update_interval) {
@@ -897,9 +966,16 @@ static void runViewer(AppContext* ctx) {
         renderMaze(&ctx->render, &ctx->ir, lockEdit || g_fdlg.windowActive);
     }
 
+    /* Q-table overlay (H / G): one quad, a slice of rows rebuilt per frame */
+    if ((g_overlay.show_heat || g_overlay.show_arrows) &&
+        qtableOverlaySync(&g_overlay, &ctx->agent, &ctx->ir)) {
+        qtableOverlayRefresh(&g_overlay, &ctx->agent, &ctx->ir, OVERLAY_CELLS_PER_FRAME);
+        qtableOverlayDraw(&g_overlay, &ctx->render);
+    }
+
     /* draw tracked arrows (T) */
     if (g_view.track_steps) {
-        renderTrackedArrows(&g_view.agent_steps, &ctx->render);
+        stepTrailDraw(&g_trail, &g_overlay, &ctx->render);
     }
 
     if (g_view.running) renderAgentDot(&ctx->agent, &ctx->render);
@@ -921,6 +997,8 @@ static void runViewer(AppContext* ctx) {
         if (GuiButton((Rectangle){vx, vy, lscale*180, bh}, GuiIconText(ICON_FILE_OPEN, "Load Qtable"))) {
             openFileDialog(DLG_LOAD_QTABLE, false, NULL); lockEdit = true;
         } VADV(lscale*180);
+        /* a background training run owns the agent */
+        if (g_train.running) GuiLock();
         if (GuiButton((Rectangle){vx, vy, lscale*180, bh},
                       GuiIconText(g_view.running ? ICON_PLAYER_STOP : ICON_PLAYER_PLAY,
                                   g_view.running ? "Stop" : "Run Agent"))) {
@@ -933,13 +1011,14 @@ static void runViewer(AppContext* ctx) {
                     g_view.steps_taken = 0;
                     g_view.is_goal     = false;
                     g_view.accum_q     = 0.0f;
-                    g_view.agent_steps.count = 0;
+                    stepTrailClear(&g_trail);
                     g_view.running     = true;
                 }
             } else {
                 g_view.running = false;
             }
         } VADV(180);
+        if (g_train.running && !g_fdlg.windowActive) GuiUnlock();
         #undef VADV
 
         int ix = UI_LEFT_X, iy = vy + bh + UI_BTN_SPACING;
@@ -957,7 +1036,23 @@ static void runViewer(AppContext* ctx) {
                  iy += LABEL_TEXT_SIZE + 8;
         DrawText(TextFormat("Lock camera [Z]: %s", g_view.lock_camera ? "ON" : "OFF"),
                  ix, iy, LABEL_TEXT_SIZE, g_view.lock_camera ? GREEN : GRAY);
-                 iy += LABEL_TEXT_SIZE + 16;
+                 iy += LABEL_TEXT_SIZE + 8;
+        DrawText(TextFormat("Max-Q heatmap [H]: %s", g_overlay.show_heat ? "ON" : "OFF"),
+                 ix, iy, LABEL_TEXT_SIZE, g_overlay.show_heat ? GREEN : GRAY);
+                 iy += LABEL_TEXT_SIZE + 8;
+        DrawText(TextFormat("Policy arrows [G]: %s", g_overlay.show_arrows ? "ON" : "OFF"),
+                 ix, iy, LABEL_TEXT_SIZE, g_overlay.show_arrows ? GREEN : GRAY);
+                 iy += LABEL_TEXT_SIZE + 8;
+        if (g_overlay.ready && (g_overlay.show_heat || g_overlay.show_arrows)) {
+            DrawText(TextFormat("Max-Q range: [%.3f, %.3f]", (double)g_overlay.lo, (double)g_overlay.hi),
+                     ix, iy, LABEL_TEXT_SIZE, WHITE); iy += LABEL_TEXT_SIZE + 8;
+        }
+        if (g_train.running) {
+            DrawText(TextFormat("Training: episode %zu / %zu%s", g_train.cur_episode, ctx->num_episodes,
+                                g_train.paused ? " (paused)" : ""),
+                     ix, iy, LABEL_TEXT_SIZE, ORANGE); iy += LABEL_TEXT_SIZE + 8;
+        }
+        iy += 8;
         DrawText(TextFormat("Map:    %s", GetFileName(ctx->maze_path)),
                  ix, iy, LABEL_TEXT_SIZE, WHITE); iy += LABEL_TEXT_SIZE + 8;
         DrawText(TextFormat("Qtable: %s", GetFileName(ctx->qtable_path)),
@@ -991,13 +1086,6 @@ static void drawFloatInput(Rectangle r, const char* label, float* val, bool* edi
 }
 
 static void runTrainer(AppContext* ctx) {
-    /* drive training */
-    if (g_train.running && !g_train.paused) {
-        for (int i = 0; i < g_train.episodes_per_frame && g_train.running; i++) {
-            trainOneEpisode(ctx);
-        }
-    }
-
     /* layout */
     int sw = GetScreenWidth(), sh = GetScreenHeight();
     int top_h = 90;
@@ -1030,6 +1118,11 @@ static void runTrainer(AppContext* ctx) {
                   GuiIconText(ICON_PLAYER_STOP, "Reset"))) {
         trainFreeMetrics(&g_train);
     } ADV(lscale*110);
+    if (GuiButton((Rectangle){bx, by, lscale*130, bh},
+                  GuiIconText(ICON_WAVE_SINUS,
+                              g_train.smooth_ema ? "Smooth: EMA" : "Smooth: Mean"))) {
+        g_train.smooth_ema = !g_train.smooth_ema;
+    } ADV(lscale*130);
 
     bool can_save = g_train.allocated && g_train.cur_episode > 0;
     if (!can_save) GuiLock();
@@ -1069,6 +1162,19 @@ static void runTrainer(AppContext* ctx) {
                         (double)ctx->discount_factor,
                         (double)ctx->epsilon_decay),
              10, hy + 44, 16, RAYWHITE);
+#ifdef CQ_INSTRUMENT
+    if (g_train.allocated) {
+        double el = instElapsedSecs(&g_inst);
+        double pct = el > 0.0 ? 100.0 / el : 0.0;
+        DrawText(TextFormat("%.0f steps/s  %.1f ep/s   policy %.0f%%  step %.0f%%  update %.0f%%  metrics %.0f%%",
+                            g_inst.steps_per_sec, g_inst.episodes_per_sec,
+                            instPhaseSecs(&g_inst, INST_POLICY)  * pct,
+                            instPhaseSecs(&g_inst, INST_STEP)    * pct,
+                            instPhaseSecs(&g_inst, INST_UPDATE)  * pct,
+                            instPhaseSecs(&g_inst, INST_METRICS) * pct),
+                 10, hy + 66, 16, SKYBLUE);
+    }
+#endif
 
     /* hyper-param controls — dock to the right side */
     static bool ed_ep = false, ed_st = false, ed_epf = false;
@@ -1148,26 +1254,13 @@ static void runTrainer(AppContext* ctx) {
     /* smooth every series with a zero-padded trailing window whose length
      * is g_train.episodes_per_frame (reuses the speed knob as a bias knob) */
     {
-        static float sm_R[8192], sm_S[8192], sm_L[8192], sm_T[8192];
-        int   win  = g_train.episodes_per_frame > 0 ? g_train.episodes_per_frame : 1;
-        size_t take = n > 8192 ? 8192 : n;
-        size_t skip = n - take;
-
-        if (g_train.allocated && take > 0) {
-            smoothToF_from_f(g_train.rewards      + skip, sm_R, take, win);
-            smoothToF_from_d(g_train.success_rate + skip, sm_S, take, win);
-            smoothToF_from_d(g_train.loss         + skip, sm_L, take, win);
-            smoothToF_from_z(g_train.steps        + skip, sm_T, take, win);
-            drawLineGraphF(rR, sm_R, take, "Reward / episode",            SKYBLUE, skip);
-            drawLineGraphF(rS, sm_S, take, "Success rate (%) [rolling]",  LIME,    skip);
-            drawLineGraphF(rL, sm_L, take, "Huber loss / episode",        RED,     skip);
-            drawLineGraphF(rT, sm_T, take, "Steps / episode",             ORANGE,  skip);
-        } else {
-            drawLineGraphF(rR, NULL, 0, "Reward / episode",           SKYBLUE, 0);
-            drawLineGraphF(rS, NULL, 0, "Success rate (%) [rolling]", LIME,    0);
-            drawLineGraphF(rL, NULL, 0, "Huber loss / episode",       RED,     0);
-            drawLineGraphF(rT, NULL, 0, "Steps / episode",            ORANGE,  0);
-        }
+        int win = g_train.episodes_per_frame > 0 ? g_train.episodes_per_frame : 1;
+        bool has = g_train.allocated && n > 0;
+        bool ema = g_train.smooth_ema;
+        drawSeriesGraph(rR, has ? &g_train.g_rewards : NULL, win, ema, "Reward / episode",           SKYBLUE);
+        drawSeriesGraph(rS, has ? &g_train.g_success : NULL, win, ema, "Success rate (%) [rolling]", LIME);
+        drawSeriesGraph(rL, has ? &g_train.g_loss    : NULL, win, ema, "Huber loss / episode",       RED);
+        drawSeriesGraph(rT, has ? &g_train.g_steps   : NULL, win, ema, "Steps / episode",            ORANGE);
     }
 
     if (g_train.done) {
@@ -1180,6 +1273,36 @@ static void runTrainer(AppContext* ctx) {
 /* ------------------------------------------------------------------ */
 /*  Common dialog handler                                              */
 /* ------------------------------------------------------------------ */
+
+/* file i/o as trace spans; plain calls without -DCQ_TRACE */
+static bool traceLoadMaze(AppContext* ctx, const char* path) {
+    TRACE_BEGIN(load);
+    bool ok = appLoadMazeFile(ctx, path);
+    TRACE_END(load, "load maze", "io", 0);
+    return ok;
+}
+
+static bool traceLoadQtable(AppContext* ctx, const char* path) {
+    TRACE_BEGIN(load);
+    bool ok = appLoadQtableFile(ctx, path);
+    TRACE_END(load, "load qtable", "io", 0);
+    return ok;
+}
+
+static bool traceSaveQtable(AppContext* ctx, const char* path) {
+    TRACE_BEGIN(save);
+    bool ok = appSaveQtableFile(ctx, path);
+    TRACE_END(save, "checkpoint qtable", "io", 0);
+    return ok;
+}
+
+static bool traceSaveMetrics(AppContext* ctx, const char* path) {
+    TRACE_BEGIN(save);
+    bool ok = saveMetricsCSV(ctx, path);
+    TRACE_END(save, "save metrics", "io", g_train.cur_episode);
+    return ok;
+}
+
 static void handleFileDialogResult(AppContext* ctx) {
     if (!g_fdlg.SelectFilePressed) return;
 
@@ -1189,8 +1312,9 @@ static void handleFileDialogResult(AppContext* ctx) {
 
     switch (g_dlg_target) {
     case DLG_LOAD_MAZE:
-        if (!appLoadMazeFile(ctx, path)) APP_POPUP(ctx, "Could not load maze file");
-        else                              appSaveState(ctx);
+        trainStop();
+        if (!traceLoadMaze(ctx, path)) APP_POPUP(ctx, "Could not load maze file");
+        else                          { repairForget(); appSaveState(ctx); }
         break;
 
     case DLG_SAVE_MAZE:
@@ -1206,14 +1330,15 @@ static void handleFileDialogResult(AppContext* ctx) {
         break;
 
     case DLG_LOAD_QTABLE:
-        if (!appLoadQtableFile(ctx, path)) APP_POPUP(ctx, "Could not load qtable");
-        else                                appSaveState(ctx);
+        trainStop();
+        if (!traceLoadQtable(ctx, path)) APP_POPUP(ctx, "Could not load qtable");
+        else                            { repairForget(); appSaveState(ctx); }
         break;
 
     case DLG_SAVE_QTABLE:
         if (!IsFileExtension(path, ".qtable")) {
             APP_POPUP(ctx, "Qtable must end in .qtable");
-        } else if (!appSaveQtableFile(ctx, path)) {
+        } else if (!traceSaveQtable(ctx, path)) {
             APP_POPUP(ctx, "Failed to save qtable");
         } else {
             strncpy(ctx->qtable_path, path, sizeof(ctx->qtable_path) - 1);
@@ -1225,7 +1350,7 @@ static void handleFileDialogResult(AppContext* ctx) {
     case DLG_SAVE_METRICS:
         if (!IsFileExtension(path, ".csv")) {
             APP_POPUP(ctx, "Metrics must end in .csv");
-        } else if (!saveMetricsCSV(ctx, path)) {
+        } else if (!traceSaveMetrics(ctx, path)) {
             APP_POPUP(ctx, "Failed to save metrics");
         } else {
             strncpy(ctx->metrics_path, path, sizeof(ctx->metrics_path) - 1);
@@ -1247,6 +1372,8 @@ static void handleFileDialogResult(AppContext* ctx) {
 /* ------------------------------------------------------------------ */
 int main(int argc, char** argv) {
     (void)argc; (void)argv;
+    TRACE_INIT("cqlearning.trace.json");
+    TRACE_THREAD_NAME("gui");
 
     AppContext ctx;
     appContextInit(&ctx);
@@ -1265,9 +1392,15 @@ int main(int argc, char** argv) {
     setCustomStyle();
     g_fdlg    = InitGuiWindowFileDialog(GetWorkingDirectory());
     g_genForm = initGenerateFormState("random.maze", 10, 10);
+    qtableOverlayInit(&g_overlay);
+    stepTrailInit(&g_trail, STEP_TRAIL_DEFAULT_CAPACITY);
 
     
+    uint64_t frame_no = 0;
     while (!WindowShouldClose() && ctx.mode != (AppMode)-1) {
+        TRACE_BEGIN_SAMPLED(frame, frame_no);
+        trainTick(&ctx);
+
         BeginDrawing();
 
             switch (ctx.mode) {
@@ -1287,14 +1420,20 @@ int main(int argc, char** argv) {
             drawPopup(&ctx);
 
         EndDrawing();
+        TRACE_END(frame, "frame", "gui", frame_no);
+        frame_no++;
     }
 
     appSaveState(&ctx);
     trainFreeMetrics(&g_train);
-    free(g_view.agent_steps.items); /* free tracked steps */
+    stepTrailFree(&g_trail);
+    qtableOverlayFree(&g_overlay);
+    repairForget();
     if (ctx.maze_loaded) freeMaze(&ctx.ir);
-    if (ctx.agent.q_table.vals) free(ctx.agent.q_table.vals);
+    agentFreeQtable(&ctx.agent);
+    arenaFree(&g_train_arena);
 
     CloseWindow();
+    TRACE_SHUTDOWN();
     return 0;
 }
\ No newline at end of file
@@ -17,7 +17,9 @@
 #define MAZE_RENDER_IMPLEMENTATION
 #include "mazeRender.h"
 
+#define MAZE_GENERATION_IMPLEMENTATION
 #include "mazeGeneration.h"
+#undef MAZE_GENERATION_IMPLEMENTATION
 
 #define UI_IMPLEMENTATION
 #include "UI.h"